@@ -0,0 +1,87 @@
+#pragma once
+#include <Arduino.h>
+
+// Records actuator GPIO edges (pin, level, time) into a fixed ring buffer so a
+// scripted scenario can be captured over serial and diffed against a stored
+// trace after timing changes (tools/trace_replay). Writes go through write()
+// whether or not recording is on; only level changes are stored.
+//
+// Outputs driven by LEDC (feeder step train, buzzer) have no GPIO level to
+// write; their drivers record() the duty or tone frequency instead. Writers
+// run in loop() and the esp_timer task, so ring updates hold a spinlock.
+class ActuatorTrace {
+public:
+  static const uint16_t CAPACITY = 512;
+
+  struct Edge {
+    uint32_t tUs;   // Microseconds since start()
+    uint8_t  pin;
+    uint16_t level; // GPIO level, or LEDC duty / tone Hz
+  };
+
+  // Drive the pin and record the edge if tracing
+  void write(uint8_t pin, uint8_t level) {
+    digitalWrite(pin, level);
+    record(pin, level, micros());
+  }
+
+  // Record without driving anything: LEDC outputs, or an edge an ISR
+  // already made at atUs (micros())
+  void record(uint8_t pin, uint16_t level, uint32_t atUs) {
+    if (!_recording) return;
+    portENTER_CRITICAL(&_mux);
+    uint16_t& last = _lastLevel[pin & 63];
+    if (last != level) {
+      last = level;
+      _edges[_head] = { atUs - _startUs, pin, level };
+      _head = (_head + 1) % CAPACITY;
+      if (_count < CAPACITY) _count++;
+      else _dropped++;
+    }
+    portEXIT_CRITICAL(&_mux);
+  }
+  void record(uint8_t pin, uint16_t level) { record(pin, level, micros()); }
+
+  void start() {
+    portENTER_CRITICAL(&_mux);
+    _head = 0;
+    _count = 0;
+    _dropped = 0;
+    memset(_lastLevel, 0xFF, sizeof(_lastLevel));
+    _startUs = micros();
+    _recording = true;
+    portEXIT_CRITICAL(&_mux);
+  }
+
+  void stop() { _recording = false; }
+  bool isRecording() const { return _recording; }
+  uint16_t count() const { return _count; }
+  uint32_t dropped() const { return _dropped; }
+
+  // One "t_us,pin,level" line per edge, oldest first
+  void dump() {
+    portENTER_CRITICAL(&_mux);
+    uint16_t count = _count, first = (_head + CAPACITY - _count) % CAPACITY;
+    uint32_t dropped = _dropped;
+    portEXIT_CRITICAL(&_mux);
+
+    Serial.printf("# trace edges=%u dropped=%lu\n", count, (unsigned long)dropped);
+    for (uint16_t i = 0; i < count; i++) {
+      portENTER_CRITICAL(&_mux);
+      Edge e = _edges[(first + i) % CAPACITY];
+      portEXIT_CRITICAL(&_mux);
+      Serial.printf("%lu,%u,%u\n", (unsigned long)e.tUs, e.pin, e.level);
+    }
+    Serial.println("# end");
+  }
+
+private:
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+  Edge     _edges[CAPACITY];
+  uint16_t _lastLevel[64];
+  uint16_t _head{0};
+  uint16_t _count{0};
+  uint32_t _dropped{0};
+  uint32_t _startUs{0};
+  bool     _recording{false};
+};
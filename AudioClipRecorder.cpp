@@ -0,0 +1,232 @@
+#include "AudioClipRecorder.h"
+
+AudioClipRecorder::AudioClipRecorder(uint32_t preMs, uint32_t postMs, uint16_t sampleRate) {
+    this->sampleRate = sampleRate;
+    this->preSamples = preMs * sampleRate / 1000;
+    this->postSamples = postMs * sampleRate / 1000;
+
+    ring = nullptr;
+    ringSamples = 0;
+    written = 0;
+    inPsram = false;
+
+    state = IDLE;
+    clipStart = clipEnd = encodePos = 0;
+    triggerMs = 0;
+    nextId = 0;
+    triggerRequested = false;
+
+    clipsSaved = 0;
+    clipsDropped = 0;
+    triggersIgnored = 0;
+}
+
+bool AudioClipRecorder::begin() {
+    // Room for the whole clip plus slack for capture running ahead of encoding
+    uint32_t wanted = preSamples + postSamples + CLIP_CAPTURE_SLACK;
+
+    if (psramFound()) {
+        ring = (int16_t*)ps_malloc(wanted * sizeof(int16_t));
+        inPsram = ring != nullptr;
+    }
+    if (!ring) {
+        // Internal RAM only: shrink to ~1 s total, keeping the pre/post ratio
+        uint32_t maxSamples = sampleRate;
+        if (preSamples + postSamples > maxSamples) {
+            preSamples = (uint64_t)preSamples * maxSamples / (preSamples + postSamples);
+            postSamples = maxSamples - preSamples;
+        }
+        wanted = preSamples + postSamples + CLIP_CAPTURE_SLACK;
+        ring = (int16_t*)malloc(wanted * sizeof(int16_t));
+    }
+    if (!ring) {
+        Serial.println("AudioClipRecorder: no memory for ring buffer");
+        return false;
+    }
+    ringSamples = wanted;
+
+    if (!LittleFS.begin(true)) {
+        Serial.println("AudioClipRecorder: LittleFS mount failed");
+        return false;
+    }
+    if (!LittleFS.exists(CLIP_DIR)) LittleFS.mkdir(CLIP_DIR);
+
+    // Continue numbering after the newest stored clip
+    File dir = LittleFS.open(CLIP_DIR);
+    for (File f = dir.openNextFile(); f; f = dir.openNextFile()) {
+        int id = atoi(f.name() + (f.name()[0] == '/' ? strlen(CLIP_DIR) + 1 : 0));
+        if (id >= nextId) nextId = id + 1;
+    }
+
+    Serial.printf("AudioClipRecorder initialized (%lu+%lu samples, %s)\n",
+                  (unsigned long)preSamples, (unsigned long)postSamples,
+                  inPsram ? "PSRAM" : "internal RAM");
+    return true;
+}
+
+void AudioClipRecorder::pushSamples(const int16_t* pcm, size_t n) {
+    if (!ring) return;
+
+    uint32_t pos = written % ringSamples;
+    size_t first = min((size_t)(ringSamples - pos), n);
+    memcpy(ring + pos, pcm, first * sizeof(int16_t));
+    if (first < n) memcpy(ring, pcm + first, (n - first) * sizeof(int16_t));
+    written += n;
+}
+
+// May be called from the BLE task: only latches the request, update() acts on it
+bool AudioClipRecorder::trigger() {
+    if (!ring || state != IDLE || triggerRequested) {
+        triggersIgnored++;
+        return false;
+    }
+    triggerMs = millis();
+    triggerRequested = true;
+    return true;
+}
+
+void AudioClipRecorder::update() {
+    uint32_t captured = written;  // One snapshot; the capture task keeps adding
+
+    if (triggerRequested && state == IDLE) {
+        triggerRequested = false;
+        uint32_t pre = min(preSamples, captured);
+        clipStart = captured - pre;
+        clipEnd = captured + postSamples;
+        encodePos = clipStart;
+        adpcm = ImaAdpcmState();
+        state = WAIT_POST;
+    }
+
+    if (state == WAIT_POST && (int32_t)(captured - clipEnd) >= 0) {
+        state = openClipFile() ? ENCODING : IDLE;
+    }
+
+    if (state != ENCODING) return;
+
+    // The writer must not have lapped the samples still to be encoded, and
+    // must stay a chunk clear of them while this one is copied out. Read
+    // again: opening the file above can take a while.
+    if (written - encodePos > ringSamples - CLIP_ENCODE_PER_UPDATE) {
+        Serial.println("AudioClipRecorder: ring overrun, clip dropped");
+        finishClip(false);
+        return;
+    }
+
+    static uint8_t out[CLIP_ENCODE_PER_UPDATE / 2];
+    static int16_t chunk[CLIP_ENCODE_PER_UPDATE];
+
+    uint32_t n = min((uint32_t)CLIP_ENCODE_PER_UPDATE, clipEnd - encodePos) & ~1u;
+    uint32_t pos = encodePos % ringSamples;
+    uint32_t first = min(ringSamples - pos, n);
+    memcpy(chunk, ring + pos, first * sizeof(int16_t));
+    if (first < n) memcpy(chunk + first, ring, (n - first) * sizeof(int16_t));
+
+    imaAdpcmEncode(adpcm, chunk, n, out);
+    if (clipFile.write(out, n / 2) != n / 2) {
+        finishClip(false);
+        return;
+    }
+    encodePos += n;
+
+    if (clipEnd - encodePos < 2) finishClip(true);
+}
+
+bool AudioClipRecorder::openClipFile() {
+    pruneOldClips();
+    clipFile = LittleFS.open(clipPath(nextId), FILE_WRITE);
+    if (!clipFile) {
+        clipsDropped++;
+        return false;
+    }
+
+    ClipHeader h = {};
+    memcpy(h.magic, "BKC1", 4);
+    h.sampleRate = sampleRate;
+    h.samples = (clipEnd - clipStart) & ~1u;
+    h.triggerOffset = clipEnd - postSamples - clipStart;
+    h.timestampMs = triggerMs;
+    h.predictor = adpcm.predictor;
+    h.index = adpcm.index;
+    clipFile.write((const uint8_t*)&h, sizeof(h));
+    return true;
+}
+
+void AudioClipRecorder::finishClip(bool ok) {
+    if (clipFile) clipFile.close();
+    if (ok) {
+        clipsSaved++;
+        Serial.printf("🎙️  Bark clip %d saved\n", nextId);
+        nextId++;
+    } else {
+        clipsDropped++;
+        LittleFS.remove(clipPath(nextId));
+    }
+    state = IDLE;
+}
+
+// Ids are consecutive, so making room for nextId means dropping one clip
+void AudioClipRecorder::pruneOldClips() {
+    int oldest = nextId - CLIP_MAX_FILES;
+    if (oldest >= 0 && LittleFS.exists(clipPath(oldest))) LittleFS.remove(clipPath(oldest));
+}
+
+String AudioClipRecorder::clipPath(int id) {
+    return String(CLIP_DIR) + "/" + String(id) + ".bkc";
+}
+
+void AudioClipRecorder::listClips() {
+    Serial.println("\n🎙️  BARK CLIPS:");
+    for (int id = max(0, nextId - CLIP_MAX_FILES); id < nextId; id++) {
+        File f = LittleFS.open(clipPath(id), FILE_READ);
+        if (!f) continue;
+        ClipHeader h = {};
+        f.read((uint8_t*)&h, sizeof(h));
+        Serial.printf("   #%d  %lu samples @ %u Hz, t=%lu ms, %u bytes\n", id,
+                      (unsigned long)h.samples, h.sampleRate,
+                      (unsigned long)h.timestampMs, (unsigned)f.size());
+        f.close();
+    }
+    Serial.println();
+}
+
+// Raw file as hex, 32 bytes per line, framed for a host script to capture
+bool AudioClipRecorder::dumpClip(int id) {
+    File f = LittleFS.open(clipPath(id), FILE_READ);
+    if (!f) return false;
+
+    Serial.printf("# clip %d bytes=%u format=BKC1/ima-adpcm\n", id, (unsigned)f.size());
+    uint8_t buf[32];
+    char line[sizeof(buf) * 2 + 1];
+    int n;
+    while ((n = f.read(buf, sizeof(buf))) > 0) {
+        for (int i = 0; i < n; i++) sprintf(line + 2 * i, "%02x", buf[i]);
+        Serial.println(line);
+    }
+    Serial.println("# end");
+    f.close();
+    return true;
+}
+
+void AudioClipRecorder::clearClips() {
+    if (state == ENCODING) finishClip(false);
+    state = IDLE;
+    triggerRequested = false;
+    for (int id = max(0, nextId - 2 * CLIP_MAX_FILES); id < nextId; id++) {
+        LittleFS.remove(clipPath(id));
+    }
+}
+
+void AudioClipRecorder::getStatus(String& statusMsg) {
+    if (!ring) {
+        statusMsg = "Not available";
+        return;
+    }
+    const char* s = state == IDLE ? "idle" : (state == WAIT_POST ? "recording" : "saving");
+    statusMsg = String(s) + ", saved: " + String(clipsSaved) +
+                ", dropped: " + String(clipsDropped) +
+                ", busy-skipped: " + String(triggersIgnored) +
+                " (" + String((preSamples * 1000) / sampleRate) + "+" +
+                String((postSamples * 1000) / sampleRate) + " ms, " +
+                (inPsram ? "PSRAM" : "RAM") + ")";
+}
@@ -0,0 +1,90 @@
+#ifndef AUDIO_CLIP_RECORDER_H
+#define AUDIO_CLIP_RECORDER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <LittleFS.h>
+#include "ImaAdpcm.h"
+
+#define CLIP_DIR                 "/clips"
+#define CLIP_MAX_FILES           8      // Oldest clip is deleted beyond this
+#define CLIP_ENCODE_PER_UPDATE   1024   // Samples compressed per update() call
+#define CLIP_CAPTURE_SLACK       4096   // Ring space beyond the clip (256 ms of capture ahead of encoding)
+
+// On-flash clip layout: ClipHeader followed by IMA ADPCM data
+struct __attribute__((packed)) ClipHeader {
+    char     magic[4];        // "BKC1"
+    uint16_t sampleRate;
+    uint16_t reserved;
+    uint32_t samples;
+    uint32_t triggerOffset;   // Sample index of the bark within the clip
+    uint32_t timestampMs;     // millis() at the trigger
+    int16_t  predictor;       // Initial ADPCM state
+    uint8_t  index;
+    uint8_t  pad;
+};
+
+// Keeps the last few seconds of microphone audio in a (PSRAM if present)
+// ring buffer. On trigger it waits for the post-trigger audio, then
+// compresses the clip to flash a chunk at a time from update(), so capture
+// (pushSamples, in the mic capture task) never waits on encoding or flash
+// writes.
+class AudioClipRecorder {
+public:
+    // Constructor
+    AudioClipRecorder(uint32_t preMs = 2000, uint32_t postMs = 1000, uint16_t sampleRate = 16000);
+
+    // Setup functions
+    bool begin();
+
+    // Capture path: call for every PCM block (memcpy only; single writer task)
+    void pushSamples(const int16_t* pcm, size_t n);
+
+    // Main loop function (trigger handling, incremental encode + write)
+    void update();
+
+    // Control functions
+    bool trigger();              // Latch a clip; false if busy or not ready
+    void listClips();
+    bool dumpClip(int id);       // Hex dump over serial
+    void clearClips();
+    void getStatus(String& statusMsg);
+
+private:
+    enum State { IDLE, WAIT_POST, ENCODING };
+
+    // Config
+    uint32_t preSamples;
+    uint32_t postSamples;
+    uint16_t sampleRate;
+
+    // Ring buffer (positions are running sample counts, wrap-safe)
+    int16_t* ring;
+    uint32_t ringSamples;
+    volatile uint32_t written;  // Advanced by the capture task after each copy
+    bool inPsram;
+
+    // Clip in progress
+    State state;
+    uint32_t clipStart;
+    uint32_t clipEnd;
+    uint32_t encodePos;
+    uint32_t triggerMs;
+    ImaAdpcmState adpcm;
+    File clipFile;
+    int nextId;
+    volatile bool triggerRequested;
+
+    // Stats
+    unsigned long clipsSaved;
+    unsigned long clipsDropped;
+    unsigned long triggersIgnored;
+
+    // Internal functions
+    bool openClipFile();
+    void finishClip(bool ok);
+    void pruneOldClips();
+    String clipPath(int id);
+};
+
+#endif
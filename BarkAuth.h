@@ -0,0 +1,343 @@
+#pragma once
+#include <Arduino.h>
+#include <Preferences.h>
+#include "SipHash.h"
+
+// Authenticated bark advertisements.
+//
+// A paired sensor puts a BarkAdvPayload in its manufacturer data: sensor ID,
+// a sequence number it never reuses (kept in its NVS) and its timestamp,
+// followed by SipHash-2-4 over those fields with the sensor's 128-bit key,
+// truncated to 64 bits. Checks run cheapest first (length, company ID, tag,
+// sensor lookup) so foreign packets are dropped before any hashing; the MAC
+// starts from a key state prepared at pairing and is compared in constant
+// time. A sequence number not above the last accepted one is a replay (or a
+// repeat of the same burst) and is dropped.
+//
+// Sensors send each bark as a burst of adverts with one sequence number, so
+// the same counters also measure reception: repeats of the last number are
+// extra copies of a bark already heard, and a jump of more than one means
+// barks the scanner missed. Jumps over BARK_AUTH_MAX_GAP are counted as an
+// outage (sensor off or out of range) instead, and resyncSeqs() makes the
+// next bark of every sensor start fresh after the scanner was stopped.
+//
+// The last accepted sequence of each sensor outlives a restart, or every
+// recorded advert would be accepted once after it: the sketch hands begin()
+// a BarkAuthRtc in RTC memory, which verify() keeps exact through deep sleep
+// and resets, and persistSeqs() copies it to NVS at most every
+// BARK_AUTH_SEQ_SAVE_MS for power loss. Only adverts accepted in that last
+// stretch before a power cut can be replayed once.
+//
+// verify() runs in the BLE task; pairing and persistSeqs() run from loop().
+// A slot is only marked valid after its key state is written.
+
+#define BARK_AUTH_COMPANY_ID   0xFFFF   // "No company" ID reserved for testing/internal use
+#define BARK_AUTH_TAG0         'B'
+#define BARK_AUTH_TAG1         'K'
+#define BARK_AUTH_MAX_SENSORS  8
+#define BARK_AUTH_MAX_GAP      32       // Larger sequence jumps are outages, not misses
+#define BARK_AUTH_SEQ_SAVE_MS  60000    // NVS copy of the last sequences at most this often
+#define BARK_AUTH_RTC_MAGIC    0x42415351UL
+
+struct __attribute__((packed)) BarkAdvPayload {
+  uint16_t companyId;   // BARK_AUTH_COMPANY_ID
+  char     tag[2];      // "BK"
+  uint16_t sensorId;
+  uint32_t seq;
+  uint32_t timestamp;   // Sensor clock (s); covered by the MAC, not checked
+  uint8_t  mac[8];      // SipHash-2-4 over all fields above
+};
+
+// Last accepted sequence of a sensor (NVS "seqs", RTC copy)
+struct BarkAuthSeq {
+  uint16_t id;
+  uint8_t  valid;
+  uint32_t seq;
+};
+
+// Kept by the sketch in RTC_DATA_ATTR memory; one entry per slot
+struct BarkAuthRtc {
+  uint32_t    magic;
+  BarkAuthSeq seqs[BARK_AUTH_MAX_SENSORS];
+};
+
+enum BarkAuthResult : uint8_t {
+  BARK_AUTH_OK = 0,
+  BARK_AUTH_NOT_OURS,        // Not a BarkAdvPayload at all
+  BARK_AUTH_UNKNOWN_SENSOR,
+  BARK_AUTH_BAD_MAC,
+  BARK_AUTH_REPLAY,
+  BARK_AUTH_RESULT_COUNT
+};
+
+class BarkAuth {
+public:
+  explicit BarkAuth(const char* nvsNamespace = "barkKeys") : _ns(nvsNamespace) {}
+
+  // rtc: the sketch's RTC-resident sequence copy (nullptr = NVS only)
+  void begin(BarkAuthRtc* rtc = nullptr) {
+    _rtc = rtc;
+    if (_rtc && _rtc->magic != BARK_AUTH_RTC_MAGIC) {
+      memset(_rtc, 0, sizeof(*_rtc));  // Power-on: nothing kept
+      _rtc->magic = BARK_AUTH_RTC_MAGIC;
+    }
+    _prefs.begin(_ns, false);
+    StoredSensor stored[BARK_AUTH_MAX_SENSORS];
+    size_t n = _prefs.getBytes("sensors", stored, sizeof(stored)) / sizeof(StoredSensor);
+    for (size_t i = 0; i < n; i++) _install(stored[i].id, stored[i].key);
+    _restoreSeqs();
+  }
+
+  // Add or re-key a sensor (resets its replay state)
+  bool pair(uint16_t sensorId, const uint8_t key[16]) {
+    if (!_install(sensorId, key)) return false;
+    _forgetRtcSeq(sensorId);
+    _save();
+    _saveSeqs();
+    return true;
+  }
+
+  bool unpair(uint16_t sensorId) {
+    Slot* s = _find(sensorId);
+    if (!s) return false;
+    s->valid = false;
+    memset(s->rawKey, 0, sizeof(s->rawKey));
+    _forgetRtcSeq(sensorId);
+    _save();
+    _saveSeqs();
+    return true;
+  }
+
+  // loop(): write the sequences accepted since the last save to NVS, at most
+  // every BARK_AUTH_SEQ_SAVE_MS unless forced (before deep sleep)
+  void persistSeqs(uint32_t nowMs, bool force = false) {
+    if (!_seqsDirty || (!force && nowMs - _seqsSavedMs < BARK_AUTH_SEQ_SAVE_MS)) return;
+    _seqsSavedMs = nowMs;
+    _saveSeqs();
+  }
+
+  // BLE task. On BARK_AUTH_OK, sensorId/seq identify the accepted packet.
+  BarkAuthResult verify(const uint8_t* data, size_t len, uint16_t& sensorId, uint32_t& seq) {
+    if (len != sizeof(BarkAdvPayload)) return _count(BARK_AUTH_NOT_OURS);
+    BarkAdvPayload p;
+    memcpy(&p, data, sizeof(p));
+    if (p.companyId != BARK_AUTH_COMPANY_ID || p.tag[0] != BARK_AUTH_TAG0 || p.tag[1] != BARK_AUTH_TAG1) {
+      return _count(BARK_AUTH_NOT_OURS);
+    }
+
+    Slot* s = _find(p.sensorId);
+    if (!s) return _count(BARK_AUTH_UNKNOWN_SENSOR);
+
+    uint64_t mac = sipHash24(s->key, data, offsetof(BarkAdvPayload, mac));
+    if (!macEqual(mac, p.mac)) {
+      s->rejected++;
+      return _count(BARK_AUTH_BAD_MAC);
+    }
+    if (s->haveSeq && p.seq == s->lastSeq) {
+      s->repeats++;
+      return _count(BARK_AUTH_REPLAY);
+    }
+    if (s->haveSeq && (int32_t)(p.seq - s->lastSeq) < 0) return _count(BARK_AUTH_REPLAY);
+
+    if (s->haveSeq && !s->resync) {
+      uint32_t gap = p.seq - s->lastSeq - 1;
+      if (gap <= BARK_AUTH_MAX_GAP) s->missed += gap;
+      else s->outages++;
+    }
+    s->resync = false;
+    s->lastSeq = p.seq;
+    s->haveSeq = true;
+    if (_rtc) _rtc->seqs[s - _slots] = {s->id, 1, p.seq};
+    _seqsDirty = true;
+    s->accepted++;
+    sensorId = p.sensorId;
+    seq = p.seq;
+    return _count(BARK_AUTH_OK);
+  }
+
+  // Build a signed payload (sensor firmware, host tools, console self-test)
+  static void sign(const uint8_t key[16], uint16_t sensorId, uint32_t seq, uint32_t timestamp,
+                   BarkAdvPayload& out) {
+    out.companyId = BARK_AUTH_COMPANY_ID;
+    out.tag[0] = BARK_AUTH_TAG0;
+    out.tag[1] = BARK_AUTH_TAG1;
+    out.sensorId = sensorId;
+    out.seq = seq;
+    out.timestamp = timestamp;
+    SipHashKey k;
+    sipHashPrepare(key, k);
+    uint64_t mac = sipHash24(k, (const uint8_t*)&out, offsetof(BarkAdvPayload, mac));
+    for (int i = 0; i < 8; i++) out.mac[i] = (uint8_t)(mac >> (8 * i));
+  }
+
+  // Constant time: every byte is compared whatever the first mismatch
+  static bool macEqual(uint64_t mac, const uint8_t* tag) {
+    uint8_t diff = 0;
+    for (int i = 0; i < 8; i++) diff |= (uint8_t)(mac >> (8 * i)) ^ tag[i];
+    return diff == 0;
+  }
+
+  bool hasSensors() const {
+    for (const Slot& s : _slots) if (s.valid) return true;
+    return false;
+  }
+
+  // loop(): the scanner was off; gaps up to each sensor's next bark are not misses
+  void resyncSeqs() {
+    for (Slot& s : _slots) s.resync = true;
+  }
+
+  // Totals over the paired sensors (barks heard, barks missed, copies of the
+  // barks heard including the first)
+  void receptionTotals(uint32_t& heard, uint32_t& missed, uint32_t& copies) const {
+    heard = missed = copies = 0;
+    for (const Slot& s : _slots) {
+      if (!s.valid) continue;
+      heard += s.accepted;
+      missed += s.missed;
+      copies += s.accepted + s.repeats;
+    }
+  }
+
+  uint32_t resultCount(BarkAuthResult r) const { return r < BARK_AUTH_RESULT_COUNT ? _results[r] : 0; }
+
+  static const char* resultName(BarkAuthResult r) {
+    switch (r) {
+      case BARK_AUTH_OK:             return "ok";
+      case BARK_AUTH_NOT_OURS:       return "foreign";
+      case BARK_AUTH_UNKNOWN_SENSOR: return "unknown sensor";
+      case BARK_AUTH_BAD_MAC:        return "bad MAC";
+      case BARK_AUTH_REPLAY:         return "replay";
+      default:                       return "?";
+    }
+  }
+
+  void printSensors() const {
+    Serial.println("\n🔑 PAIRED SENSORS:");
+    bool any = false;
+    for (const Slot& s : _slots) {
+      if (!s.valid) continue;
+      any = true;
+      Serial.printf("   #%u accepted %lu, bad MAC %lu, last seq %lu\n", s.id,
+                    (unsigned long)s.accepted, (unsigned long)s.rejected, (unsigned long)s.lastSeq);
+      uint32_t barks = s.accepted + s.missed;
+      Serial.printf("      missed %lu (%.1f%%), %.1f copies/bark, outages %lu\n", (unsigned long)s.missed,
+                    barks ? 100.0 * s.missed / barks : 0.0,
+                    s.accepted ? (double)(s.accepted + s.repeats) / s.accepted : 0.0,
+                    (unsigned long)s.outages);
+    }
+    if (!any) Serial.println("   (none - legacy name/tag adverts accepted)");
+    Serial.print("   Results:");
+    for (uint8_t r = 0; r < BARK_AUTH_RESULT_COUNT; r++) {
+      Serial.printf(" %s=%lu", resultName((BarkAuthResult)r), (unsigned long)_results[r]);
+    }
+    Serial.println("\n");
+  }
+
+private:
+  struct StoredSensor {
+    uint16_t id;
+    uint8_t  key[16];
+  };
+
+  struct Slot {
+    volatile bool valid;
+    uint16_t   id;
+    SipHashKey key;          // Prepared at pairing
+    uint8_t    rawKey[16];   // Kept only to persist
+    uint32_t   lastSeq;
+    bool       haveSeq;
+    uint32_t   accepted;
+    uint32_t   rejected;
+    uint32_t   repeats;      // Extra copies of an accepted bark
+    uint32_t   missed;       // Sequence numbers skipped
+    uint32_t   outages;      // Skips over BARK_AUTH_MAX_GAP
+    volatile bool resync;
+  };
+
+  Slot* _find(uint16_t id) {
+    for (Slot& s : _slots) if (s.valid && s.id == id) return &s;
+    return nullptr;
+  }
+
+  bool _install(uint16_t id, const uint8_t key[16]) {
+    Slot* s = _find(id);
+    if (s) {
+      s->valid = false;  // Re-key: hide the slot while it changes
+    } else {
+      for (Slot& f : _slots) if (!f.valid) { s = &f; break; }
+      if (!s) return false;
+    }
+    s->id = id;
+    sipHashPrepare(key, s->key);
+    memcpy(s->rawKey, key, 16);
+    s->lastSeq = 0;
+    s->haveSeq = false;
+    s->accepted = s->rejected = 0;
+    s->repeats = s->missed = s->outages = 0;
+    s->resync = false;
+    s->valid = true;  // Publish last
+    return true;
+  }
+
+  // Resume each sensor after its last accepted sequence, whichever of the
+  // RTC and NVS copies is later (RTC is exact unless power was lost)
+  void _restoreSeqs() {
+    BarkAuthSeq saved[BARK_AUTH_MAX_SENSORS];
+    size_t n = _prefs.getBytes("seqs", saved, sizeof(saved)) / sizeof(BarkAuthSeq);
+    for (Slot& s : _slots) {
+      if (!s.valid) continue;
+      for (size_t i = 0; i < n + (_rtc ? BARK_AUTH_MAX_SENSORS : 0); i++) {
+        const BarkAuthSeq& e = i < n ? saved[i] : _rtc->seqs[i - n];
+        if (!e.valid || e.id != s.id) continue;
+        if (!s.haveSeq || (int32_t)(e.seq - s.lastSeq) > 0) s.lastSeq = e.seq;
+        s.haveSeq = true;
+        s.resync = true;  // Barks sent while we were down are not misses
+      }
+      if (_rtc) _rtc->seqs[&s - _slots] = {s.id, (uint8_t)s.haveSeq, s.lastSeq};
+    }
+  }
+
+  void _forgetRtcSeq(uint16_t id) {
+    if (!_rtc) return;
+    for (BarkAuthSeq& e : _rtc->seqs) if (e.id == id) e.valid = 0;
+  }
+
+  void _saveSeqs() {
+    _seqsDirty = false;  // Before reading: a bark accepted meanwhile saves next time
+    BarkAuthSeq seqs[BARK_AUTH_MAX_SENSORS];
+    size_t n = 0;
+    for (const Slot& s : _slots) {
+      if (!s.valid || !s.haveSeq) continue;
+      seqs[n++] = {s.id, 1, s.lastSeq};
+    }
+    if (n) _prefs.putBytes("seqs", seqs, n * sizeof(BarkAuthSeq));
+    else _prefs.remove("seqs");
+  }
+
+  void _save() {
+    StoredSensor stored[BARK_AUTH_MAX_SENSORS];
+    size_t n = 0;
+    for (const Slot& s : _slots) {
+      if (!s.valid) continue;
+      stored[n].id = s.id;
+      memcpy(stored[n].key, s.rawKey, 16);
+      n++;
+    }
+    if (n) _prefs.putBytes("sensors", stored, n * sizeof(StoredSensor));
+    else _prefs.remove("sensors");
+  }
+
+  BarkAuthResult _count(BarkAuthResult r) {
+    _results[r]++;
+    return r;
+  }
+
+  const char* _ns;
+  Preferences _prefs;
+  BarkAuthRtc* _rtc{nullptr};
+  volatile bool _seqsDirty{false};
+  uint32_t _seqsSavedMs{0};
+  Slot _slots[BARK_AUTH_MAX_SENSORS]{};
+  uint32_t _results[BARK_AUTH_RESULT_COUNT]{};
+};
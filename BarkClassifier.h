@@ -0,0 +1,143 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Compact int8 bark classifier run only on energy-gated candidate blocks.
+//
+// Features (int8, log2 in Q3 = 0.75 dB per unit):
+//   [0..7] spectral shape: log band power minus mean over 8 Goertzel bands
+//   [8]    loudness over the noise floor
+//   [9]    onset slope: last candidate block vs first (slams decay fast)
+// Model: 10 -> 8 ReLU -> 1, int8 weights, int32 accumulators, bark if > 0.
+//
+// Weights are a table so a trained export can replace them. The defaults are
+// hand-set detectors (harmonic peaks in the bark band, low thump, hiss, fast
+// decay), not a trained model, so the classifier is off by default until
+// BARK_CLS_MODEL_TRAINED is set alongside an export that tools/bark_eval has
+// checked on labelled recordings.
+// At ~100 MACs per inference the cost is dominated by the Goertzel bands, so
+// there is only a portable scalar kernel.
+#define BARK_CLS_BANDS     8
+#define BARK_CLS_FEATURES  (BARK_CLS_BANDS + 2)
+#define BARK_CLS_HIDDEN    8
+#define BARK_CLS_SHIFT1    4   // Hidden layer requantization shift
+#define BARK_CLS_MODEL_TRAINED  0   // BARK_CLS_DEFAULT_MODEL is hand-set
+
+struct BarkClassifierModel {
+  int8_t  w1[BARK_CLS_HIDDEN][BARK_CLS_FEATURES];
+  int16_t b1[BARK_CLS_HIDDEN];
+  int8_t  w2[BARK_CLS_HIDDEN];
+  int16_t b2;
+};
+
+// Band centres: 250, 400, 600, 900, 1300, 1900, 2800, 4000 Hz
+static const BarkClassifierModel BARK_CLS_DEFAULT_MODEL = {
+  {
+    //  250  400  600  900 1300 1900 2800 4000  snr slope
+    {   0,  16,   0,   0,   0,   0,   0,   0,   0,   0 },  // harmonic peak 400 Hz
+    {   0,   0,  16,   0,   0,   0,   0,   0,   0,   0 },  // harmonic peak 600 Hz
+    {   0,   0,   0,  16,   0,   0,   0,   0,   0,   0 },  // harmonic peak 900 Hz
+    {   0,   0,   0,   0,  16,   0,   0,   0,   0,   0 },  // harmonic peak 1300 Hz
+    {  16,   0,  -8,  -8,  -8,   0,   0,   0,   0,   0 },  // low thump
+    {   0,  -8,  -8,  -8,   0,   8,  16,  16,   0,   0 },  // hiss / broadband high
+    {   0,   0,   0,   0,   0,   0,   0,   0,   0, -16 },  // fast decay
+    {   0 },
+  },
+  // Peak units only fire 20 units (~15 dB) above the mean band level
+  { -320, -320, -320, -320, -160, 0, 0, 0 },
+  { 4, 4, 4, 4, -4, -3, -3, 0 },
+  -16,
+};
+
+// Goertzel coefficients 2*cos(2*pi*f/16000) in Q14 for the band centres above
+static const int32_t BARK_CLS_COEFF_Q14[BARK_CLS_BANDS] = {
+  32610, 32365, 31863, 30743, 28590, 24062, 14876, 0
+};
+
+class BarkClassifier {
+public:
+  explicit BarkClassifier(const BarkClassifierModel* model = &BARK_CLS_DEFAULT_MODEL)
+    : _model(model) {}
+
+  void setModel(const BarkClassifierModel* model) { _model = model; }
+
+  // Start a new candidate event
+  void begin() {
+    for (int b = 0; b < BARK_CLS_BANDS; b++) _bandPower[b] = 0;
+    _blocks = 0;
+    _firstEnergyQ3 = _lastEnergyQ3 = 0;
+  }
+
+  // Accumulate one gated block into the band powers
+  void addBlock(const int16_t* x, size_t n, uint32_t blockEnergy) {
+    for (int b = 0; b < BARK_CLS_BANDS; b++) {
+      int32_t c = BARK_CLS_COEFF_Q14[b];
+      int32_t s1 = 0, s2 = 0;
+      for (size_t i = 0; i < n; i++) {
+        int32_t s0 = x[i] + (int32_t)(((int64_t)c * s1) >> 14) - s2;
+        s2 = s1;
+        s1 = s0;
+      }
+      int64_t p = (int64_t)s1 * s1 + (int64_t)s2 * s2 - ((((int64_t)c * s1) >> 14) * s2);
+      _bandPower[b] += p > 0 ? (uint64_t)p : 0;
+    }
+
+    int16_t eq3 = log2Q3(blockEnergy);
+    if (_blocks == 0) _firstEnergyQ3 = eq3;
+    _lastEnergyQ3 = eq3;
+    _blocks++;
+  }
+
+  // Run the network on what has been accumulated; true = bark
+  bool classify(uint32_t noiseFloor) {
+    if (_blocks == 0) return false;
+
+    int16_t logBand[BARK_CLS_BANDS];
+    int32_t mean = 0;
+    for (int b = 0; b < BARK_CLS_BANDS; b++) {
+      logBand[b] = log2Q3(_bandPower[b]);
+      mean += logBand[b];
+    }
+    mean /= BARK_CLS_BANDS;
+
+    int8_t* f = _features;
+    for (int b = 0; b < BARK_CLS_BANDS; b++) f[b] = clampS8(logBand[b] - mean);
+    f[BARK_CLS_BANDS]     = clampS8(_lastEnergyQ3 - log2Q3(noiseFloor));
+    f[BARK_CLS_BANDS + 1] = clampS8(_lastEnergyQ3 - _firstEnergyQ3);
+
+    int32_t out = _model->b2;
+    for (int j = 0; j < BARK_CLS_HIDDEN; j++) {
+      int32_t acc = _model->b1[j];
+      for (int i = 0; i < BARK_CLS_FEATURES; i++) acc += (int32_t)_model->w1[j][i] * f[i];
+      acc >>= BARK_CLS_SHIFT1;
+      if (acc < 0) acc = 0;
+      if (acc > 127) acc = 127;
+      out += (int32_t)_model->w2[j] * acc;
+    }
+    _lastScore = out;
+    return out > 0;
+  }
+
+  int32_t lastScore() const { return _lastScore; }
+  const int8_t* lastFeatures() const { return _features; }
+  uint8_t blocks() const { return _blocks; }
+
+  // log2(v) in Q3; 0 for v == 0
+  static int16_t log2Q3(uint64_t v) {
+    if (v == 0) return 0;
+    int msb = 63 - __builtin_clzll(v);
+    uint32_t frac = (msb >= 3) ? (uint32_t)(v >> (msb - 3)) : (uint32_t)(v << (3 - msb));
+    return (int16_t)(msb * 8 + (frac & 7));
+  }
+
+private:
+  static int8_t clampS8(int32_t v) { return (int8_t)(v < -128 ? -128 : (v > 127 ? 127 : v)); }
+
+  const BarkClassifierModel* _model;
+  uint64_t _bandPower[BARK_CLS_BANDS]{};
+  int8_t   _features[BARK_CLS_FEATURES]{};
+  int16_t  _firstEnergyQ3{0};
+  int16_t  _lastEnergyQ3{0};
+  uint8_t  _blocks{0};
+  int32_t  _lastScore{0};
+};
@@ -0,0 +1,144 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include "BarkClassifier.h"
+
+// Fixed-point streaming bark front end: energy gate against an adaptive noise
+// floor, then a three-band energy split (one-pole filters) to tell bark-like
+// sound from low thumps and hiss. With the classifier enabled (off until a
+// trained model is in BarkClassifier.h), gated blocks are the candidates and
+// BarkClassifier makes the final call. No Arduino dependencies, so the same
+// code builds on the host and can be fed from WAV files.
+//
+// Energies are mean squares in (int16 sample)^2 / 256 units.
+struct BarkDspConfig {
+  uint8_t  gateRatio     = 8;     // Block energy must exceed noise floor x this (~9 dB)
+  uint32_t minEnergy     = 2000;  // Absolute gate floor (~700 peak amplitude)
+  uint8_t  midPercentMin = 45;    // Mid band share of band energy to count as bark-like
+  uint8_t  onsetBlocks   = 2;     // Consecutive bark-like blocks before firing
+  uint8_t  releaseBlocks = 6;     // Gate-closed blocks before the next bark can fire
+  bool     useClassifier = BARK_CLS_MODEL_TRAINED;  // false = mid-band share rule only
+};
+
+struct BarkFeatures {
+  uint32_t energy;      // Whole block
+  uint32_t lowEnergy;   // Below ~300 Hz (at 16 kHz)
+  uint32_t midEnergy;   // ~300-2000 Hz
+  uint32_t highEnergy;  // Above ~2000 Hz
+  bool     gateOpen;
+  bool     barkLike;
+};
+
+class BarkDsp {
+public:
+  // One-pole coefficients (Q15) for 16 kHz: 1 - exp(-2*pi*fc/fs)
+  static const int32_t ALPHA_LOW_Q15 = 3640;    // fc ~300 Hz
+  static const int32_t ALPHA_HIGH_Q15 = 17860;  // fc ~2000 Hz
+
+  explicit BarkDsp(const BarkDspConfig& cfg = BarkDspConfig()) : _cfg(cfg) {}
+
+  // Process one block of samples; returns true on a bark onset.
+  // Cost is a fixed handful of multiplies per sample.
+  bool processBlock(const int16_t* x, size_t n) {
+    if (n == 0) return false;
+
+    uint64_t eAll = 0, eLow = 0, eMid = 0, eHigh = 0;
+    for (size_t i = 0; i < n; i++) {
+      int32_t s = x[i];
+      _lpLow  += (int32_t)(((int64_t)ALPHA_LOW_Q15  * (s - _lpLow))  >> 15);
+      _lpHigh += (int32_t)(((int64_t)ALPHA_HIGH_Q15 * (s - _lpHigh)) >> 15);
+      // Band magnitudes fit in 16 bits unsigned, so squares fit in uint32
+      uint32_t all  = (uint32_t)abs(s);
+      uint32_t low  = (uint32_t)abs(_lpLow);
+      uint32_t mid  = (uint32_t)abs(_lpHigh - _lpLow);
+      uint32_t high = (uint32_t)abs(s - _lpHigh);
+      eAll  += (all * all) >> 8;
+      eLow  += (low * low) >> 8;
+      eMid  += (mid * mid) >> 8;
+      eHigh += (high * high) >> 8;
+    }
+
+    BarkFeatures& f = _features;
+    f.energy = (uint32_t)(eAll / n);
+    f.lowEnergy = (uint32_t)(eLow / n);
+    f.midEnergy = (uint32_t)(eMid / n);
+    f.highEnergy = (uint32_t)(eHigh / n);
+
+    if (!_floorValid) {
+      _noiseFloor = f.energy;
+      _floorValid = true;
+    }
+
+    f.gateOpen = f.energy > _cfg.minEnergy && f.energy / _cfg.gateRatio > _noiseFloor;
+
+    uint64_t bandTotal = (uint64_t)f.lowEnergy + f.midEnergy + f.highEnergy;
+    f.barkLike = f.gateOpen && bandTotal > 0 &&
+                 (uint64_t)f.midEnergy * 100 >= (uint64_t)_cfg.midPercentMin * bandTotal;
+
+    // Floor falls fast, rises slowly while quiet and barely at all while the
+    // gate is open (so a long bark does not raise the bar for the next one)
+    if (f.energy < _noiseFloor) {
+      _noiseFloor -= (_noiseFloor - f.energy) >> 2;
+    } else {
+      _noiseFloor += (f.energy - _noiseFloor) >> (f.gateOpen ? 10 : 5);
+    }
+    if (_noiseFloor < 1) _noiseFloor = 1;
+
+    // The classifier only sees candidate blocks of an armed event, so it
+    // costs nothing while quiet and at most onsetBlocks blocks per event
+    bool candidate = _cfg.useClassifier ? f.gateOpen : f.barkLike;
+    bool fired = false;
+    if (candidate) {
+      if (_onsetCount < 255) _onsetCount++;
+      if (_armed && _cfg.useClassifier) {
+        if (_onsetCount == 1) _classifier.begin();
+        _classifier.addBlock(x, n, f.energy);
+      }
+      if (_armed && _onsetCount >= _cfg.onsetBlocks) {
+        _armed = false;
+        fired = !_cfg.useClassifier || _classifier.classify(_noiseFloor);
+        if (_cfg.useClassifier) _classifierRuns++;
+      }
+    } else {
+      _onsetCount = 0;
+    }
+
+    if (f.gateOpen) {
+      _releaseCount = 0;
+    } else if (!_armed && ++_releaseCount >= _cfg.releaseBlocks) {
+      _armed = true;
+    }
+
+    return fired;
+  }
+
+  void reset() {
+    _lpLow = _lpHigh = 0;
+    _noiseFloor = 0;
+    _floorValid = false;
+    _onsetCount = _releaseCount = 0;
+    _armed = true;
+    _features = BarkFeatures();
+  }
+
+  const BarkFeatures& lastFeatures() const { return _features; }
+  uint32_t noiseFloor() const { return _noiseFloor; }
+  BarkDspConfig& config() { return _cfg; }
+  BarkClassifier& classifier() { return _classifier; }
+  uint32_t classifierRuns() const { return _classifierRuns; }
+
+private:
+  BarkDspConfig _cfg;
+  BarkFeatures  _features{};
+  BarkClassifier _classifier;
+  uint32_t _classifierRuns{0};
+
+  int32_t  _lpLow{0};
+  int32_t  _lpHigh{0};
+  uint32_t _noiseFloor{0};
+  bool     _floorValid{false};
+  uint8_t  _onsetCount{0};
+  uint8_t  _releaseCount{0};
+  bool     _armed{true};
+};
@@ -0,0 +1,168 @@
+#pragma once
+#include <Arduino.h>
+
+enum BarkSource : uint8_t { BARK_SRC_BLE = 0, BARK_SRC_MIC, BARK_SRC_COUNT };
+
+enum FusionPolicy : uint8_t {
+  FUSION_ANY = 0,   // Any single source is enough (no added latency)
+  FUSION_ALL,       // Every enabled source must report within the alignment window
+  FUSION_WEIGHTED   // Sum of reporting source weights must reach the threshold
+};
+
+// Correlates bark reports from several sources inside a short alignment
+// window. report() may be called from any task (one slot per source, under
+// a spinlock shared with update()); update() runs in loop() and returns true
+// once per fused bark. A report waits at most alignWindowMs before it is
+// accepted or dropped. Sources that are switched off (setSourceEnabled) are
+// not waited for under FUSION_ALL.
+class BarkFusion {
+public:
+  struct SourceStats {
+    uint32_t reported;     // Reports seen
+    uint32_t confirmed;    // Accepted together with another source
+    uint32_t solo;         // Accepted on its own
+    uint32_t unconfirmed;  // Expired without enough support (dropped)
+  };
+
+  BarkFusion(FusionPolicy policy = FUSION_ANY, uint32_t alignWindowMs = 60)
+    : _policy(policy), _windowMs(alignWindowMs) {
+    for (uint8_t s = 0; s < BARK_SRC_COUNT; s++) _weight[s] = 60;
+  }
+
+  void report(BarkSource src, uint32_t nowMs) {
+    if (src >= BARK_SRC_COUNT) return;
+    portENTER_CRITICAL(&_mux);
+    _reportMs[src] = nowMs;
+    _pending[src] = true;
+    _stats[src].reported++;
+    portEXIT_CRITICAL(&_mux);
+  }
+
+  bool update(uint32_t nowMs) {
+    portENTER_CRITICAL(&_mux);
+    bool fused = _update(nowMs);
+    portEXIT_CRITICAL(&_mux);
+    return fused;
+  }
+
+  void setPolicy(FusionPolicy p) { _policy = p; }
+  FusionPolicy policy() const { return _policy; }
+  void setWindow(uint32_t ms) { _windowMs = ms; }
+  uint32_t window() const { return _windowMs; }
+  void setWeight(BarkSource src, uint8_t w) { if (src < BARK_SRC_COUNT) _weight[src] = w; }
+  uint8_t weight(BarkSource src) const { return src < BARK_SRC_COUNT ? _weight[src] : 0; }
+  void setThreshold(uint16_t t) { _threshold = t; }
+  uint16_t threshold() const { return _threshold; }
+  // A source that cannot report (e.g. the mic is off or failed to start)
+  void setSourceEnabled(BarkSource src, bool on) {
+    if (src >= BARK_SRC_COUNT) return;
+    if (on) _enabled |= (1 << src);
+    else _enabled &= ~(1 << src);
+  }
+  bool sourceEnabled(BarkSource src) const { return src < BARK_SRC_COUNT && (_enabled & (1 << src)); }
+
+  const SourceStats& stats(BarkSource src) const { return _stats[src]; }
+  uint32_t fusedCount() const { return _fused; }
+  bool hasPending() const {
+    for (uint8_t s = 0; s < BARK_SRC_COUNT; s++) if (_pending[s]) return true;
+    return false;
+  }
+  uint8_t lastSources() const { return _lastGroup; }  // Bit per BarkSource
+  uint32_t lastLatencyMs() const { return _lastLatencyMs; }
+  uint32_t maxLatencyMs() const { return _maxLatencyMs; }
+
+  static const char* policyName(FusionPolicy p) {
+    return p == FUSION_ALL ? "all" : (p == FUSION_WEIGHTED ? "weighted" : "any");
+  }
+  static const char* sourceName(BarkSource s) {
+    return s == BARK_SRC_BLE ? "BLE" : "Mic";
+  }
+
+  void resetStats() {
+    portENTER_CRITICAL(&_mux);
+    memset(_stats, 0, sizeof(_stats));
+    _fused = 0;
+    _lastLatencyMs = _maxLatencyMs = 0;
+    portEXIT_CRITICAL(&_mux);
+  }
+
+private:
+  bool _update(uint32_t nowMs) {
+    bool any = false;
+    uint8_t first = BARK_SRC_COUNT;
+    for (uint8_t s = 0; s < BARK_SRC_COUNT; s++) {
+      if (!_pending[s]) continue;
+      any = true;
+
+      // Late partner of a bark that was already accepted: absorb it
+      if (_hasAccepted && _reportMs[s] - _lastAcceptedMs <= _windowMs) {
+        _pending[s] = false;
+        _stats[s].confirmed++;
+        continue;
+      }
+      if (first == BARK_SRC_COUNT || (int32_t)(_reportMs[s] - _reportMs[first]) < 0) first = s;
+    }
+    if (!any || first == BARK_SRC_COUNT) return false;
+
+    uint32_t t0 = _reportMs[first];
+    uint8_t group = 0, count = 0, needed = 0;
+    uint16_t weight = 0;
+    for (uint8_t s = 0; s < BARK_SRC_COUNT; s++) {
+      if (_pending[s] && _reportMs[s] - t0 <= _windowMs) {
+        group |= (1 << s);
+        count++;
+        weight += _weight[s];
+      }
+      if (_enabled & (1 << s)) needed++;
+    }
+
+    bool accept;
+    switch (_policy) {
+      case FUSION_ALL:      accept = count >= needed; break;
+      case FUSION_WEIGHTED: accept = weight >= _threshold; break;
+      default:              accept = true; break;
+    }
+
+    if (accept) {
+      for (uint8_t s = 0; s < BARK_SRC_COUNT; s++) {
+        if (!(group & (1 << s))) continue;
+        _pending[s] = false;
+        if (count > 1) _stats[s].confirmed++;
+        else _stats[s].solo++;
+      }
+      _lastAcceptedMs = t0;
+      _lastGroup = group;
+      _hasAccepted = true;
+      _lastLatencyMs = nowMs - t0;
+      if (_lastLatencyMs > _maxLatencyMs) _maxLatencyMs = _lastLatencyMs;
+      _fused++;
+      return true;
+    }
+
+    if (nowMs - t0 > _windowMs) {
+      _pending[first] = false;
+      _stats[first].unconfirmed++;
+    }
+    return false;
+  }
+
+private:
+  FusionPolicy _policy;
+  uint32_t _windowMs;
+  uint8_t  _weight[BARK_SRC_COUNT];
+  uint16_t _threshold{100};
+  uint8_t  _enabled{(1 << BARK_SRC_COUNT) - 1};
+
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;  // report() runs in the BLE and mic tasks
+  volatile uint32_t _reportMs[BARK_SRC_COUNT]{};
+  volatile bool     _pending[BARK_SRC_COUNT]{};
+
+  uint32_t _lastAcceptedMs{0};
+  uint8_t  _lastGroup{0};
+  bool     _hasAccepted{false};
+
+  SourceStats _stats[BARK_SRC_COUNT]{};
+  uint32_t _fused{0};
+  uint32_t _lastLatencyMs{0};
+  uint32_t _maxLatencyMs{0};
+};
@@ -0,0 +1,251 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <functional>
+
+// Relays accepted barks between trainer units so a unit can correct barks
+// only another room's sensor heard. No Arduino dependencies: the radio sits
+// behind BarkRelayTransport (EspNowTransport on the device, LoopbackBus on
+// the host), so relay and dedup logic can be exercised without radios.
+//
+// Only locally sensed barks are relayed (no flooding). Each origin numbers
+// its messages from a random per-boot epoch; receivers drop repeat copies
+// and count sequence gaps as lost. A new epoch (the origin rebooted, e.g.
+// after the nightly deep sleep) or a peer silent for
+// BARK_RELAY_PEER_TIMEOUT_MS starts the numbering over instead. Suppressing a bark the local unit already corrected is left to the
+// caller's BLEBarkWindow, which sees relayed and local barks alike.
+
+#define BARK_RELAY_VERSION     2
+#define BARK_RELAY_MAX_PEERS   8
+#define BARK_RELAY_INBOX       8   // Received messages waiting for poll()
+#define BARK_RELAY_SOURCE_BIT  0x80  // Journal/source bit for a relayed bark
+#define BARK_RELAY_PEER_TIMEOUT_MS  (30UL * 60 * 1000)  // Silence after which a peer's numbering restarts
+
+typedef std::function<void(const uint8_t* data, size_t len)> RelayReceiveCallback;
+
+class BarkRelayTransport {
+public:
+  virtual ~BarkRelayTransport() {}
+  virtual bool begin() = 0;
+  virtual bool send(const uint8_t* data, size_t len) = 0;  // Broadcast, no ack
+  virtual void setReceiver(RelayReceiveCallback cb) = 0;   // May fire from another task
+  virtual void selfId(uint8_t out[6]) = 0;
+};
+
+struct __attribute__((packed)) BarkRelayMsg {
+  char     magic[2];    // "BR"
+  uint8_t  version;
+  uint8_t  sources;     // BarkSource bitmask at the origin
+  uint8_t  origin[6];
+  uint16_t seq;
+  uint16_t heldMs;      // Accept → send delay at the origin
+  uint32_t epoch;       // Random per boot; seq restarts with it
+};
+
+struct BarkRelayEvent {
+  uint8_t  origin[6];
+  uint8_t  sources;
+  uint16_t seq;
+  uint16_t heldMs;
+};
+
+class BarkRelay {
+public:
+  struct Stats {
+    uint32_t sent;
+    uint32_t sendFailures;
+    uint32_t received;     // Accepted remote barks
+    uint32_t duplicates;   // Repeat copies / late resends
+    uint32_t lost;         // Sequence gaps
+    uint32_t restarts;     // Peer numbering started over (reboot or long silence)
+    uint32_t malformed;
+    uint32_t overflow;     // Inbox full
+  };
+
+  // repeats: copies sent per bark (broadcasts are not acked; copies are
+  // deduplicated on the receiving side)
+  explicit BarkRelay(BarkRelayTransport& transport, uint8_t repeats = 2)
+    : _transport(transport), _repeats(repeats ? repeats : 1) {}
+
+  // epoch: random per boot (esp_random() on the device)
+  bool begin(uint32_t epoch) {
+    if (!_transport.begin()) return false;
+    _epoch = epoch;
+    _transport.selfId(_self);
+    _transport.setReceiver([this](const uint8_t* data, size_t len) { _onReceive(data, len); });
+    _started = true;
+    return true;
+  }
+
+  // Send a locally sensed, accepted bark
+  void relay(uint8_t sources, uint32_t acceptMs, uint32_t nowMs) {
+    if (!_started || !_enabled) return;
+    BarkRelayMsg m;
+    memcpy(m.magic, "BR", 2);
+    m.version = BARK_RELAY_VERSION;
+    m.sources = sources;
+    memcpy(m.origin, _self, 6);
+    m.seq = ++_seq;
+    m.epoch = _epoch;
+    uint32_t held = nowMs - acceptMs;
+    m.heldMs = held > 0xFFFF ? 0xFFFF : (uint16_t)held;
+
+    bool ok = false;
+    for (uint8_t i = 0; i < _repeats; i++) {
+      ok |= _transport.send((const uint8_t*)&m, sizeof(m));
+    }
+    if (ok) _stats.sent++;
+    else _stats.sendFailures++;
+  }
+
+  // Next new remote bark, if any. Call from loop(); dedup happens here so
+  // the receive path stays short.
+  bool poll(BarkRelayEvent& ev, uint32_t nowMs) {
+    while (_inTail != _inHead) {
+      BarkRelayMsg m = _inbox[_inTail % BARK_RELAY_INBOX];
+      _inTail++;
+      if (!_enabled) continue;
+
+      Peer& p = _peer(m.origin, nowMs);
+      if (p.valid && (m.epoch != p.epoch || nowMs - p.lastHeardMs > BARK_RELAY_PEER_TIMEOUT_MS)) {
+        p.valid = false;  // Old numbering no longer applies; nothing counted as lost
+        _stats.restarts++;
+      }
+      if (p.valid) {
+        int16_t d = (int16_t)(m.seq - p.lastSeq);
+        if (d <= 0) {
+          _stats.duplicates++;
+          continue;
+        }
+        _stats.lost += d - 1;
+      }
+      p.valid = true;
+      p.epoch = m.epoch;
+      p.lastSeq = m.seq;
+      p.lastHeardMs = nowMs;
+
+      memcpy(ev.origin, m.origin, 6);
+      ev.sources = m.sources;
+      ev.seq = m.seq;
+      ev.heldMs = m.heldMs;
+      _stats.received++;
+      return true;
+    }
+    return false;
+  }
+
+  void setEnabled(bool e) { _enabled = e; }
+  bool isEnabled() const { return _enabled; }
+  const Stats& stats() const { return _stats; }
+  uint8_t peerCount() const {
+    uint8_t n = 0;
+    for (const Peer& p : _peers) n += p.valid;
+    return n;
+  }
+
+private:
+  struct Peer {
+    uint8_t  id[6];
+    uint16_t lastSeq;
+    uint32_t epoch;
+    uint32_t lastHeardMs;
+    bool     valid;
+  };
+
+  // Transport receive context: validate and queue only
+  void _onReceive(const uint8_t* data, size_t len) {
+    if (len != sizeof(BarkRelayMsg) || memcmp(data, "BR", 2) != 0 ||
+        data[2] != BARK_RELAY_VERSION) {
+      _stats.malformed++;
+      return;
+    }
+    const BarkRelayMsg* m = (const BarkRelayMsg*)data;
+    if (memcmp(m->origin, _self, 6) == 0) return;  // Own broadcast echoed back
+    if ((uint8_t)(_inHead - _inTail) >= BARK_RELAY_INBOX) {
+      _stats.overflow++;
+      return;
+    }
+    _inbox[_inHead % BARK_RELAY_INBOX] = *m;
+    _inHead++;  // Publish after the slot is written
+  }
+
+  // Peer slot for an origin; a new origin takes a free slot or the one heard
+  // from longest ago
+  Peer& _peer(const uint8_t* id, uint32_t nowMs) {
+    Peer* oldest = &_peers[0];
+    for (Peer& p : _peers) {
+      if (p.valid && memcmp(p.id, id, 6) == 0) return p;
+    }
+    for (Peer& p : _peers) {
+      if (!p.valid) { oldest = &p; break; }
+      if (nowMs - p.lastHeardMs > nowMs - oldest->lastHeardMs) oldest = &p;
+    }
+    memcpy(oldest->id, id, 6);
+    oldest->valid = false;
+    return *oldest;
+  }
+
+  BarkRelayTransport& _transport;
+  uint8_t _repeats;
+  uint8_t _self[6]{};
+  bool    _started{false};
+  bool    _enabled{true};
+  uint16_t _seq{0};
+  uint32_t _epoch{0};
+
+  BarkRelayMsg _inbox[BARK_RELAY_INBOX];
+  volatile uint8_t _inHead{0};  // Written by the receive context only
+  volatile uint8_t _inTail{0};  // Written by poll() only
+
+  Peer  _peers[BARK_RELAY_MAX_PEERS]{};
+  Stats _stats{};
+};
+
+// Host stand-in for the radio: every transport on a bus hears every other
+// one synchronously. dropPercent simulates lost frames.
+class LoopbackBus {
+public:
+  static const uint8_t MAX_NODES = 8;
+
+  void join(class LoopbackTransport* t) { if (_count < MAX_NODES) _nodes[_count++] = t; }
+  void setDropPercent(uint8_t p) { _dropPercent = p; }
+  inline void broadcast(const class LoopbackTransport* from, const uint8_t* data, size_t len);
+
+private:
+  bool _drop() {
+    _rng = _rng * 1103515245u + 12345u;
+    return ((_rng >> 16) % 100) < _dropPercent;
+  }
+
+  class LoopbackTransport* _nodes[MAX_NODES]{};
+  uint8_t  _count{0};
+  uint8_t  _dropPercent{0};
+  uint32_t _rng{1};
+};
+
+class LoopbackTransport : public BarkRelayTransport {
+public:
+  LoopbackTransport(LoopbackBus& bus, uint8_t nodeId) : _bus(bus) {
+    memset(_id, 0, sizeof(_id));
+    _id[5] = nodeId;
+  }
+
+  bool begin() override { _bus.join(this); return true; }
+  bool send(const uint8_t* data, size_t len) override { _bus.broadcast(this, data, len); return true; }
+  void setReceiver(RelayReceiveCallback cb) override { _receiver = cb; }
+  void selfId(uint8_t out[6]) override { memcpy(out, _id, 6); }
+
+  void deliver(const uint8_t* data, size_t len) { if (_receiver) _receiver(data, len); }
+
+private:
+  LoopbackBus& _bus;
+  uint8_t _id[6];
+  RelayReceiveCallback _receiver;
+};
+
+inline void LoopbackBus::broadcast(const LoopbackTransport* from, const uint8_t* data, size_t len) {
+  for (uint8_t i = 0; i < _count; i++) {
+    if (_nodes[i] != from && !_drop()) _nodes[i]->deliver(data, len);
+  }
+}
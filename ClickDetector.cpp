@@ -8,6 +8,7 @@ ClickDetector::ClickDetector(int rxPin, int doubleClickMs, int debounceMs, int t
     this->rmtChannel = RMT_CHANNEL_0;
     this->minPulses = 50;
     this->maxPulses = 400;
+    this->minQuality = 0;
 
     // Reset state
     hasSignature = false;
@@ -15,8 +16,14 @@ ClickDetector::ClickDetector(int rxPin, int doubleClickMs, int debounceMs, int t
     lastPress = 0;
     firstClickTime = 0;
     secondClickTime = 0;
+    thirdClickTime = 0;
     lastCallbackTime = 0;
-    signature = {0, 0, 0, 0};
+    signature = {0, 0, 0, 0, 0, 0, -1};
+    lastFrameQuality = 0;
+    lastFrameShortUs = 0;
+    lastFrameLongUs = 0;
+    lowQualityRejects = 0;
+    frameCount = 0;
 }
 
 void ClickDetector::begin() {
@@ -31,6 +38,10 @@ void ClickDetector::setCallbacks(ClickCallback singleClick, ClickCallback double
     tripleClickCallback = tripleClick;
 }
 
+void ClickDetector::setQuadClickCallback(ClickCallback quadClick) {
+    quadClickCallback = quadClick;
+}
+
 void ClickDetector::setupRMT() {
     rmt_config_t config = {};
     config.rmt_mode = RMT_MODE_RX;
@@ -64,21 +75,12 @@ int ClickDetector::readPulseCount() {
 
         if (!items) break;  // Buffer is empty
 
-        int nItems = length / sizeof(rmt_item32_t);
-        int pulseCount = 0;
-
-        for (int i = 0; i < nItems && pulseCount < maxPulses; i++) {
-            if (items[i].duration0 > 0) pulseCount++;
-            if (items[i].duration1 > 0) pulseCount++;
-        }
+        // Keep only LAST valid signal (quality is scored before the item is returned)
+        int pulseCount = decodeFrame(items, length / sizeof(rmt_item32_t));
+        if (pulseCount) lastValidPulseCount = pulseCount;
 
         vRingbufferReturnItem(rb, items);
         itemsProcessed++;
-
-        // Keep only LAST valid signal
-        if (pulseCount >= minPulses && pulseCount <= maxPulses) {
-            lastValidPulseCount = pulseCount;
-        }
     }
 
     // Warn if buffer had many items (RF noise)
@@ -89,6 +91,78 @@ int ClickDetector::readPulseCount() {
     return lastValidPulseCount;
 }
 
+int ClickDetector::decodeFrame(const rmt_item32_t* items, int nItems) {
+    int pulseCount = 0;
+    for (int i = 0; i < nItems && pulseCount < maxPulses; i++) {
+        if (items[i].duration0 > 0) pulseCount++;
+        if (items[i].duration1 > 0) pulseCount++;
+    }
+    if (pulseCount < minPulses || pulseCount > maxPulses) return 0;
+    lastFrameQuality = measureFrameQuality(items, nItems);
+    return pulseCount;
+}
+
+static const int MAX_DATA_PULSE_US = 4000;  // Longer gaps are sync/idle, not data
+
+// Call fn(width) for every data pulse in the frame
+template <typename Fn>
+static void forEachDataPulse(const rmt_item32_t* items, int nItems, Fn fn) {
+    for (int i = 0; i < nItems; i++) {
+        int d0 = items[i].duration0, d1 = items[i].duration1;
+        if (d0 > 0 && d0 < MAX_DATA_PULSE_US) fn(d0);
+        if (d1 > 0 && d1 < MAX_DATA_PULSE_US) fn(d1);
+    }
+}
+
+// Score a frame 0-100 from pulse-width jitter. Every data pulse is classed as
+// short or long and its deviation from that class width is averaged. Uses the
+// learned timing once known, otherwise the frame's own decoded timing.
+int ClickDetector::measureFrameQuality(const rmt_item32_t* items, int nItems) {
+    bool learnedTiming = signature.shortUs > 0 && signature.longUs > signature.shortUs;
+    long shortSum = 0, longSum = 0, devPermille = 0;
+    int shortN = 0, longN = 0;
+
+    if (learnedTiming) {
+        // Deviation from the learned widths, summed in the classification pass
+        int refShort = signature.shortUs, refLong = signature.longUs;
+        int threshold = (refShort + refLong) / 2;
+        forEachDataPulse(items, nItems, [&](int d) {
+            if (d < threshold) { shortSum += d; shortN++; devPermille += (long)abs(d - refShort) * 1000 / refShort; }
+            else               { longSum += d;  longN++;  devPermille += (long)abs(d - refLong) * 1000 / refLong; }
+        });
+        lastFrameShortUs = shortN ? shortSum / shortN : 0;
+        lastFrameLongUs  = longN ? longSum / longN : 0;
+    } else {
+        // Still learning: the threshold and reference widths come from this
+        // frame, so each needs its own pass
+        long sum = 0;
+        int count = 0;
+        forEachDataPulse(items, nItems, [&](int d) { sum += d; count++; });
+        if (count == 0) return 0;
+        int threshold = sum / count;
+        forEachDataPulse(items, nItems, [&](int d) {
+            if (d < threshold) { shortSum += d; shortN++; }
+            else               { longSum += d;  longN++; }
+        });
+        lastFrameShortUs = shortN ? shortSum / shortN : 0;
+        lastFrameLongUs  = longN ? longSum / longN : 0;
+
+        int refShort = lastFrameShortUs, refLong = lastFrameLongUs;
+        if (refShort == 0 || refLong == 0) return 0;  // Not a two-width OOK frame
+        forEachDataPulse(items, nItems, [&](int d) {
+            int ref = (d < threshold) ? refShort : refLong;
+            devPermille += (long)abs(d - ref) * 1000 / ref;
+        });
+    }
+
+    int n = shortN + longN;
+    if (n == 0) return 0;  // Learned timing, but nothing in this frame is a data pulse
+
+    // Mean relative jitter: 0% scores 100, 25% or worse scores 0
+    int jitterPermille = devPermille / n;
+    return constrain(100 - jitterPermille * 100 / 250, 0, 100);
+}
+
 void ClickDetector::updateSignature(int pulses) {
     if (!hasSignature) {
         signature.minPulses = pulses;
@@ -108,6 +182,25 @@ void ClickDetector::updateSignature(int pulses) {
                          signature.minPulses, signature.maxPulses, signature.avgPulses, signature.sampleCount);
         }
     }
+
+    // Fold this frame's timing and quality into the per-remote EWMAs (alpha = 1/8)
+    updateTiming();
+    if (signature.qualityX16 < 0) {
+        signature.qualityX16 = lastFrameQuality * 16;
+    } else {
+        signature.qualityX16 += (lastFrameQuality * 16 - signature.qualityX16) / 8;
+    }
+}
+
+void ClickDetector::updateTiming() {
+    if (lastFrameShortUs <= 0 || lastFrameLongUs <= lastFrameShortUs) return;
+    if (signature.shortUs == 0) {
+        signature.shortUs = lastFrameShortUs;
+        signature.longUs = lastFrameLongUs;
+    } else {
+        signature.shortUs += (lastFrameShortUs - signature.shortUs) / 8;
+        signature.longUs += (lastFrameLongUs - signature.longUs) / 8;
+    }
 }
 
 bool ClickDetector::matchesSignature(int pulses) {
@@ -163,6 +256,11 @@ void ClickDetector::handleButtonPress(int pulses) {
     }
     else if (clickCount == 3) {
         if (now - secondClickTime <= tripleClickMs) {
+            if (quadClickCallback) {
+                thirdClickTime = now;
+                Serial.println("Third click (waiting for quad...)");
+                return;
+            }
             clickCount = 0;
             lastCallbackTime = now;  // FIXED: Mark callback time
             Serial.println("TRIPLE CLICK");
@@ -173,11 +271,42 @@ void ClickDetector::handleButtonPress(int pulses) {
             Serial.println("First click (timeout - restarted)");
         }
     }
+    else if (clickCount == 4) {
+        if (now - thirdClickTime <= (unsigned long)tripleClickMs) {
+            clickCount = 0;
+            lastCallbackTime = now;
+            Serial.println("QUAD CLICK");
+            if (quadClickCallback) quadClickCallback();
+        } else {
+            clickCount = 1;
+            firstClickTime = now;
+            Serial.println("First click (timeout - restarted)");
+        }
+    }
 }
 
 void ClickDetector::processSignal() {
-    int pulses = readPulseCount();
+    handleFrame(readPulseCount());
+}
+
+void ClickDetector::processFrame(const rmt_item32_t* items, int nItems) {
+    handleFrame(decodeFrame(items, nItems));
+}
+
+void ClickDetector::handleFrame(int pulses) {
     if (pulses < minPulses) return;
+    frameCount++;
+
+    // Reject marginal frames before spending time on signature matching
+    if (minQuality > 0 && lastFrameQuality < minQuality) {
+        lowQualityRejects++;
+        Serial.printf("Low quality frame (%d < %d) - ignored\n", lastFrameQuality, minQuality);
+        // A near miss from the learned button: follow its timing drift
+        if (isLearned() && lastFrameQuality >= minQuality - RF_TIMING_TRACK_MARGIN && matchesSignature(pulses)) {
+            updateTiming();
+        }
+        return;
+    }
 
     if (!hasSignature) {
         updateSignature(pulses);
@@ -216,13 +345,20 @@ void ClickDetector::update() {
         Serial.println("DOUBLE CLICK");
         if (doubleClickCallback) doubleClickCallback();
     }
+    else if (clickCount == 3 && (now - thirdClickTime >= (unsigned long)tripleClickMs)) {
+        clickCount = 0;
+        lastCallbackTime = now;
+        Serial.println("TRIPLE CLICK");
+        if (tripleClickCallback) tripleClickCallback();
+    }
 
     processSignal();
 }
 
 void ClickDetector::reset() {
     hasSignature = false;
-    signature = {0, 0, 0, 0};
+    signature = {0, 0, 0, 0, 0, 0, -1};
+    lowQualityRejects = 0;
     clickCount = 0;
     lastCallbackTime = 0;
     Serial.println("ClickDetector reset");
@@ -236,7 +372,9 @@ void ClickDetector::getStatus(String& statusMsg) {
     if (isLearned()) {
         statusMsg = "Learned: " + String(signature.minPulses) + "-" +
                    String(signature.maxPulses) + " pulses (avg: " +
-                   String(signature.avgPulses) + ")";
+                   String(signature.avgPulses) + "), quality: " +
+                   String(getSignalQuality()) + " (last " + String(lastFrameQuality) +
+                   ", " + String(lowQualityRejects) + " rejected)";
     } else {
         statusMsg = "Not learned yet (" + String(signature.sampleCount) + "/3 samples)";
     }
@@ -260,8 +398,26 @@ void ClickDetector::getBufferStats(String& stats) {
     }
 }
 
+int ClickDetector::getSignalQuality() {
+    return signature.qualityX16 < 0 ? -1 : (signature.qualityX16 + 8) / 16;
+}
+
+int ClickDetector::getLastFrameQuality() {
+    return lastFrameQuality;
+}
+
+unsigned long ClickDetector::getFrameCount() {
+    return frameCount;
+}
+
+unsigned long ClickDetector::getLowQualityRejects() {
+    return lowQualityRejects;
+}
+
 void ClickDetector::setDoubleClickTime(int ms) { doubleClickMs = ms; }
 void ClickDetector::setTripleClickTime(int ms) { tripleClickMs = ms; }
 void ClickDetector::setDebounceTime(int ms) { debounceMs = ms; }
 void ClickDetector::setMinPulses(int min) { minPulses = min; }
-void ClickDetector::setMaxPulses(int max) { maxPulses = max; }
\ No newline at end of file
+void ClickDetector::setMaxPulses(int max) { maxPulses = max; }
+void ClickDetector::setMinQuality(int q) { minQuality = q; }
+int ClickDetector::getMinQuality() { return minQuality; }
\ No newline at end of file
@@ -9,6 +9,8 @@
 // Callback function types
 typedef std::function<void()> ClickCallback;
 
+#define RF_TIMING_TRACK_MARGIN  20  // Rejected frames this close to minQuality still track the timing
+
 class ClickDetector {
 public:
     // Constructor
@@ -17,6 +19,8 @@ public:
     // Setup functions
     void begin();
     void setCallbacks(ClickCallback singleClick, ClickCallback doubleClick, ClickCallback tripleClick);
+    // Four clicks; once set, a triple click waits tripleClickMs for a fourth
+    void setQuadClickCallback(ClickCallback quadClick);
 
     // Main loop function
     void update();
@@ -26,6 +30,10 @@ public:
     bool isLearned();
     void getStatus(String& statusMsg);
     void getBufferStats(String& stats);
+    int getSignalQuality();      // Per-remote EWMA, 0-100 (-1 if no frames yet)
+    int getLastFrameQuality();   // Quality of the most recent valid frame, 0-100
+    unsigned long getFrameCount();  // Frames long enough to be a button (RF activity)
+    unsigned long getLowQualityRejects();
 
     // Advanced settings
     void setDoubleClickTime(int ms);
@@ -33,6 +41,19 @@ public:
     void setDebounceTime(int ms);
     void setMinPulses(int min);
     void setMaxPulses(int max);
+    // Reject frames below this quality (0 = accept all). Quality is scored
+    // against the learned pulse widths, so a remote whose timing drifts
+    // scores lower: rejected frames within RF_TIMING_TRACK_MARGIN of q that
+    // match the learned button still update the timing, so a slow drift is
+    // followed rather than locking the remote out.
+    void setMinQuality(int q);
+    int getMinQuality();
+
+    // One RMT frame without the ring buffer (benchmarks, replay). decodeFrame
+    // returns the pulse count if it is in range (else 0) and scores quality.
+    int decodeFrame(const rmt_item32_t* items, int nItems);
+    bool matchesSignature(int pulses);
+    void processFrame(const rmt_item32_t* items, int nItems);
 
 private:
     // Hardware config
@@ -45,6 +66,7 @@ private:
     int debounceMs;
     int minPulses;
     int maxPulses;
+    int minQuality;
 
     // Button signature
     struct ButtonSignature {
@@ -52,6 +74,9 @@ private:
         int maxPulses;
         int avgPulses;
         int sampleCount;
+        int shortUs;      // Learned short pulse width (EWMA)
+        int longUs;       // Learned long pulse width (EWMA)
+        int qualityX16;   // Signal quality EWMA, fixed point x16 (-1 = none)
     } signature;
 
     bool hasSignature;
@@ -60,20 +85,31 @@ private:
     unsigned long lastPress;
     unsigned long firstClickTime;
     unsigned long secondClickTime;
+    unsigned long thirdClickTime;
     unsigned long lastCallbackTime;  // FIXED: Prevents RF echo
     int clickCount;
 
+    // Signal quality of the last valid frame
+    int lastFrameQuality;
+    int lastFrameShortUs;
+    int lastFrameLongUs;
+    unsigned long lowQualityRejects;
+    unsigned long frameCount;
+
     // Callbacks
     ClickCallback singleClickCallback;
     ClickCallback doubleClickCallback;
     ClickCallback tripleClickCallback;
+    ClickCallback quadClickCallback;
 
     // Internal functions
     void setupRMT();
     int readPulseCount();
+    int measureFrameQuality(const rmt_item32_t* items, int nItems);
     void updateSignature(int pulses);
-    bool matchesSignature(int pulses);
+    void updateTiming();
     void handleButtonPress(int pulses);
+    void handleFrame(int pulses);
     void processSignal();
 };
 
@@ -0,0 +1,158 @@
+#pragma once
+#include <Arduino.h>
+
+// Actuators a correction uses (the ladder's notion of intensity)
+#define CORR_OUT_TONE   0x01
+#define CORR_OUT_VIB    0x02
+#define CORR_OUT_WATER  0x04
+#define CORR_OUT_ALL    (CORR_OUT_TONE | CORR_OUT_VIB | CORR_OUT_WATER)
+
+#define CORR_BUCKETS    12    // Sliding window resolution
+#define CORR_MAX_RUNGS  8
+#define CORR_COUNT_CAP  63    // Bark counts above this share the top lookup slot
+#define CORR_SAME_BARK_MS 1000  // Reports closer than this are one physical bark
+
+struct CorrectionRung {
+  uint8_t  minBarks;    // Barks in the window (this one included) to reach the rung
+  uint8_t  outputs;     // CORR_OUT_* bits
+  uint16_t durationMs;
+};
+
+struct CorrectionDecision {
+  uint8_t  rung;
+  uint8_t  outputs;
+  uint16_t durationMs;
+  uint8_t  barksInWindow;
+};
+
+// Picks the correction for a bark from how much the dog has barked lately.
+// Every bark (including ones the bark window suppresses) goes into a ring of
+// per-bucket counts with a running total, so the sliding-window count costs
+// at most CORR_BUCKETS steps to age out, whatever the bark rate. One
+// physical bark can be reported more than once (BLE and mic further apart
+// than the fusion window, a relayed echo of a bark heard here too); reports
+// within CORR_SAME_BARK_MS of the last counted one are merged. The ladder
+// is flattened into a count → rung table when set, so decide() is a lookup:
+// a tone-only first correction is picked as fast as a full one.
+class CorrectionPolicy {
+public:
+  CorrectionPolicy(const CorrectionRung* ladder, uint8_t rungCount, uint32_t windowMs = 120000) {
+    setWindow(windowMs);
+    setLadder(ladder, rungCount);
+  }
+
+  // Rungs in increasing minBarks order; rung 0 applies below its minBarks too
+  void setLadder(const CorrectionRung* ladder, uint8_t rungCount) {
+    _rungCount = rungCount > CORR_MAX_RUNGS ? CORR_MAX_RUNGS : rungCount;
+    if (_rungCount == 0) return;
+    memcpy(_ladder, ladder, _rungCount * sizeof(CorrectionRung));
+    uint8_t r = 0;
+    for (uint8_t n = 0; n <= CORR_COUNT_CAP; n++) {
+      while (r + 1 < _rungCount && n >= _ladder[r + 1].minBarks) r++;
+      _rungFor[n] = r;
+    }
+    memset(_decisions, 0, sizeof(_decisions));
+  }
+
+  void setWindow(uint32_t windowMs) {
+    _bucketMs = windowMs / CORR_BUCKETS;
+    if (_bucketMs == 0) _bucketMs = 1;
+    reset();
+  }
+
+  // Every detected bark, before any suppression. False if it was merged
+  // into the previous one.
+  bool noteBark(uint32_t nowMs) {
+    if (_haveLast && nowMs - _lastBarkMs < CORR_SAME_BARK_MS) {
+      _merged++;
+      return false;
+    }
+    _haveLast = true;
+    _lastBarkMs = nowMs;
+    _advance(nowMs);
+    if (_buckets[_cur] < 0xFFFF) {
+      _buckets[_cur]++;
+      _total++;
+    }
+    return true;
+  }
+
+  // Correction for a bark that will be corrected (after noteBark)
+  CorrectionDecision decide(uint32_t nowMs) {
+    _advance(nowMs);
+    CorrectionDecision d{};
+    if (_rungCount == 0) return d;
+    uint8_t n = _total > CORR_COUNT_CAP ? CORR_COUNT_CAP : (uint8_t)_total;
+    const CorrectionRung& rung = _ladder[_rungFor[n]];
+    d.rung = _rungFor[n];
+    d.outputs = rung.outputs;
+    d.durationMs = rung.durationMs;
+    d.barksInWindow = n;
+    _decisions[d.rung]++;
+    return d;
+  }
+
+  uint32_t barksInWindow(uint32_t nowMs) {
+    _advance(nowMs);
+    return _total;
+  }
+
+  void reset() {
+    memset(_buckets, 0, sizeof(_buckets));
+    _total = 0;
+    _cur = 0;
+    _bucketStartMs = 0;  // First _advance() after a long gap clears and re-anchors
+    _haveLast = false;
+  }
+
+  uint32_t windowMs() const { return _bucketMs * CORR_BUCKETS; }
+  uint8_t rungCount() const { return _rungCount; }
+  const CorrectionRung& rung(uint8_t i) const { return _ladder[i < _rungCount ? i : 0]; }
+  uint32_t decisions(uint8_t i) const { return i < CORR_MAX_RUNGS ? _decisions[i] : 0; }
+  uint32_t mergedReports() const { return _merged; }
+
+  static String outputsName(uint8_t outputs) {
+    String s;
+    if (outputs & CORR_OUT_TONE)  s += "tone+";
+    if (outputs & CORR_OUT_VIB)   s += "vib+";
+    if (outputs & CORR_OUT_WATER) s += "water+";
+    if (s.length()) s.remove(s.length() - 1);
+    else s = "none";
+    return s;
+  }
+
+private:
+  // Age out whole buckets; at most CORR_BUCKETS steps
+  void _advance(uint32_t nowMs) {
+    uint32_t steps = (nowMs - _bucketStartMs) / _bucketMs;
+    if (steps == 0) return;
+    if (steps >= CORR_BUCKETS) {
+      memset(_buckets, 0, sizeof(_buckets));
+      _total = 0;
+      _bucketStartMs = nowMs;
+      return;
+    }
+    for (uint32_t i = 0; i < steps; i++) {
+      _cur = (_cur + 1) % CORR_BUCKETS;
+      _total -= _buckets[_cur];
+      _buckets[_cur] = 0;
+    }
+    _bucketStartMs += steps * _bucketMs;
+  }
+
+  CorrectionRung _ladder[CORR_MAX_RUNGS]{};
+  uint8_t  _rungCount{0};
+  uint8_t  _rungFor[CORR_COUNT_CAP + 1]{};
+
+  uint16_t _buckets[CORR_BUCKETS]{};
+  uint32_t _total{0};
+  uint8_t  _cur{0};
+  uint32_t _bucketMs{1};
+  uint32_t _bucketStartMs{0};
+
+  uint32_t _lastBarkMs{0};
+  bool     _haveLast{false};
+  uint32_t _merged{0};
+
+  uint32_t _decisions[CORR_MAX_RUNGS]{};
+};
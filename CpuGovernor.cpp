@@ -0,0 +1,198 @@
+#include "CpuGovernor.h"
+
+CpuGovernor::CpuGovernor(uint32_t highMhz, uint32_t lowMhz)
+    : wakeProbe("cpu.boost") {
+    highClock = highMhz;
+    lowClock = lowMhz;
+    autoMode = true;
+    boosted = true;       // Boots at full clock
+    lastActivityMs = 0;
+    lastAccountMs = 0;
+
+    activityPending = false;
+    activityUs = 0;
+
+#if CONFIG_PM_ENABLE
+    boostLock = nullptr;
+    lockMux = portMUX_INITIALIZER_UNLOCKED;
+    lockHeld = false;
+#endif
+    pmActive = false;
+
+    memset(msAt, 0, sizeof(msAt));
+    boosts = 0;
+    lastWakeUs = 0;
+    maxWakeUs = 0;
+}
+
+void CpuGovernor::begin() {
+    lastAccountMs = millis();
+    lastActivityMs = lastAccountMs;
+#if CONFIG_PM_ENABLE
+    if (configurePm() && esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "boost", &boostLock) == ESP_OK) {
+        pmActive = true;
+        lockHeld = true;
+        esp_pm_lock_acquire(boostLock);
+    }
+#endif
+    Serial.printf("CpuGovernor initialized (%lu/%lu MHz, %s)\n", (unsigned long)highClock,
+                  (unsigned long)lowClock, pmActive ? "esp_pm locks" : "setCpuFrequencyMhz");
+}
+
+#if CONFIG_PM_ENABLE
+bool CpuGovernor::configurePm() {
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t cfg = {};
+#else
+    esp_pm_config_esp32_t cfg = {};
+#endif
+    cfg.max_freq_mhz = highClock;
+    cfg.min_freq_mhz = lowClock;
+    cfg.light_sleep_enable = false;  // Light sleep would stall the scanner and RMT
+    return esp_pm_configure(&cfg) == ESP_OK;
+}
+#endif
+
+void CpuGovernor::noteActivity() {
+    int64_t nowUs = esp_timer_get_time();
+    activityUs = nowUs;
+    activityPending = true;
+#if CONFIG_PM_ENABLE
+    // Boost from the calling task: the lock switches the clock before it returns
+    if (!pmActive || !autoMode) return;
+    portENTER_CRITICAL(&lockMux);
+    bool take = !lockHeld;
+    lockHeld = true;
+    portEXIT_CRITICAL(&lockMux);
+    if (take) {
+        esp_pm_lock_acquire(boostLock);
+        lastWakeUs = (int32_t)(esp_timer_get_time() - nowUs);
+    }
+#endif
+}
+
+void CpuGovernor::update(uint32_t nowMs, bool busy) {
+    msAt[slotFor(currentMhz())] += nowMs - lastAccountMs;
+    lastAccountMs = nowMs;
+
+    bool activity = activityPending;
+    int64_t sinceUs = activityUs;
+    if (activity) {
+        activityPending = false;
+        lastActivityMs = nowMs;
+    }
+    bool want = !autoMode || busy || nowMs - lastActivityMs < CPU_BOOST_HOLD_MS;
+
+#if CONFIG_PM_ENABLE
+    if (pmActive) {
+        if (want && !boosted) {
+            // Activity path already holds the lock; busy-only boosts take it here
+            portENTER_CRITICAL(&lockMux);
+            bool take = !lockHeld;
+            lockHeld = true;
+            portEXIT_CRITICAL(&lockMux);
+            if (take) esp_pm_lock_acquire(boostLock);
+            boosted = true;
+            boosts++;
+            if (activity) {
+                int32_t us = lastWakeUs;
+                wakeProbe.record((uint32_t)us * highClock, us);
+                if (us > maxWakeUs) maxWakeUs = us;
+            }
+        } else if (!want && boosted) {
+            portENTER_CRITICAL(&lockMux);
+            bool release = lockHeld;
+            lockHeld = false;
+            portEXIT_CRITICAL(&lockMux);
+            if (release) esp_pm_lock_release(boostLock);
+            boosted = false;
+        }
+        return;
+    }
+#endif
+
+    if (want && !boosted) {
+        setClock(highClock, activity ? sinceUs : 0);
+        boosted = true;
+        boosts++;
+    } else if (!want && (boosted || currentMhz() != lowClock)) {
+        setClock(lowClock, 0);
+        boosted = false;
+    }
+}
+
+void CpuGovernor::setClock(uint32_t mhz, int64_t sinceUs) {
+    setCpuFrequencyMhz(mhz);
+    if (sinceUs == 0) return;
+    // Event → clock switched: the loop pass it waited for plus the switch itself
+    int32_t us = (int32_t)(esp_timer_get_time() - sinceUs);
+    lastWakeUs = us;
+    if (us > maxWakeUs) maxWakeUs = us;
+    wakeProbe.record((uint32_t)us * mhz, us);
+}
+
+void CpuGovernor::setAuto(bool enabled) {
+    autoMode = enabled;
+}
+
+bool CpuGovernor::isAuto() { return autoMode; }
+
+void CpuGovernor::setLowMhz(uint32_t mhz) {
+    if (mhz == lowClock || (mhz != 80 && mhz != 160)) return;
+    lowClock = mhz;
+#if CONFIG_PM_ENABLE
+    if (pmActive) configurePm();
+#endif
+}
+
+uint32_t CpuGovernor::lowMhz() { return lowClock; }
+
+bool CpuGovernor::usesPmLocks() { return pmActive; }
+
+uint32_t CpuGovernor::currentMhz() { return getCpuFrequencyMhz(); }
+
+void CpuGovernor::getStatus(String& statusMsg) {
+    uint32_t total = msAt[0] + msAt[1] + msAt[2];
+    statusMsg = String(currentMhz()) + " MHz (" + (autoMode ? "auto" : "fixed") + ", " +
+                (pmActive ? "pm" : "direct") + "), boosted " +
+                String(total ? (uint32_t)((uint64_t)msAt[0] * 100 / total) : 0) + "%, " +
+                String(boosts) + " boosts, last " + String(lastWakeUs) + " us";
+}
+
+void CpuGovernor::printReport() {
+    static const uint32_t MHZ[3] = { 240, 160, 80 };
+    uint32_t total = msAt[0] + msAt[1] + msAt[2];
+    Serial.printf("\n⚡ CPU CLOCK (%s, %s, low %lu MHz):\n", autoMode ? "auto" : "fixed",
+                  pmActive ? "esp_pm locks" : "setCpuFrequencyMhz", (unsigned long)lowClock);
+    uint64_t maMs = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+        maMs += (uint64_t)msAt[i] * maFor(i);
+        Serial.printf("   %3lu MHz: %8lu s  %5.1f%%\n", (unsigned long)MHZ[i], (unsigned long)(msAt[i] / 1000),
+                      total ? 100.0 * msAt[i] / total : 0.0);
+    }
+    Serial.printf("   Boosts: %lu, wake latency avg %.0f us, max %ld us\n", boosts,
+                  wakeProbe.avgUs(), (long)maxWakeUs);
+    if (total) {
+        double ma = (double)maMs / total;
+        double mwh = ma * CPU_SUPPLY_MV / 1000.0;
+        double fixed = (double)CPU_MA_240 * CPU_SUPPLY_MV / 1000.0;
+        Serial.printf("   CPU energy (est.): %.0f mWh/h vs %.0f fixed at 240 MHz (%.0f%% saved)\n", mwh, fixed,
+                      100.0 * (fixed - mwh) / fixed);
+    }
+    Serial.println();
+}
+
+void CpuGovernor::resetStats() {
+    memset(msAt, 0, sizeof(msAt));
+    boosts = 0;
+    maxWakeUs = 0;
+    wakeProbe.reset();
+}
+
+uint8_t CpuGovernor::slotFor(uint32_t mhz) {
+    return mhz >= 240 ? 0 : mhz >= 160 ? 1 : 2;
+}
+
+uint32_t CpuGovernor::maFor(uint8_t slot) {
+    return slot == 0 ? CPU_MA_240 : slot == 1 ? CPU_MA_160 : CPU_MA_80;
+}
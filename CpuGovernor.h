@@ -0,0 +1,91 @@
+#ifndef CPU_GOVERNOR_H
+#define CPU_GOVERNOR_H
+
+#include <Arduino.h>
+#include "esp_timer.h"
+#include "PerfCounters.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+#define CPU_FREQ_HIGH_MHZ   240
+#define CPU_FREQ_LOW_MHZ    80     // Lowest clock with the radio on (APB stays at 80 MHz)
+#define CPU_BOOST_HOLD_MS   2000   // Stay boosted this long after the last activity
+
+// CPU share of the supply current per clock (mA, ESP32 modem-sleep datasheet
+// figures, dual core). Only used for the energy estimate; radio current is
+// the same at every clock and left out. Measure the board and adjust.
+#define CPU_MA_240          68
+#define CPU_MA_160          44
+#define CPU_MA_80           31
+#define CPU_SUPPLY_MV       3300
+
+// Frequency governor: full clock while there is work (a radio/RF event in
+// the last CPU_BOOST_HOLD_MS, a queued bark, an actuator or cue running),
+// the low clock otherwise.
+//
+// With CONFIG_PM_ENABLE the IDF power manager scales the clock and the boost
+// is an ESP_PM_CPU_FREQ_MAX lock, taken straight from whichever task sees
+// the event. Without it the clock is switched with setCpuFrequencyMhz() from
+// loop(), so a boost waits for the next pass. Either way the event → full
+// clock latency is measured ("cpu.boost" probe), along with the time spent
+// at each clock and the CPU energy per hour that implies.
+class CpuGovernor {
+public:
+    CpuGovernor(uint32_t highMhz = CPU_FREQ_HIGH_MHZ, uint32_t lowMhz = CPU_FREQ_LOW_MHZ);
+
+    // Setup functions
+    void begin();
+
+    // Any task: radio or RF activity
+    void noteActivity();
+
+    // Main loop function (busy = work queued or an actuator running)
+    void update(uint32_t nowMs, bool busy);
+
+    // Control functions
+    void setAuto(bool enabled);       // false = fixed at the high clock
+    bool isAuto();
+    void setLowMhz(uint32_t mhz);     // 80/160; e.g. raised while the mic DSP runs
+    uint32_t lowMhz();
+    bool usesPmLocks();
+    uint32_t currentMhz();
+
+    // Status
+    void getStatus(String& statusMsg);
+    void printReport();
+    void resetStats();
+
+private:
+    uint32_t highClock;
+    uint32_t lowClock;
+    bool autoMode;
+    bool boosted;
+    uint32_t lastActivityMs;
+    uint32_t lastAccountMs;
+
+    // Set from other tasks, consumed in update()
+    volatile bool activityPending;
+    volatile int64_t activityUs;
+
+#if CONFIG_PM_ENABLE
+    esp_pm_lock_handle_t boostLock;
+    portMUX_TYPE lockMux;
+    volatile bool lockHeld;
+    bool configurePm();
+#endif
+    bool pmActive;
+
+    // Stats
+    uint32_t msAt[3];          // 240 / 160 / 80 MHz
+    unsigned long boosts;
+    volatile int32_t lastWakeUs;
+    int32_t maxWakeUs;
+    PerfProbe wakeProbe;       // Activity → full clock
+
+    void setClock(uint32_t mhz, int64_t sinceUs);
+    static uint8_t slotFor(uint32_t mhz);
+    static uint32_t maFor(uint8_t slot);
+};
+
+#endif
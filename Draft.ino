@@ -1,7 +1,34 @@
 #include <NimBLEDevice.h>
 #include "ClickDetector.h"
+#include "FeederController.h"
+#include "ToneEngine.h"
+#include "MarkerCue.h"
+#include "MicBarkDetector.h"
+#include "AudioClipRecorder.h"
 #include "QuietReinforcementManager.h"
 #include "BLEBarkWindow.h"
+#include "CorrectionPolicy.h"
+#include "TrainingProgram.h"
+#include "TrainingSession.h"
+#include "WallClock.h"
+#include "ScheduleTable.h"
+#include "BarkFusion.h"
+#include "ActuatorTrace.h"
+#include "PerfCounters.h"
+#include "EventJournal.h"
+#include "BarkRelay.h"
+#include "ScanDutyMeter.h"
+#include "CpuGovernor.h"
+#include "ScanTuner.h"
+#include <esp_sleep.h>
+#include "BarkAuth.h"
+#include "InputParsers.h"
+#include "TrainerLoop.h"
+
+// LEDC channels pair up on a timer ((channel / 2) % 4). The buzzer retunes its
+// timer for every note, so sharing one would change the feeder's step rate.
+static_assert((TONE_LEDC_CHANNEL / 2) % 4 != (FEEDER_LEDC_CHANNEL / 2) % 4,
+              "buzzer and feeder step train must use different LEDC timers");
 // ===== Pin Definitions =====
 const int waterPin = 13;
 const int stepPin = 33;
@@ -13,24 +40,80 @@ const int barkButtonPin = 12;
 const int waterButtonPin = 14;   // Manual water/punishment (does NOT affect manager)
 const int feederButtonPin = 27;  // Manual feeder/reward (does NOT affect manager)
 const int rfRemotePin = 35;
+const int micSckPin = 18;        // I2S microphone bit clock
+const int micWsPin = 19;         // I2S microphone word select
+const int micSdPin = 34;         // I2S microphone data (input-only pin)
+const int dropSensorPin = 4;     // IR break-beam under the feeder chute (active low)
+const int buzzerPin = 23;        // Piezo for cues and corrections (LEDC tone)
 
 // ===== BLE Configuration =====
 #define ADV_NAME                "PING-ESP32"
 #define ADV_TAG                 "PING1234"
-#define SCAN_INTERVAL_UNITS     80
-#define SCAN_WINDOW_UNITS       80
 #define SCAN_DURATION_SECONDS   0
 #define SERIAL_BAUD_RATE        115200
+#define SERIAL_LINE_MAX         64
 
-// ===== Hardware timings =====
-#define STEP_PULSE_MS           2
-#define DEBOUNCE_MS             50
-#define LED_BLINK_MS            500
-
-// ===== Manual action durations (do NOT affect manager) =====
-#define MANUAL_PUNISH_MS        2000
-#define MANUAL_REWARD_MS        1200
+// ===== Timings (debounce, manual actions, marker/feeder look-ahead: TrainerLoop.h) =====
 #define BARK_WINDOW             5000
+#define FEEDER_USE_DROP_SENSOR  1     // 0 = old open-loop timed dispensing
+#define FUSION_ALIGN_MS         60    // Max wait for a second source to confirm a bark
+#define JOURNAL_DUMP_DEFAULT    20
+
+// ===== Training sessions (quad click / "session start|stop" / "session every") =====
+#define SESSION_MAX_MS          (45UL * 60 * 1000)   // Sessions end on their own after this
+
+// ===== Wall clock and schedule ("time", "sched") =====
+#define SCHEDULE_CHECK_MS       1000
+#define SLEEP_MAX_MIN           (12 * 60)    // Wake at least this often overnight to re-check the clock
+#define RTC_STATE_MAGIC         0x44525443   // "DRTC"
+#define NTP_SERVER              "pool.ntp.org"  // With ENABLE_TELEMETRY (needs Wi-Fi)
+
+// ===== CPU clock ("cpu"): low while idle, full on radio/RF activity or work =====
+#define CPU_FREQ_MIC_MHZ        160   // Idle clock while the mic DSP runs (80 MHz can fall behind)
+
+// ===== Scan tuning ("scan"): lowest scan duty that keeps missed barks under target =====
+#define SENSOR_BURST_ADVERTS    3     // Adverts per bark the paired sensors send (sensor firmware setting)
+#define SCAN_TUNE_CHECK_MS      5000
+
+// ===== Adaptive shaping ("qshape on"): quiet target from the dog's own bark intervals =====
+#define SHAPING_PERCENTILE      70
+#define SHAPING_MIN_QUIET_MS    2000
+#define SHAPING_MAX_QUIET_MS    60000
+
+// ===== Optional Wi-Fi/MQTT telemetry (needs AsyncMqttClient + AsyncTCP) =====
+#define ENABLE_TELEMETRY        0
+#define WIFI_SSID               "dog-trainer"
+#define WIFI_PASSWORD           "changeme"
+#define MQTT_HOST               "192.168.1.10"
+#define MQTT_PORT               1883
+#define MQTT_TOPIC_PREFIX       "dogtrainer"
+
+#if ENABLE_TELEMETRY
+#include "TelemetryPublisher.h"
+#include <esp_sntp.h>
+#endif
+
+// ===== BLE GATT config/telemetry service (runs next to the scanner) =====
+#define ENABLE_GATT_SERVICE     1
+
+#if ENABLE_GATT_SERVICE
+#include "TrainerGattService.h"
+#endif
+
+// ===== Optional ESP-NOW bark relay between trainer units =====
+#define ENABLE_BARK_RELAY       0
+#define BARK_RELAY_REPEATS      2     // Copies per relayed bark (broadcasts are unacked)
+
+#if ENABLE_BARK_RELAY
+#include "EspNowTransport.h"
+#endif
+
+// ===== On-target micro-benchmarks ("perf bench", same cases as tools/perf_bench) =====
+#define ENABLE_PERF_BENCH       0
+
+#if ENABLE_PERF_BENCH
+#include "PerfBench.h"
+#endif
 
 // ===== REINFORCEMENT LEVELS (manager-driven rewards) =====
 // Patterns: 1=reward, 0=skip
@@ -48,108 +131,163 @@ LevelConfig LEVELS[] = {
 };
 const uint8_t LEVEL_COUNT = sizeof(LEVELS)/sizeof(LEVELS[0]);
 
+#define REWARD_COOLDOWN_MS      7000
+
 // Manager: (namespace, levels, count, successesToAdvance, rewardCooldownMs, log, punishmentMs)
-QuietReinforcementManager quietMgr("dogNVS", LEVELS, LEVEL_COUNT, 4, 7000, 3, true);
+QuietReinforcementManager quietMgr("dogNVS", LEVELS, LEVEL_COUNT, 4, REWARD_COOLDOWN_MS, 3, true);
+
+// ===== Compiled training program (tools/plan_compiler) - replaces LEVELS[] while loaded =====
+TrainingProgram program;
+TrainingProgramLoader programLoader;
+Preferences programPrefs;
+LevelConfig programLevels[TP_MAX_PHASES];
+uint8_t programPatterns[TP_MAX_PHASES][TP_MAX_PATTERN];
 
 BLEBarkWindow bleBarkWindow(BARK_WINDOW);  // 5 second window
 
-// ===== Button debounce state =====
-unsigned long lastWaterButtonTime = 0;
-unsigned long lastFeederButtonTime = 0;
-unsigned long lastBarkButtonTime  = 0;
-unsigned long lastLedBlinkTime    = 0;
-bool ledState = false;
+// ===== CORRECTION LADDER (barks in the last CORRECTION_WINDOW_MS → correction) =====
+#define CORRECTION_WINDOW_MS    120000
 
-// ===== Non-blocking punishment runner =====
-bool punishActive = false;
-unsigned long punishEndMs = 0;
+const CorrectionRung CORRECTION_LADDER[] = {
+  // minBarks, outputs,                       durationMs
+  { 1,         CORR_OUT_TONE,                 700  },  // First bark: warning tone
+  { 2,         CORR_OUT_TONE | CORR_OUT_VIB,  1000 },
+  { 4,         CORR_OUT_ALL,                  1500 },
+  { 6,         CORR_OUT_ALL,                  MANUAL_PUNISH_MS },  // Old fixed correction
+};
 
-// ===== BLE =====
-NimBLEScan* pBLEScan;
-ClickDetector detector(rfRemotePin);  // GPIO35
+CorrectionPolicy correctionPolicy(CORRECTION_LADDER,
+                                  sizeof(CORRECTION_LADDER) / sizeof(CORRECTION_LADDER[0]),
+                                  CORRECTION_WINDOW_MS);
 
-// Debounce
-bool isButtonPressed(int pin, unsigned long& lastPressTime) {
-  if (digitalRead(pin) == LOW) { // active-low
-    unsigned long now = millis();
-    if (now - lastPressTime > DEBOUNCE_MS) {
-      lastPressTime = now;
-      return true;
-    }
-  }
-  return false;
-}
+// BLE + mic bark reports → one fused bark (policy "any" keeps the old behaviour)
+BarkFusion barkFusion(FUSION_ANY, FUSION_ALIGN_MS);
 
-// Feeder: run for durationMs (simple loop; convert to FSM if needed)
-void runFeederFor(uint32_t durationMs) {
-  digitalWrite(enPin, LOW);
-  digitalWrite(dirPin, HIGH);
-  uint32_t start = millis();
-  while (millis() - start < durationMs) {
-    digitalWrite(stepPin, HIGH);
-    delay(STEP_PULSE_MS);
-    digitalWrite(stepPin, LOW);
-    delay(STEP_PULSE_MS);
-  }
-  digitalWrite(enPin, HIGH);
-  Serial.printf("🍖 Treat dispensed for %lu ms\n", (unsigned long)durationMs);
-}
+// All actuator writes go through this so edges can be captured ("trace" command)
+ActuatorTrace actuatorTrace;
 
-// Water: run pump/valve for durationMs (blocking)
-void runWaterFor(uint32_t durationMs) {
-  if (durationMs == 0) return;
+// Stepper feeder, stopped by the drop sensor as soon as a treat falls
+FeederController feeder(actuatorTrace, stepPin, dirPin, enPin,
+                        FEEDER_USE_DROP_SENSOR ? dropSensorPin : -1);
 
-  digitalWrite(waterPin, HIGH);
-  uint32_t start = millis();
-  while (millis() - start < durationMs) {
-    delay(1); // keep loop responsive-ish
-  }
-  digitalWrite(waterPin, LOW);
-  Serial.printf("💧 Water ran for %lu ms\n", (unsigned long)durationMs);
-}
+// Non-blocking tone/LED/vibration cues (corrections pre-empt markers)
+ToneEngine toneEngine(actuatorTrace, buzzerPin, ledPin, vibrationPin);
 
-// Manager-driven punishment (from barks)
-void startPunishment(uint32_t ms) {
-  if (ms == 0) return;
-  punishActive = true;
-  punishEndMs = millis() + ms;
+// Marker cue at the moment a quiet success earns a reward
+MarkerCue markerCue(toneEngine);
 
-  digitalWrite(waterPin, HIGH);
-  digitalWrite(vibrationPin, HIGH);
-  digitalWrite(ledPin, HIGH);
-  Serial.printf("🚨 Punishment ON for %lu ms (manager)\n", (unsigned long)ms);
-}
+// Training events (bark, punish, rewards, level changes) for dumps and telemetry
+EventJournal journal;
 
-// Update punishment runner
-void updatePunishment() {
-  if (punishActive && (long)(millis() - punishEndMs) >= 0) {
-    punishActive = false;
-    digitalWrite(waterPin, LOW);
-    digitalWrite(vibrationPin, LOW);
-    digitalWrite(ledPin, LOW);
-    Serial.println("✅ Punishment OFF");
-  }
-}
+// Current/last training session; summaries are journaled at session end
+TrainingSession session;
+Preferences sessionPrefs;
+uint32_t sessionMaxMs = SESSION_MAX_MS;
+uint32_t sessionEveryMs = 0;      // Auto-start period (0 = off)
+uint32_t sessionLengthMs = 0;     // Auto-started session length
+uint32_t nextSessionMs = 0;
+
+// Wall clock and the schedule table gating training/corrections/scanning/sleep
+WallClock wallClock;
+ScheduleTable schedule;
+Preferences schedPrefs;
+uint32_t lastScheduleCheckMs = 0;
+volatile bool sntpSynced = false;   // Set from the SNTP task
+
+// Held in RTC slow memory through deep sleep (not power loss): the settings
+// that otherwise only live in RAM, so a scheduled wake resumes as it slept
+struct RtcState {
+  uint32_t magic;
+  uint32_t sleeps;
+  uint32_t sleptAtUnix;
+  uint32_t lastSyncUnix;
+  uint8_t  clockSource;
+  bool     correctionLadderOn;
+  uint32_t sessionMaxMs;
+  uint32_t sessionEveryMs;
+  uint32_t sessionLengthMs;
+};
+RTC_DATA_ATTR RtcState rtcState;
+
+// Per-sensor keys for authenticated bark adverts ("pair" command); the last
+// accepted sequences stay in RTC memory so a restart cannot reopen replays
+BarkAuth barkAuth;
+RTC_DATA_ATTR BarkAuthRtc barkAuthRtc;
+
+// Scanner listening time as adverts/s, split by GATT connection state
+ScanDutyMeter scanDuty;
+
+// Missed barks from sensor sequence gaps → scan window/interval
+ScanTuner scanTuner(SENSOR_BURST_ADVERTS, SCAN_TUNE_TARGET_PERMILLE);
+uint32_t lastScanTuneMs = 0;
+
+// CPU frequency scaling
+CpuGovernor cpuGovernor;
+unsigned long lastRfFrameCount = 0;
+
+#if ENABLE_GATT_SERVICE
+TrainerGattService gattService(journal);
+#endif
+
+#if ENABLE_BARK_RELAY
+EspNowTransport espNow;
+BarkRelay barkRelay(espNow, BARK_RELAY_REPEATS);
+#endif
+
+#if ENABLE_TELEMETRY
+TelemetryPublisher telemetry(journal, WIFI_SSID, WIFI_PASSWORD, MQTT_HOST, MQTT_PORT, MQTT_TOPIC_PREFIX);
+#endif
+
+// ===== Hot-path cycle probes ("perf" command) =====
+PerfProbe perfLoop("loop");
+PerfProbe perfRemote("rf.update");
+PerfProbe perfBleFilter("ble.filter");
+PerfProbe perfBleAuth("ble.auth");
+PerfProbe perfSerial("serial.dispatch");
+PerfProbe perfMic("mic.update");
+
+// ===== BLE =====
+NimBLEScan* pBLEScan;
+ClickDetector detector(rfRemotePin);  // GPIO35
+MicBarkDetector mic(micSckPin, micWsPin, micSdPin);
+AudioClipRecorder clipRecorder(2000, 1000, MIC_SAMPLE_RATE);  // 2 s before, 1 s after a bark
+
+// Bark/remote/button handling, rewards and corrections (the part of loop() tools/trace_replay runs)
+TrainerLoop trainer({waterPin, vibrationPin, ledPin, barkButtonPin, waterButtonPin, feederButtonPin},
+                    actuatorTrace, feeder, toneEngine, markerCue, detector, quietMgr, bleBarkWindow,
+                    correctionPolicy, barkFusion, journal, session, program);
 
 // BLE callbacks → on bark, notify manager (affects manager)
 class MyAdvertisedDeviceCallbacks : public NimBLEAdvertisedDeviceCallbacks {
   void onResult(NimBLEAdvertisedDevice* d) override {
-    std::string deviceName = d->getName();
-    if (deviceName == ADV_NAME) {
-      std::string mfgData = d->getManufacturerData();
-      if (mfgData.find(ADV_TAG) != std::string::npos) {
-
-        uint32_t now = millis();
-
-        // Check window before punishing
-        if (bleBarkWindow.shouldPunish(now)) {
-          quietMgr.onBark(now);  // enqueue punishment + reset quiet window
-          startPunishment(MANUAL_PUNISH_MS);
-          Serial.printf("📱 BLE Bark Detected. RSSI: %d dBm\n", d->getRSSI());
-        }
-        // If shouldPunish returns false, bark is logged but ignored
+    scanDuty.onAdvert();
+    uint16_t sensorId = 0;
+    uint32_t seq = 0;
+    {
+      PerfScope ps(perfBleFilter);
+      if (!d->haveManufacturerData()) return;
+      std::string mfg = d->getManufacturerData();
+
+      BarkAuthResult r;
+      {
+        PerfScope pa(perfBleAuth);
+        r = barkAuth.verify((const uint8_t*)mfg.data(), mfg.size(), sensorId, seq);
+      }
+      if (r == BARK_AUTH_NOT_OURS) {
+        if (barkAuth.hasSensors() || !d->haveName()) return;
+        // Legacy name/tag match, only while no sensor is paired so existing
+        // sensors keep working until keys are provisioned
+        if (!isBarkAdvertisement(d->getName(), mfg, ADV_NAME, ADV_TAG)) return;
+        sensorId = 0;  // Legacy sensor
+      } else if (r != BARK_AUTH_OK) {
+        return;
       }
     }
+
+    cpuGovernor.noteActivity();  // Boost before the bark goes through fusion
+    barkFusion.report(BARK_SRC_BLE, millis());
+    Serial.printf("📱 BLE Bark reported (sensor %u, seq %lu). RSSI: %d dBm\n",
+                  sensorId, (unsigned long)seq, d->getRSSI());
   }
 };
 
@@ -161,12 +299,1008 @@ void initBLEScan() {
   pBLEScan = NimBLEDevice::getScan();
   pBLEScan->setAdvertisedDeviceCallbacks(new MyAdvertisedDeviceCallbacks(), true);
   pBLEScan->setActiveScan(false);
-  pBLEScan->setInterval(SCAN_INTERVAL_UNITS);
-  pBLEScan->setWindow(SCAN_WINDOW_UNITS);
+  pBLEScan->setDuplicateFilter(!barkAuth.hasSensors());  // See applyScanParams()
+  pBLEScan->setInterval(scanTuner.params().intervalUnits);
+  pBLEScan->setWindow(scanTuner.params().windowUnits);
   pBLEScan->setMaxResults(0);
   Serial.println("✅ BLE scan configured successfully.");
 }
 
+bool gattConnected() {
+#if ENABLE_GATT_SERVICE
+  return gattService.isConnected();
+#else
+  return false;
+#endif
+}
+
+// ===== Training session =====
+void startSession(SessionCause cause, uint32_t maxMs) {
+  uint32_t now = millis();
+  uint16_t id = sessionPrefs.getUShort("id", 0) + 1;
+  if (!session.start(id, cause, quietMgr.currentLevel(), now, maxMs)) {
+    Serial.printf("🎬 Session %u already running\n", session.id());
+    return;
+  }
+  sessionPrefs.putUShort("id", id);
+  journal.log(JEV_SESSION_START, cause, id);
+  toneEngine.play(CUE_RESET);
+  Serial.printf("🎬 Session %u started (%s, max %lu min)\n", id, TrainingSession::causeName(cause),
+                (unsigned long)(maxMs / 60000));
+}
+
+void printSessionSummary(const SessionSummary& s) {
+  Serial.printf("   #%u %s → %s, %lu s\n", s.id, TrainingSession::causeName(s.startCause),
+                TrainingSession::causeName(s.endCause), (unsigned long)(s.durationMs / 1000));
+  Serial.printf("   Barks %u, rewards %u, corrections %u, quiet successes %u\n", s.barks, s.rewards,
+                s.punishments, s.successes);
+  Serial.printf("   Longest quiet %lu s, level %u → %u\n", (unsigned long)(s.longestQuietMs / 1000),
+                s.startLevel, s.endLevel);
+  for (uint8_t i = 0; i < SESSION_MAX_LEVELS; i++) {
+    if (s.secondsAtLevel[i]) Serial.printf("   Level %u: %u s\n", i, s.secondsAtLevel[i]);
+  }
+}
+
+// End the session and journal its summary (END, then one STAT record per figure)
+void stopSession(SessionCause cause) {
+  if (!session.stop(cause, millis())) {
+    Serial.println("🎬 No session running");
+    return;
+  }
+  const SessionSummary& s = session.last();
+  journal.log(JEV_SESSION_END, cause, s.id);
+  TrainingSession::forEachStat(s, [](uint8_t stat, uint16_t value) {
+    journal.log(JEV_SESSION_STAT, stat, value);
+  });
+  toneEngine.play(CUE_RESET);
+  Serial.println("🏁 Session ended:");
+  printSessionSummary(s);
+}
+
+void updateSession(uint32_t now) {
+  if (session.expired(now)) stopSession(SESS_MAX_DURATION);
+  if (sessionEveryMs > 0 && (int32_t)(now - nextSessionMs) >= 0) {
+    nextSessionMs += sessionEveryMs;
+    if (!session.isActive()) startSession(SESS_SCHEDULE, sessionLengthMs);
+  }
+}
+
+// ===== Wall clock and schedule =====
+// Gates for the current local minute; everything runs while the clock is unset
+uint8_t scheduledGates(uint32_t* secondsToEdge) {
+  uint8_t weekday;
+  uint16_t minute;
+  if (!wallClock.local(weekday, minute)) {
+    if (secondsToEdge) *secondsToEdge = 0;
+    return GATE_AWAKE_ALL;
+  }
+  if (secondsToEdge) {
+    uint16_t m = min<uint16_t>(schedule.minutesToNextEdge(minute), SLEEP_MAX_MIN);
+    *secondsToEdge = m * 60UL - wallClock.now() % 60;
+  }
+  return schedule.gatesAt(weekday, minute);
+}
+
+void saveRtcState() {
+  rtcState.magic = RTC_STATE_MAGIC;
+  rtcState.lastSyncUnix = wallClock.lastSyncUnix();
+  rtcState.clockSource = wallClock.source();
+  rtcState.correctionLadderOn = trainer.correctionLadderEnabled();
+  rtcState.sessionMaxMs = sessionMaxMs;
+  rtcState.sessionEveryMs = sessionEveryMs;
+  rtcState.sessionLengthMs = sessionLengthMs;
+}
+
+// Deep sleep until the next schedule edge; the timer wake comes back through setup()
+void enterNightSleep(uint32_t seconds) {
+  if (session.isActive()) stopSession(SESS_SCHEDULE);
+  actuatorTrace.write(waterPin, LOW);
+  actuatorTrace.write(vibrationPin, LOW);
+  actuatorTrace.write(ledPin, LOW);
+  if (pBLEScan && pBLEScan->isScanning()) pBLEScan->stop();
+  journal.log(JEV_SLEEP, 0, (uint16_t)(seconds / 60));
+  barkAuth.persistSeqs(millis(), true);  // RTC has them too, but not across a power cut
+  saveRtcState();
+  rtcState.sleeps++;
+  rtcState.sleptAtUnix = wallClock.now();
+  Serial.printf("🌙 Deep sleep for %lu min (sleep #%lu)\n", (unsigned long)(seconds / 60),
+                (unsigned long)rtcState.sleeps);
+  Serial.flush();
+  esp_sleep_enable_timer_wakeup((uint64_t)seconds * 1000000ULL);
+  esp_deep_sleep_start();
+}
+
+void applyScheduleGates(uint8_t gates, uint32_t now) {
+  uint8_t changed = gates ^ trainer.gates();
+  if (!changed) return;
+  journal.log(JEV_SCHEDULE, gates, trainer.gates());
+  Serial.printf("🕒 Schedule: %s → %s\n", ScheduleTable::gatesName(trainer.gates()).c_str(),
+                ScheduleTable::gatesName(gates).c_str());
+  trainer.setGates(gates);
+  // The paused time must not count as quiet; also cancels a pre-armed treat/marker
+  if (changed & GATE_TRAIN) quietMgr.restartQuiet(now);
+  if ((changed & GATE_SCAN) && !(gates & GATE_SCAN) && pBLEScan->isScanning()) pBLEScan->stop();
+  if (changed & GATE_SESSION) {
+    if (gates & GATE_SESSION) startSession(SESS_SCHEDULE, 0);
+    else if (session.isActive()) stopSession(SESS_SCHEDULE);
+  }
+}
+
+void updateSchedule(uint32_t now) {
+  if (sntpSynced) {
+    sntpSynced = false;
+    wallClock.noteSync(CLOCK_SNTP);
+    Serial.println("🕒 Clock synced (SNTP)");
+  }
+  if (now - lastScheduleCheckMs < SCHEDULE_CHECK_MS) return;
+  lastScheduleCheckMs = now;
+  uint32_t secondsToEdge;
+  uint8_t gates = scheduledGates(&secondsToEdge);
+  applyScheduleGates(gates, now);
+  // Finish a dispense or correction first
+  if ((gates & GATE_SLEEP) && secondsToEdge > 0 && !feeder.isBusy() && !trainer.isPunishing()) {
+    enterNightSleep(secondsToEdge);
+  }
+}
+
+void saveSchedule() {
+  if (schedule.count()) schedPrefs.putBytes("table", schedule.data(), schedule.dataLen());
+  else schedPrefs.remove("table");
+}
+
+// ===== Scan tuning =====
+// New window/interval only take effect on a scan start; loop() restarts it.
+// Paired sensors need every copy of a burst (sequence numbers tell repeats
+// apart, and the tuner counts them); legacy adverts carry no sequence, so
+// while none is paired the controller's duplicate filter stays on and one
+// advert burst stays one bark.
+void applyScanParams() {
+  const ScanParams& sp = scanTuner.params();
+  if (pBLEScan->isScanning()) pBLEScan->stop();
+  pBLEScan->setDuplicateFilter(!barkAuth.hasSensors());
+  pBLEScan->setInterval(sp.intervalUnits);
+  pBLEScan->setWindow(sp.windowUnits);
+  Serial.printf("📡 Scan %u/%u units (%u.%u%% duty), missed %u.%u%% last epoch\n", sp.windowUnits,
+                sp.intervalUnits, scanTuner.dutyPermille() / 10, scanTuner.dutyPermille() % 10,
+                scanTuner.lastMissPermille() / 10, scanTuner.lastMissPermille() % 10);
+}
+
+void updateScanTuning(uint32_t now) {
+  if (now - lastScanTuneMs < SCAN_TUNE_CHECK_MS) return;
+  lastScanTuneMs = now;
+  uint32_t heard, missed, copies;
+  barkAuth.receptionTotals(heard, missed, copies);
+  if (scanTuner.update(heard, missed, copies)) applyScanParams();
+}
+
+void printScanReport() {
+  const ScanParams& sp = scanTuner.params();
+  uint32_t heard, missed, copies;
+  barkAuth.receptionTotals(heard, missed, copies);
+  Serial.printf("\n📡 SCAN (%s, rung %u/%u):\n", scanTuner.isAuto() ? "auto" : "fixed", scanTuner.level() + 1,
+                SCAN_LADDER_LEN);
+  Serial.printf("   Window %u / interval %u units (%.1f%% duty)\n", sp.windowUnits, sp.intervalUnits,
+                scanTuner.dutyPermille() / 10.0);
+  Serial.printf("   Barks heard %lu, missed %lu (%.1f%%), %.2f copies/bark\n", (unsigned long)heard,
+                (unsigned long)missed, heard + missed ? 100.0 * missed / (heard + missed) : 0.0,
+                heard ? (double)copies / heard : 0.0);
+  Serial.printf("   Last epoch: missed %.1f%% (target %.1f%%), advert capture %.1f%%, %lu decisions, %lu steps\n",
+                scanTuner.lastMissPermille() / 10.0, scanTuner.targetPermille() / 10.0,
+                scanTuner.captureProbPermille() / 10.0, (unsigned long)scanTuner.decisions(),
+                (unsigned long)scanTuner.steps());
+  uint8_t burst = scanTuner.recommendedBurst();
+  if (burst) Serial.printf("   Sensor burst: %u adverts, %u needed for the target at this rung\n", scanTuner.burst(), burst);
+  else Serial.printf("   Sensor burst: %u adverts (no estimate yet)\n", scanTuner.burst());
+  if (!barkAuth.hasSensors()) Serial.println("   (no paired sensors: legacy adverts carry no sequence numbers)");
+  Serial.println();
+}
+
+// ===== Training program =====
+// Build the manager's level table from the program and hand it level control
+void applyProgram(uint8_t phase, uint32_t now) {
+  for (uint8_t i = 0; i < program.phaseCount(); i++) {
+    const TpPhase& p = program.phase(i);
+    for (uint8_t s = 0; s < p.patternLen; s++) programPatterns[i][s] = TrainingProgram::patternSlot(p, s);
+    programLevels[i] = { p.quietMs, p.dispenseMs, programPatterns[i], p.patternLen,
+                         (p.flags & TP_FLAG_SHUFFLE) != 0 };
+  }
+  quietMgr.useLevels(programLevels, program.phaseCount(), true);
+  trainer.startProgram(phase, now);
+}
+
+void clearProgram() {
+  program.unload();
+  programPrefs.remove("image");
+  programPrefs.remove("phase");
+  quietMgr.useLevels(LEVELS, LEVEL_COUNT, false);
+  quietMgr.setCooldownMs(REWARD_COOLDOWN_MS);
+  Serial.println("📜 Program cleared - back to the built-in levels");
+}
+
+void commitProgram() {
+  uint8_t phase = 0;
+  TpError e = programLoader.commit(program, &phase);
+  if (e != TP_OK) {
+    Serial.printf("❌ Program rejected: %s (phase %u)\n", TrainingProgram::errorName(e), phase);
+    return;
+  }
+  programPrefs.putBytes("image", program.image(), program.imageLen());
+  applyProgram(program.phaseIndex(), millis());  // load() leaves the start phase selected
+  char name[TP_NAME_LEN + 1];
+  program.name(name);
+  Serial.printf("📜 Program '%s' loaded: %u phases, %u bytes\n", name, program.phaseCount(),
+                (unsigned)program.imageLen());
+}
+
+// Binary upload chunk (GATT program characteristic)
+void handleProgramChunk(const uint8_t* data, size_t len) {
+  TpUploadOp op = programLoader.chunk(data, len);
+  if (op == TP_OP_COMMIT) commitProgram();
+  else if (op == TP_OP_CLEAR) clearProgram();
+}
+
+// Resume the stored program at its last phase
+void loadStoredProgram() {
+  programPrefs.begin("trainProg", false);
+  static uint8_t image[TP_MAX_IMAGE];
+  size_t n = programPrefs.getBytes("image", image, sizeof(image));
+  if (n == 0) return;
+  TpError e = program.load(image, n);
+  if (e != TP_OK) {
+    Serial.printf("❌ Stored program invalid (%s) - using built-in levels\n", TrainingProgram::errorName(e));
+    return;
+  }
+  applyProgram(programPrefs.getUChar("phase", program.phaseIndex()), millis());
+  char name[TP_NAME_LEN + 1];
+  program.name(name);
+  Serial.printf("📜 Program '%s' resumed at phase %u/%u\n", name, program.phaseIndex(), program.phaseCount());
+}
+
+#if ENABLE_GATT_SERVICE
+// Mic on/off; fusion only waits for the mic while it can report
+void setMicEnabled(bool on) {
+  mic.setEnabled(on);
+  barkFusion.setSourceEnabled(BARK_SRC_MIC, mic.isRunning());
+}
+
+void initGattService() {
+  gattService.setLevelCallbacks(
+    []() { return quietMgr.currentLevel(); },
+    [](uint8_t level) {
+      if (level >= quietMgr.levelCount()) return;
+      quietMgr.setLevel(level, millis());
+      Serial.printf("📲 GATT: QuietMgr level set to %u\n", level);
+    });
+  gattService.setConfigCallbacks(
+    [](TrainerConfig& c) {
+      c.fusionPolicy = barkFusion.policy();
+      c.fusionWindowMs = (uint16_t)barkFusion.window();
+      c.rfMinQuality = (uint8_t)detector.getMinQuality();
+      c.micEnabled = mic.isEnabled();
+      c.classifierEnabled = mic.dsp().config().useClassifier;
+      c.quietLogging = quietMgr.loggingEnabled();
+    },
+    [](const TrainerConfig& c) {
+      if (c.fusionPolicy <= FUSION_WEIGHTED) barkFusion.setPolicy((FusionPolicy)c.fusionPolicy);
+      if (c.fusionWindowMs <= 1000) barkFusion.setWindow(c.fusionWindowMs);
+      detector.setMinQuality(constrain((int)c.rfMinQuality, 0, 100));
+      setMicEnabled(c.micEnabled != 0);
+      mic.dsp().config().useClassifier = c.classifierEnabled != 0;
+      quietMgr.setLogging(c.quietLogging != 0);
+      Serial.println("📲 GATT: config updated");
+    });
+  gattService.setProgramCallbacks(
+    [](TrainerProgramStatus& s) {
+      s.loaded = program.isLoaded();
+      s.phase = program.phaseIndex();
+      s.phaseCount = program.phaseCount();
+      s.lastError = programLoader.lastError();
+      s.stagedBytes = programLoader.written();
+      s.expectedBytes = programLoader.expected();
+    },
+    [](const uint8_t* data, size_t len) { handleProgramChunk(data, len); });
+  gattService.setMetricsProvider([](TrainerMetrics& m) {
+    m.uptimeMs = millis();
+    m.level = quietMgr.currentLevel();
+    m.successesAtLevel = quietMgr.successesAtLevel();
+    m.scanAdvPerSecX10 = scanDuty.lastRateX10();
+    m.quietTargetMs = quietMgr.currentQuietTargetMs();
+    m.journalSeq = journal.nextSeq();
+    m.barksFused = barkFusion.fusedCount();
+    m.freeHeap = ESP.getFreeHeap();
+    m.treatsDispensed = feeder.dispensedCount();
+    m.treatsFailed = feeder.failedCount();
+    uint32_t heard, missed, copies;
+    barkAuth.receptionTotals(heard, missed, copies);
+    m.barksMissed = missed;
+    m.barkMissPermille = scanTuner.lastMissPermille();
+    m.scanWindowUnits = scanTuner.params().windowUnits;
+    m.scanIntervalUnits = scanTuner.params().intervalUnits;
+    m.recommendedBurst = scanTuner.recommendedBurst();
+    m.rfSignalQuality = (int8_t)detector.getSignalQuality();
+    m.rfLowQualityRejects = detector.getLowQualityRejects();
+  });
+  gattService.begin();
+}
+#endif
+
+// ===== Serial console =====
+// Non-blocking, bounded line reader: never waits for a newline and drops
+// lines longer than SERIAL_LINE_MAX instead of growing without limit.
+bool readSerialLine(String& out) {
+  static LineReader<SERIAL_LINE_MAX> reader;
+
+  while (Serial.available()) {
+    int c = Serial.read();
+    if (c < 0) break;
+    LineStatus st = reader.push((char)c);
+    if (st == LINE_TOO_LONG) {
+      Serial.println("❓ Command too long - ignored");
+    } else if (st == LINE_READY) {
+      out = reader.line();
+      return true;
+    }
+  }
+  return false;
+}
+
+// Decimal argument starting at cmd[pos] (see parseDecimal)
+bool parseIntArg(const String& cmd, int pos, int& value) {
+  int64_t v;
+  if (pos > (int)cmd.length() || !parseDecimal(cmd.c_str() + pos, -CONSOLE_INT_LIMIT, CONSOLE_INT_LIMIT, v))
+    return false;
+  value = (int)v;
+  return true;
+}
+
+// 32 hex digits → 16-byte key
+bool parseHexKey(const String& s, uint8_t key[16]) {
+  return parseHexBytes(s.c_str(), key, 16) == 16;
+}
+
+void printFusionStatus() {
+  Serial.printf("   Bark Fusion: %s, window %lu ms, fused %lu, latency last/max %lu/%lu ms\n",
+                BarkFusion::policyName(barkFusion.policy()),
+                (unsigned long)barkFusion.window(), (unsigned long)barkFusion.fusedCount(),
+                (unsigned long)barkFusion.lastLatencyMs(), (unsigned long)barkFusion.maxLatencyMs());
+  for (uint8_t s = 0; s < BARK_SRC_COUNT; s++) {
+    const BarkFusion::SourceStats& st = barkFusion.stats((BarkSource)s);
+    Serial.printf("     %-3s w=%u reported %lu, confirmed %lu, solo %lu, unconfirmed %lu\n",
+                  BarkFusion::sourceName((BarkSource)s), barkFusion.weight((BarkSource)s),
+                  (unsigned long)st.reported, (unsigned long)st.confirmed,
+                  (unsigned long)st.solo, (unsigned long)st.unconfirmed);
+  }
+}
+
+void handleSerialCommand(String cmd) {
+  PerfScope ps(perfSerial);
+  cmd.trim(); cmd.toLowerCase();
+
+  if (cmd == "status") {
+    String detectorStatus;
+    detector.getStatus(detectorStatus);
+    Serial.println("\n📊 SYSTEM STATUS:");
+    Serial.printf("   Remote Detector: %s\n", detectorStatus.c_str());
+    String micStatus;
+    mic.getStatus(micStatus);
+    Serial.printf("   Microphone: %s, %lu self-tone reports muted\n", micStatus.c_str(), trainer.micSelfNoiseCount());
+    String feederStatus;
+    feeder.getStatus(feederStatus);
+    Serial.printf("   Feeder: %s\n", feederStatus.c_str());
+    String toneStatus;
+    toneEngine.getStatus(toneStatus);
+    Serial.printf("   Tones: %s\n", toneStatus.c_str());
+    String cueStatus;
+    markerCue.getStatus(cueStatus);
+    Serial.printf("   Marker Cue: %s\n", cueStatus.c_str());
+    String clipStatus;
+    clipRecorder.getStatus(clipStatus);
+    Serial.printf("   Bark Clips: %s\n", clipStatus.c_str());
+    printFusionStatus();
+#if ENABLE_TELEMETRY
+    String telemetryStatus;
+    telemetry.getStatus(telemetryStatus);
+    Serial.printf("   Telemetry: %s\n", telemetryStatus.c_str());
+#endif
+#if ENABLE_BARK_RELAY
+    String relayStatus;
+    espNow.getStatus(relayStatus);
+    const BarkRelay::Stats& rs = barkRelay.stats();
+    Serial.printf("   Bark Relay: %s, %s, peers %u, sent %lu, received %lu, dup %lu, lost %lu, restarts %lu\n",
+                  barkRelay.isEnabled() ? "on" : "off", relayStatus.c_str(), barkRelay.peerCount(),
+                  (unsigned long)rs.sent, (unsigned long)rs.received,
+                  (unsigned long)rs.duplicates, (unsigned long)rs.lost, (unsigned long)rs.restarts);
+#endif
+    Serial.printf("   Journal: %lu events\n", (unsigned long)journal.nextSeq());
+    Serial.printf("   BLE Scan: %s\n", pBLEScan->isScanning() ? "Active" : "Stopped");
+    String dutyStatus;
+    scanDuty.getStatus(dutyStatus);
+    Serial.printf("   Scan Duty: %s\n", dutyStatus.c_str());
+    Serial.printf("   Scan Tuning: %s, %u/%u units, missed %.1f%% (target %.1f%%)\n",
+                  scanTuner.isAuto() ? "auto" : "fixed", scanTuner.params().windowUnits,
+                  scanTuner.params().intervalUnits, scanTuner.lastMissPermille() / 10.0,
+                  scanTuner.targetPermille() / 10.0);
+#if ENABLE_GATT_SERVICE
+    String gattStatus;
+    gattService.getStatus(gattStatus);
+    Serial.printf("   GATT: %s\n", gattStatus.c_str());
+#endif
+    Serial.printf("   QuietMgr Level: %u\n", quietMgr.currentLevel());
+    Serial.printf("   QuietMgr Successes: %u\n", quietMgr.successesAtLevel());
+    Serial.printf("   Quiet Target: %lu ms", (unsigned long)quietMgr.currentQuietTargetMs());
+    if (quietMgr.adaptiveShaping()) {
+      const P2Quantile& iv = quietMgr.barkIntervals();
+      Serial.printf(" (adaptive p%d of %lu intervals: %lu ms)", (int)(iv.quantile() * 100 + 0.5f),
+                    (unsigned long)iv.count(), (unsigned long)iv.value());
+    }
+    Serial.println();
+    if (program.isLoaded()) {
+      char name[TP_NAME_LEN + 1];
+      program.name(name);
+      Serial.printf("   Program: '%s' phase %u/%u\n", name, program.phaseIndex(), program.phaseCount());
+    }
+    String cpuStatus;
+    cpuGovernor.getStatus(cpuStatus);
+    Serial.printf("   CPU: %s\n", cpuStatus.c_str());
+    if (schedule.count())
+      Serial.printf("   Schedule: %s\n", ScheduleTable::gatesName(trainer.gates()).c_str());
+    if (session.isActive())
+      Serial.printf("   Session: #%u, %lu min\n", session.id(), (unsigned long)(session.elapsedMs(millis()) / 60000));
+    Serial.printf("   Last Bark: %lu ms ago\n\n", (unsigned long)(millis() - quietMgr.lastBarkMs()));
+  }
+  else if (cmd == "qreset") {
+    quietMgr.resetState();
+    journal.log(JEV_RESET);
+    Serial.println("🔄 QuietMgr reset");
+  }
+  else if (cmd.startsWith("qlevel")) {
+    int lvl = 0;
+    if (!parseIntArg(cmd, 6, lvl) || lvl < 0 || lvl >= quietMgr.levelCount()) {
+      Serial.printf("❓ Usage: qlevel 0-%u\n", quietMgr.levelCount() - 1);
+      return;
+    }
+    quietMgr.setLevel((uint8_t)lvl, millis());
+    Serial.printf("🔧 QuietMgr level set to %d\n", lvl);
+  }
+  else if (cmd.startsWith("rfqual")) {
+    int q = 0;
+    if (!parseIntArg(cmd, 6, q)) {
+      Serial.println("❓ Usage: rfqual 0-100");
+      return;
+    }
+    q = constrain(q, 0, 100);
+    detector.setMinQuality(q);
+    Serial.printf("📶 Remote min signal quality set to %d\n", q);
+  }
+  else if (cmd == "bark") {
+    // Same path as the bark button, for scripted scenarios
+    Serial.println("🐕 Console bark → manager bark");
+    trainer.handleManualBark(millis());
+  }
+  else if (cmd == "corr") {
+    uint32_t now = millis();
+    Serial.printf("\n🚨 CORRECTION LADDER (%s, window %lu s, %lu barks in window, %lu repeat reports merged):\n",
+                  trainer.correctionLadderEnabled() ? "on" : "off - fixed full correction",
+                  (unsigned long)(correctionPolicy.windowMs() / 1000),
+                  (unsigned long)correctionPolicy.barksInWindow(now),
+                  (unsigned long)correctionPolicy.mergedReports());
+    for (uint8_t i = 0; i < correctionPolicy.rungCount(); i++) {
+      const CorrectionRung& r = correctionPolicy.rung(i);
+      Serial.printf("   %u: >=%u barks → %s %u ms (used %lu)\n", i, r.minBarks,
+                    CorrectionPolicy::outputsName(r.outputs).c_str(), r.durationMs,
+                    (unsigned long)correctionPolicy.decisions(i));
+    }
+    Serial.println();
+  }
+  else if (cmd == "corr on") {
+    trainer.setCorrectionLadder(true);  Serial.println("🚨 Correction ladder: ON");
+  }
+  else if (cmd == "corr off") {
+    trainer.setCorrectionLadder(false); Serial.println("🚨 Correction ladder: OFF (fixed full correction)");
+  }
+  else if (cmd.startsWith("corr window ")) {
+    int sec;
+    if (!parseIntArg(cmd, 12, sec) || sec < 12 || sec > 3600) {
+      Serial.println("❓ Usage: corr window 12-3600 (seconds)");
+      return;
+    }
+    correctionPolicy.setWindow((uint32_t)sec * 1000);
+    Serial.printf("🚨 Correction window set to %d s (history cleared)\n", sec);
+  }
+  else if (cmd == "mic on") {
+    setMicEnabled(true);  Serial.println("🎤 Microphone bark detection: ON");
+    if (!mic.isRunning()) Serial.println("⚠️  Microphone not installed (I2S failed): BLE only");
+  }
+  else if (cmd == "mic off") {
+    setMicEnabled(false); Serial.println("🎤 Microphone bark detection: OFF");
+  }
+  else if (cmd == "mic cls on") {
+    mic.dsp().config().useClassifier = true;  Serial.println("🎤 Bark classifier: ON");
+    if (!BARK_CLS_MODEL_TRAINED) Serial.println("⚠️  Hand-set weights, not a trained model: evaluate before relying on it");
+  }
+  else if (cmd == "mic cls off") {
+    mic.dsp().config().useClassifier = false; Serial.println("🎤 Bark classifier: OFF (energy/band rule only)");
+  }
+  else if (cmd == "clips") {
+    clipRecorder.listClips();
+  }
+  else if (cmd == "clips clear") {
+    clipRecorder.clearClips();
+    Serial.println("🎙️  Bark clips deleted");
+  }
+  else if (cmd.startsWith("clip dump")) {
+    int id = 0;
+    if (!parseIntArg(cmd, 9, id) || !clipRecorder.dumpClip(id)) {
+      Serial.println("❓ Usage: clip dump N (see 'clips')");
+    }
+  }
+  else if (cmd == "fusion any" || cmd == "fusion all" || cmd == "fusion weighted") {
+    FusionPolicy p = cmd.endsWith("all") ? FUSION_ALL :
+                     (cmd.endsWith("weighted") ? FUSION_WEIGHTED : FUSION_ANY);
+    barkFusion.setPolicy(p);
+    Serial.printf("🔀 Bark fusion policy: %s\n", BarkFusion::policyName(p));
+    if (p == FUSION_ALL && !mic.isRunning()) {
+      Serial.println("⚠️  Mic is not running: 'all' accepts BLE barks alone until it is");
+    }
+  }
+  else if (cmd.startsWith("fusion window")) {
+    int ms = 0;
+    if (!parseIntArg(cmd, 13, ms) || ms < 0 || ms > 1000) {
+      Serial.println("❓ Usage: fusion window 0-1000");
+      return;
+    }
+    barkFusion.setWindow(ms);
+    Serial.printf("🔀 Bark fusion window: %d ms\n", ms);
+  }
+  else if (cmd.startsWith("fusion weight ble") || cmd.startsWith("fusion weight mic")) {
+    int w = 0;
+    if (!parseIntArg(cmd, 17, w) || w < 0 || w > 255) {
+      Serial.println("❓ Usage: fusion weight ble|mic 0-255");
+      return;
+    }
+    BarkSource src = cmd.startsWith("fusion weight ble") ? BARK_SRC_BLE : BARK_SRC_MIC;
+    barkFusion.setWeight(src, w);
+    Serial.printf("🔀 %s weight: %d\n", BarkFusion::sourceName(src), w);
+  }
+  else if (cmd.startsWith("fusion threshold")) {
+    int t = 0;
+    if (!parseIntArg(cmd, 16, t) || t < 0 || t > 1000) {
+      Serial.println("❓ Usage: fusion threshold 0-1000");
+      return;
+    }
+    barkFusion.setThreshold(t);
+    Serial.printf("🔀 Fusion threshold: %d\n", t);
+  }
+  else if (cmd == "fusion reset") {
+    barkFusion.resetStats();
+    Serial.println("🔀 Fusion stats reset");
+  }
+  else if (cmd == "perf") {
+    PerfProbe::printAll();
+  }
+  else if (cmd == "perf reset") {
+    PerfProbe::resetAll();
+    Serial.println("⏱️  Perf counters reset");
+  }
+#if ENABLE_PERF_BENCH
+  else if (cmd == "perf bench" || cmd.startsWith("perf bench ")) {
+    String filter = cmd.length() > 11 ? cmd.substring(11) : String();
+    if (!PerfBench::runAll(filter.c_str())) Serial.printf("❓ No benchmark matches '%s'\n", filter.c_str());
+  }
+#endif
+  else if (cmd == "trace start") {
+    actuatorTrace.start();
+    Serial.println("🧾 Actuator trace: recording");
+  }
+  else if (cmd == "trace stop") {
+    actuatorTrace.stop();
+    Serial.printf("🧾 Actuator trace: stopped (%u edges)\n", actuatorTrace.count());
+  }
+  else if (cmd == "feeder test") {
+    trainer.dispenseTreat(MANUAL_REWARD_MS);
+  }
+  else if (cmd == "feeder clear") {
+    feeder.clearJam();
+    Serial.println("🍖 Feeder jam alarm cleared");
+  }
+  else if (cmd == "cue on") {
+    markerCue.setEnabled(true);  Serial.println("🔔 Marker cue: ON");
+  }
+  else if (cmd == "cue off") {
+    markerCue.setEnabled(false); Serial.println("🔔 Marker cue: OFF");
+  }
+  else if (cmd == "cue test") {
+    markerCue.fire(CUE_MARKER);
+  }
+  else if (cmd == "tones on") {
+    toneEngine.setEnabled(true);  Serial.println("🔊 Tones: ON");
+  }
+  else if (cmd == "tones off") {
+    toneEngine.setEnabled(false); Serial.println("🔊 Tones: OFF");
+  }
+  else if (cmd == "trace dump") {
+    actuatorTrace.dump();
+  }
+#if ENABLE_BARK_RELAY
+  else if (cmd == "relay on") {
+    barkRelay.setEnabled(true);
+    Serial.println("📨 Bark relay: ON");
+  }
+  else if (cmd == "relay off") {
+    barkRelay.setEnabled(false);
+    Serial.println("📨 Bark relay: OFF");
+  }
+#endif
+  else if (cmd.startsWith("pair ")) {
+    // pair N          → generate a key for sensor N and print it for flashing
+    // pair N <32 hex> → install a key provisioned elsewhere
+    int sp = cmd.indexOf(' ', 5);
+    int id = 0;
+    uint8_t key[16];
+    if (!parseIntArg(sp < 0 ? cmd : cmd.substring(0, sp), 4, id) || id < 1 || id > 65535 ||
+        (sp >= 0 && !parseHexKey(cmd.substring(sp + 1), key))) {
+      Serial.println("❓ Usage: pair 1-65535 [32 hex digit key]");
+      return;
+    }
+    if (sp < 0) {
+      for (int i = 0; i < 16; i += 4) {
+        uint32_t r = esp_random();
+        memcpy(key + i, &r, 4);
+      }
+    }
+    if (!barkAuth.pair((uint16_t)id, key)) {
+      Serial.printf("❌ No free sensor slot (max %d)\n", BARK_AUTH_MAX_SENSORS);
+      return;
+    }
+    scanTuner.restartEpoch();  // The slot's counters started over
+    applyScanParams();         // First paired sensor: duplicate filter off
+    Serial.printf("🔑 Sensor %d paired, key: ", id);
+    for (int i = 0; i < 16; i++) Serial.printf("%02x", key[i]);
+    Serial.println();
+  }
+  else if (cmd.startsWith("unpair")) {
+    int id = 0;
+    if (!parseIntArg(cmd, 6, id) || id < 1 || id > 65535) {
+      Serial.println("❓ Usage: unpair 1-65535");
+      return;
+    }
+    Serial.println(barkAuth.unpair((uint16_t)id) ? "🔑 Sensor unpaired" : "❓ Sensor not paired");
+    scanTuner.restartEpoch();
+    applyScanParams();  // Last one gone: legacy adverts need the duplicate filter again
+  }
+  else if (cmd == "sensors") {
+    barkAuth.printSensors();
+  }
+  else if (cmd == "auth bench") {
+    // Cost of one MAC check as done in the filter stage, with a throwaway key
+    uint8_t key[16] = {};
+    BarkAdvPayload p;
+    BarkAuth::sign(key, 1, 1, 0, p);
+    SipHashKey k;
+    sipHashPrepare(key, k);
+    const int runs = 1000;
+    volatile bool ok = true;
+    uint32_t t0 = perfCycles();
+    for (int i = 0; i < runs; i++) {
+      uint64_t mac = sipHash24(k, (const uint8_t*)&p, offsetof(BarkAdvPayload, mac));
+      ok = ok && BarkAuth::macEqual(mac, p.mac);
+    }
+    uint32_t cycles = (perfCycles() - t0) / runs;
+    Serial.printf("⏱️  SipHash-2-4 verify: %lu cycles (%.2f us) per packet%s\n", (unsigned long)cycles,
+                  cycles / (float)getCpuFrequencyMhz(), ok ? "" : " - MISMATCH");
+  }
+  else if (cmd.startsWith("journal")) {
+    int n = JOURNAL_DUMP_DEFAULT;
+    if (cmd.length() > 7 && (!parseIntArg(cmd, 7, n) || n <= 0)) {
+      Serial.println("❓ Usage: journal [N]");
+      return;
+    }
+    journal.dump((uint16_t)min(n, (int)EventJournal::CAPACITY), wallClock.isValid() ? wallClock.now() : 0);
+  }
+  else if (cmd == "qlog on") {
+    quietMgr.setLogging(true);  Serial.println("📝 QuietMgr logging: ON");
+  }
+  else if (cmd == "qlog off") {
+    quietMgr.setLogging(false); Serial.println("📝 QuietMgr logging: OFF");
+  }
+  else if (cmd == "cpu") {
+    cpuGovernor.printReport();
+  }
+  else if (cmd == "cpu auto") {
+    cpuGovernor.setAuto(true);  Serial.println("⚡ CPU clock: auto");
+  }
+  else if (cmd == "cpu fixed") {
+    cpuGovernor.setAuto(false); Serial.printf("⚡ CPU clock: fixed at %u MHz\n", CPU_FREQ_HIGH_MHZ);
+  }
+  else if (cmd == "cpu reset") {
+    cpuGovernor.resetStats();   Serial.println("⚡ CPU clock stats reset");
+  }
+  else if (cmd == "scan") {
+    printScanReport();
+  }
+  else if (cmd == "scan tune on" || cmd == "scan tune off") {
+    bool on = cmd == "scan tune on";
+    if (scanTuner.setAuto(on)) applyScanParams();
+    Serial.printf("📡 Scan tuning: %s\n", on ? "auto" : "off (full duty)");
+  }
+  else if (cmd.startsWith("scan target")) {
+    int permille = 0;
+    if (!parseIntArg(cmd, 11, permille) || permille < 1 || permille > 500) {
+      Serial.println("❓ Usage: scan target PERMILLE (1-500 missed barks per 1000)");
+      return;
+    }
+    scanTuner.setTargetPermille((uint16_t)permille);
+    Serial.printf("📡 Missed-bark target: %.1f%%\n", permille / 10.0);
+  }
+  else if (cmd.startsWith("scan burst")) {
+    int n = 0;
+    if (!parseIntArg(cmd, 10, n) || n < 1 || n > SCAN_TUNE_MAX_BURST) {
+      Serial.printf("❓ Usage: scan burst 1-%d (adverts per bark the sensors send)\n", SCAN_TUNE_MAX_BURST);
+      return;
+    }
+    scanTuner.setBurst((uint8_t)n);
+    scanTuner.restartEpoch();
+    Serial.printf("📡 Sensor burst: %d adverts\n", n);
+  }
+  else if (cmd == "time") {
+    char buf[20];
+    wallClock.format(buf);
+    Serial.printf("🕒 %s (UTC%+d min), source %s", buf, wallClock.tzOffsetMin(),
+                  WallClock::sourceName(wallClock.source()));
+    if (wallClock.lastSyncUnix()) Serial.printf(", synced %lu min ago", (unsigned long)(wallClock.syncAgeSec() / 60));
+    Serial.println();
+  }
+  else if (cmd.startsWith("time set")) {
+    // Host sync: echo "time set $(date +%s)" > /dev/ttyUSB0
+    int64_t unixSec;
+    if (!parseDecimal(cmd.c_str() + 8, WALLCLOCK_MIN_VALID, UINT32_MAX, unixSec)) {
+      Serial.printf("❓ Usage: time set UNIX_SECONDS (%lu..%lu)\n", (unsigned long)WALLCLOCK_MIN_VALID,
+                    (unsigned long)UINT32_MAX);
+      return;
+    }
+    wallClock.set((uint32_t)unixSec, CLOCK_SERIAL);
+    char buf[20];
+    wallClock.format(buf);
+    Serial.printf("🕒 Clock set: %s\n", buf);
+  }
+  else if (cmd.startsWith("time tz")) {
+    int tz = 0;
+    if (!parseIntArg(cmd, 7, tz) || tz < -720 || tz > 840) {
+      Serial.println("❓ Usage: time tz MINUTES (UTC offset, -720..840)");
+      return;
+    }
+    wallClock.setTzOffsetMin((int16_t)tz);
+    schedPrefs.putShort("tz", (int16_t)tz);
+    Serial.printf("🕒 UTC offset: %+d min\n", tz);
+  }
+  else if (cmd == "sched") {
+    Serial.printf("🗓️ Schedule (%u windows), now: %s\n", schedule.count(),
+                  ScheduleTable::gatesName(trainer.gates()).c_str());
+    for (uint8_t i = 0; i < schedule.count(); i++) {
+      const ScheduleEntry& e = schedule.entry(i);
+      char days[8];
+      uint8_t n = 0;
+      for (uint8_t d = 0; d < 7; d++) if ((e.days >> d) & 1) days[n++] = '0' + d;
+      days[n] = 0;
+      Serial.printf("   %u: %02u:%02u-%02u:%02u %-5s days %s\n", i, e.startMin / 60, e.startMin % 60,
+                    e.endMin / 60, e.endMin % 60, ScheduleTable::gatesName(e.gates).c_str(), days);
+    }
+    if (!wallClock.isValid()) Serial.println("   (clock unset - schedule inactive)");
+  }
+  else if (cmd.startsWith("sched add ")) {
+    // sched add HH:MM HH:MM GATES [DAYS]
+    String a[4];
+    int n = 0, from = 10;
+    while (n < 4 && from < (int)cmd.length()) {
+      int sp = cmd.indexOf(' ', from);
+      if (sp < 0) sp = cmd.length();
+      if (sp > from) a[n++] = cmd.substring(from, sp);
+      from = sp + 1;
+    }
+    ScheduleEntry e{0, 0, SCHED_ALL_DAYS, 0};
+    bool ok = n >= 3 && parseClockTime(a[0].c_str(), e.startMin) && parseClockTime(a[1].c_str(), e.endMin) &&
+              ScheduleTable::parseGates(a[2], e.gates);
+    if (ok && n == 4) {
+      e.days = 0;
+      for (int i = 0; i < (int)a[3].length(); i++) {
+        if (a[3][i] < '0' || a[3][i] > '6') ok = false;
+        else e.days |= 1 << (a[3][i] - '0');
+      }
+    }
+    if (!ok || !schedule.add(e)) {
+      Serial.println("❓ Usage: sched add HH:MM HH:MM t|c|s|n|z|- [DAYS 0-6, 0=Sun] (max 8)");
+      return;
+    }
+    saveSchedule();
+    lastScheduleCheckMs = millis() - SCHEDULE_CHECK_MS;  // Apply now
+    Serial.printf("🗓️ Window %u added\n", schedule.count() - 1);
+  }
+  else if (cmd.startsWith("sched del")) {
+    int i = 0;
+    if (!parseIntArg(cmd, 9, i) || i < 0 || !schedule.remove((uint8_t)i)) {
+      Serial.println("❓ Usage: sched del N");
+      return;
+    }
+    saveSchedule();
+    lastScheduleCheckMs = millis() - SCHEDULE_CHECK_MS;
+    Serial.printf("🗓️ Window %d removed\n", i);
+  }
+  else if (cmd == "sched clear") {
+    schedule.clear();
+    saveSchedule();
+    lastScheduleCheckMs = millis() - SCHEDULE_CHECK_MS;
+    Serial.println("🗓️ Schedule cleared - training around the clock");
+  }
+  else if (cmd == "session") {
+    uint32_t now = millis();
+    if (session.isActive()) {
+      Serial.printf("🎬 Session running, %lu/%lu min:\n", (unsigned long)(session.elapsedMs(now) / 60000),
+                    (unsigned long)(session.maxMs() / 60000));
+      printSessionSummary(session.snapshot(now));
+    } else if (session.hasLast()) {
+      Serial.println("🎬 No session running. Last:");
+      printSessionSummary(session.last());
+    } else {
+      Serial.println("🎬 No session yet");
+    }
+    if (sessionEveryMs)
+      Serial.printf("   Auto: every %lu min for %lu min, next in %ld s\n", (unsigned long)(sessionEveryMs / 60000),
+                    (unsigned long)(sessionLengthMs / 60000), (long)(int32_t)(nextSessionMs - now) / 1000);
+  }
+  else if (cmd == "session start") {
+    startSession(SESS_CONSOLE, sessionMaxMs);
+  }
+  else if (cmd == "session stop") {
+    stopSession(SESS_CONSOLE);
+  }
+  else if (cmd.startsWith("session max")) {
+    int m = 0;
+    if (!parseIntArg(cmd, 11, m) || m < 1 || m > 600) {
+      Serial.println("❓ Usage: session max 1-600 (minutes)");
+      return;
+    }
+    sessionMaxMs = (uint32_t)m * 60000;
+    Serial.printf("🎬 Sessions end after %d min\n", m);
+  }
+  else if (cmd == "session every off") {
+    sessionEveryMs = 0;
+    Serial.println("🎬 Auto sessions: OFF");
+  }
+  else if (cmd.startsWith("session every ")) {
+    // session every PERIOD LENGTH (minutes)
+    int sp = cmd.indexOf(' ', 14);
+    int period = 0, length = 0;
+    if (sp < 0 || !parseIntArg(cmd.substring(0, sp), 14, period) || !parseIntArg(cmd, sp, length) ||
+        period < 2 || period > 1440 || length < 1 || length >= period) {
+      Serial.println("❓ Usage: session every PERIOD LENGTH (minutes, LENGTH < PERIOD) / session every off");
+      return;
+    }
+    sessionEveryMs = (uint32_t)period * 60000;
+    sessionLengthMs = (uint32_t)length * 60000;
+    nextSessionMs = millis() + sessionEveryMs;
+    Serial.printf("🎬 Auto sessions: %d min every %d min (first in %d min)\n", length, period, period);
+  }
+  else if (cmd == "prog") {
+    if (!program.isLoaded()) {
+      Serial.println("📜 No program loaded (built-in levels)");
+    } else {
+      char name[TP_NAME_LEN + 1];
+      program.name(name);
+      Serial.printf("📜 Program '%s': phase %u/%u, %u bytes\n", name, program.phaseIndex(),
+                    program.phaseCount(), (unsigned)program.imageLen());
+      const TpPhase& p = program.current();
+      uint32_t now = millis();
+      for (uint8_t t = 0; t < TP_MAX_TRANSITIONS; t++) {
+        const TpTransition& tr = p.transitions[t];
+        if (tr.metric == TP_UNUSED) continue;
+        Serial.printf("   when %s >= %lu -> %u (now %lu)\n", TrainingProgram::metricName((TpMetric)tr.metric),
+                      (unsigned long)tr.threshold, tr.target,
+                      (unsigned long)program.metric((TpMetric)tr.metric, now));
+      }
+    }
+    if (programLoader.expected())
+      Serial.printf("   Upload: %u/%u bytes\n", (unsigned)programLoader.written(), (unsigned)programLoader.expected());
+  }
+  else if (cmd.startsWith("prog begin")) {
+    int n = 0;
+    if (!parseIntArg(cmd, 10, n) || n <= 0 || n > (int)TP_MAX_IMAGE) {
+      Serial.printf("❓ Usage: prog begin 1-%u\n", (unsigned)TP_MAX_IMAGE);
+      return;
+    }
+    programLoader.begin(n);
+    Serial.printf("📜 Program upload: expecting %d bytes\n", n);
+  }
+  else if (cmd.startsWith("prog data ")) {
+    // prog data OFFSET HEX (as printed by plan_compiler --serial)
+    int sp = cmd.indexOf(' ', 10);
+    int off = 0;
+    uint8_t bytes[64];
+    int n = sp > 0 ? parseHexBytes(cmd.substring(sp + 1).c_str(), bytes, sizeof(bytes)) : -1;
+    if (sp < 0 || !parseIntArg(cmd.substring(0, sp), 10, off) || off < 0 || n <= 0) {
+      Serial.println("❓ Usage: prog data OFFSET HEX");
+      return;
+    }
+    if (!programLoader.data(off, bytes, n))
+      Serial.printf("❌ Program data rejected at offset %d\n", off);
+  }
+  else if (cmd == "prog commit") {
+    commitProgram();
+  }
+  else if (cmd == "prog clear") {
+    clearProgram();
+  }
+  else if (cmd.startsWith("prog phase")) {
+    int ph = 0;
+    if (!program.isLoaded() || !parseIntArg(cmd, 10, ph) || ph < 0 || ph >= program.phaseCount()) {
+      Serial.println("❓ Usage: prog phase N (program loaded)");
+      return;
+    }
+    program.enter((uint8_t)ph, millis());
+    trainer.enterProgramPhase(millis());
+    Serial.printf("📜 Program phase set to %d\n", ph);
+  }
+  else if (cmd == "qshape off") {
+    quietMgr.setAdaptiveShaping(false);
+    Serial.println("📐 Adaptive shaping: OFF (level table quiet targets)");
+  }
+  else if (cmd == "qshape on" || cmd.startsWith("qshape on ")) {
+    int pct = SHAPING_PERCENTILE;
+    if (cmd.length() > 9 && (!parseIntArg(cmd, 10, pct) || pct < 10 || pct > 95)) {
+      Serial.println("❓ Usage: qshape on [10-95]");
+      return;
+    }
+    quietMgr.setAdaptiveShaping(true, pct / 100.0f, SHAPING_MIN_QUIET_MS, SHAPING_MAX_QUIET_MS);
+    Serial.printf("📐 Adaptive shaping: ON (p%d of recent bark intervals)\n", pct);
+  }
+  else if (cmd == "help") {
+    Serial.println("\n📖 COMMANDS:");
+    Serial.println("status     - Show system & QuietMgr status");
+    Serial.println("qreset     - Reset QuietMgr (level=0)");
+    Serial.println("qlevel X   - Manually set level");
+    Serial.println("qlog on/off- Toggle QuietMgr logging");
+    Serial.println("qshape on [P]/off - Quiet target = Pth percentile of bark intervals");
+    Serial.println("cpu [auto/fixed/reset] - Clock share, boost latency, est. energy / governor mode");
+    Serial.println("time [set UNIX / tz MIN] - Wall clock / sync from the host / UTC offset");
+    Serial.println("sched [add HH:MM HH:MM GATES [DAYS] / del N / clear] - Schedule windows");
+    Serial.println("           GATES: t=train c=correct s=scan n=session z=deep sleep -=none");
+    Serial.println("session [start/stop] - Session totals / start / stop (remote: 4 clicks)");
+    Serial.println("session max M / every P L / every off - Max length; auto L-min session every P min");
+    Serial.println("prog       - Training program phase and transitions");
+    Serial.println("prog begin N / data OFF HEX / commit - Upload (tools/plan_compiler --serial)");
+    Serial.println("prog clear / phase N - Back to built-in levels / jump to a phase");
+    Serial.println("rfqual X   - Reject remote frames below quality X (0-100, 0=off)");
+    Serial.println("mic on/off - Toggle microphone bark detection");
+    Serial.println("mic cls on/off - Toggle the int8 bark classifier");
+    Serial.println("fusion any|all|weighted - Bark fusion policy");
+    Serial.println("fusion window N / weight ble|mic N / threshold N / reset");
+    Serial.println("clips [clear] - List/delete recorded bark clips");
+    Serial.println("clip dump N - Hex-dump clip N (BKC1 header + IMA ADPCM)");
+    Serial.println("bark       - Inject a manager bark (same as bark button)");
+    Serial.println("feeder test/clear - Dispense one treat / clear the jam alarm");
+    Serial.println("corr [on/off] - Correction ladder / toggle (off = fixed full correction)");
+    Serial.println("corr window S - Bark history window for the ladder (seconds)");
+    Serial.println("cue on/off/test - Toggle / play the reward marker cue");
+    Serial.println("tones on/off - Toggle all cue/correction tones");
+    Serial.println("trace start/stop/dump - Record actuator GPIO edges");
+    Serial.println("perf [reset] - Show/reset hot-path cycle counts");
+#if ENABLE_PERF_BENCH
+    Serial.println("perf bench [name] - Run the hot-path micro-benchmarks");
+#endif
+    Serial.println("journal [N] - Show the last N training events");
+    Serial.println("pair N [key] - Pair bark sensor N (new key printed if none given)");
+    Serial.println("unpair N   - Forget bark sensor N");
+    Serial.println("sensors    - Paired sensors and advert auth results");
+    Serial.println("auth bench - Time one advert MAC check");
+    Serial.println("scan       - Missed barks, scan duty, tuner state and burst advice");
+    Serial.println("scan tune on/off - Auto-tune scan window/interval (off = full duty)");
+    Serial.println("scan target P / burst N - Missed barks per 1000 to aim for / sensor burst length");
+#if ENABLE_BARK_RELAY
+    Serial.println("relay on/off - Toggle the ESP-NOW bark relay");
+#endif
+    Serial.println();
+  }
+}
+
 void setup() {
   // Pins
   pinMode(waterPin, OUTPUT);
@@ -185,47 +1319,119 @@ void setup() {
 
   // Serial
   Serial.begin(SERIAL_BAUD_RATE);
-  Serial.println("=================================");
-  Serial.println("🐕 Smart Dog Training System v3.1");
-  Serial.println("=================================");
-  while (!Serial) delay(10);
 
-  // Remote click detector
+  // Clock (the RTC kept counting through deep sleep) and schedule
+  bool fastWake = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER && rtcState.magic == RTC_STATE_MAGIC;
+  schedPrefs.begin("sched", false);
+  static uint8_t table[SCHED_MAX_ENTRIES * sizeof(ScheduleEntry)];
+  schedule.load(table, schedPrefs.getBytes("table", table, sizeof(table)));
+  wallClock.begin((int16_t)schedPrefs.getShort("tz", 0), (ClockSource)(fastWake ? rtcState.clockSource : CLOCK_NONE),
+                  fastWake ? rtcState.lastSyncUnix : 0);
+  uint32_t sleptMin = 0;
+  if (fastWake) {
+    // Timer wake inside the sleep window (drift, or the SLEEP_MAX_MIN cap): straight back to sleep
+    uint32_t secondsToEdge;
+    if ((scheduledGates(&secondsToEdge) & GATE_SLEEP) && secondsToEdge > 0) {
+      Serial.printf("🌙 Still night - sleeping %lu min more\n", (unsigned long)(secondsToEdge / 60));
+      Serial.flush();
+      esp_sleep_enable_timer_wakeup((uint64_t)secondsToEdge * 1000000ULL);
+      esp_deep_sleep_start();
+    }
+    sleptMin = (wallClock.now() - rtcState.sleptAtUnix) / 60;
+    trainer.setCorrectionLadder(rtcState.correctionLadderOn);
+    sessionMaxMs = rtcState.sessionMaxMs;
+    sessionEveryMs = rtcState.sessionEveryMs;
+    sessionLengthMs = rtcState.sessionLengthMs;
+    nextSessionMs = millis() + sessionEveryMs;
+    Serial.printf("☀️ Woke after %lu min (sleep #%lu)\n", (unsigned long)sleptMin, (unsigned long)rtcState.sleeps);
+  } else {
+    rtcState.magic = 0;  // Cold boot: RTC memory is garbage
+    rtcState.sleeps = 0;
+    Serial.println("=================================");
+    Serial.println("🐕 Smart Dog Training System v3.1");
+    Serial.println("=================================");
+    while (!Serial) delay(10);
+  }
+
+  // Feeder
+  feeder.begin();
+  toneEngine.begin();
+  markerCue.begin();
+  markerCue.setPlanEpochSource([]() { return quietMgr.planEpoch(); });
+  trainer.setBarkCorrectedCallback([](uint8_t) {
+    clipRecorder.trigger();  // Keep the audio around this bark as evidence
+  });
+  trainer.setProgramPhaseCallback([](uint8_t phase) { programPrefs.putUChar("phase", phase); });
+
+  // Remote click detector (single/double/triple: trainer.begin())
   detector.begin();
-  detector.setCallbacks(
-    []() { // single click → manual punishment ONLY (does NOT affect manager)
-      Serial.println("🎮 Remote Single Click → MANUAL punishment");
-      startPunishment(MANUAL_PUNISH_MS);
-    },
-    []() { // double click → manual reward ONLY (does NOT affect manager)
-      Serial.println("🎮 Remote Double Click → MANUAL reward");
-      runFeederFor(MANUAL_REWARD_MS);
-    },
-     []() { // Long press
-          Serial.println("🎮 Remote Triple Press Click → reset");
-            quietMgr.resetState();
-            Serial.println("🔄 QuietMgr reset");
-
-            // First vibration pulse
-            digitalWrite(vibrationPin, HIGH);
-            delay(500);
-            digitalWrite(vibrationPin, LOW);
-            delay(500);
-            digitalWrite(vibrationPin, HIGH);
-            delay(500);
-            digitalWrite(vibrationPin, LOW);
-        }
-  );
+  detector.setQuadClickCallback([]() {
+    Serial.println("🎮 Remote Quad Click → session start/stop");
+    if (session.isActive()) stopSession(SESS_REMOTE);
+    else startSession(SESS_REMOTE, sessionMaxMs);
+  });
+
+  // On-device microphone → same bark path as BLE
+  clipRecorder.begin();
+  mic.setAudioTap([](const int16_t* pcm, size_t n) {
+    clipRecorder.pushSamples(pcm, n);  // Mic capture task
+  });
+  mic.setCallback([]() { trainer.onMicBark(); });
+  mic.begin();
+  barkFusion.setSourceEnabled(BARK_SRC_MIC, mic.isRunning());
 
   // BLE
+  barkAuth.begin(&barkAuthRtc);
   initBLEScan();
+#if ENABLE_GATT_SERVICE
+  initGattService();
+#endif
 
   // Quiet manager
   quietMgr.begin();
+  loadStoredProgram();
+  sessionPrefs.begin("session", false);
   quietMgr.setLogging(true);
+  trainer.begin();
+  journal.log(JEV_BOOT, quietMgr.currentLevel());
+  journal.log(JEV_WAKE, fastWake, (uint16_t)min<uint32_t>(sleptMin, 0xFFFF));
+  trainer.setGates(GATE_AWAKE_ALL);
+  applyScheduleGates(scheduledGates(nullptr), millis());
 
+#if ENABLE_TELEMETRY
+  telemetry.setMetricsProvider([](TelemetryMetrics& m) {
+    m.uptimeMs = millis();
+    m.level = quietMgr.currentLevel();
+    m.successesAtLevel = quietMgr.successesAtLevel();
+    m.quietTargetMs = quietMgr.currentQuietTargetMs();
+    m.journalSeq = journal.nextSeq();
+    m.barksFused = barkFusion.fusedCount();
+    m.freeHeap = ESP.getFreeHeap();
+    m.treatsDispensed = feeder.dispensedCount();
+    m.treatsFailed = feeder.failedCount();
+    m.barkMissPermille = scanTuner.lastMissPermille();
+    m.rfSignalQuality = (int8_t)detector.getSignalQuality();
+    m.rfLowQualityRejects = detector.getLowQualityRejects();
+  });
+  telemetry.begin();
+  // SNTP once Wi-Fi is up; the callback runs in the SNTP task
+  sntp_set_time_sync_notification_cb([](struct timeval*) { sntpSynced = true; });
+  configTime(0, 0, NTP_SERVER);
+#endif
+
+#if ENABLE_BARK_RELAY
+  barkRelay.begin(esp_random());  // After telemetry so ESP-NOW follows the AP channel
+#endif
+
+  cpuGovernor.begin();
+
+  if (fastWake) {
+    Serial.println("✅ Ready (fast wake)");
+    return;
+  }
   Serial.println("\n✅ System Ready!");
   Serial.println("📡 BLE: Bark → manager (punish + reset quiet window)");
+  Serial.println("🎤 Mic: Bark → manager (fused with BLE, same path)");
   Serial.println("🎮 Remote: Single→manual punish, Double→manual reward (no manager)");
   Serial.println("🔘 Water button→manual punish (no manager), Feeder button→manual reward (no manager)");
   Serial.println("🐕 Bark button→manager bark");
@@ -233,93 +1439,81 @@ void setup() {
 }
 
 void loop() {
+  PerfScope loopScope(perfLoop);
   uint32_t now = millis();
 
   // Remote
-  detector.update();
-
-  // Keep BLE scanning
-  if (!pBLEScan->isScanning()) {
-    pBLEScan->start(0, nullptr, false);
+  {
+    PerfScope ps(perfRemote);
+    detector.update();
   }
-
-  // === Inputs ===
-  // Bark button → affects manager
-  if (isButtonPressed(barkButtonPin, lastBarkButtonTime)) {
-    Serial.println("🐕 Bark button pressed → manager bark");
-    quietMgr.onBark(now);
-     Serial.println("\n✅ Loop!");
+  if (detector.getFrameCount() != lastRfFrameCount) {
+    lastRfFrameCount = detector.getFrameCount();
+    cpuGovernor.noteActivity();
   }
 
-  // Water button → manual punishment ONLY (no manager)
-  if (isButtonPressed(waterButtonPin, lastWaterButtonTime)) {
-    Serial.println("🔧 Manual water button → MANUAL punishment");
-    runWaterFor(MANUAL_REWARD_MS);
+  // Feeder (drop sensor / time budget)
+  feeder.update();
+
+  // Microphone
+  {
+    PerfScope ps(perfMic);
+    mic.update();
   }
+  clipRecorder.update();
 
-  // Feeder button → manual reward ONLY (no manager)
-  if (isButtonPressed(feederButtonPin, lastFeederButtonTime)) {
-    Serial.println("🔧 Manual feeder button → MANUAL reward");
-    runFeederFor(MANUAL_REWARD_MS);
+  // Fused sensor barks (BLE/mic) → manager
+  if (trainer.updateBarks(now)) {
+#if ENABLE_BARK_RELAY
+    barkRelay.relay(barkFusion.lastSources(), now, millis());
+#endif
   }
 
-  // === Manager decisions ===
-  // Rewards (quiet success)
-  if (quietMgr.tick(now)) {
-    uint32_t treatMs = quietMgr.consumePendingDispenseMs();
-    if (treatMs > 0 && !punishActive) {
-      Serial.printf("🏆 Manager reward: %lu ms\n", (unsigned long)treatMs);
-      runFeederFor(treatMs);
+#if ENABLE_BARK_RELAY
+  // Barks other units heard → same path; the bark window drops the ones
+  // this unit already corrected
+  BarkRelayEvent relayed;
+  while (barkRelay.poll(relayed, now)) {
+    if (trainer.handleBarkEvent(now, BARK_RELAY_SOURCE_BIT)) {
+      Serial.printf("📨 Relayed bark accepted from %02x:%02x:%02x (seq %u)\n",
+                    relayed.origin[3], relayed.origin[4], relayed.origin[5], relayed.seq);
     }
   }
+#endif
 
-  updatePunishment();
-
-  // Blink LED when system is idle
-  if (!punishActive && (now - lastLedBlinkTime >= LED_BLINK_MS)) {
-    ledState = !ledState;
-    digitalWrite(ledPin, ledState);
-    lastLedBlinkTime = now;
+  // Keep BLE scanning (unless the schedule has it off)
+  if ((trainer.gates() & GATE_SCAN) && !pBLEScan->isScanning()) {
+    barkAuth.resyncSeqs();  // Barks sent while the scanner was off are not misses
+    pBLEScan->start(0, nullptr, false);
   }
+  scanDuty.update(now, pBLEScan->isScanning(), gattConnected());
+  barkAuth.persistSeqs(now);
+#if ENABLE_GATT_SERVICE
+  gattService.update();
+#endif
+
+  // Buttons, manager decisions (rewards, marker, pre-arm), program, punishment
+  trainer.update(now);
+  updateSession(now);
+  updateSchedule(now);
+  updateScanTuning(now);
+
+  // CPU clock: full while anything is queued or running
+  bool cpuBusy = trainer.isPunishing() || feeder.isBusy() || feeder.isArmed() || markerCue.isScheduled() ||
+                 toneEngine.isActive() || barkFusion.hasPending() || gattConnected();
+  cpuGovernor.setLowMhz(mic.isEnabled() ? CPU_FREQ_MIC_MHZ : CPU_FREQ_LOW_MHZ);
+  cpuGovernor.update(now, cpuBusy);
+
+#if ENABLE_TELEMETRY
+  telemetry.update(now);
+#endif
+
+  // Blink LED when system is idle (a playing cue may own it)
+  trainer.updateIdleLed(now);
 
   // === Serial commands ===
-  if (Serial.available()) {
-    String cmd = Serial.readStringUntil('\n');
-    cmd.trim(); cmd.toLowerCase();
-
-    if (cmd == "status") {
-      String detectorStatus;
-      detector.getStatus(detectorStatus);
-      Serial.println("\n📊 SYSTEM STATUS:");
-      Serial.printf("   Remote Detector: %s\n", detectorStatus.c_str());
-      Serial.printf("   BLE Scan: %s\n", pBLEScan->isScanning() ? "Active" : "Stopped");
-      Serial.printf("   QuietMgr Level: %u\n", quietMgr.currentLevel());
-      Serial.printf("   QuietMgr Successes: %u\n", quietMgr.successesAtLevel());
-      Serial.printf("   Quiet Target: %lu ms\n", (unsigned long)quietMgr.currentQuietTargetMs());
-      Serial.printf("   Last Bark: %lu ms ago\n\n", (unsigned long)(millis() - quietMgr.lastBarkMs()));
-    }
-    else if (cmd == "qreset") {
-      quietMgr.resetState();
-      Serial.println("🔄 QuietMgr reset");
-    }
-    else if (cmd.startsWith("qlevel")) {
-      int lvl = cmd.substring(6).toInt();
-      quietMgr.setLevel((uint8_t)lvl, millis());
-      Serial.printf("🔧 QuietMgr level set to %d\n", lvl);
-    }
-    else if (cmd == "qlog on") {
-      quietMgr.setLogging(true);  Serial.println("📝 QuietMgr logging: ON");
-    }
-    else if (cmd == "qlog off") {
-      quietMgr.setLogging(false); Serial.println("📝 QuietMgr logging: OFF");
-    }
-    else if (cmd == "help") {
-      Serial.println("\n📖 COMMANDS:");
-      Serial.println("status     - Show system & QuietMgr status");
-      Serial.println("qreset     - Reset QuietMgr (level=0)");
-      Serial.println("qlevel X   - Manually set level");
-      Serial.println("qlog on/off- Toggle QuietMgr logging");
-      Serial.println();
-    }
+  String cmd;
+  if (readSerialLine(cmd)) {
+    handleSerialCommand(cmd);
   }
-}
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "EspNowTransport.h"
+
+static const uint8_t BROADCAST_ADDR[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+EspNowTransport* EspNowTransport::instance = nullptr;
+
+EspNowTransport::EspNowTransport(uint8_t channel) {
+    this->channel = channel;
+    this->started = false;
+    framesSent = 0;
+    framesReceived = 0;
+    sendErrors = 0;
+}
+
+bool EspNowTransport::begin() {
+    // ESP-NOW needs the Wi-Fi driver in station mode; it does not need an AP
+    if (WiFi.getMode() == WIFI_OFF) {
+        WiFi.mode(WIFI_STA);
+        WiFi.setChannel(channel);
+    }
+    if (esp_now_init() != ESP_OK) {
+        Serial.println("EspNowTransport: esp_now_init failed");
+        return false;
+    }
+
+    esp_now_peer_info_t peer = {};
+    memcpy(peer.peer_addr, BROADCAST_ADDR, 6);
+    peer.channel = 0;  // Follow the current channel
+    peer.encrypt = false;
+    if (!esp_now_is_peer_exist(BROADCAST_ADDR) && esp_now_add_peer(&peer) != ESP_OK) {
+        Serial.println("EspNowTransport: add broadcast peer failed");
+        return false;
+    }
+
+    instance = this;
+    esp_now_register_recv_cb(onReceive);
+    started = true;
+    Serial.printf("EspNowTransport initialized (channel %u)\n", WiFi.channel());
+    return true;
+}
+
+bool EspNowTransport::send(const uint8_t* data, size_t len) {
+    if (!started) return false;
+    if (esp_now_send(BROADCAST_ADDR, data, len) != ESP_OK) {
+        sendErrors++;
+        return false;
+    }
+    framesSent++;
+    return true;
+}
+
+void EspNowTransport::setReceiver(RelayReceiveCallback cb) {
+    receiver = cb;
+}
+
+void EspNowTransport::selfId(uint8_t out[6]) {
+    WiFi.macAddress(out);
+}
+
+// Runs in the Wi-Fi task: hand the frame to BarkRelay, which only queues it
+#if defined(ESP_IDF_VERSION_MAJOR) && ESP_IDF_VERSION_MAJOR >= 5
+void EspNowTransport::onReceive(const esp_now_recv_info_t* info, const uint8_t* data, int len) {
+#else
+void EspNowTransport::onReceive(const uint8_t* mac, const uint8_t* data, int len) {
+#endif
+    if (!instance || len <= 0) return;
+    instance->framesReceived++;
+    if (instance->receiver) instance->receiver(data, (size_t)len);
+}
+
+void EspNowTransport::getStatus(String& statusMsg) {
+    if (!started) {
+        statusMsg = "ESP-NOW not started";
+        return;
+    }
+    statusMsg = "ESP-NOW ch " + String(WiFi.channel()) +
+                ", frames tx/rx: " + String(framesSent) + "/" + String(framesReceived) +
+                ", tx errors: " + String(sendErrors);
+}
@@ -0,0 +1,42 @@
+#ifndef ESPNOW_TRANSPORT_H
+#define ESPNOW_TRANSPORT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_now.h>
+#include "BarkRelay.h"
+
+// ESP-NOW broadcast transport for BarkRelay. Frames go out unacked on the
+// current Wi-Fi channel (one ~0.5 ms frame, no association), which keeps
+// one-way latency well under 10 ms. All units must share a channel: with
+// telemetry on that is the AP's channel, otherwise ESPNOW_DEFAULT_CHANNEL.
+#define ESPNOW_DEFAULT_CHANNEL   1
+
+class EspNowTransport : public BarkRelayTransport {
+public:
+    EspNowTransport(uint8_t channel = ESPNOW_DEFAULT_CHANNEL);
+
+    bool begin() override;
+    bool send(const uint8_t* data, size_t len) override;
+    void setReceiver(RelayReceiveCallback cb) override;
+    void selfId(uint8_t out[6]) override;
+
+    void getStatus(String& statusMsg);
+
+private:
+    uint8_t channel;
+    bool started;
+    RelayReceiveCallback receiver;
+    unsigned long framesSent;
+    unsigned long framesReceived;
+    unsigned long sendErrors;
+
+    static EspNowTransport* instance;  // esp_now callbacks carry no context
+#if defined(ESP_IDF_VERSION_MAJOR) && ESP_IDF_VERSION_MAJOR >= 5
+    static void onReceive(const esp_now_recv_info_t* info, const uint8_t* data, int len);
+#else
+    static void onReceive(const uint8_t* mac, const uint8_t* data, int len);
+#endif
+};
+
+#endif
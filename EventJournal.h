@@ -0,0 +1,112 @@
+#pragma once
+#include <Arduino.h>
+
+enum JournalEventType : uint8_t {
+  JEV_BOOT = 1,
+  JEV_BARK,            // a = BarkSource bitmask (0 = bark button)
+  JEV_PUNISH,          // a = CORR_OUT_* actuators, b = duration ms
+  JEV_QUIET_SUCCESS,   // a = level
+  JEV_REWARD,          // a = level, b = dispense ms
+  JEV_LEVEL,           // a = new level, b = old level
+  JEV_MANUAL_REWARD,   // b = duration ms
+  JEV_MANUAL_PUNISH,   // b = duration ms
+  JEV_RESET,
+  JEV_TREAT_DROPPED,   // b = motor start → treat detected, ms
+  JEV_TREAT_FAILED,    // b = time budget used, ms
+  JEV_FEEDER_JAM,      // a = consecutive failures
+  JEV_SESSION_START,   // a = SessionCause, b = session id
+  JEV_SESSION_END,     // a = SessionCause, b = session id; JEV_SESSION_STAT records follow
+  JEV_SESSION_STAT,    // a = SessionStat id, b = value
+  JEV_SCHEDULE,        // a = new GATE_* bits, b = old
+  JEV_SLEEP,           // b = planned minutes (last record before deep sleep; RAM journal is lost)
+  JEV_WAKE,            // a = fast wake (1) or cold boot (0), b = minutes slept
+};
+
+// 8-byte packed record; this layout is what telemetry and dumps carry
+struct __attribute__((packed)) JournalRecord {
+  uint32_t tMs;
+  uint8_t  type;
+  uint8_t  a;
+  uint16_t b;
+};
+
+// In-RAM ring of recent events. Every record gets a running sequence number,
+// so several consumers (telemetry, notifications, dumps) can each keep their
+// own cursor and learn how many records they missed if they fall behind.
+// Single writer: log from loop() only.
+class EventJournal {
+public:
+  static const uint16_t CAPACITY = 256;
+
+  void log(JournalEventType type, uint8_t a = 0, uint16_t b = 0) {
+    JournalRecord& r = _ring[_nextSeq % CAPACITY];
+    r.tMs = millis();
+    r.type = type;
+    r.a = a;
+    r.b = b;
+    _nextSeq++;
+  }
+
+  // Sequence number the next record will get
+  uint32_t nextSeq() const { return _nextSeq; }
+
+  // Oldest sequence number still held
+  uint32_t oldestSeq() const { return _nextSeq > CAPACITY ? _nextSeq - CAPACITY : 0; }
+
+  // Copy up to max records starting at seq (clamped to the oldest held).
+  // Returns the count; firstSeq receives the sequence of out[0].
+  uint16_t read(uint32_t seq, JournalRecord* out, uint16_t max, uint32_t& firstSeq) const {
+    if (seq < oldestSeq()) seq = oldestSeq();
+    firstSeq = seq;
+    uint16_t n = 0;
+    while (n < max && seq < _nextSeq) {
+      out[n++] = _ring[seq % CAPACITY];
+      seq++;
+    }
+    return n;
+  }
+
+  // Print the most recent count records
+  // unixNow = wall clock (0 = not set); printed with millis() so a captured
+  // dump can be placed in time later
+  void dump(uint16_t count, uint32_t unixNow) const {
+    uint32_t from = _nextSeq > count ? _nextSeq - count : 0;
+    if (from < oldestSeq()) from = oldestSeq();
+    Serial.printf("\n📒 JOURNAL (%lu records total, now t=%lu unix=%lu):\n", (unsigned long)_nextSeq,
+                  (unsigned long)millis(), (unsigned long)unixNow);
+    for (uint32_t s = from; s < _nextSeq; s++) {
+      const JournalRecord& r = _ring[s % CAPACITY];
+      Serial.printf("   #%lu t=%lu %-13s a=%u b=%u\n", (unsigned long)s, (unsigned long)r.tMs,
+                    typeName(r.type), r.a, r.b);
+    }
+    Serial.println();
+  }
+
+  static const char* typeName(uint8_t type) {
+    switch (type) {
+      case JEV_BOOT:          return "boot";
+      case JEV_BARK:          return "bark";
+      case JEV_PUNISH:        return "punish";
+      case JEV_QUIET_SUCCESS: return "quiet-success";
+      case JEV_REWARD:        return "reward";
+      case JEV_LEVEL:         return "level";
+      case JEV_MANUAL_REWARD: return "manual-reward";
+      case JEV_MANUAL_PUNISH: return "manual-punish";
+      case JEV_RESET:         return "reset";
+      case JEV_TREAT_DROPPED: return "treat-dropped";
+      case JEV_TREAT_FAILED:  return "treat-failed";
+      case JEV_FEEDER_JAM:    return "feeder-jam";
+      case JEV_SESSION_START: return "session-start";
+      case JEV_SESSION_END:   return "session-end";
+      case JEV_SESSION_STAT:  return "session-stat";
+      case JEV_SCHEDULE:      return "schedule";
+      case JEV_SLEEP:         return "sleep";
+      case JEV_WAKE:          return "wake";
+      default:                return "?";
+    }
+  }
+
+private:
+  JournalRecord _ring[CAPACITY];
+  uint32_t _nextSeq{0};
+};
@@ -0,0 +1,281 @@
+#include "FeederController.h"
+
+FeederController* FeederController::instance = nullptr;
+
+FeederController::FeederController(ActuatorTrace& trace, int stepPin, int dirPin, int enPin, int dropPin)
+    : trace(trace) {
+    this->stepPin = stepPin;
+    this->dirPin = dirPin;
+    this->enPin = enPin;
+    this->dropPin = dropPin;
+
+    running = false;
+    startMs = 0;
+    budgetMs = 0;
+    dropSeen = false;
+    dropMs = 0;
+    dropUs = 0;
+    lastDropEdgeMs = 0;
+    consecutiveFailures = 0;
+    jammed = false;
+
+    armed = false;
+    armStarted = false;
+    armReleaseMs = 0;
+    armBudgetMs = 0;
+    armTagValue = 0;
+    runPrearmed = false;
+    armHeld = false;
+    heldMotorMs = 0;
+    treatAdvanced = false;
+
+    dispensed = 0;
+    failed = 0;
+    jamAlarms = 0;
+    strayDrops = 0;
+    lastLatency = 0;
+    latencyTotal = 0;
+    latencySamples = 0;
+    armsCommitted = 0;
+    armsCancelled = 0;
+    treatsWasted = 0;
+    lastLandingError = 0;
+}
+
+void FeederController::begin() {
+    pinMode(stepPin, OUTPUT);
+    pinMode(dirPin, OUTPUT);
+    pinMode(enPin, OUTPUT);
+    digitalWrite(enPin, HIGH);  // Driver disabled
+
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+    ledcAttachChannel(stepPin, FEEDER_STEP_HZ, 8, FEEDER_LEDC_CHANNEL);
+#else
+    ledcSetup(FEEDER_LEDC_CHANNEL, FEEDER_STEP_HZ, 8);
+    ledcAttachPin(stepPin, FEEDER_LEDC_CHANNEL);
+#endif
+    setStepDuty(0);
+
+    if (dropPin >= 0) {
+        instance = this;
+        pinMode(dropPin, INPUT_PULLUP);
+        attachInterrupt(digitalPinToInterrupt(dropPin), onDropISR, FALLING);
+    }
+    Serial.printf("FeederController initialized (%s)\n",
+                  dropPin >= 0 ? "drop sensor" : "open loop");
+}
+
+void FeederController::setCallbacks(DispenseDoneCallback onDone, JamCallback onJam) {
+    doneCallback = onDone;
+    jamCallback = onJam;
+}
+
+// Beam broken: stop the motor right here rather than a loop() later
+void IRAM_ATTR FeederController::onDropISR() {
+    FeederController* f = instance;
+    if (!f) return;
+    unsigned long now = millis();
+    if (now - f->lastDropEdgeMs < FEEDER_DROP_DEBOUNCE_MS) return;
+    f->lastDropEdgeMs = now;
+
+    if (!f->running || f->dropSeen) {
+        f->strayDrops++;
+        return;
+    }
+    gpio_set_level((gpio_num_t)f->enPin, 1);  // Driver off (IRAM-safe)
+    f->dropUs = micros();
+    f->dropMs = now;
+    f->dropSeen = true;
+}
+
+bool FeederController::dispense(uint32_t maxMs) {
+    if (running || maxMs == 0) return false;
+    if (armed) disarm();  // Manual dispense overrides a waiting pre-arm
+    startRun(maxMs);
+    return true;
+}
+
+bool FeederController::arm(uint32_t releaseAtMs, uint32_t maxMs, uint32_t tag) {
+    if (running || armed || jammed || maxMs == 0) return false;
+    armed = true;
+    armStarted = false;
+    armHeld = false;
+    heldMotorMs = 0;
+    armReleaseMs = releaseAtMs;
+    armBudgetMs = maxMs;
+    armTagValue = tag;
+    return true;
+}
+
+void FeederController::commitArm() {
+    if (!armed) return;
+    armed = false;
+    armsCommitted++;
+    if (running || (armStarted && !armHeld)) return;  // Still in the lead, or already ended
+
+    // Resume the held run, or start now if the deadline came before the start time
+    armHeld = false;
+    startRun(armBudgetMs > heldMotorMs ? armBudgetMs - heldMotorMs : 1, true);
+}
+
+void FeederController::disarm() {
+    if (!armed) return;
+    armed = false;
+    armsCancelled++;
+    if (!armStarted) return;
+    if (running || armHeld) {
+        stop();  // Treat stays part-way along, ready for next time
+        armHeld = false;
+        heldMotorMs = 0;
+        treatAdvanced = true;  // stop() does nothing while held
+        Serial.println("🍖 Pre-armed feeder cancelled");
+    } else if (dropSeen) {
+        treatsWasted++;  // Dropped faster than the learned latency, before the pause
+    }
+}
+
+void FeederController::startRun(uint32_t maxMs, bool prearmed) {
+    runPrearmed = prearmed;
+    dropSeen = false;
+    budgetMs = maxMs;
+    startMs = millis();
+    running = true;
+    motorOn();
+}
+
+void FeederController::update() {
+    // Start a pre-armed run early by the expected latency
+    if (armed && !armStarted && !running &&
+        (int32_t)(millis() - (armReleaseMs - expectedLatencyMs())) >= 0) {
+        armStarted = true;
+        startRun(armBudgetMs, true);
+    }
+    // Hold the treat short of the drop until the reward is confirmed
+    if (armed && running && runPrearmed && !dropSeen &&
+        (int32_t)(millis() - (armReleaseMs - FEEDER_PREARM_HOLD_MS)) >= 0) {
+        motorOff();
+        running = false;
+        armHeld = true;
+        heldMotorMs = millis() - startMs;
+        return;
+    }
+    if (!running) return;
+
+    if (dropSeen) {
+        finish(true);
+    } else if (millis() - startMs >= budgetMs) {
+        finish(false);
+    }
+}
+
+void FeederController::stop() {
+    if (!running) return;
+    motorOff();
+    running = false;
+    treatAdvanced = true;
+}
+
+void FeederController::motorOn() {
+    trace.write(enPin, LOW);
+    trace.write(dirPin, HIGH);
+    setStepDuty(128);  // 50% duty step train
+}
+
+void FeederController::motorOff() {
+    setStepDuty(0);
+    trace.write(enPin, HIGH);
+}
+
+void FeederController::setStepDuty(uint32_t duty) {
+    trace.record(stepPin, duty);
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+    ledcWrite(stepPin, duty);  // 3.x addresses LEDC by pin
+#else
+    ledcWrite(FEEDER_LEDC_CHANNEL, duty);
+#endif
+}
+
+void FeederController::finish(bool dropped) {
+    if (dropped) trace.record(enPin, HIGH, dropUs);  // The ISR's write, not this one
+    motorOff();
+    running = false;
+
+    // Motor time from a treat at rest; a part-way treat says nothing about it
+    bool timed = !treatAdvanced;
+    uint32_t carried = runPrearmed ? heldMotorMs : 0;
+    treatAdvanced = false;
+    heldMotorMs = 0;
+
+    uint32_t elapsed;
+    if (dropped) {
+        elapsed = dropMs - startMs;
+        dispensed++;
+        lastLatency = elapsed + carried;
+        if (timed) {
+            latencyTotal += lastLatency;
+            latencySamples++;
+        }
+        if (runPrearmed) lastLandingError = (int32_t)(dropMs - armReleaseMs);
+        consecutiveFailures = 0;
+        jammed = false;
+        Serial.printf("🍖 Treat dropped after %lu ms\n", (unsigned long)elapsed);
+    } else {
+        elapsed = budgetMs;
+        if (dropPin < 0) {
+            // Open loop: a full run is all we can know
+            dispensed++;
+            Serial.printf("🍖 Treat dispensed for %lu ms\n", (unsigned long)elapsed);
+        } else {
+            failed++;
+            if (consecutiveFailures < 255) consecutiveFailures++;
+            Serial.printf("⚠️  No treat detected after %lu ms\n", (unsigned long)elapsed);
+            if (consecutiveFailures >= FEEDER_JAM_FAILURES && !jammed) {
+                jammed = true;
+                jamAlarms++;
+                if (jamCallback) jamCallback(consecutiveFailures);
+            }
+        }
+    }
+    if (doneCallback) doneCallback(dropped || dropPin < 0, elapsed);
+}
+
+bool FeederController::isBusy() { return running; }
+bool FeederController::isJammed() { return jammed; }
+bool FeederController::hasDropSensor() { return dropPin >= 0; }
+
+void FeederController::clearJam() {
+    jammed = false;
+    consecutiveFailures = 0;
+}
+
+unsigned long FeederController::dispensedCount() { return dispensed; }
+unsigned long FeederController::failedCount() { return failed; }
+unsigned long FeederController::jamAlarmCount() { return jamAlarms; }
+uint32_t FeederController::lastLatencyMs() { return lastLatency; }
+
+bool FeederController::isArmed() { return armed; }
+uint32_t FeederController::armTag() { return armTagValue; }
+int32_t FeederController::lastLandingErrorMs() { return lastLandingError; }
+
+uint32_t FeederController::expectedLatencyMs() {
+    uint32_t avg = avgLatencyMs();
+    return avg ? avg : FEEDER_DEFAULT_LATENCY_MS;
+}
+
+uint32_t FeederController::avgLatencyMs() {
+    unsigned long n = dropPin >= 0 ? latencySamples : 0;
+    return n ? (uint32_t)(latencyTotal / n) : 0;
+}
+
+void FeederController::getStatus(String& statusMsg) {
+    statusMsg = String(running ? "Dispensing" : (jammed ? "JAMMED" : (armHeld ? "Held" : (armed ? "Armed" : "Idle")))) +
+                (dropPin >= 0 ? "" : " (open loop)") +
+                ", dispensed: " + String(dispensed) +
+                ", failed: " + String(failed) +
+                ", jam alarms: " + String(jamAlarms) +
+                ", latency last/avg: " + String(lastLatency) + "/" + String(avgLatencyMs()) + " ms" +
+                ", stray drops: " + String(strayDrops) +
+                ", pre-arms committed/cancelled: " + String(armsCommitted) + "/" + String(armsCancelled) +
+                ", landing error: " + String(lastLandingError) + " ms" +
+                ", wasted: " + String(treatsWasted);
+}
@@ -0,0 +1,136 @@
+#ifndef FEEDER_CONTROLLER_H
+#define FEEDER_CONTROLLER_H
+
+#include <Arduino.h>
+#include "driver/gpio.h"
+#include <functional>
+#include "ActuatorTrace.h"
+
+// Callback function types
+typedef std::function<void(bool dropped, uint32_t elapsedMs)> DispenseDoneCallback;
+typedef std::function<void(uint8_t consecutiveFailures)> JamCallback;
+
+#define FEEDER_STEP_HZ           250   // Same rate as the old 2 ms high / 2 ms low loop
+#define FEEDER_LEDC_CHANNEL      4
+#define FEEDER_DROP_DEBOUNCE_MS  30
+#define FEEDER_JAM_FAILURES      2     // Consecutive timeouts before the jam alarm
+#define FEEDER_DEFAULT_LATENCY_MS 500  // Pre-arm lead until drops have been timed
+#define FEEDER_PREARM_HOLD_MS    150   // Pre-armed run pauses this long before the deadline
+
+// Closed-loop treat dispenser. The stepper is driven by an LEDC step train
+// (no blocking loop) and stops as soon as the drop sensor (IR break-beam,
+// active low, on an interrupt) sees a treat fall, or when the time budget
+// runs out. Without a drop sensor it runs for the full budget as before.
+//
+// The ISR disables the driver through EN immediately; update() then tidies
+// up, records the EN edge (at the ISR's time) in the actuator trace and
+// reports the outcome. Individual step edges come from LEDC; the trace gets
+// the step pin's duty changes instead.
+//
+// Pre-arm: arm() schedules a dispense so the treat lands just after a given
+// deadline, starting the motor early by the learned motor→drop latency. The
+// run pauses FEEDER_PREARM_HOLD_MS before the deadline, short of the drop,
+// and only finishes once commitArm() confirms the reward; a bark in the lead
+// makes the caller disarm() and the treat stays part-way along the chute.
+// Runs that start from such a part-way treat are left out of the latency
+// average. The arm stays pending after the run ends so the caller can match
+// it against the reward decision.
+class FeederController {
+public:
+    // Constructor (dropPin < 0 = no drop sensor, open-loop timing)
+    FeederController(ActuatorTrace& trace, int stepPin, int dirPin, int enPin, int dropPin = -1);
+
+    // Setup functions
+    void begin();
+    void setCallbacks(DispenseDoneCallback onDone, JamCallback onJam);
+
+    // Start dispensing; runs until a treat drops or maxMs passes.
+    // Returns false if a dispense is already running.
+    bool dispense(uint32_t maxMs);
+
+    // Pre-arm for a deadline (tag identifies the plan it belongs to).
+    // Returns false if busy, jammed or already armed.
+    bool arm(uint32_t releaseAtMs, uint32_t maxMs, uint32_t tag);
+    void commitArm();   // Reward confirmed: let the run finish normally
+    void disarm();      // Reward cancelled: stop the motor if it started
+    bool isArmed();
+    uint32_t armTag();
+    uint32_t expectedLatencyMs();
+
+    // Main loop function
+    void update();
+
+    // Control functions
+    void stop();
+    bool isBusy();
+    bool isJammed();
+    void clearJam();
+    bool hasDropSensor();
+    void getStatus(String& statusMsg);
+
+    // Metrics
+    unsigned long dispensedCount();   // Treat seen by the sensor
+    unsigned long failedCount();      // Timed out without a treat
+    unsigned long jamAlarmCount();
+    uint32_t lastLatencyMs();         // Motor start → treat detected
+    uint32_t avgLatencyMs();          // Of runs that started with the treat at rest
+    int32_t lastLandingErrorMs();     // Drop time - deadline of the last pre-armed treat
+
+private:
+    ActuatorTrace& trace;
+
+    // Hardware config
+    int stepPin;
+    int dirPin;
+    int enPin;
+    int dropPin;
+
+    // Dispense state
+    volatile bool running;
+    unsigned long startMs;
+    uint32_t budgetMs;
+    volatile bool dropSeen;
+    volatile unsigned long dropMs;
+    volatile uint32_t dropUs;           // micros() of the ISR's EN write, for the trace
+    volatile unsigned long lastDropEdgeMs;
+    uint8_t consecutiveFailures;
+    bool jammed;
+
+    // Pre-arm state
+    bool armed;
+    bool armStarted;
+    uint32_t armReleaseMs;
+    uint32_t armBudgetMs;
+    uint32_t armTagValue;
+    bool runPrearmed;
+    bool armHeld;                       // Paused short of the drop, waiting for commitArm()
+    uint32_t heldMotorMs;               // Motor time before the pause, part of the drop latency
+    bool treatAdvanced;                 // A stopped run left the treat part-way along
+
+    // Stats
+    unsigned long dispensed;
+    unsigned long failed;
+    unsigned long jamAlarms;
+    volatile unsigned long strayDrops;   // Sensor edges while idle
+    uint32_t lastLatency;
+    uint64_t latencyTotal;
+    unsigned long latencySamples;
+    unsigned long armsCommitted;
+    unsigned long armsCancelled;
+    unsigned long treatsWasted;          // Dropped early, then cancelled
+    int32_t lastLandingError;
+
+    DispenseDoneCallback doneCallback;
+    JamCallback jamCallback;
+
+    static FeederController* instance;  // GPIO ISR has no context argument here
+    static void IRAM_ATTR onDropISR();
+
+    void motorOn();
+    void motorOff();
+    void setStepDuty(uint32_t duty);
+    void startRun(uint32_t maxMs, bool prearmed = false);
+    void finish(bool dropped);
+};
+
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// IMA ADPCM (4 bits per sample, two samples per byte, low nibble first).
+// No Arduino dependencies so captured clips can be decoded on the host.
+struct ImaAdpcmState {
+  int16_t predictor = 0;
+  uint8_t index = 0;
+};
+
+static const int16_t IMA_STEP_TABLE[89] = {
+  7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+  50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+  253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+  1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+  3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+  11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+  32767
+};
+
+static const int8_t IMA_INDEX_TABLE[16] = {
+  -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+// Apply one code to the state; shared by encoder and decoder so they agree
+static inline int16_t imaAdpcmStep(ImaAdpcmState& st, uint8_t code) {
+  int32_t step = IMA_STEP_TABLE[st.index];
+  int32_t diff = step >> 3;
+  if (code & 4) diff += step;
+  if (code & 2) diff += step >> 1;
+  if (code & 1) diff += step >> 2;
+
+  int32_t p = st.predictor + ((code & 8) ? -diff : diff);
+  if (p > 32767) p = 32767;
+  if (p < -32768) p = -32768;
+  st.predictor = (int16_t)p;
+
+  int idx = st.index + IMA_INDEX_TABLE[code & 15];
+  st.index = (uint8_t)(idx < 0 ? 0 : (idx > 88 ? 88 : idx));
+  return st.predictor;
+}
+
+static inline uint8_t imaAdpcmEncodeSample(ImaAdpcmState& st, int16_t sample) {
+  int32_t step = IMA_STEP_TABLE[st.index];
+  int32_t diff = (int32_t)sample - st.predictor;
+  uint8_t code = 0;
+  if (diff < 0) { code = 8; diff = -diff; }
+  if (diff >= step) { code |= 4; diff -= step; }
+  step >>= 1;
+  if (diff >= step) { code |= 2; diff -= step; }
+  step >>= 1;
+  if (diff >= step) { code |= 1; }
+  imaAdpcmStep(st, code);
+  return code;
+}
+
+// Encode n samples (n even) into n/2 bytes
+static inline void imaAdpcmEncode(ImaAdpcmState& st, const int16_t* in, size_t n, uint8_t* out) {
+  for (size_t i = 0; i + 1 < n; i += 2) {
+    uint8_t lo = imaAdpcmEncodeSample(st, in[i]);
+    uint8_t hi = imaAdpcmEncodeSample(st, in[i + 1]);
+    out[i / 2] = (uint8_t)(lo | (hi << 4));
+  }
+}
+
+// Decode nBytes into 2 * nBytes samples
+static inline void imaAdpcmDecode(ImaAdpcmState& st, const uint8_t* in, size_t nBytes, int16_t* out) {
+  for (size_t i = 0; i < nBytes; i++) {
+    out[2 * i]     = imaAdpcmStep(st, in[i] & 15);
+    out[2 * i + 1] = imaAdpcmStep(st, in[i] >> 4);
+  }
+}
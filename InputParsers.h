@@ -0,0 +1,100 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+// Parsers for untrusted input: serial console lines and their arguments,
+// and the legacy bark advertisement match. Plain C++ with no Arduino types,
+// so tools/fuzz_parsers runs exactly this code under the sanitizers; the
+// sketch wraps them for String and Serial.
+
+#define CONSOLE_INT_LIMIT  100000   // Magnitude limit of plain numeric arguments
+
+enum LineStatus : uint8_t { LINE_NONE, LINE_READY, LINE_TOO_LONG };
+
+// Bounded line assembler fed one byte at a time. CR or LF ends a line;
+// empty lines are skipped and lines longer than MAX are dropped whole
+// (reported once, at their end) instead of growing without limit.
+template <size_t MAX>
+class LineReader {
+public:
+  LineStatus push(char c) {
+    if (c != '\n' && c != '\r') {
+      if (_len < MAX) _buf[_len++] = c;
+      else _overflow = true;
+      return LINE_NONE;
+    }
+    bool overflow = _overflow, empty = _len == 0;
+    _buf[_len] = '\0';
+    _len = 0;
+    _overflow = false;
+    if (overflow) return LINE_TOO_LONG;
+    return empty ? LINE_NONE : LINE_READY;
+  }
+
+  // Valid after LINE_READY until the next push()
+  const char* line() const { return _buf; }
+
+private:
+  char _buf[MAX + 1];
+  size_t _len{0};
+  bool _overflow{false};
+};
+
+// Decimal integer in [lo, hi] filling the rest of s: optional leading
+// spaces and '-', then digits only. Empty, non-numeric and out-of-range
+// input is rejected rather than read as 0 or wrapped.
+inline bool parseDecimal(const char* s, int64_t lo, int64_t hi, int64_t& value) {
+  while (*s == ' ') s++;
+  bool negative = *s == '-';
+  if (negative) s++;
+  if (!*s) return false;
+
+  uint64_t limit = negative ? (uint64_t)(lo < 0 ? -lo : 0) : (uint64_t)(hi > 0 ? hi : 0);
+  uint64_t v = 0;
+  for (; *s; s++) {
+    if (*s < '0' || *s > '9') return false;
+    v = v * 10 + (uint64_t)(*s - '0');
+    if (v > limit) return false;
+  }
+  int64_t r = negative ? -(int64_t)v : (int64_t)v;
+  if (r < lo || r > hi) return false;
+  value = r;
+  return true;
+}
+
+// Lower-case hex → bytes; returns the byte count, or -1 if malformed/too long
+inline int parseHexBytes(const char* s, uint8_t* out, int maxLen) {
+  int n = 0;
+  for (; s[n]; n++) {
+    if (n / 2 >= maxLen) return -1;
+    char c = s[n];
+    uint8_t v;
+    if (c >= '0' && c <= '9') v = c - '0';
+    else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+    else return -1;
+    if (n % 2 == 0) out[n / 2] = v << 4;
+    else out[n / 2] |= v;
+  }
+  return n % 2 == 0 ? n / 2 : -1;
+}
+
+// "H:MM" or "HH:MM" → minute of the day
+inline bool parseClockTime(const char* s, uint16_t& minute) {
+  int h = 0, i = 0;
+  for (; i < 2 && s[i] >= '0' && s[i] <= '9'; i++) h = h * 10 + (s[i] - '0');
+  if (i == 0 || s[i] != ':') return false;
+  const char* m = s + i + 1;
+  if (m[0] < '0' || m[0] > '9' || m[1] < '0' || m[1] > '9' || m[2]) return false;
+  int mm = (m[0] - '0') * 10 + (m[1] - '0');
+  if (h > 23 || mm > 59) return false;
+  minute = h * 60 + mm;
+  return true;
+}
+
+// Legacy bark advertisement (unauthenticated name/tag match). Both fields
+// come straight from radio data.
+inline bool isBarkAdvertisement(const std::string& name, const std::string& mfgData,
+                                const char* advName, const char* advTag) {
+  return name == advName && mfgData.find(advTag) != std::string::npos;
+}
@@ -0,0 +1,124 @@
+#include "MarkerCue.h"
+
+MarkerCue::MarkerCue(ToneEngine& tones)
+    : tones(tones), deadlineProbe("cue.deadline") {
+    enabled = true;
+
+    timer = nullptr;
+    lock = portMUX_INITIALIZER_UNLOCKED;
+    state = IDLE;
+    tag = 0;
+    scheduledPattern = CUE_MARKER;
+    targetUs = 0;
+
+    fired = 0;
+    timed = 0;
+    cancelled = 0;
+    lastOnsetErrorUs = 0;
+}
+
+void MarkerCue::begin() {
+    esp_timer_create_args_t args = {};
+    args.callback = &MarkerCue::onTimer;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "marker";
+    esp_timer_create(&args, &timer);
+}
+
+void MarkerCue::setPlanEpochSource(PlanEpochSource source) {
+    planEpoch = source;
+}
+
+bool MarkerCue::schedule(uint32_t atMs, uint32_t planTag, CuePattern pattern) {
+    if (!enabled || state == ARMED || state == COMMITTED || !timer || pattern >= CUE_PATTERN_COUNT) return false;
+
+    // millis() is esp_timer time / 1000: aim for the µs at which it reaches atMs
+    int64_t nowUs = esp_timer_get_time();
+    uint32_t nowMs = (uint32_t)(nowUs / 1000);
+    int32_t aheadMs = (int32_t)(atMs - nowMs);
+    if (aheadMs <= 0) return false;  // Too late to schedule; caller fires instead
+
+    targetUs = nowUs - (nowUs % 1000) + (int64_t)aheadMs * 1000;
+    tag = planTag;
+    scheduledPattern = pattern;
+    state = ARMED;
+    if (esp_timer_start_once(timer, (uint64_t)(targetUs - nowUs)) != ESP_OK) {
+        state = IDLE;
+        return false;
+    }
+    return true;
+}
+
+void MarkerCue::cancel() {
+    portENTER_CRITICAL(&lock);
+    bool armed = state == ARMED;
+    if (armed) {
+        state = IDLE;  // A callback already running now does nothing
+        cancelled++;
+    }
+    portEXIT_CRITICAL(&lock);
+    if (armed) esp_timer_stop(timer);
+}
+
+bool MarkerCue::commit(uint32_t planTag) {
+    portENTER_CRITICAL(&lock);
+    bool ours = planTag == tag && state != IDLE;
+    if (ours && state == ARMED) state = COMMITTED;  // Plays even though the epoch moves on now
+    else if (ours) state = IDLE;
+    portEXIT_CRITICAL(&lock);
+    return ours;
+}
+
+bool MarkerCue::isScheduled() { return state == ARMED; }
+uint32_t MarkerCue::scheduledTag() { return tag; }
+
+// esp_timer task: start the cue unless the plan changed since it was armed,
+// and record how late the callback ran
+void MarkerCue::onTimer(void* arg) {
+    MarkerCue* m = (MarkerCue*)arg;
+    int32_t err = (int32_t)(esp_timer_get_time() - m->targetUs);
+    bool stale = m->planEpoch && m->planEpoch() != m->tag;
+
+    portENTER_CRITICAL(&m->lock);
+    bool play = m->state == COMMITTED || (m->state == ARMED && !stale);
+    bool drop = m->state == ARMED && stale;
+    m->state = play ? PLAYED : IDLE;
+    if (drop) m->cancelled++;
+    if (play) {
+        m->timed++;
+        m->fired++;
+    }
+    portEXIT_CRITICAL(&m->lock);
+    if (!play) return;
+
+    m->tones.play(m->scheduledPattern);
+
+    m->lastOnsetErrorUs = err;
+    m->deadlineProbe.recordUs(err > 0 ? err : 0);
+}
+
+void MarkerCue::fire(CuePattern pattern) {
+    if (!enabled) return;
+    if (!tones.play(pattern)) return;
+    portENTER_CRITICAL(&lock);
+    fired++;
+    portEXIT_CRITICAL(&lock);
+}
+
+void MarkerCue::setEnabled(bool enabled) {
+    this->enabled = enabled;
+    if (!enabled) cancel();
+}
+
+bool MarkerCue::isEnabled() { return enabled; }
+
+void MarkerCue::getStatus(String& statusMsg) {
+    portENTER_CRITICAL(&lock);
+    unsigned long nFired = fired, nTimed = timed, nCancelled = cancelled;
+    portEXIT_CRITICAL(&lock);
+    statusMsg = String(enabled ? (isScheduled() ? "Scheduled" : "Idle") : "OFF") +
+                ", cues: " + String(nFired) +
+                " (timed " + String(nTimed) + ", cancelled " + String(nCancelled) + ")" +
+                ", last onset error: " + String(lastOnsetErrorUs) + " us (\"perf\" for avg/max)";
+}
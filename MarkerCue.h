@@ -0,0 +1,70 @@
+#ifndef MARKER_CUE_H
+#define MARKER_CUE_H
+
+#include <Arduino.h>
+#include "esp_timer.h"
+#include "ToneEngine.h"
+#include <functional>
+
+typedef std::function<uint32_t()> PlanEpochSource;
+
+// Marker cue: tells the dog the exact moment it earned the reward, however
+// long the feeder takes. Playback is the ToneEngine's (tone + LED, from
+// flash tables); this class only decides when.
+//
+// schedule() arms a one-shot esp_timer for the quiet deadline the manager
+// predicts, so the cue starts within the timer's jitter (tens of µs) rather
+// than at the next loop() pass; fire() starts a cue right away. The timer
+// callback checks the plan epoch itself, so a bark or punishment between
+// loop()'s last look and the deadline cancels the cue instead of marking it.
+class MarkerCue {
+public:
+    explicit MarkerCue(ToneEngine& tones);
+
+    // Setup functions
+    void begin();
+    void setPlanEpochSource(PlanEpochSource source);  // Current plan epoch (read in the timer task)
+
+    // Start a cue at the moment millis() reaches atMs (tag identifies the
+    // plan it belongs to). Returns false if one is already scheduled.
+    bool schedule(uint32_t atMs, uint32_t tag, CuePattern pattern = CUE_MARKER);
+    void cancel();       // Plan changed before the deadline
+    // Deadline of plan tag confirmed: true if the timer played or will play
+    // its cue, false if the caller has to fire one
+    bool commit(uint32_t tag);
+    bool isScheduled();  // Armed and not yet committed, played or cancelled
+    uint32_t scheduledTag();
+
+    // Start a cue now
+    void fire(CuePattern pattern = CUE_MARKER);
+
+    // Control functions
+    void setEnabled(bool enabled);
+    bool isEnabled();
+    void getStatus(String& statusMsg);
+
+private:
+    ToneEngine& tones;
+    bool enabled;
+
+    // Schedule state, shared with the timer task
+    enum State : uint8_t { IDLE, ARMED, COMMITTED, PLAYED };
+    esp_timer_handle_t timer;
+    portMUX_TYPE lock;
+    volatile State state;
+    PlanEpochSource planEpoch;
+    uint32_t tag;
+    CuePattern scheduledPattern;
+    int64_t targetUs;
+
+    // Stats (counters under lock: the timer task updates them too)
+    unsigned long fired;
+    unsigned long timed;        // Started by the timer
+    unsigned long cancelled;
+    volatile int32_t lastOnsetErrorUs;
+    PerfProbe deadlineProbe;    // Deadline → timer callback (benchmark harness)
+
+    static void onTimer(void* arg);
+};
+
+#endif
@@ -0,0 +1,159 @@
+#include "MicBarkDetector.h"
+
+MicBarkDetector::MicBarkDetector(int sckPin, int wsPin, int sdPin) {
+    this->sckPin = sckPin;
+    this->wsPin = wsPin;
+    this->sdPin = sdPin;
+    this->i2sPort = I2S_NUM_0;
+    this->installed = false;
+    this->enabled = true;
+    this->i2sEvents = nullptr;
+    this->blockQueue = nullptr;
+
+    blocksProcessed = 0;
+    barksDetected = 0;
+    dmaOverruns = 0;
+    blocksDropped = 0;
+}
+
+void MicBarkDetector::begin() {
+    setupI2S();
+    if (installed) {
+        blockQueue = xQueueCreate(MIC_QUEUE_BLOCKS, sizeof(pcmBlock));
+        if (!blockQueue || xTaskCreatePinnedToCore(captureTask, "mic", MIC_TASK_STACK, this,
+                                                   MIC_TASK_PRIORITY, nullptr, MIC_TASK_CORE) != pdPASS) {
+            installed = false;
+        }
+    }
+    Serial.println(installed ? "MicBarkDetector initialized" : "MicBarkDetector: I2S install failed");
+}
+
+void MicBarkDetector::setCallback(BarkCallback onBark) {
+    barkCallback = onBark;
+}
+
+void MicBarkDetector::setAudioTap(AudioTapCallback tap) {
+    audioTap = tap;
+}
+
+void MicBarkDetector::setupI2S() {
+    i2s_config_t config = {};
+    config.mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX);
+    config.sample_rate = MIC_SAMPLE_RATE;
+    config.bits_per_sample = I2S_BITS_PER_SAMPLE_32BIT;  // 24-bit data in 32-bit slots
+    config.channel_format = I2S_CHANNEL_FMT_ONLY_LEFT;
+    config.communication_format = I2S_COMM_FORMAT_STAND_I2S;
+    config.intr_alloc_flags = 0;
+    config.dma_buf_count = MIC_DMA_BUFFERS;
+    config.dma_buf_len = MIC_BLOCK_SAMPLES;
+    config.use_apll = false;
+
+    if (i2s_driver_install(i2sPort, &config, 4, &i2sEvents) != ESP_OK) return;
+
+    i2s_pin_config_t pins = {};
+    pins.mck_io_num = I2S_PIN_NO_CHANGE;
+    pins.bck_io_num = sckPin;
+    pins.ws_io_num = wsPin;
+    pins.data_out_num = I2S_PIN_NO_CHANGE;
+    pins.data_in_num = sdPin;
+    i2s_set_pin(i2sPort, &pins);
+    i2s_zero_dma_buffer(i2sPort);
+    installed = true;
+}
+
+// Capture runs in its own task above loop(): a LittleFS write in loop()
+// (clip saving) then only holds capture off for single flash operations,
+// which the DMA buffers outlast, instead of for the whole write.
+void MicBarkDetector::captureTask(void* arg) {
+    MicBarkDetector* m = (MicBarkDetector*)arg;
+    for (;;) m->captureBlock();
+}
+
+// Blocks until the DMA has a whole block, feeds the audio tap (clip ring)
+// and queues the block for the DSP
+void MicBarkDetector::captureBlock() {
+    if (!enabled) {
+        vTaskDelay(pdMS_TO_TICKS(MIC_BLOCK_SAMPLES * 1000 / MIC_SAMPLE_RATE));
+        return;
+    }
+
+    i2s_event_t evt;
+    while (xQueueReceive(i2sEvents, &evt, 0) == pdTRUE) {
+        if (evt.type == I2S_EVENT_RX_Q_OVF) dmaOverruns++;
+    }
+
+    size_t bytesRead = 0;
+    i2s_read(i2sPort, rawBlock, sizeof(rawBlock), &bytesRead, portMAX_DELAY);
+    if (bytesRead < sizeof(rawBlock)) return;
+
+    // Top 24 bits are the sample; keep 16 bits with 2 bits of gain, saturated
+    for (int i = 0; i < MIC_BLOCK_SAMPLES; i++) {
+        int32_t s = rawBlock[i] >> 14;
+        capturedBlock[i] = (int16_t)constrain(s, -32768, 32767);
+    }
+
+    if (audioTap) audioTap(capturedBlock, MIC_BLOCK_SAMPLES);
+    if (xQueueSend(blockQueue, capturedBlock, 0) != pdTRUE) blocksDropped++;
+}
+
+// Non-blocking: runs the DSP on every block the capture task has queued
+void MicBarkDetector::update() {
+    if (!installed || !enabled) return;
+
+    while (xQueueReceive(blockQueue, pcmBlock, 0) == pdTRUE) processBlock();
+}
+
+void MicBarkDetector::processBlock() {
+    blocksProcessed++;
+    if (barkDsp.processBlock(pcmBlock, MIC_BLOCK_SAMPLES)) {
+        barksDetected++;
+        const BarkFeatures& f = barkDsp.lastFeatures();
+        Serial.printf("Mic bark (energy %lu, mid %lu, floor %lu, score %ld)\n",
+                      (unsigned long)f.energy, (unsigned long)f.midEnergy,
+                      (unsigned long)barkDsp.noiseFloor(),
+                      (long)barkDsp.classifier().lastScore());
+        if (barkCallback) barkCallback();
+    }
+}
+
+void MicBarkDetector::setEnabled(bool enabled) {
+    this->enabled = enabled;
+    if (enabled) {
+        barkDsp.reset();
+        if (installed) {
+            i2s_zero_dma_buffer(i2sPort);
+            xQueueReset(blockQueue);
+        }
+    }
+}
+
+bool MicBarkDetector::isEnabled() {
+    return enabled;
+}
+
+bool MicBarkDetector::isRunning() {
+    return installed && enabled;
+}
+
+void MicBarkDetector::getStatus(String& statusMsg) {
+    if (!installed) {
+        statusMsg = "Not installed";
+        return;
+    }
+    const BarkFeatures& f = barkDsp.lastFeatures();
+    statusMsg = String(enabled ? "On" : "Off") + ", barks: " + String(barksDetected) +
+                ", blocks: " + String(blocksProcessed) +
+                " (lost: " + String(dmaOverruns) + " DMA, " + String(blocksDropped) + " DSP)" +
+                ", energy: " + String((unsigned long)f.energy) +
+                " (floor " + String((unsigned long)barkDsp.noiseFloor()) + ")";
+    if (barkDsp.config().useClassifier) {
+        statusMsg += ", classifier runs: " + String((unsigned long)barkDsp.classifierRuns()) +
+                     " (last score " + String((long)barkDsp.classifier().lastScore()) + ")";
+    } else {
+        statusMsg += ", classifier off";
+    }
+}
+
+BarkDsp& MicBarkDetector::dsp() {
+    return barkDsp;
+}
@@ -0,0 +1,74 @@
+#ifndef MIC_BARK_DETECTOR_H
+#define MIC_BARK_DETECTOR_H
+
+#include <Arduino.h>
+#include "driver/i2s.h"
+#include <functional>
+#include "BarkDsp.h"
+
+// Callback function types
+typedef std::function<void()> BarkCallback;
+typedef std::function<void(const int16_t* pcm, size_t n)> AudioTapCallback;
+
+#define MIC_SAMPLE_RATE          16000
+#define MIC_BLOCK_SAMPLES        256   // 16 ms per block
+#define MIC_DMA_BUFFERS          8     // 128 ms: outlasts a flash sector erase (no task runs from flash then)
+#define MIC_QUEUE_BLOCKS         16    // 256 ms of blocks waiting for the DSP in loop()
+#define MIC_TASK_PRIORITY        5     // Above loop() (1): clip saving in loop() cannot hold off capture
+#define MIC_TASK_CORE            1
+#define MIC_TASK_STACK           3072
+
+class MicBarkDetector {
+public:
+    // Constructor (I2S MEMS microphone, e.g. INMP441)
+    MicBarkDetector(int sckPin = 18, int wsPin = 19, int sdPin = 34);
+
+    // Setup functions (set the callbacks before begin(): the tap runs in the capture task)
+    void begin();
+    void setCallback(BarkCallback onBark);
+    void setAudioTap(AudioTapCallback tap);  // Sees every PCM block before the DSP
+
+    // Main loop function (DSP on every block captured since the last call)
+    void update();
+
+    // Control functions
+    void setEnabled(bool enabled);
+    bool isEnabled();
+    bool isRunning();  // Enabled and capturing (I2S installed)
+    void getStatus(String& statusMsg);
+    BarkDsp& dsp();
+
+private:
+    // Hardware config
+    int sckPin;
+    int wsPin;
+    int sdPin;
+    i2s_port_t i2sPort;
+    bool installed;
+    volatile bool enabled;
+
+    // Capture task → loop(): whole PCM blocks
+    QueueHandle_t i2sEvents;
+    QueueHandle_t blockQueue;
+    int32_t rawBlock[MIC_BLOCK_SAMPLES];    // Capture task only
+    int16_t capturedBlock[MIC_BLOCK_SAMPLES];
+    int16_t pcmBlock[MIC_BLOCK_SAMPLES];    // loop() only
+
+    // Stats
+    unsigned long blocksProcessed;
+    unsigned long barksDetected;
+    volatile unsigned long dmaOverruns;     // Samples lost before capture (DMA full)
+    volatile unsigned long blocksDropped;   // Captured, but the DSP queue was full
+
+    BarkDsp barkDsp;
+    BarkCallback barkCallback;
+    AudioTapCallback audioTap;
+
+    // Internal functions
+    void setupI2S();
+    static void captureTask(void* arg);
+    void captureBlock();
+    void processBlock();
+};
+
+#endif
@@ -0,0 +1,99 @@
+#pragma once
+#include <stdint.h>
+
+// Streaming quantile estimate (Jain & Chlamtac P² algorithm): five markers,
+// O(1) per sample, no sample storage. Until five samples have arrived it is
+// the nearest order statistic; after that it converges on the quantile. It
+// follows slow drift in the distribution but never forgets old samples.
+class P2Quantile {
+public:
+  explicit P2Quantile(float p = 0.5f) { reset(p); }
+
+  void reset(float p) {
+    _p = p;
+    _count = 0;
+    _dn[0] = 0.0f;
+    _dn[1] = p / 2.0f;
+    _dn[2] = p;
+    _dn[3] = (1.0f + p) / 2.0f;
+    _dn[4] = 1.0f;
+  }
+
+  void add(float x) {
+    if (_count < 5) {
+      // Insertion sort the first five samples into the markers
+      int i = _count++;
+      while (i > 0 && _q[i - 1] > x) {
+        _q[i] = _q[i - 1];
+        i--;
+      }
+      _q[i] = x;
+      if (_count == 5) {
+        for (int j = 0; j < 5; j++) {
+          _n[j] = j;
+          _np[j] = 4.0f * _dn[j];
+        }
+      }
+      return;
+    }
+    _count++;
+
+    // Cell containing x; extremes move the end markers
+    int k;
+    if (x < _q[0]) {
+      _q[0] = x;
+      k = 0;
+    } else if (x >= _q[4]) {
+      _q[4] = x;
+      k = 3;
+    } else {
+      k = 0;
+      while (k < 3 && x >= _q[k + 1]) k++;
+    }
+    for (int j = k + 1; j < 5; j++) _n[j]++;
+    for (int j = 0; j < 5; j++) _np[j] += _dn[j];
+
+    // Nudge the middle markers towards their desired positions
+    for (int j = 1; j <= 3; j++) {
+      float d = _np[j] - _n[j];
+      if ((d >= 1.0f && _n[j + 1] - _n[j] > 1) || (d <= -1.0f && _n[j - 1] - _n[j] < -1)) {
+        int s = d > 0 ? 1 : -1;
+        float q = _parabolic(j, s);
+        if (!(_q[j - 1] < q && q < _q[j + 1])) q = _linear(j, s);
+        _q[j] = q;
+        _n[j] += s;
+      }
+    }
+  }
+
+  // Current estimate (0 before any sample)
+  float value() const {
+    if (_count == 0) return 0.0f;
+    if (_count < 5) {
+      int i = (int)(_p * (_count - 1) + 0.5f);
+      return _q[i];
+    }
+    return _q[2];
+  }
+
+  uint32_t count() const { return _count; }
+  float quantile() const { return _p; }
+
+private:
+  float _parabolic(int j, int s) const {
+    float a = (float)(_n[j] - _n[j - 1] + s) * (_q[j + 1] - _q[j]) / (float)(_n[j + 1] - _n[j]);
+    float b = (float)(_n[j + 1] - _n[j] - s) * (_q[j] - _q[j - 1]) / (float)(_n[j] - _n[j - 1]);
+    return _q[j] + (float)s * (a + b) / (float)(_n[j + 1] - _n[j - 1]);
+  }
+
+  float _linear(int j, int s) const {
+    return _q[j] + (float)s * (_q[j + s] - _q[j]) / (float)(_n[j + s] - _n[j]);
+  }
+
+  float    _p{0.5f};
+  uint32_t _count{0};
+  float    _q[5]{};    // Marker heights
+  int32_t  _n[5]{};    // Marker positions
+  float    _np[5]{};   // Desired positions
+  float    _dn[5]{};   // Desired position increments
+};
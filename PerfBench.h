@@ -0,0 +1,326 @@
+#pragma once
+#include <Arduino.h>
+#include "esp_timer.h"
+#include "PerfCounters.h"
+#include "ClickDetector.h"
+#include "BLEBarkWindow.h"
+#include "QuietReinforcementManager.h"
+#include "BarkAuth.h"
+#include "InputParsers.h"
+#include "EventJournal.h"
+#include "ActuatorTrace.h"
+#ifndef ARDUINO
+#include <chrono>
+#endif
+
+// Micro-benchmarks of the hot paths, Google Benchmark style: a case is a
+// function taking a PerfBenchState and doing its work in
+// "for (auto _ : state)", registered with PERF_BENCH(name, fn). Each case runs with
+// 10x more iterations until a batch takes PERF_BENCH_MIN_US.
+//
+// The same cases build into the sketch (ENABLE_PERF_BENCH, console
+// "perf bench [name]"), which reports cycles per op from perfCycles()
+// (esp_cpu_get_cycle_count on IDF 5) at the current clock, and into
+// tools/perf_bench on the host, which reports ns per op only. Cases use
+// their own instances, never the sketch's globals; the ones that persist
+// state use the "perfbench" NVS namespace.
+
+#ifdef ARDUINO
+#define PERF_BENCH_MIN_US  50000
+#else
+#define PERF_BENCH_MIN_US  200000
+#endif
+#define PERF_BENCH_MAX_ITERS  10000000UL
+
+// Keep a result alive without the compiler dropping the work behind it
+template <class T>
+inline void perfBenchKeep(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class PerfBenchState {
+public:
+  explicit PerfBenchState(uint32_t iterations) : _iterations(iterations) {}
+
+  struct Value {
+    ~Value() {}  // Non-trivial, so an unused "_" draws no warning
+  };
+  class Iterator {
+  public:
+    Iterator(PerfBenchState* s, uint32_t left) : _s(s), _left(left) {}
+    Value operator*() const { return Value(); }
+    void operator++() { _left--; }
+    bool operator!=(const Iterator&) {
+      if (_left) return true;
+      _s->_stop();
+      return false;
+    }
+
+  private:
+    PerfBenchState* _s;
+    uint32_t _left;
+  };
+
+  Iterator begin() {
+    _start();
+    return Iterator(this, _iterations);
+  }
+  Iterator end() { return Iterator(this, 0); }
+
+  uint32_t iterations() const { return _iterations; }
+  uint32_t cycles() const     { return _cycles; }
+  uint64_t elapsedNs() const  { return _ns; }
+
+private:
+  void _start() {
+    _startNs = _nowNs();
+    _startCycles = perfCycles();
+  }
+  void _stop() {
+    _cycles = perfCycles() - _startCycles;
+    _ns = _nowNs() - _startNs;
+  }
+
+  static uint64_t _nowNs() {
+#ifdef ARDUINO
+    return (uint64_t)esp_timer_get_time() * 1000;
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  uint32_t _iterations;
+  uint64_t _startNs{0};
+  uint32_t _startCycles{0};
+  uint64_t _ns{0};
+  uint32_t _cycles{0};
+};
+
+typedef void (*PerfBenchFn)(PerfBenchState&);
+
+class PerfBench {
+public:
+  PerfBench(const char* name, PerfBenchFn fn) : _name(name), _fn(fn) {
+    PerfBench** p = &_head();
+    while (*p) p = &(*p)->_next;
+    *p = this;  // Run in registration order
+  }
+
+  // Cases whose name contains filter (all if null or empty); returns the count run
+  static int runAll(const char* filter) {
+#ifdef ARDUINO
+    Serial.printf("\n⏱️  PERF BENCH (%lu MHz):\n", (unsigned long)getCpuFrequencyMhz());
+    Serial.println("   case                    iterations   cycles/op      ns/op");
+#else
+    Serial.println("case                    iterations      ns/op");
+#endif
+    int ran = 0;
+    for (PerfBench* b = _head(); b; b = b->_next) {
+      if (filter && *filter && !strstr(b->_name, filter)) continue;
+      b->_run();
+      ran++;
+    }
+    return ran;
+  }
+
+private:
+  void _run() {
+    for (uint32_t n = 1;; n *= 10) {
+      PerfBenchState st(n);
+      _quiet(true);
+      _fn(st);
+      _quiet(false);
+      if (st.elapsedNs() < (uint64_t)PERF_BENCH_MIN_US * 1000 && n < PERF_BENCH_MAX_ITERS) continue;
+      double nsPerOp = (double)st.elapsedNs() / n;
+#ifdef ARDUINO
+      Serial.printf("   %-22s %11lu %11.1f %10.1f\n", _name, (unsigned long)n, (double)st.cycles() / n, nsPerOp);
+      delay(1);  // Let the idle task run between cases
+#else
+      Serial.printf("%-22s %11lu %10.1f\n", _name, (unsigned long)n, nsPerOp);
+#endif
+      return;
+    }
+  }
+
+  // Mute what the cases print (host only; the device has no such switch)
+  static void _quiet(bool on) {
+#ifndef ARDUINO
+    Serial.quiet = on;
+#else
+    (void)on;
+#endif
+  }
+
+  static PerfBench*& _head() {
+    static PerfBench* head = nullptr;
+    return head;
+  }
+
+  const char* _name;
+  PerfBenchFn _fn;
+  PerfBench*  _next{nullptr};
+};
+
+#define PERF_BENCH(name, fn) static PerfBench fn##_registration(name, fn)
+
+// ===== Cases =====
+
+// EV1527-style remote frame: 24 bits of short/long pairs and a sync gap, x4
+static int perfBenchRfFrame(rmt_item32_t* items, uint32_t code) {
+  int n = 0;
+  for (int rep = 0; rep < 4; rep++) {
+    for (int b = 23; b >= 0; b--) {
+      bool one = code >> b & 1;
+      int jitter = (b % 3 - 1) * 20;
+      rmt_item32_t& it = items[n++];
+      it.duration0 = (one ? 1050 : 350) + jitter;
+      it.level0 = 1;
+      it.duration1 = (one ? 350 : 1050) - jitter;
+      it.level1 = 0;
+    }
+    rmt_item32_t& sync = items[n++];
+    sync.duration0 = 350;
+    sync.level0 = 1;
+    sync.duration1 = 10850;
+    sync.level1 = 0;
+  }
+  return n;
+}
+
+static void benchRfDecode(PerfBenchState& st) {
+  static rmt_item32_t items[100];
+  int n = perfBenchRfFrame(items, 0xA5C3F1);
+  ClickDetector det;
+  for (auto _ : st) perfBenchKeep(det.decodeFrame(items, n));
+}
+PERF_BENCH("rf.decode", benchRfDecode);
+
+static void benchRfMatch(PerfBenchState& st) {
+  static rmt_item32_t items[100];
+  int n = perfBenchRfFrame(items, 0xA5C3F1);
+  ClickDetector det;
+  for (int i = 0; i < 3; i++) det.processFrame(items, n);  // Learn the button
+  for (auto _ : st) perfBenchKeep(det.matchesSignature(det.decodeFrame(items, n)));
+}
+PERF_BENCH("rf.decode+match", benchRfMatch);
+
+static void benchBarkWindow(PerfBenchState& st) {
+  BLEBarkWindow window(5000);
+  uint32_t now = 0;
+  for (auto _ : st) {
+    now += 5000;  // Always outside the window: the common, silent path
+    perfBenchKeep(window.shouldPunish(now));
+  }
+}
+PERF_BENCH("ble.window", benchBarkWindow);
+
+static const uint8_t PERF_BENCH_PATTERN[] = {1, 0, 1, 1, 0};
+static const LevelConfig PERF_BENCH_LEVELS[] = {
+  {3000, 1000, PERF_BENCH_PATTERN, 5, false},
+  {8000, 800, PERF_BENCH_PATTERN, 5, true},
+};
+
+// The quiet period restarts before it is due, so this is the per-loop()
+// check and never a success (which would save to NVS)
+static void benchQuietTick(PerfBenchState& st) {
+  QuietReinforcementManager mgr("perfbench", PERF_BENCH_LEVELS, 2);
+  mgr.begin();
+  uint32_t now = millis(), quietFrom = now;
+  mgr.restartQuiet(now);
+  for (auto _ : st) {
+    now += 10;  // A loop() pass
+    if (now - quietFrom >= 2000) mgr.restartQuiet(quietFrom = now);
+    perfBenchKeep(mgr.tick(now));
+  }
+}
+PERF_BENCH("quiet.tick", benchQuietTick);
+
+// A bark burst 1 ms apart: the throttled save runs once per 10000 barks
+static void benchQuietBark(PerfBenchState& st) {
+  QuietReinforcementManager mgr("perfbench", PERF_BENCH_LEVELS, 2);
+  mgr.begin();
+  uint32_t now = millis();
+  for (auto _ : st) mgr.onBark(++now);
+}
+PERF_BENCH("quiet.onBark", benchQuietBark);
+
+static const uint8_t PERF_BENCH_KEY[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                                           0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+
+// Someone else's beacon: what almost every advertisement is
+static void benchAdvForeign(PerfBenchState& st) {
+  BarkAuth auth("perfbench");
+  auth.pair(7, PERF_BENCH_KEY);
+  std::string mfg("\x4c\x00\x02\x15", 4);
+  mfg.append(21, '\x5a');
+  std::string name = "Tile";
+  uint16_t sensorId;
+  uint32_t seq;
+  for (auto _ : st) {
+    BarkAuthResult r = auth.verify((const uint8_t*)mfg.data(), mfg.size(), sensorId, seq);
+    perfBenchKeep(r);
+    perfBenchKeep(isBarkAdvertisement(name, mfg, "PING-ESP32", "PING1234"));
+  }
+}
+PERF_BENCH("ble.filter.foreign", benchAdvForeign);
+
+// A paired sensor's packet; repeats are replays, which cost the same MAC
+static void benchAdvSigned(PerfBenchState& st) {
+  BarkAuth auth("perfbench");
+  auth.pair(7, PERF_BENCH_KEY);
+  BarkAdvPayload p;
+  BarkAuth::sign(PERF_BENCH_KEY, 7, 42, 1760000000, p);
+  uint16_t sensorId;
+  uint32_t seq;
+  for (auto _ : st) perfBenchKeep(auth.verify((const uint8_t*)&p, sizeof(p), sensorId, seq));
+}
+PERF_BENCH("ble.filter.signed", benchAdvSigned);
+
+// Line assembly and argument parsing; the String compare chain itself is
+// in the sketch and measured there by the serial.dispatch probe
+static void benchSerialLine(PerfBenchState& st) {
+  static const char line[] = "sched add 07:30 22:00 tcs 12345\n";
+  LineReader<64> reader;  // SERIAL_LINE_MAX
+  for (auto _ : st) {
+    for (const char* c = line; *c; c++) {
+      if (reader.push(*c) != LINE_READY) continue;
+      const char* l = reader.line();
+      uint16_t from, to;
+      int64_t v;
+      perfBenchKeep(parseClockTime("07:30", from) && parseClockTime("22:00", to));
+      perfBenchKeep(parseDecimal(l + 26, -CONSOLE_INT_LIMIT, CONSOLE_INT_LIMIT, v));
+    }
+  }
+}
+PERF_BENCH("serial.line", benchSerialLine);
+
+static void benchSerialKey(PerfBenchState& st) {
+  static const char hex[] = "00112233445566778899aabbccddeeff";
+  uint8_t key[16];
+  for (auto _ : st) perfBenchKeep(parseHexBytes(hex, key, sizeof(key)));
+}
+PERF_BENCH("serial.hexkey", benchSerialKey);
+
+static void benchJournalLog(PerfBenchState& st) {
+  static EventJournal journal;
+  for (auto _ : st) journal.log(JEV_BARK, 1, 0);
+  perfBenchKeep(journal.nextSeq());
+}
+PERF_BENCH("log.journal", benchJournalLog);
+
+// Trace off: the cost every actuator write pays in normal operation
+static void benchTraceIdle(PerfBenchState& st) {
+  static ActuatorTrace trace;
+  for (auto _ : st) trace.record(33, 512);
+}
+PERF_BENCH("log.trace.idle", benchTraceIdle);
+
+static void benchTraceRecording(PerfBenchState& st) {
+  static ActuatorTrace trace;
+  trace.start();
+  uint16_t level = 0;
+  for (auto _ : st) trace.record(33, level ^= 1);
+  trace.stop();
+}
+PERF_BENCH("log.trace.recording", benchTraceRecording);
@@ -0,0 +1,94 @@
+#pragma once
+#include <Arduino.h>
+#include "esp_timer.h"
+
+#if defined(ESP_IDF_VERSION_MAJOR) && ESP_IDF_VERSION_MAJOR >= 5
+#include "esp_cpu.h"
+static inline uint32_t perfCycles() { return esp_cpu_get_cycle_count(); }
+#else
+static inline uint32_t perfCycles() { return ESP.getCycleCount(); }
+#endif
+
+// Cycle-count probe for one hot path. Declare probes as globals; they link
+// themselves into a list so the "perf" command can report all of them.
+// Each sample also carries its wall time: with the CPU governor switching
+// clocks, cycles summed at 80 and 240 MHz do not convert back to time at
+// any single frequency, so avg_us comes from the accumulated microseconds.
+// Updates are not atomic - a probe hit from the BLE task while being printed
+// may show a torn sample, which is fine for diagnostics.
+class PerfProbe {
+public:
+  explicit PerfProbe(const char* name) : _name(name), _next(_head()) { _head() = this; }
+
+  void record(uint32_t cycles, uint32_t us) {
+    _count++;
+    _total += cycles;
+    _totalUs += us;
+    if (cycles < _min) _min = cycles;
+    if (cycles > _max) _max = cycles;
+  }
+
+  // For probes timed with esp_timer: cycles at the current clock
+  void recordUs(uint32_t us) { record(us * getCpuFrequencyMhz(), us); }
+
+  void reset() {
+    _count = 0;
+    _total = 0;
+    _totalUs = 0;
+    _min = UINT32_MAX;
+    _max = 0;
+  }
+
+  const char* name() const { return _name; }
+  uint32_t count() const   { return _count; }
+  uint32_t minCycles() const { return _count ? _min : 0; }
+  uint32_t maxCycles() const { return _max; }
+  uint32_t avgCycles() const { return _count ? (uint32_t)(_total / _count) : 0; }
+  double   avgUs() const     { return _count ? (double)_totalUs / _count : 0.0; }
+
+  static void printAll() {
+    uint32_t mhz = getCpuFrequencyMhz();
+    Serial.printf("\n⏱️  PERF (cycles at the clock of each sample, now %lu MHz):\n", (unsigned long)mhz);
+    Serial.println("   probe              count       min       avg       max   avg_us");
+    for (PerfProbe* p = _head(); p; p = p->_next) {
+      Serial.printf("   %-16s %7lu %9lu %9lu %9lu %8.1f\n", p->_name,
+                    (unsigned long)p->count(), (unsigned long)p->minCycles(),
+                    (unsigned long)p->avgCycles(), (unsigned long)p->maxCycles(), p->avgUs());
+    }
+    Serial.println();
+  }
+
+  static void resetAll() {
+    for (PerfProbe* p = _head(); p; p = p->_next) p->reset();
+  }
+
+private:
+  static PerfProbe*& _head() {
+    static PerfProbe* head = nullptr;
+    return head;
+  }
+
+  const char* _name;
+  PerfProbe*  _next;
+  uint32_t    _count{0};
+  uint64_t    _total{0};
+  uint64_t    _totalUs{0};
+  uint32_t    _min{UINT32_MAX};
+  uint32_t    _max{0};
+};
+
+// Records the cycles and microseconds spent in the enclosing scope
+class PerfScope {
+public:
+  explicit PerfScope(PerfProbe& probe)
+    : _probe(probe), _startUs(esp_timer_get_time()), _start(perfCycles()) {}
+  ~PerfScope() {
+    uint32_t cycles = perfCycles() - _start;
+    _probe.record(cycles, (uint32_t)(esp_timer_get_time() - _startUs));
+  }
+
+private:
+  PerfProbe& _probe;
+  int64_t    _startUs;
+  uint32_t   _start;
+};
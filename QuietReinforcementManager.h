@@ -1,6 +1,7 @@
 #pragma once
 #include <Arduino.h>
 #include <Preferences.h>
+#include "P2Quantile.h"
 
 struct LevelConfig {
   uint32_t quietMs;          // How long the dog must be quiet
@@ -29,6 +30,7 @@ public:
 
   // Enable/disable logs dynamically
   void setLogging(bool enabled) { _logEnabled = enabled; }
+  bool loggingEnabled() const { return _logEnabled; }
 
   // NEW: Set how many levels to drop on bark (0 = no demotion)
   void setDemotionLevels(uint8_t levels) {
@@ -39,19 +41,64 @@ public:
   // NEW: Get current demotion setting
   uint8_t getDemotionLevels() const { return _demotionLevels; }
 
+  // Adaptive shaping: the quiet target becomes the given percentile of the
+  // dog's recent inter-bark intervals (clamped to [minMs, maxMs]) instead of
+  // the level's quietMs. Levels still set dispense time and pattern. Uses the
+  // table until ADAPTIVE_MIN_SAMPLES intervals have been seen. Two P² sketches
+  // restart in turn every ADAPTIVE_WINDOW intervals, so the estimate always
+  // covers the last ADAPTIVE_WINDOW..2*ADAPTIVE_WINDOW barks.
+  void setAdaptiveShaping(bool enabled, float quantile = 0.7f,
+                          uint32_t minMs = 2000, uint32_t maxMs = 60000) {
+    if (quantile != _intervals[0].quantile()) {
+      _intervals[0].reset(quantile);
+      _intervals[1].reset(quantile);
+      _intervalCount = 0;
+    }
+    _adaptive = enabled;
+    _adaptiveMinMs = minMs;
+    _adaptiveMaxMs = maxMs > minMs ? maxMs : minMs;
+    _planEpoch++;
+    _log(String("Adaptive shaping ") + (enabled ? "ON, p" + String((int)(quantile * 100)) : "OFF"));
+  }
+
+  bool adaptiveShaping() const { return _adaptive; }
+
+  // Swap the level table (e.g. for a loaded training program). With external
+  // level control the caller moves between levels via setLevel(); tick() no
+  // longer levels up and barks no longer demote.
+  void useLevels(const LevelConfig* levels, uint8_t levelCount, bool externalControl) {
+    if (levelCount == 0) return;
+    _planEpoch++;
+    _levels = levels;
+    _levelCount = levelCount;
+    _externalLevels = externalControl;
+    if (_currentLevel >= _levelCount) _currentLevel = 0;
+    _successesAtLevel = 0;
+    _patternIndex = 0;
+    _log("Level table: " + String(levelCount) + " levels" + (externalControl ? " (external control)" : ""));
+  }
+
+  void setCooldownMs(uint32_t ms) {
+    _planEpoch++;
+    _cooldownMs = ms;
+  }
+  const P2Quantile& barkIntervals() const {
+    return _intervals[0].count() >= _intervals[1].count() ? _intervals[0] : _intervals[1];
+  }
+
   // Call at boot
   void begin() {
     _prefs.begin(_ns, false);
     _currentLevel = _prefs.getUChar("lvl", 0);
-    if (_currentLevel >= _levelCount) _currentLevel = 0;
-
     _successesAtLevel = _prefs.getUChar("succ", 0);
     _patternIndex = _prefs.getUChar("pidx", 0);
+    _sanitizeState();
 
     uint32_t now = millis();
     _quietStartMs = now;
     _lastBarkMs = now;
-    _rewardCooldownUntil = 0;
+    _haveBark = false;  // Time asleep or powered off is no bark interval
+    _cooldownActive = false;
     _pendingDispenseMs = 0;
 
     // Seed RNG for shuffling
@@ -63,13 +110,17 @@ public:
 
   // Call when bark/noise is detected - NOW WITH DEMOTION
   void onBark(uint32_t nowMs) {
+    _planEpoch++;
+    _barkCount++;
+    if (_haveBark) _addInterval(nowMs - _lastBarkMs);
+    _haveBark = true;
     _lastBarkMs = nowMs;
     _successesAtLevel = 0;
     _quietStartMs = nowMs;
     _pendingDispenseMs = 0;
 
     // NEW: Apply level demotion if configured
-    if (_demotionLevels > 0 && _currentLevel > 0) {
+    if (_demotionLevels > 0 && _currentLevel > 0 && !_externalLevels) {
       uint8_t oldLevel = _currentLevel;
 
       // Drop levels, but never go below 0
@@ -101,13 +152,16 @@ public:
 
     const LevelConfig& L = _levels[_currentLevel];
 
-    if (nowMs - _quietStartMs >= L.quietMs) {
+    if (nowMs - _quietStartMs >= _quietTargetMs()) {
       bool shouldReward = _decideReinforcement(L);
+      _planEpoch++;
       _successesAtLevel++;
+      _quietSuccessCount++;
 
-      if (shouldReward && nowMs >= _rewardCooldownUntil) {
+      if (shouldReward && _cooldownElapsed(nowMs)) {
         _pendingDispenseMs = L.dispenseMs;
-        _rewardCooldownUntil = nowMs + _cooldownMs;
+        _lastRewardMs = nowMs;
+        _cooldownActive = true;
         _log("Reward scheduled: " + String(_pendingDispenseMs) + "ms");
       } else {
         _log("Quiet success, no reward this time. Pattern idx=" + String(_patternIndex));
@@ -115,10 +169,17 @@ public:
 
       _quietStartMs = nowMs;
 
+      // The count restarts under external control too, so it stays in the
+      // range begin() accepts from NVS
       if (_successesAtLevel >= _needSuccesses) {
-        _currentLevel = (_currentLevel + 1 < _levelCount) ? _currentLevel + 1 : _currentLevel;
         _successesAtLevel = 0;
-        _log("Level up! New level=" + String(_currentLevel));
+        if (!_externalLevels) {
+          if (_currentLevel + 1 < _levelCount) {
+            _currentLevel++;
+            _patternIndex = 0;  // Index belongs to the old level's pattern
+          }
+          _log("Level up! New level=" + String(_currentLevel));
+        }
       }
 
       _saveThrottled(nowMs);
@@ -139,6 +200,7 @@ public:
   // Allow manual level set / reset
   void setLevel(uint8_t lvl, uint32_t nowMs) {
     if (lvl >= _levelCount) return;
+    _planEpoch++;
     _currentLevel = lvl;
     _successesAtLevel = 0;
     _patternIndex = 0;
@@ -147,16 +209,30 @@ public:
     _log("Level manually set to " + String(lvl));
   }
 
+  // Drop the look-ahead without touching the quiet period (manual correction):
+  // anything pre-armed for the current plan goes stale
+  void invalidatePlan() { _planEpoch++; }
+
+  // Fresh quiet period without counting a bark (training resumes after a
+  // pause); the pause does not end a bark interval either
+  void restartQuiet(uint32_t nowMs) {
+    _planEpoch++;
+    _quietStartMs = nowMs;
+    _haveBark = false;
+  }
+
   // Reset state completely (to level 0, no successes, no dispense pending)
   void resetState() {
     uint32_t nowMs = millis();
 
+    _planEpoch++;
     _currentLevel = 0;
     _successesAtLevel = 0;
     _patternIndex = 0;
     _quietStartMs = nowMs;
     _lastBarkMs = nowMs;
-    _rewardCooldownUntil = 0;
+    _haveBark = false;
+    _cooldownActive = false;
     _pendingDispenseMs = 0;
     _lastSaveMs = 0;
 
@@ -168,15 +244,63 @@ public:
     _log("State reset. Back to level 0.");
   }
 
+  // Look-ahead for actuators that need lead time (feeder pre-arm).
+  // When the current quiet window completes if no bark arrives:
+  uint32_t nextDeadlineMs() const { return _quietStartMs + _quietTargetMs(); }
+
+  // Whether the success at that deadline will dispense: the next pattern slot
+  // and the cooldown as it will stand then (a shuffle can only happen after
+  // the slot is consumed, so this is exact)
+  bool nextSlotRewards() const {
+    const LevelConfig& L = _levels[_currentLevel];
+    bool slot = true;
+    if (L.patternLen > 0 && L.pattern != nullptr) {
+      slot = L.pattern[_patternIndex < L.patternLen ? _patternIndex : 0] != 0;
+    }
+    return slot && (!_cooldownActive || nextDeadlineMs() - _lastRewardMs >= _cooldownMs);
+  }
+
+  uint32_t nextDispenseMs() const { return _levels[_currentLevel].dispenseMs; }
+
+  // Changes whenever the look-ahead above is invalidated (bark, success,
+  // level change, reset); a pre-arm tagged with an older epoch is stale
+  uint32_t planEpoch() const { return _planEpoch; }
+
   // Getters
   uint8_t  currentLevel() const        { return _currentLevel; }
+  uint8_t  levelCount() const          { return _levelCount; }
   uint8_t  successesAtLevel() const    { return _successesAtLevel; }
-  uint32_t currentQuietTargetMs() const{ return _levels[_currentLevel].quietMs; }
+  uint8_t  patternIndex() const        { return _patternIndex; }      // Next slot of the level's pattern
+  uint32_t currentQuietTargetMs() const{ return _quietTargetMs(); }
   uint32_t lastBarkMs() const          { return _lastBarkMs; }
+  uint32_t quietSuccessCount() const   { return _quietSuccessCount; }  // Since boot
+  uint32_t barkCount() const           { return _barkCount; }          // Since boot
 
 private:
+  static const uint8_t ADAPTIVE_MIN_SAMPLES = 5;
+  static const uint8_t ADAPTIVE_WINDOW = 32;
+
+  // O(1): both sketches take every interval; the older one restarts each window
+  void _addInterval(uint32_t ms) {
+    _intervals[0].add((float)ms);
+    _intervals[1].add((float)ms);
+    _intervalCount++;
+    if (_intervalCount % ADAPTIVE_WINDOW == 0) {
+      P2Quantile& older = _intervals[(_intervalCount / ADAPTIVE_WINDOW) & 1];
+      older.reset(older.quantile());
+    }
+  }
+
+  uint32_t _quietTargetMs() const {
+    const P2Quantile& q = barkIntervals();
+    if (!_adaptive || q.count() < ADAPTIVE_MIN_SAMPLES) return _levels[_currentLevel].quietMs;
+    uint32_t t = (uint32_t)q.value();
+    return t < _adaptiveMinMs ? _adaptiveMinMs : (t > _adaptiveMaxMs ? _adaptiveMaxMs : t);
+  }
+
   bool _decideReinforcement(const LevelConfig& L) {
     if (L.patternLen == 0 || L.pattern == nullptr) return true;
+    if (_patternIndex >= L.patternLen) _patternIndex = 0;
     uint8_t value = L.pattern[_patternIndex];
     _patternIndex++;
     if (_patternIndex >= L.patternLen) {
@@ -191,6 +315,19 @@ private:
     _log("Pattern reshuffled, new start idx=" + String(_patternIndex));
   }
 
+  // Wraparound-safe: compares elapsed time, not absolute millis() values
+  bool _cooldownElapsed(uint32_t nowMs) const {
+    return !_cooldownActive || (nowMs - _lastRewardMs >= _cooldownMs);
+  }
+
+  // Clamp values restored from NVS so they are valid for the current table
+  void _sanitizeState() {
+    if (_currentLevel >= _levelCount) _currentLevel = 0;
+    if (_successesAtLevel >= _needSuccesses) _successesAtLevel = 0;
+    const LevelConfig& L = _levels[_currentLevel];
+    if (_patternIndex >= L.patternLen) _patternIndex = 0;
+  }
+
   void _saveImmediate() {
     _prefs.putUChar("lvl",  _currentLevel);
     _prefs.putUChar("succ", _successesAtLevel);
@@ -225,9 +362,21 @@ private:
 
   uint32_t _quietStartMs{0};
   uint32_t _lastBarkMs{0};
-  uint32_t _rewardCooldownUntil{0};
+  uint32_t _lastRewardMs{0};
+  bool     _cooldownActive{false};
   uint32_t _pendingDispenseMs{0};
   uint32_t _lastSaveMs{0};
+  uint32_t _quietSuccessCount{0};
+  uint32_t _planEpoch{0};
+  uint32_t _barkCount{0};
+  bool     _externalLevels{false};
+
+  P2Quantile _intervals[2]{P2Quantile(0.7f), P2Quantile(0.7f)};  // Inter-bark intervals (ms)
+  uint32_t _intervalCount{0};
+  bool     _haveBark{false};
+  bool     _adaptive{false};
+  uint32_t _adaptiveMinMs{2000};
+  uint32_t _adaptiveMaxMs{60000};
 
   uint8_t  _needSuccesses{4};
   uint32_t _cooldownMs{7000};
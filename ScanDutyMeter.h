@@ -0,0 +1,91 @@
+#pragma once
+#include <Arduino.h>
+
+// Measures how much of the time the BLE scanner is actually listening, as
+// seen from the outside: advertisements received per second, kept separately
+// for periods with and without a GATT connection. Connection events and our
+// own advertising take radio time from the scanner, so connected/idle rate
+// is the figure to watch when tuning connection parameters.
+#define SCAN_DUTY_PERIOD_MS  10000
+
+class ScanDutyMeter {
+public:
+  // BLE task, every advertisement before filtering
+  void onAdvert() { _adverts++; }
+
+  // loop(): close a measurement period every SCAN_DUTY_PERIOD_MS
+  void update(uint32_t nowMs, bool scanning, bool connected) {
+    if (!_started) {
+      _started = true;
+      _periodStartMs = _lastSampleMs = nowMs;
+      _advertsAtStart = _adverts;
+    }
+    uint32_t dt = nowMs - _lastSampleMs;
+    _lastSampleMs = nowMs;
+    if (scanning) _scanningMs += dt;
+    if (connected) _connectedMs += dt;
+
+    uint32_t elapsed = nowMs - _periodStartMs;
+    if (elapsed < SCAN_DUTY_PERIOD_MS) return;
+
+    uint32_t n = _adverts - _advertsAtStart;
+    _lastRateX10 = (uint16_t)min<uint32_t>(n * 10000UL / elapsed, 0xFFFF);
+    _lastScanPercent = (uint8_t)(_scanningMs * 100 / elapsed);
+
+    // A period counts as connected if a link was up for most of it
+    Avg& a = (_connectedMs * 2 > elapsed) ? _connected : _idle;
+    a.adverts += n;
+    a.ms += elapsed;
+
+    _periodStartMs = nowMs;
+    _advertsAtStart = _adverts;
+    _scanningMs = 0;
+    _connectedMs = 0;
+  }
+
+  uint16_t lastRateX10() const { return _lastRateX10; }       // Adverts/s x10, last period
+  uint8_t  lastScanPercent() const { return _lastScanPercent; } // Scanner running, last period
+  uint16_t idleRateX10() const { return _idle.rateX10(); }
+  uint16_t connectedRateX10() const { return _connected.rateX10(); }
+
+  // Connected rate as a percentage of the idle rate (100 = no loss)
+  int connectedVsIdlePercent() const {
+    uint16_t idle = _idle.rateX10();
+    if (idle == 0 || _connected.ms == 0) return -1;
+    return (int)((uint32_t)_connected.rateX10() * 100 / idle);
+  }
+
+  void getStatus(String& statusMsg) {
+    int ratio = connectedVsIdlePercent();
+    statusMsg = String(_lastRateX10 / 10.0f, 1) + " adv/s, scanning " + String(_lastScanPercent) +
+                "%, idle " + String(_idle.rateX10() / 10.0f, 1) +
+                " adv/s, connected " + String(_connected.rateX10() / 10.0f, 1) + " adv/s" +
+                (ratio >= 0 ? " (" + String(ratio) + "% of idle)" : String(""));
+  }
+
+  void reset() {
+    _idle = Avg();
+    _connected = Avg();
+    _started = false;
+  }
+
+private:
+  struct Avg {
+    uint32_t adverts = 0;
+    uint32_t ms = 0;
+    uint16_t rateX10() const { return ms ? (uint16_t)min<uint64_t>((uint64_t)adverts * 10000 / ms, 0xFFFF) : 0; }
+  };
+
+  volatile uint32_t _adverts{0};
+  uint32_t _advertsAtStart{0};
+  uint32_t _periodStartMs{0};
+  uint32_t _lastSampleMs{0};
+  uint32_t _scanningMs{0};
+  uint32_t _connectedMs{0};
+  bool     _started{false};
+
+  uint16_t _lastRateX10{0};
+  uint8_t  _lastScanPercent{0};
+  Avg _idle;
+  Avg _connected;
+};
@@ -0,0 +1,157 @@
+#pragma once
+#include <Arduino.h>
+#include <math.h>
+
+#define SCAN_TUNE_MIN_BARKS       30    // Fewest barks (heard + missed) per tuning decision
+#define SCAN_TUNE_TARGET_PERMILLE 20    // Missed barks allowed (2%)
+#define SCAN_TUNE_MAX_BURST       16    // Largest sensor burst ever recommended
+
+// Scanner settings from least to most radio time (units of 0.625 ms). The
+// top rung is the old fixed setting: a 50 ms window every 50 ms, i.e.
+// listening continuously.
+struct ScanParams {
+  uint16_t intervalUnits;
+  uint16_t windowUnits;
+};
+
+static const ScanParams SCAN_LADDER[] = {
+  { 160, 16 },   // 10%
+  { 160, 32 },   // 20%
+  { 160, 56 },   // 35%
+  { 160, 80 },   // 50%
+  { 80, 56 },    // 70%
+  { 80, 80 },    // 100%
+};
+static const uint8_t SCAN_LADDER_LEN = sizeof(SCAN_LADDER) / sizeof(SCAN_LADDER[0]);
+
+// Picks the lowest scan duty that keeps missed barks under a target.
+//
+// Each bark is a burst of `burst` adverts carrying the same sequence number;
+// the scanner catches each copy with some probability p (the duty cycle,
+// less whatever Wi-Fi coexistence and channel hopping take). A bark is lost
+// when every copy is, (1 - p)^burst. Gaps in the sensors' sequence numbers
+// give the real miss rate; copies per bark heard give p, which predicts the
+// miss rate one rung down before trying it and the burst length the sensors
+// would need to hit the target at the current rung.
+//
+// Fed cumulative counters from loop(); decides once per epochBarks() barks:
+// up a rung when over target, down one when the prediction there still
+// leaves half the target as margin.
+class ScanTuner {
+public:
+  ScanTuner(uint8_t burst, uint16_t targetPermille)
+    : _burst(burst), _targetPermille(targetPermille) {}
+
+  // loop(): true when params() changed and the scanner needs them applied
+  bool update(uint32_t heard, uint32_t missed, uint32_t copies) {
+    if (!_started) {
+      _started = true;
+      _mark(heard, missed, copies);
+      return false;
+    }
+    uint32_t h = heard - _heard0, m = missed - _missed0, c = copies - _copies0;
+    if (h + m < epochBarks()) return false;
+    _mark(heard, missed, copies);
+
+    _lastMissPermille = (uint16_t)(m * 1000UL / (h + m));
+    if (!h) _captureP = 0.0f;
+    else if (_burst > 1) _captureP = _estimateP((float)c / h, _burst);
+    else _captureP = (float)h / (h + m);  // Single adverts: the miss rate is all there is
+    _decisions++;
+    if (!_auto) return false;
+
+    if (_lastMissPermille > _targetPermille) return _step(+1);
+    if (_level > 0) {
+      float p = min(1.0f, _captureP * _duty(_level - 1) / _duty(_level));
+      if (_predictPermille(p, _burst) * 2 <= _targetPermille) return _step(-1);
+    }
+    return false;
+  }
+
+  // Smallest burst that meets the target at the current rung (0 = no estimate yet)
+  uint8_t recommendedBurst() const {
+    if (_captureP <= 0.0f) return 0;
+    for (uint8_t n = 1; n < SCAN_TUNE_MAX_BURST; n++) {
+      if (_predictPermille(_captureP, n) <= _targetPermille) return n;
+    }
+    return SCAN_TUNE_MAX_BURST;
+  }
+
+  // Tuning off holds the top rung (the old fixed setting)
+  bool setAuto(bool enabled) {
+    _auto = enabled;
+    return !enabled && _step(SCAN_LADDER_LEN);
+  }
+  bool isAuto() const { return _auto; }
+
+  void setTargetPermille(uint16_t p) { _targetPermille = p; }
+  uint16_t targetPermille() const { return _targetPermille; }
+  void setBurst(uint8_t n) { _burst = n; }
+  uint8_t burst() const { return _burst; }
+
+  // Long enough that one stray miss stays under half the target
+  uint32_t epochBarks() const {
+    return max<uint32_t>(SCAN_TUNE_MIN_BARKS, 2000UL / max<uint16_t>(_targetPermille, 1));
+  }
+
+  // Counters restart at the next update (e.g. after the sensors changed)
+  void restartEpoch() { _started = false; }
+
+  const ScanParams& params() const { return SCAN_LADDER[_level]; }
+  uint8_t level() const { return _level; }
+  uint16_t dutyPermille() const { return (uint16_t)(_duty(_level) * 1000); }
+  uint16_t lastMissPermille() const { return _lastMissPermille; }
+  uint16_t captureProbPermille() const { return (uint16_t)(_captureP * 1000); }
+  uint32_t decisions() const { return _decisions; }
+  uint32_t steps() const { return _steps; }
+
+private:
+  bool _step(int8_t d) {
+    int8_t l = constrain((int8_t)_level + d, 0, SCAN_LADDER_LEN - 1);
+    if (l == _level) return false;
+    _level = (uint8_t)l;
+    _steps++;
+    return true;
+  }
+
+  void _mark(uint32_t heard, uint32_t missed, uint32_t copies) {
+    _heard0 = heard;
+    _missed0 = missed;
+    _copies0 = copies;
+  }
+
+  static float _duty(uint8_t level) {
+    return (float)SCAN_LADDER[level].windowUnits / SCAN_LADDER[level].intervalUnits;
+  }
+
+  static uint16_t _predictPermille(float p, uint8_t burst) {
+    return (uint16_t)(powf(1.0f - p, burst) * 1000.0f + 0.5f);
+  }
+
+  // Copies per bark heard is burst*p / (1 - (1-p)^burst) (at least one copy
+  // was caught); it rises with p, so bisect
+  static float _estimateP(float copiesPerBark, uint8_t burst) {
+    if (copiesPerBark >= burst) return 1.0f;
+    float lo = 0.0f, hi = 1.0f;
+    for (int i = 0; i < 20; i++) {
+      float p = (lo + hi) / 2;
+      float mean = burst * p / (1.0f - powf(1.0f - p, burst));
+      if (mean < copiesPerBark) lo = p;
+      else hi = p;
+    }
+    return (lo + hi) / 2;
+  }
+
+  uint8_t  _burst;
+  uint16_t _targetPermille;
+  bool     _auto{true};
+  uint8_t  _level{SCAN_LADDER_LEN - 1};   // Start at full duty and work down
+  bool     _started{false};
+  uint32_t _heard0{0};
+  uint32_t _missed0{0};
+  uint32_t _copies0{0};
+  uint16_t _lastMissPermille{0};
+  float    _captureP{0.0f};
+  uint32_t _decisions{0};
+  uint32_t _steps{0};
+};
@@ -0,0 +1,125 @@
+#pragma once
+#include <Arduino.h>
+
+// What the schedule lets run
+#define GATE_TRAIN      0x01   // Quiet rewards (manager ticks, bark demotion)
+#define GATE_CORRECT    0x02   // Corrections for barks
+#define GATE_SCAN       0x04   // BLE bark scanning
+#define GATE_SESSION    0x08   // A training session spans the window
+#define GATE_SLEEP      0x10   // Deep sleep through the window (everything else off)
+#define GATE_AWAKE_ALL  (GATE_TRAIN | GATE_CORRECT | GATE_SCAN)
+
+#define SCHED_MAX_ENTRIES  8
+#define SCHED_ALL_DAYS     0x7F  // Bit 0 = Sunday
+#define MINUTES_PER_DAY    1440
+
+// Local-time window; end < start wraps past midnight (days = the start day),
+// end == start is the whole day. 6 bytes, stored as-is in Preferences.
+struct ScheduleEntry {
+  uint16_t startMin;
+  uint16_t endMin;
+  uint8_t  days;
+  uint8_t  gates;
+};
+
+// Ordered table of windows; the first window containing the minute decides
+// the gates, and minutes outside every window get GATE_AWAKE_ALL (so an
+// empty table is the old around-the-clock behaviour). The sketch asks once
+// per minute, so the linear scan does not matter.
+class ScheduleTable {
+public:
+  bool add(const ScheduleEntry& e) {
+    if (_count >= SCHED_MAX_ENTRIES || e.startMin >= MINUTES_PER_DAY || e.endMin >= MINUTES_PER_DAY ||
+        (e.days & SCHED_ALL_DAYS) == 0) {
+      return false;
+    }
+    _entries[_count++] = e;
+    return true;
+  }
+
+  bool remove(uint8_t i) {
+    if (i >= _count) return false;
+    memmove(&_entries[i], &_entries[i + 1], (_count - i - 1) * sizeof(ScheduleEntry));
+    _count--;
+    return true;
+  }
+
+  void clear() { _count = 0; }
+
+  // Gates at a local minute (weekday 0 = Sunday)
+  uint8_t gatesAt(uint8_t weekday, uint16_t minute) const {
+    for (uint8_t i = 0; i < _count; i++) {
+      if (_contains(_entries[i], weekday, minute)) return _entries[i].gates;
+    }
+    return GATE_AWAKE_ALL;
+  }
+
+  // Minutes until the next window edge (1..MINUTES_PER_DAY): the gates cannot
+  // change sooner than this, so it bounds a sleep
+  uint16_t minutesToNextEdge(uint16_t minute) const {
+    uint16_t best = MINUTES_PER_DAY;
+    for (uint8_t i = 0; i < _count; i++) {
+      best = min(best, _ahead(minute, _entries[i].startMin));
+      best = min(best, _ahead(minute, _entries[i].endMin));
+    }
+    return best;
+  }
+
+  uint8_t count() const { return _count; }
+  const ScheduleEntry& entry(uint8_t i) const { return _entries[i < _count ? i : 0]; }
+
+  // Persistence as a flat blob
+  const void* data() const { return _entries; }
+  size_t dataLen() const { return _count * sizeof(ScheduleEntry); }
+  void load(const void* data, size_t len) {
+    clear();
+    const ScheduleEntry* e = (const ScheduleEntry*)data;
+    for (size_t i = 0; i < len / sizeof(ScheduleEntry); i++) add(e[i]);
+  }
+
+  // "tcs" style letters: t=train c=correct s=scan n=session z=sleep, "-" = none
+  static bool parseGates(const String& s, uint8_t& gates) {
+    gates = 0;
+    if (s == "-") return true;
+    for (int i = 0; i < (int)s.length(); i++) {
+      switch (s[i]) {
+        case 't': gates |= GATE_TRAIN; break;
+        case 'c': gates |= GATE_CORRECT; break;
+        case 's': gates |= GATE_SCAN; break;
+        case 'n': gates |= GATE_SESSION; break;
+        case 'z': gates |= GATE_SLEEP; break;
+        default: return false;
+      }
+    }
+    return s.length() > 0;
+  }
+
+  static String gatesName(uint8_t gates) {
+    if (gates & GATE_SLEEP) return "z";
+    String s;
+    if (gates & GATE_TRAIN)   s += 't';
+    if (gates & GATE_CORRECT) s += 'c';
+    if (gates & GATE_SCAN)    s += 's';
+    if (gates & GATE_SESSION) s += 'n';
+    return s.length() ? s : String("-");
+  }
+
+private:
+  static bool _day(uint8_t days, uint8_t weekday) { return (days >> weekday) & 1; }
+
+  static bool _contains(const ScheduleEntry& e, uint8_t weekday, uint16_t m) {
+    if (e.startMin == e.endMin) return _day(e.days, weekday);
+    if (e.startMin < e.endMin) return _day(e.days, weekday) && m >= e.startMin && m < e.endMin;
+    // Wraps midnight: the evening part belongs to today, the morning part to yesterday
+    if (m >= e.startMin) return _day(e.days, weekday);
+    return m < e.endMin && _day(e.days, (weekday + 6) % 7);
+  }
+
+  static uint16_t _ahead(uint16_t from, uint16_t to) {
+    uint16_t d = (to + MINUTES_PER_DAY - from) % MINUTES_PER_DAY;
+    return d == 0 ? MINUTES_PER_DAY : d;
+  }
+
+  ScheduleEntry _entries[SCHED_MAX_ENTRIES]{};
+  uint8_t _count{0};
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// SipHash-2-4 (64-bit output). The key schedule is split out so a verifier
+// can derive the initial state once per key (at pairing) and start every
+// message from a copy of it.
+
+struct SipHashKey {
+  uint64_t v0, v1, v2, v3;  // Initial state for one 128-bit key
+};
+
+static inline uint64_t sipRotl(uint64_t x, int b) { return (x << b) | (x >> (64 - b)); }
+
+static inline uint64_t sipLoad64(const uint8_t* p) {
+  return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+         ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+#define SIP_ROUND(v0, v1, v2, v3) do {                              \
+    v0 += v1; v1 = sipRotl(v1, 13); v1 ^= v0; v0 = sipRotl(v0, 32);  \
+    v2 += v3; v3 = sipRotl(v3, 16); v3 ^= v2;                        \
+    v0 += v3; v3 = sipRotl(v3, 21); v3 ^= v0;                        \
+    v2 += v1; v1 = sipRotl(v1, 17); v1 ^= v2; v2 = sipRotl(v2, 32);  \
+  } while (0)
+
+static inline void sipHashPrepare(const uint8_t key[16], SipHashKey& out) {
+  uint64_t k0 = sipLoad64(key), k1 = sipLoad64(key + 8);
+  out.v0 = k0 ^ 0x736f6d6570736575ULL;
+  out.v1 = k1 ^ 0x646f72616e646f6dULL;
+  out.v2 = k0 ^ 0x6c7967656e657261ULL;
+  out.v3 = k1 ^ 0x7465646279746573ULL;
+}
+
+static inline uint64_t sipHash24(const SipHashKey& k, const uint8_t* m, size_t len) {
+  uint64_t v0 = k.v0, v1 = k.v1, v2 = k.v2, v3 = k.v3;
+  const uint8_t* end = m + (len & ~(size_t)7);
+  for (; m != end; m += 8) {
+    uint64_t w = sipLoad64(m);
+    v3 ^= w;
+    SIP_ROUND(v0, v1, v2, v3);
+    SIP_ROUND(v0, v1, v2, v3);
+    v0 ^= w;
+  }
+
+  uint64_t b = (uint64_t)len << 56;
+  switch (len & 7) {
+    case 7: b |= (uint64_t)m[6] << 48;  // fall through
+    case 6: b |= (uint64_t)m[5] << 40;  // fall through
+    case 5: b |= (uint64_t)m[4] << 32;  // fall through
+    case 4: b |= (uint64_t)m[3] << 24;  // fall through
+    case 3: b |= (uint64_t)m[2] << 16;  // fall through
+    case 2: b |= (uint64_t)m[1] << 8;   // fall through
+    case 1: b |= (uint64_t)m[0];        break;
+    default: break;
+  }
+  v3 ^= b;
+  SIP_ROUND(v0, v1, v2, v3);
+  SIP_ROUND(v0, v1, v2, v3);
+  v0 ^= b;
+
+  v2 ^= 0xff;
+  SIP_ROUND(v0, v1, v2, v3);
+  SIP_ROUND(v0, v1, v2, v3);
+  SIP_ROUND(v0, v1, v2, v3);
+  SIP_ROUND(v0, v1, v2, v3);
+  return v0 ^ v1 ^ v2 ^ v3;
+}
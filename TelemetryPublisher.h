@@ -0,0 +1,368 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <AsyncMqttClient.h>
+#include <LittleFS.h>
+#include <functional>
+#include "EventJournal.h"
+#include "WallClock.h"
+
+// Optional Wi-Fi/MQTT telemetry (include only when ENABLE_TELEMETRY is set;
+// needs the AsyncMqttClient + AsyncTCP libraries).
+//
+// Journal records are batched into compact binary payloads and published
+// with QoS1 to <prefix>/<deviceId>/events. Only one batch is in flight; the
+// cursor advances on PUBACK, so delivery is at-least-once. While offline,
+// records about to fall out of the RAM journal are spilled to a bounded
+// LittleFS backlog that is drained first once connected. Spilled chunks keep
+// their journal sequence and time anchor, so resends are recognised and
+// placed like live batches, and the drain offset is kept in flash so a
+// reboot resumes where the last PUBACK left off. Publishes are
+// rate-limited so Wi-Fi never hogs the shared radio from BLE scanning.
+//
+// Record times are device millis(). Every payload says which millis() it
+// was sent at and the wall clock at that moment (once SNTP or the serial
+// host set it), so the collector can place batches that arrive late, e.g. a
+// backlog drained hours after it was recorded.
+
+#define TELEMETRY_MAX_BATCH          60        // Records per payload (480 B)
+#define TELEMETRY_BATCH_INTERVAL_MS  10000     // Normal batching period
+#define TELEMETRY_DRAIN_INTERVAL_MS  1000      // Period while draining a backlog
+#define TELEMETRY_METRICS_INTERVAL_MS 60000
+#define TELEMETRY_ACK_TIMEOUT_MS     10000     // Resend if no PUBACK
+#define TELEMETRY_RECONNECT_MS       5000
+#define TELEMETRY_BACKLOG_PATH       "/telemetry.bin"
+#define TELEMETRY_BACKLOG_POS_PATH   "/telemetry.pos"  // Drain offset (acked bytes)
+#define TELEMETRY_BACKLOG_MAX_BYTES  (64 * 1024)
+#define TELEMETRY_VERSION            3         // 2: sentMs/sentUnix anchor in the header, 3: RF quality metrics
+
+enum TelemetryKind : uint8_t { TELEMETRY_EVENTS = 1, TELEMETRY_METRICS = 2 };
+
+// Payload header, followed by `count` JournalRecords or one TelemetryMetrics
+struct __attribute__((packed)) TelemetryHeader {
+  char     magic[2];      // "DJ"
+  uint8_t  version;       // TELEMETRY_VERSION
+  uint8_t  kind;          // TelemetryKind
+  uint8_t  deviceId[6];   // Base MAC
+  uint16_t count;
+  uint32_t firstSeq;      // Journal sequence of the first record (events)
+  uint32_t sentMs;        // Device millis() the record times are relative to
+  uint32_t sentUnix;      // Wall clock at sentMs, 0 = not set yet
+};
+
+struct __attribute__((packed)) TelemetryMetrics {
+  uint32_t uptimeMs;
+  uint8_t  level;
+  uint8_t  successesAtLevel;
+  uint16_t barkMissPermille;   // Scan tuning, last epoch
+  uint32_t quietTargetMs;
+  uint32_t journalSeq;
+  uint32_t barksFused;
+  uint32_t freeHeap;
+  uint32_t backlogBytes;
+  uint32_t droppedRecords;
+  uint32_t treatsDispensed;
+  uint32_t treatsFailed;
+  int8_t   rfSignalQuality;    // Learned remote, 0-100 (-1 = none yet); version 3
+  uint32_t rfLowQualityRejects;
+};
+
+// Backlog file: chunks of this header followed by `count` JournalRecords
+struct __attribute__((packed)) TelemetryBacklogChunk {
+  char     magic[2];      // "BL"
+  uint16_t count;
+  uint32_t firstSeq;      // Journal sequence of the first record
+  uint32_t spillMs;       // millis() and wall clock at spill: the records'
+  uint32_t spillUnix;     // time anchor, valid across a reboot (0 = unset)
+};
+
+typedef std::function<void(TelemetryMetrics&)> MetricsProvider;
+
+class TelemetryPublisher {
+public:
+  TelemetryPublisher(EventJournal& journal, const char* ssid, const char* password,
+                     const char* host, uint16_t port, const char* topicPrefix)
+    : _journal(journal), _ssid(ssid), _password(password),
+      _host(host), _port(port), _prefix(topicPrefix) {}
+
+  void setMetricsProvider(MetricsProvider p) { _metrics = p; }
+
+  void begin() {
+    uint64_t mac = ESP.getEfuseMac();
+    for (int i = 0; i < 6; i++) _deviceId[i] = (uint8_t)(mac >> (8 * i));
+    char id[13];
+    snprintf(id, sizeof(id), "%02x%02x%02x%02x%02x%02x", _deviceId[0], _deviceId[1],
+             _deviceId[2], _deviceId[3], _deviceId[4], _deviceId[5]);
+    _eventsTopic = String(_prefix) + "/" + id + "/events";
+    _metricsTopic = String(_prefix) + "/" + id + "/metrics";
+
+    _cursor = _journal.nextSeq();
+    File f = LittleFS.open(TELEMETRY_BACKLOG_PATH, FILE_READ);
+    if (f) {
+      _backlogBytes = f.size();
+      f.close();
+    }
+    f = LittleFS.open(TELEMETRY_BACKLOG_POS_PATH, FILE_READ);
+    if (f) {
+      uint32_t pos = 0;
+      if (f.read((uint8_t*)&pos, sizeof(pos)) == sizeof(pos) && pos < _backlogBytes) _backlogReadPos = pos;
+      f.close();
+    }
+    _bootBacklogStart = _backlogBytes;  // Chunks from here on were spilled this boot
+
+    WiFi.mode(WIFI_STA);
+    WiFi.setSleep(true);  // Modem sleep is required for Wi-Fi/BLE coexistence
+    WiFi.begin(_ssid, _password);
+
+    _mqtt.setServer(_host, _port);
+    _mqtt.onPublish([this](uint16_t packetId) { _ackedId = packetId; });
+    _enabled = true;
+    Serial.printf("📶 Telemetry → %s:%u %s\n", _host, _port, _eventsTopic.c_str());
+  }
+
+  void update(uint32_t nowMs) {
+    if (!_enabled) return;
+
+    if (_inflightId && _ackedId == _inflightId) _onAck();
+
+    if (!WiFi.isConnected() || !_mqtt.connected()) {
+      if (WiFi.isConnected() && nowMs - _lastConnectMs >= TELEMETRY_RECONNECT_MS) {
+        _lastConnectMs = nowMs;
+        _mqtt.connect();
+      }
+      _inflightId = 0;  // Unacked batch is resent after reconnect
+      _spillIfNeeded();
+      return;
+    }
+
+    if (_inflightId) {
+      if (nowMs - _inflightMs < TELEMETRY_ACK_TIMEOUT_MS) return;
+      _inflightId = 0;  // Give up waiting; cursor did not move, so resend
+      _timeouts++;
+    }
+
+    if (_metrics && nowMs - _lastMetricsMs >= TELEMETRY_METRICS_INTERVAL_MS) {
+      _lastMetricsMs = nowMs;
+      _publishMetrics();
+      return;
+    }
+
+    // Backlog and full batches go out at the drain rate, partial batches
+    // wait for the normal batching period
+    uint32_t sinceLast = nowMs - _lastPublishMs;
+    uint32_t unsent = _journal.nextSeq() - _cursor;
+    if (_backlogBytes > 0) {
+      if (sinceLast >= TELEMETRY_DRAIN_INTERVAL_MS) _publishBacklog(nowMs);
+    } else if (unsent >= TELEMETRY_MAX_BATCH) {
+      if (sinceLast >= TELEMETRY_DRAIN_INTERVAL_MS) _publishJournal(nowMs);
+    } else if (unsent > 0 && sinceLast >= TELEMETRY_BATCH_INTERVAL_MS) {
+      _publishJournal(nowMs);
+    }
+  }
+
+  void getStatus(String& statusMsg) {
+    if (!_enabled) {
+      statusMsg = "Off";
+      return;
+    }
+    statusMsg = String(WiFi.isConnected() ? "WiFi up" : "WiFi down") +
+                (_mqtt.connected() ? ", MQTT up" : ", MQTT down") +
+                ", batches: " + String(_batchesAcked) +
+                ", records: " + String(_recordsAcked) +
+                ", backlog: " + String(_backlogBytes) + " B" +
+                ", dropped: " + String(_dropped) +
+                ", timeouts: " + String(_timeouts);
+  }
+
+  uint32_t backlogBytes() const { return _backlogBytes; }
+  uint32_t droppedRecords() const { return _dropped; }
+
+private:
+  enum InflightSource : uint8_t { FROM_JOURNAL, FROM_BACKLOG };
+
+  // Wall clock now, 0 = not set
+  static uint32_t _unixNow() {
+    uint32_t unixNow = (uint32_t)time(nullptr);
+    return unixNow >= WALLCLOCK_MIN_VALID ? unixNow : 0;
+  }
+
+  void _fillHeader(TelemetryHeader& h, TelemetryKind kind, uint16_t count, uint32_t firstSeq,
+                   uint32_t sentMs, uint32_t sentUnix) {
+    memcpy(h.magic, "DJ", 2);
+    h.version = TELEMETRY_VERSION;
+    h.kind = kind;
+    memcpy(h.deviceId, _deviceId, 6);
+    h.count = count;
+    h.firstSeq = firstSeq;
+    h.sentMs = sentMs;
+    h.sentUnix = sentUnix;
+  }
+
+  void _publishJournal(uint32_t nowMs) {
+    JournalRecord* recs = (JournalRecord*)(_payload + sizeof(TelemetryHeader));
+    uint32_t firstSeq;
+    uint16_t n = _journal.read(_cursor, recs, TELEMETRY_MAX_BATCH, firstSeq);
+    if (firstSeq != _cursor) _dropped += firstSeq - _cursor;  // Fell out of the ring
+    _cursor = firstSeq;
+    if (n == 0) return;
+
+    _fillHeader(*(TelemetryHeader*)_payload, TELEMETRY_EVENTS, n, firstSeq, millis(), _unixNow());
+    _send(FROM_JOURNAL, n, 0, nowMs);
+  }
+
+  void _publishBacklog(uint32_t nowMs) {
+    File f = LittleFS.open(TELEMETRY_BACKLOG_PATH, FILE_READ);
+    if (!f) {
+      _backlogBytes = 0;
+      _backlogReadPos = 0;
+      return;
+    }
+    f.seek(_backlogReadPos);
+    TelemetryBacklogChunk c;
+    JournalRecord* recs = (JournalRecord*)(_payload + sizeof(TelemetryHeader));
+    bool ok = f.read((uint8_t*)&c, sizeof(c)) == sizeof(c) && memcmp(c.magic, "BL", 2) == 0 &&
+              c.count > 0 && c.count <= TELEMETRY_MAX_BATCH;
+    size_t bytes = ok ? c.count * sizeof(JournalRecord) : 0;
+    ok = ok && f.read((uint8_t*)recs, bytes) == (int)bytes;
+    f.close();
+
+    if (!ok) {
+      // End of file, or a chunk cut short by a reset mid-write: nothing
+      // after it can be framed
+      if (_backlogReadPos < _backlogBytes) _dropped++;
+      _clearBacklog();
+      return;
+    }
+    // Spilled this boot without a clock: millis() still lines up with the
+    // records, so today's anchor places them
+    uint32_t sentMs = c.spillMs, sentUnix = c.spillUnix;
+    if (!sentUnix && _backlogReadPos >= _bootBacklogStart) {
+      sentMs = millis();
+      sentUnix = _unixNow();
+    }
+    _fillHeader(*(TelemetryHeader*)_payload, TELEMETRY_EVENTS, c.count, c.firstSeq, sentMs, sentUnix);
+    _send(FROM_BACKLOG, c.count, sizeof(c) + bytes, nowMs);
+  }
+
+  void _clearBacklog() {
+    LittleFS.remove(TELEMETRY_BACKLOG_PATH);
+    LittleFS.remove(TELEMETRY_BACKLOG_POS_PATH);
+    _backlogBytes = 0;
+    _backlogReadPos = 0;
+    _bootBacklogStart = 0;
+  }
+
+  void _send(InflightSource src, uint16_t n, uint32_t fileBytes, uint32_t nowMs) {
+    size_t len = sizeof(TelemetryHeader) + n * sizeof(JournalRecord);
+    uint16_t id = _mqtt.publish(_eventsTopic.c_str(), 1, false, (const char*)_payload, len);
+    _lastPublishMs = nowMs;
+    if (id == 0) return;  // Not queued; retry next interval
+    _inflightId = id;
+    _inflightMs = nowMs;
+    _inflightSrc = src;
+    _inflightCount = n;
+    _inflightFileBytes = fileBytes;
+  }
+
+  void _onAck() {
+    if (_inflightSrc == FROM_JOURNAL) {
+      _cursor += _inflightCount;
+    } else {
+      _backlogReadPos += _inflightFileBytes;
+      if (_backlogReadPos >= _backlogBytes) {
+        _clearBacklog();
+      } else {
+        File f = LittleFS.open(TELEMETRY_BACKLOG_POS_PATH, FILE_WRITE);
+        if (f) {
+          f.write((const uint8_t*)&_backlogReadPos, sizeof(_backlogReadPos));
+          f.close();
+        }
+      }
+    }
+    _batchesAcked++;
+    _recordsAcked += _inflightCount;
+    _inflightId = 0;
+  }
+
+  void _publishMetrics() {
+    TelemetryMetrics m = {};
+    _metrics(m);
+    m.backlogBytes = _backlogBytes;
+    m.droppedRecords = _dropped;
+    _fillHeader(*(TelemetryHeader*)_payload, TELEMETRY_METRICS, 1, _journal.nextSeq(), millis(), _unixNow());
+    memcpy(_payload + sizeof(TelemetryHeader), &m, sizeof(m));
+    _mqtt.publish(_metricsTopic.c_str(), 0, false, (const char*)_payload,
+                  sizeof(TelemetryHeader) + sizeof(m));
+  }
+
+  // Offline: move records that are about to be overwritten in RAM to flash
+  void _spillIfNeeded() {
+    uint32_t unsent = _journal.nextSeq() - _cursor;
+    if (unsent < EventJournal::CAPACITY * 3 / 4) return;
+
+    JournalRecord recs[TELEMETRY_MAX_BATCH];
+    uint32_t firstSeq;
+    uint16_t n = _journal.read(_cursor, recs, TELEMETRY_MAX_BATCH, firstSeq);
+    if (firstSeq != _cursor) _dropped += firstSeq - _cursor;
+    _cursor = firstSeq + n;
+
+    if (n == 0) return;
+
+    TelemetryBacklogChunk c;
+    memcpy(c.magic, "BL", 2);
+    c.count = n;
+    c.firstSeq = firstSeq;
+    c.spillMs = millis();
+    c.spillUnix = _unixNow();
+    size_t bytes = n * sizeof(JournalRecord);
+    if (_backlogBytes + sizeof(c) + bytes > TELEMETRY_BACKLOG_MAX_BYTES) {
+      _dropped += n;  // Backlog full: newest spill is lost, older history kept
+      return;
+    }
+    File f = LittleFS.open(TELEMETRY_BACKLOG_PATH, FILE_APPEND);
+    if (!f) {
+      _dropped += n;
+      return;
+    }
+    size_t written = f.write((const uint8_t*)&c, sizeof(c));
+    written += f.write((const uint8_t*)recs, bytes);
+    f.close();
+    _backlogBytes += written;
+  }
+
+  EventJournal& _journal;
+  const char* _ssid;
+  const char* _password;
+  const char* _host;
+  uint16_t    _port;
+  const char* _prefix;
+
+  AsyncMqttClient _mqtt;
+  MetricsProvider _metrics;
+  String  _eventsTopic;
+  String  _metricsTopic;
+  uint8_t _deviceId[6]{};
+  bool    _enabled{false};
+
+  uint8_t  _payload[sizeof(TelemetryHeader) + TELEMETRY_MAX_BATCH * sizeof(JournalRecord)];
+  uint32_t _cursor{0};
+  uint32_t _backlogBytes{0};
+  uint32_t _backlogReadPos{0};     // Acked up to here; persisted
+  uint32_t _bootBacklogStart{0};   // Backlog size at boot
+
+  volatile uint16_t _ackedId{0};  // Set from the AsyncTCP task
+  uint16_t _inflightId{0};
+  uint32_t _inflightMs{0};
+  InflightSource _inflightSrc{FROM_JOURNAL};
+  uint16_t _inflightCount{0};
+  uint32_t _inflightFileBytes{0};  // Backlog bytes the in-flight chunk covers
+
+  uint32_t _lastPublishMs{0};
+  uint32_t _lastMetricsMs{0};
+  uint32_t _lastConnectMs{0};
+
+  uint32_t _batchesAcked{0};
+  uint32_t _recordsAcked{0};
+  uint32_t _dropped{0};
+  uint32_t _timeouts{0};
+};
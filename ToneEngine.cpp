@@ -0,0 +1,238 @@
+#include "ToneEngine.h"
+
+// Cue tables (const → flash)
+static const CueStep MARKER_STEPS[] = {
+    { 2800, CUE_OUT_LED, 60 },
+    { 0,    0,           0  },
+};
+
+static const CueStep LEVEL_UP_STEPS[] = {
+    { 2000, CUE_OUT_LED, 80  },
+    { 0,    0,           40  },
+    { 2600, CUE_OUT_LED, 80  },
+    { 0,    0,           40  },
+    { 3200, CUE_OUT_LED, 140 },
+    { 0,    0,           0   },
+};
+
+// Replaces the old blocking delay(500) vibration feedback
+static const CueStep RESET_STEPS[] = {
+    { 0, CUE_OUT_VIB, 500 },
+    { 0, 0,           500 },
+    { 0, CUE_OUT_VIB, 500 },
+    { 0, 0,           0   },
+};
+
+static const CueStep CORRECTION_STEPS[] = {
+    { 420, 0, 250 },
+    { 0,   0, 100 },
+    { 420, 0, 350 },
+    { 0,   0, 0   },
+};
+
+struct CueTable {
+    const CueStep* steps;
+    uint8_t        owns;       // Outputs the cue drives (released at the end)
+    TonePriority   priority;
+};
+
+static const CueTable CUE_TABLES[CUE_PATTERN_COUNT] = {
+    { MARKER_STEPS,     CUE_OUT_LED, TONE_PRIO_CUE },
+    { LEVEL_UP_STEPS,   CUE_OUT_LED, TONE_PRIO_ALERT },
+    { RESET_STEPS,      CUE_OUT_VIB, TONE_PRIO_ALERT },
+    { CORRECTION_STEPS, 0,           TONE_PRIO_CORRECTION },
+};
+
+ToneEngine::ToneEngine(ActuatorTrace& trace, int buzzerPin, int ledPin, int vibrationPin)
+    : trace(trace), onsetProbe("tone.onset") {
+    this->buzzerPin = buzzerPin;
+    this->ledPin = ledPin;
+    this->vibrationPin = vibrationPin;
+
+    reqPattern = CUE_MARKER;
+    reqUs = 0;
+    reqPending = false;
+    stopPending = false;
+
+    active = false;
+    current = CUE_MARKER;
+    stepIndex = 0;
+    stepEndUs = 0;
+    driven = 0;
+    held = 0;
+    enabled = true;
+
+    timer = nullptr;
+
+    played = 0;
+    preempted = 0;
+    dropped = 0;
+}
+
+void ToneEngine::begin() {
+    if (buzzerPin >= 0) {
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+        ledcAttachChannel(buzzerPin, 2000, TONE_LEDC_RES_BITS, TONE_LEDC_CHANNEL);
+#else
+        ledcSetup(TONE_LEDC_CHANNEL, 2000, TONE_LEDC_RES_BITS);
+        ledcAttachPin(buzzerPin, TONE_LEDC_CHANNEL);
+#endif
+        writeTone(0);
+    }
+
+    esp_timer_create_args_t args = {};
+    args.callback = &ToneEngine::onTimer;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "tone";
+    esp_timer_create(&args, &timer);
+
+    Serial.printf("ToneEngine initialized (%s)\n", buzzerPin >= 0 ? "buzzer" : "no buzzer");
+}
+
+bool ToneEngine::play(CuePattern pattern) {
+    if (!enabled || pattern >= CUE_PATTERN_COUNT || !timer) return false;
+    if (active && CUE_TABLES[pattern].priority < CUE_TABLES[current].priority) {
+        dropped++;
+        return false;
+    }
+    reqPattern = pattern;
+    reqUs = esp_timer_get_time();
+    reqPending = true;  // Publish last
+    kick();
+    return true;
+}
+
+void ToneEngine::stop() {
+    if (!timer) return;
+    stopPending = true;
+    kick();
+}
+
+void ToneEngine::holdOutputs(uint8_t mask) { held = mask; }
+
+// Run the callback now; it reschedules itself for the next step boundary
+void ToneEngine::kick() {
+    esp_timer_stop(timer);
+    esp_timer_start_once(timer, 0);
+}
+
+void ToneEngine::onTimer(void* arg) {
+    ((ToneEngine*)arg)->service();
+}
+
+// esp_timer task: take requests, advance steps, rearm for the next boundary
+void ToneEngine::service() {
+    int64_t now = esp_timer_get_time();
+
+    if (stopPending) {
+        stopPending = false;
+        reqPending = false;
+        if (active) endCue();
+        return;
+    }
+
+    if (reqPending) {
+        reqPending = false;
+        CuePattern p = reqPattern;
+        if (active && CUE_TABLES[p].priority < CUE_TABLES[current].priority) {
+            dropped++;  // Lost a race with a higher-priority cue
+        } else {
+            if (active) {
+                preempted++;
+                endCue();
+            }
+            startCue(p, now);
+            uint32_t us = (uint32_t)(esp_timer_get_time() - reqUs);
+            onsetProbe.recordUs(us);
+        }
+    }
+
+    if (!active) return;
+
+    const CueStep* steps = CUE_TABLES[current].steps;
+    while (now >= stepEndUs) {
+        stepIndex++;
+        if (steps[stepIndex].durMs == 0) {
+            endCue();
+            return;
+        }
+        applyStep(steps[stepIndex]);
+        stepEndUs += (int64_t)steps[stepIndex].durMs * 1000;
+    }
+    esp_timer_start_once(timer, (uint64_t)(stepEndUs - now));
+}
+
+void ToneEngine::startCue(CuePattern pattern, int64_t nowUs) {
+    current = pattern;
+    stepIndex = 0;
+    driven = 0;
+    const CueStep& first = CUE_TABLES[pattern].steps[0];
+    applyStep(first);
+    stepEndUs = nowUs + (int64_t)first.durMs * 1000;
+    active = true;
+    played++;
+}
+
+void ToneEngine::applyStep(const CueStep& step) {
+    uint8_t owns = CUE_TABLES[current].owns;
+    writeTone(step.freqHz);
+    if (owns & CUE_OUT_LED) writeOutput(CUE_OUT_LED, ledPin, step.outputs & CUE_OUT_LED);
+    if (owns & CUE_OUT_VIB) writeOutput(CUE_OUT_VIB, vibrationPin, step.outputs & CUE_OUT_VIB);
+}
+
+void ToneEngine::endCue() {
+    writeTone(0);
+    if (driven & CUE_OUT_LED) writeOutput(CUE_OUT_LED, ledPin, false);
+    if (driven & CUE_OUT_VIB) writeOutput(CUE_OUT_VIB, vibrationPin, false);
+    driven = 0;
+    active = false;
+}
+
+void ToneEngine::writeOutput(uint8_t bit, int pin, bool on) {
+    if (pin < 0 || (held & bit)) return;
+    trace.write(pin, on ? HIGH : LOW);
+    if (on) driven |= bit;
+    else driven &= ~bit;
+}
+
+void ToneEngine::writeTone(uint32_t freqHz) {
+    if (buzzerPin < 0) return;
+    trace.record(buzzerPin, freqHz);
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+    ledcWriteTone(buzzerPin, freqHz);  // 3.x addresses LEDC by pin
+#else
+    ledcWriteTone(TONE_LEDC_CHANNEL, freqHz);
+#endif
+}
+
+void ToneEngine::setEnabled(bool enabled) {
+    this->enabled = enabled;
+    if (!enabled) stop();
+}
+
+bool ToneEngine::isEnabled() { return enabled; }
+bool ToneEngine::isActive() { return active; }
+bool ToneEngine::drivesLed() { return active && (CUE_TABLES[current].owns & CUE_OUT_LED); }
+
+TonePriority ToneEngine::priorityOf(CuePattern pattern) {
+    return pattern < CUE_PATTERN_COUNT ? CUE_TABLES[pattern].priority : TONE_PRIO_CUE;
+}
+
+const char* ToneEngine::patternName(CuePattern pattern) {
+    switch (pattern) {
+        case CUE_MARKER:     return "marker";
+        case CUE_LEVEL_UP:   return "level up";
+        case CUE_RESET:      return "reset";
+        case CUE_CORRECTION: return "correction";
+        default:             return "?";
+    }
+}
+
+void ToneEngine::getStatus(String& statusMsg) {
+    statusMsg = String(enabled ? (active ? "Playing " : "Idle") : "OFF") +
+                (enabled && active ? patternName(current) : "") +
+                ", played: " + String(played) +
+                ", pre-empted: " + String(preempted) +
+                ", dropped: " + String(dropped);
+}
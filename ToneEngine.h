@@ -0,0 +1,114 @@
+#ifndef TONE_ENGINE_H
+#define TONE_ENGINE_H
+
+#include <Arduino.h>
+#include "esp_timer.h"
+#include "ActuatorTrace.h"
+#include "PerfCounters.h"
+
+#define TONE_LEDC_CHANNEL   6     // Timer 3; the feeder's channel 4 is on timer 2
+#define TONE_LEDC_RES_BITS  8
+
+// Outputs a cue step can drive besides the tone
+#define CUE_OUT_LED  0x01
+#define CUE_OUT_VIB  0x02
+
+// One step of a cue: tone (0 = silent) and output levels for durMs.
+// A step with durMs == 0 ends the cue.
+struct CueStep {
+    uint16_t freqHz;
+    uint8_t  outputs;   // CUE_OUT_* bits high during the step
+    uint16_t durMs;
+};
+
+enum TonePriority : uint8_t {
+    TONE_PRIO_CUE = 0,      // Reward markers
+    TONE_PRIO_ALERT,        // Acknowledgements (level up, reset)
+    TONE_PRIO_CORRECTION    // Corrections pre-empt everything else
+};
+
+enum CuePattern : uint8_t {
+    CUE_MARKER = 0,    // Short bright "click": quiet success earned a reward
+    CUE_LEVEL_UP,      // Rising triple
+    CUE_RESET,         // Two vibration pulses (remote triple click)
+    CUE_CORRECTION,    // Low double buzz with a correction
+    CUE_PATTERN_COUNT
+};
+
+// Non-blocking cue player: LEDC tone plus LED/vibration steps from const
+// tables (flash). A one-shot esp_timer fires at each step boundary, so step
+// timing does not depend on loop() and nothing ever delays.
+//
+// play() may be called from loop() or another esp_timer callback: it posts
+// the request and kicks the timer, and the timer callback does all output
+// writes. A cue replaces the current one only at equal or higher priority;
+// lower priority requests are dropped. Outputs the sketch drives itself
+// (e.g. LED/vibration during a correction) are held and never touched.
+class ToneEngine {
+public:
+    // Constructor (any pin < 0 = not fitted)
+    ToneEngine(ActuatorTrace& trace, int buzzerPin, int ledPin, int vibrationPin);
+
+    // Setup functions
+    void begin();
+
+    // Start a cue. Returns false if a higher-priority cue is playing.
+    bool play(CuePattern pattern);
+    void stop();
+
+    // Outputs driven elsewhere right now (CUE_OUT_* bits, 0 = none)
+    void holdOutputs(uint8_t mask);
+
+    // Control functions
+    void setEnabled(bool enabled);
+    bool isEnabled();
+    bool isActive();
+    bool drivesLed();   // LED belongs to the playing cue
+    void getStatus(String& statusMsg);
+
+    static const char* patternName(CuePattern pattern);
+    static TonePriority priorityOf(CuePattern pattern);
+
+private:
+    ActuatorTrace& trace;
+
+    // Hardware config
+    int buzzerPin;
+    int ledPin;
+    int vibrationPin;
+
+    // Request slot (any task) → timer callback
+    volatile CuePattern reqPattern;
+    volatile int64_t reqUs;
+    volatile bool reqPending;
+    volatile bool stopPending;
+
+    // Playback state (timer callback only; loop() reads)
+    volatile bool active;
+    volatile CuePattern current;
+    uint8_t stepIndex;
+    int64_t stepEndUs;
+    uint8_t driven;            // Outputs set high by the current step
+    volatile uint8_t held;
+    bool enabled;
+
+    esp_timer_handle_t timer;
+
+    // Stats
+    unsigned long played;
+    unsigned long preempted;
+    unsigned long dropped;     // Refused: lower priority than the playing cue
+    PerfProbe onsetProbe;      // play() → first step (benchmark harness)
+
+    static void onTimer(void* arg);
+
+    void service();
+    void kick();
+    void startCue(CuePattern pattern, int64_t nowUs);
+    void applyStep(const CueStep& step);
+    void endCue();
+    void writeTone(uint32_t freqHz);
+    void writeOutput(uint8_t bit, int pin, bool on);
+};
+
+#endif
@@ -0,0 +1,266 @@
+#include "TrainerGattService.h"
+
+// ===== NimBLE callbacks (host task) =====
+
+class TrainerServerCallbacks : public NimBLEServerCallbacks {
+public:
+    TrainerServerCallbacks(TrainerGattService* svc) : svc(svc) {}
+
+    void onConnect(NimBLEServer* s, ble_gap_conn_desc* desc) override {
+        svc->connHandle = desc->conn_handle;
+        svc->peerMtu = BLE_ATT_MTU_DFLT;
+        svc->connections++;
+        svc->connected = true;
+        // Long interval + latency: the link costs a few ms of radio time per
+        // second instead of competing with every scan window
+        s->updateConnParams(desc->conn_handle, GATT_CONN_MIN_UNITS, GATT_CONN_MAX_UNITS,
+                            GATT_CONN_LATENCY, GATT_CONN_TIMEOUT_UNITS);
+    }
+
+    void onDisconnect(NimBLEServer* s) override {
+        svc->connected = false;
+        NimBLEDevice::startAdvertising();
+    }
+
+    void onMTUChange(uint16_t mtu, ble_gap_conn_desc* desc) override {
+        svc->peerMtu = mtu;
+    }
+
+private:
+    TrainerGattService* svc;
+};
+
+class TrainerWriteCallbacks : public NimBLECharacteristicCallbacks {
+public:
+    TrainerWriteCallbacks(TrainerGattService* svc) : svc(svc) {}
+
+    void onWrite(NimBLECharacteristic* c) override {
+        std::string v = c->getValue();
+        if (c == svc->levelChar) {
+            if (v.length() != 1) {
+                svc->writesRejected++;
+                return;
+            }
+            svc->pendingLevel = (uint8_t)v[0];
+            svc->levelWritePending = true;
+        } else if (c == svc->configChar) {
+            if (svc->configWritePending || v.length() != sizeof(TrainerConfig) || v[0] != 1) {
+                svc->writesRejected++;
+                return;
+            }
+            memcpy(&svc->pendingConfig, v.data(), sizeof(TrainerConfig));
+            svc->configWritePending = true;  // Set after the copy
+        } else if (c == svc->programChar) {
+            uint8_t used = svc->programHead - svc->programTail;
+            if (used >= GATT_PROGRAM_QUEUE || v.empty() || v.length() > sizeof(svc->programQueue[0].data)) {
+                svc->writesRejected++;  // Client reads the status and resends
+                return;
+            }
+            TrainerGattService::ProgramChunk& slot = svc->programQueue[svc->programHead % GATT_PROGRAM_QUEUE];
+            memcpy(slot.data, v.data(), v.length());
+            slot.len = (uint8_t)v.length();
+            svc->programHead++;  // Publish after the slot is written
+        }
+    }
+
+private:
+    TrainerGattService* svc;
+};
+
+// ===== TrainerGattService =====
+
+TrainerGattService::TrainerGattService(EventJournal& journal) : journal(journal) {
+    server = nullptr;
+    levelChar = configChar = metricsChar = journalChar = programChar = nullptr;
+    connected = false;
+    connHandle = 0;
+    peerMtu = BLE_ATT_MTU_DFLT;
+    levelWritePending = false;
+    pendingLevel = 0;
+    configWritePending = false;
+    memset(&pendingConfig, 0, sizeof(pendingConfig));
+    programHead = 0;
+    programTail = 0;
+
+    journalCursor = 0;
+    lastNotifyMs = 0;
+    lastRefreshMs = 0;
+    lastLevel = 0xFF;
+
+    connections = 0;
+    notificationsSent = 0;
+    recordsSent = 0;
+    recordsSkipped = 0;
+    writesRejected = 0;
+}
+
+void TrainerGattService::begin() {
+    NimBLEDevice::setMTU(GATT_PREFERRED_MTU);
+    NimBLEDevice::setSecurityAuth(true, false, true);  // Bonding, "just works", secure connections
+
+    server = NimBLEDevice::createServer();
+    server->setCallbacks(new TrainerServerCallbacks(this));
+
+    NimBLEService* svc = server->createService(GATT_SERVICE_UUID);
+    TrainerWriteCallbacks* writeCb = new TrainerWriteCallbacks(this);
+
+    // Writes need an encrypted link so a passer-by cannot change training
+    levelChar = svc->createCharacteristic(GATT_LEVEL_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_ENC | NIMBLE_PROPERTY::NOTIFY);
+    levelChar->setCallbacks(writeCb);
+
+    configChar = svc->createCharacteristic(GATT_CONFIG_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_ENC);
+    configChar->setCallbacks(writeCb);
+
+    metricsChar = svc->createCharacteristic(GATT_METRICS_UUID, NIMBLE_PROPERTY::READ);
+    journalChar = svc->createCharacteristic(GATT_JOURNAL_UUID, NIMBLE_PROPERTY::NOTIFY);
+
+    programChar = svc->createCharacteristic(GATT_PROGRAM_UUID,
+        NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_ENC);
+    programChar->setCallbacks(writeCb);
+
+    svc->start();
+
+    NimBLEAdvertising* adv = NimBLEDevice::getAdvertising();
+    adv->setName(GATT_DEVICE_NAME);
+    adv->addServiceUUID(GATT_SERVICE_UUID);
+    adv->setMinInterval(GATT_ADV_MIN_UNITS);
+    adv->setMaxInterval(GATT_ADV_MAX_UNITS);
+    adv->start();
+
+    journalCursor = journal.nextSeq();
+    refreshValues();
+    Serial.println("TrainerGattService initialized");
+}
+
+void TrainerGattService::setLevelCallbacks(LevelReader get, LevelWriter set) {
+    levelReader = get;
+    levelWriter = set;
+}
+
+void TrainerGattService::setConfigCallbacks(ConfigReader get, ConfigWriter set) {
+    configReader = get;
+    configWriter = set;
+}
+
+void TrainerGattService::setMetricsProvider(TrainerMetricsProvider provider) {
+    metricsProvider = provider;
+}
+
+void TrainerGattService::setProgramCallbacks(ProgramStatusReader get, ProgramChunkWriter write) {
+    programReader = get;
+    programWriter = write;
+}
+
+void TrainerGattService::update() {
+    if (!server) return;
+    unsigned long now = millis();
+
+    // Apply writes latched by the host task
+    if (levelWritePending) {
+        levelWritePending = false;
+        if (levelWriter) levelWriter(pendingLevel);
+        lastRefreshMs = 0;  // Publish the result right away
+    }
+    if (configWritePending) {
+        if (configWriter) configWriter(pendingConfig);
+        configWritePending = false;
+        lastRefreshMs = 0;
+    }
+    while (programTail != programHead) {
+        ProgramChunk& chunk = programQueue[programTail % GATT_PROGRAM_QUEUE];
+        if (programWriter) programWriter(chunk.data, chunk.len);
+        programTail++;
+        lastRefreshMs = 0;
+    }
+
+    if (lastRefreshMs == 0 || now - lastRefreshMs >= GATT_REFRESH_MS) {
+        lastRefreshMs = now;
+        refreshValues();
+    }
+
+    if (connected) {
+        pushJournal(now);
+    } else {
+        journalCursor = journal.nextSeq();  // Stream starts fresh on each connection
+    }
+}
+
+void TrainerGattService::refreshValues() {
+    if (levelReader) {
+        uint8_t level = levelReader();
+        levelChar->setValue(&level, 1);
+        if (level != lastLevel && connected) levelChar->notify();
+        lastLevel = level;
+    }
+    if (configReader) {
+        TrainerConfig cfg = {};
+        cfg.version = 1;
+        configReader(cfg);
+        configChar->setValue((const uint8_t*)&cfg, sizeof(cfg));
+    }
+    if (metricsProvider) {
+        TrainerMetrics m = {};
+        metricsProvider(m);
+        metricsChar->setValue((const uint8_t*)&m, sizeof(m));
+    }
+    if (programReader) {
+        TrainerProgramStatus ps = {};
+        programReader(ps);
+        programChar->setValue((const uint8_t*)&ps, sizeof(ps));
+    }
+}
+
+// One notification per call at most: full packets as soon as the previous
+// one is a connection interval old, partial ones after GATT_JOURNAL_FLUSH_MS
+void TrainerGattService::pushJournal(unsigned long now) {
+    if (journalChar->getSubscribedCount() == 0) {
+        journalCursor = journal.nextSeq();
+        return;
+    }
+    if (now - lastNotifyMs < GATT_NOTIFY_MIN_MS) return;
+
+    uint16_t payloadMax = peerMtu - 3;  // ATT notification header
+    uint16_t perPacket = (payloadMax - sizeof(GattJournalHeader)) / sizeof(JournalRecord);
+    const uint16_t maxPerPacket = (GATT_PREFERRED_MTU - 3 - sizeof(GattJournalHeader)) / sizeof(JournalRecord);
+    if (perPacket > maxPerPacket) perPacket = maxPerPacket;
+    if (perPacket == 0) return;
+
+    uint32_t unsent = journal.nextSeq() - journalCursor;
+    if (unsent == 0) return;
+    if (unsent < perPacket && now - lastNotifyMs < GATT_JOURNAL_FLUSH_MS) return;
+
+    uint8_t buf[sizeof(GattJournalHeader) + maxPerPacket * sizeof(JournalRecord)];
+    GattJournalHeader* h = (GattJournalHeader*)buf;
+    JournalRecord* recs = (JournalRecord*)(buf + sizeof(GattJournalHeader));
+    uint32_t firstSeq;
+    uint16_t n = journal.read(journalCursor, recs, perPacket, firstSeq);
+    if (firstSeq != journalCursor) recordsSkipped += firstSeq - journalCursor;  // Ring overran
+    h->firstSeq = firstSeq;
+
+    journalChar->setValue(buf, sizeof(GattJournalHeader) + n * sizeof(JournalRecord));
+    journalChar->notify();
+    journalCursor = firstSeq + n;
+    lastNotifyMs = now;
+    notificationsSent++;
+    recordsSent += n;
+}
+
+bool TrainerGattService::isConnected() {
+    return connected;
+}
+
+void TrainerGattService::getStatus(String& statusMsg) {
+    if (!server) {
+        statusMsg = "Not started";
+        return;
+    }
+    statusMsg = String(connected ? "Connected" : "Advertising") +
+                (connected ? ", MTU " + String(peerMtu) : String("")) +
+                ", connections: " + String(connections) +
+                ", notifications: " + String(notificationsSent) +
+                ", records: " + String(recordsSent) +
+                ", skipped: " + String(recordsSkipped) +
+                ", rejected writes: " + String(writesRejected);
+}
@@ -0,0 +1,168 @@
+#ifndef TRAINER_GATT_SERVICE_H
+#define TRAINER_GATT_SERVICE_H
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+#include <functional>
+#include "EventJournal.h"
+
+// BLE GATT service next to the bark scanner: level and config
+// (read/write, encrypted writes), a metrics snapshot (read), a journal
+// event stream (notify, records coalesced into MTU-sized packets) and
+// training program upload (encrypted write chunks, status read).
+//
+// NimBLE callbacks run in the host task, so writes are only latched there
+// and applied from update() in loop(); characteristic values are refreshed
+// from loop() too, never read from globals inside a callback.
+//
+// Radio time spent on the link is time the scanner is not listening, so the
+// peripheral asks for a long connection interval with slave latency and
+// advertises slowly; ScanDutyMeter shows the effect.
+
+#define GATT_SERVICE_UUID        "6d2f0001-5c1e-4b8e-9a3f-0d06a1b2c3d4"
+#define GATT_LEVEL_UUID          "6d2f0002-5c1e-4b8e-9a3f-0d06a1b2c3d4"
+#define GATT_CONFIG_UUID         "6d2f0003-5c1e-4b8e-9a3f-0d06a1b2c3d4"
+#define GATT_METRICS_UUID        "6d2f0004-5c1e-4b8e-9a3f-0d06a1b2c3d4"
+#define GATT_JOURNAL_UUID        "6d2f0005-5c1e-4b8e-9a3f-0d06a1b2c3d4"
+#define GATT_PROGRAM_UUID        "6d2f0006-5c1e-4b8e-9a3f-0d06a1b2c3d4"
+
+#define GATT_DEVICE_NAME         "DogTrainer"
+#define GATT_PREFERRED_MTU       185     // 22 journal records per notification
+#define GATT_CONN_MIN_UNITS      320     // 400 ms (1.25 ms units)
+#define GATT_CONN_MAX_UNITS      400     // 500 ms
+#define GATT_CONN_LATENCY        4       // Peripheral may skip 4 events when idle
+#define GATT_CONN_TIMEOUT_UNITS  600     // 6 s supervision timeout (10 ms units)
+#define GATT_ADV_MIN_UNITS       1600    // 1 s advertising interval (0.625 ms units)
+#define GATT_ADV_MAX_UNITS       3200    // 2 s
+#define GATT_REFRESH_MS          1000    // Level/config/metrics value refresh
+#define GATT_JOURNAL_FLUSH_MS    2000    // Send a partial journal packet after this
+#define GATT_NOTIFY_MIN_MS       400     // At most one notification per connection interval
+#define GATT_PROGRAM_QUEUE       4       // Program chunks latched until update()
+
+// Config characteristic value
+struct __attribute__((packed)) TrainerConfig {
+  uint8_t  version;            // 1
+  uint8_t  fusionPolicy;       // FusionPolicy
+  uint16_t fusionWindowMs;
+  uint8_t  rfMinQuality;       // 0-100
+  uint8_t  micEnabled;
+  uint8_t  classifierEnabled;
+  uint8_t  quietLogging;
+};
+
+// Metrics characteristic value
+struct __attribute__((packed)) TrainerMetrics {
+  uint32_t uptimeMs;
+  uint8_t  level;
+  uint8_t  successesAtLevel;
+  uint16_t scanAdvPerSecX10;   // Scanner duty, last period
+  uint32_t quietTargetMs;
+  uint32_t journalSeq;
+  uint32_t barksFused;
+  uint32_t freeHeap;
+  uint32_t treatsDispensed;
+  uint32_t treatsFailed;
+  uint32_t barksMissed;        // Sensor sequence gaps, paired sensors
+  uint16_t barkMissPermille;   // Last scan tuning epoch
+  uint16_t scanWindowUnits;    // 0.625 ms units
+  uint16_t scanIntervalUnits;
+  uint8_t  recommendedBurst;   // Sensor adverts per bark for the miss target (0 = no estimate)
+  int8_t   rfSignalQuality;    // Learned remote's frame quality EWMA, 0-100 (-1 = none yet)
+  uint32_t rfLowQualityRejects; // Remote frames dropped below rfMinQuality
+};
+
+// Program characteristic value (read back after each upload step)
+struct __attribute__((packed)) TrainerProgramStatus {
+  uint8_t  loaded;
+  uint8_t  phase;
+  uint8_t  phaseCount;
+  uint8_t  lastError;          // TpError
+  uint16_t stagedBytes;        // Upload progress
+  uint16_t expectedBytes;
+};
+
+// Journal notification: header then up to (MTU - 3 - 4) / 8 records
+struct __attribute__((packed)) GattJournalHeader {
+  uint32_t firstSeq;
+};
+
+typedef std::function<uint8_t()> LevelReader;
+typedef std::function<void(uint8_t level)> LevelWriter;
+typedef std::function<void(TrainerConfig&)> ConfigReader;
+typedef std::function<void(const TrainerConfig&)> ConfigWriter;
+typedef std::function<void(TrainerMetrics&)> TrainerMetricsProvider;
+typedef std::function<void(const uint8_t* data, size_t len)> ProgramChunkWriter;
+typedef std::function<void(TrainerProgramStatus&)> ProgramStatusReader;
+
+class TrainerGattService {
+public:
+    TrainerGattService(EventJournal& journal);
+
+    // Setup functions (call after NimBLEDevice::init)
+    void begin();
+    void setLevelCallbacks(LevelReader get, LevelWriter set);
+    void setConfigCallbacks(ConfigReader get, ConfigWriter set);
+    void setMetricsProvider(TrainerMetricsProvider provider);
+    void setProgramCallbacks(ProgramStatusReader get, ProgramChunkWriter write);
+
+    // Main loop function
+    void update();
+
+    // Status
+    bool isConnected();
+    void getStatus(String& statusMsg);
+
+private:
+    friend class TrainerServerCallbacks;
+    friend class TrainerWriteCallbacks;
+
+    EventJournal& journal;
+    NimBLEServer* server;
+    NimBLECharacteristic* levelChar;
+    NimBLECharacteristic* configChar;
+    NimBLECharacteristic* metricsChar;
+    NimBLECharacteristic* journalChar;
+    NimBLECharacteristic* programChar;
+
+    LevelReader levelReader;
+    LevelWriter levelWriter;
+    ConfigReader configReader;
+    ConfigWriter configWriter;
+    TrainerMetricsProvider metricsProvider;
+    ProgramStatusReader programReader;
+    ProgramChunkWriter programWriter;
+
+    // Set from the NimBLE host task, consumed in update()
+    volatile bool connected;
+    volatile uint16_t connHandle;
+    volatile uint16_t peerMtu;
+    volatile bool levelWritePending;
+    volatile uint8_t pendingLevel;
+    volatile bool configWritePending;
+    TrainerConfig pendingConfig;
+    struct ProgramChunk {
+        uint8_t len;
+        uint8_t data[GATT_PREFERRED_MTU - 3];
+    };
+    ProgramChunk programQueue[GATT_PROGRAM_QUEUE];
+    volatile uint8_t programHead;   // Written by the host task only
+    volatile uint8_t programTail;   // Written by update() only
+
+    // Journal stream
+    uint32_t journalCursor;
+    unsigned long lastNotifyMs;
+    unsigned long lastRefreshMs;
+    uint8_t lastLevel;
+
+    // Stats
+    unsigned long connections;
+    unsigned long notificationsSent;
+    unsigned long recordsSent;
+    unsigned long recordsSkipped;
+    unsigned long writesRejected;
+
+    void refreshValues();
+    void pushJournal(unsigned long now);
+};
+
+#endif
@@ -0,0 +1,376 @@
+#include "TrainerLoop.h"
+
+TrainerLoop::TrainerLoop(const TrainerPins& pins, ActuatorTrace& trace, FeederController& feeder,
+                         ToneEngine& tones, MarkerCue& marker, ClickDetector& remote,
+                         QuietReinforcementManager& quietMgr, BLEBarkWindow& barkWindow,
+                         CorrectionPolicy& correction, BarkFusion& fusion, EventJournal& journal,
+                         TrainingSession& session, TrainingProgram& program)
+    : pins(pins), trace(trace), feeder(feeder), tones(tones), marker(marker), remote(remote),
+      quietMgr(quietMgr), barkWindow(barkWindow), correction(correction), fusion(fusion),
+      journal(journal), session(session), program(program),
+      perfBarkWindow("ble.window"), perfQuietTick("quiet.tick"), perfQuietBark("quiet.onBark"),
+      perfCorrection("corr.decide") {
+    scheduleGates = GATE_AWAKE_ALL;
+    correctionLadderOn = true;
+
+    punishActive = false;
+    punishEndMs = 0;
+
+    lastWaterButtonTime = 0;
+    lastFeederButtonTime = 0;
+    lastBarkButtonTime = 0;
+    lastLedBlinkTime = 0;
+    ledState = false;
+
+    micMuteUntilMs = 0;
+    micSelfNoise = 0;
+
+    lastQuietSuccessCount = 0;
+    lastLoggedLevel = 0;
+    lastProgramBarkCount = 0;
+}
+
+void TrainerLoop::begin() {
+    lastLoggedLevel = quietMgr.currentLevel();
+
+    feeder.setCallbacks(
+        [this](bool dropped, uint32_t elapsedMs) {
+            journal.log(dropped ? JEV_TREAT_DROPPED : JEV_TREAT_FAILED, 0,
+                        (uint16_t)min<uint32_t>(elapsedMs, 0xFFFF));
+        },
+        [this](uint8_t failures) {
+            journal.log(JEV_FEEDER_JAM, failures);
+            Serial.printf("🚨 FEEDER JAM? %u dispenses in a row without a treat (\"feeder clear\" to reset)\n",
+                          failures);
+        }
+    );
+
+    // Quad click (sessions) is the sketch's
+    remote.setCallbacks(
+        [this]() { // single click → manual punishment ONLY (does NOT affect manager)
+            Serial.println("🎮 Remote Single Click → MANUAL punishment");
+            logEvent(JEV_MANUAL_PUNISH, 0, MANUAL_PUNISH_MS);
+            startPunishment(MANUAL_PUNISH_MS, CORR_OUT_ALL);
+        },
+        [this]() { // double click → manual reward ONLY (does NOT affect manager)
+            Serial.println("🎮 Remote Double Click → MANUAL reward");
+            logEvent(JEV_MANUAL_REWARD, 0, MANUAL_REWARD_MS);
+            dispenseTreat(MANUAL_REWARD_MS);
+        },
+        [this]() { // triple click → reset
+            Serial.println("🎮 Remote Triple Press Click → reset");
+            quietMgr.resetState();
+            journal.log(JEV_RESET);
+            Serial.println("🔄 QuietMgr reset");
+
+            // Two vibration pulses (non-blocking)
+            tones.play(CUE_RESET);
+        }
+    );
+}
+
+void TrainerLoop::setBarkCorrectedCallback(BarkCorrectedCallback onCorrected) {
+    barkCorrectedCallback = onCorrected;
+}
+
+void TrainerLoop::setProgramPhaseCallback(ProgramPhaseCallback onPhase) {
+    programPhaseCallback = onPhase;
+}
+
+// Debounce
+bool TrainerLoop::isButtonPressed(int pin, unsigned long& lastPressTime) {
+    if (digitalRead(pin) == LOW) { // active-low
+        unsigned long now = millis();
+        if (now - lastPressTime > DEBOUNCE_MS) {
+            lastPressTime = now;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Non-blocking: the feeder runs until a treat drops or maxMs passes
+// (with the drop sensor, level dispense times are an upper bound)
+void TrainerLoop::dispenseTreat(uint32_t maxMs) {
+    if (!feeder.dispense(maxMs)) {
+        Serial.println("🍖 Feeder busy - treat skipped");
+    }
+}
+
+// Water: run pump/valve for durationMs (blocking)
+void TrainerLoop::runWaterFor(uint32_t durationMs) {
+    if (durationMs == 0) return;
+
+    trace.write(pins.water, HIGH);
+    uint32_t start = millis();
+    while (millis() - start < durationMs) {
+        delay(1); // keep loop responsive-ish
+    }
+    trace.write(pins.water, LOW);
+    Serial.printf("💧 Water ran for %lu ms\n", (unsigned long)durationMs);
+}
+
+// Manager-driven punishment (from barks); outputs = CORR_OUT_* actuators
+void TrainerLoop::startPunishment(uint32_t ms, uint8_t outputs) {
+    if (ms == 0) return;
+    quietMgr.invalidatePlan();  // No marker or pre-armed treat during a correction
+    punishActive = true;
+    punishEndMs = millis() + ms;
+
+    tones.holdOutputs(CUE_OUT_LED | CUE_OUT_VIB);
+    if (outputs & CORR_OUT_TONE) tones.play(CUE_CORRECTION);
+    if (outputs & CORR_OUT_WATER) trace.write(pins.water, HIGH);
+    if (outputs & CORR_OUT_VIB) trace.write(pins.vibration, HIGH);
+    trace.write(pins.led, HIGH);
+    Serial.printf("🚨 Punishment ON for %lu ms (%s)\n", (unsigned long)ms,
+                  CorrectionPolicy::outputsName(outputs).c_str());
+}
+
+// Journal a training event and fold it into the running session totals
+void TrainerLoop::logEvent(JournalEventType type, uint8_t a, uint16_t b) {
+    journal.log(type, a, b);
+    session.onEvent(type, a, millis());
+}
+
+// Update punishment runner
+void TrainerLoop::updatePunishment() {
+    if (punishActive && (long)(millis() - punishEndMs) >= 0) {
+        punishActive = false;
+        trace.write(pins.water, LOW);
+        trace.write(pins.vibration, LOW);
+        trace.write(pins.led, LOW);
+        tones.holdOutputs(0);
+        Serial.println("✅ Punishment OFF");
+    }
+}
+
+// CUE_CORRECTION's 420 Hz sits in the bark band: the mic must not hear its own buzzer
+void TrainerLoop::onMicBark() {
+    if (tones.isActive() || (int32_t)(millis() - micMuteUntilMs) < 0) {
+        micSelfNoise++;
+        return;
+    }
+    fusion.report(BARK_SRC_MIC, millis());
+    Serial.println("🎤 Mic Bark reported");
+}
+
+// Fused sensor bark (or one relayed from another unit) → window check →
+// manager + punishment. sources is the BarkSource bitmask, or the relay bit.
+// Returns false if the bark fell inside the suppression window and was ignored.
+bool TrainerLoop::handleBarkEvent(uint32_t now, uint8_t sources) {
+    correction.noteBark(now);  // Suppressed barks still count (once) towards escalation
+    session.onBark(now);
+    bool punish;
+    {
+        PerfScope ps(perfBarkWindow);
+        punish = barkWindow.shouldPunish(now);
+    }
+    if (!punish) return false;
+    logEvent(JEV_BARK, sources, 0);
+
+    if (scheduleGates & GATE_TRAIN) {
+        PerfScope ps(perfQuietBark);
+        quietMgr.onBark(now);  // enqueue punishment + reset quiet window
+    }
+    if (!(scheduleGates & GATE_CORRECT)) return true;  // Quiet hours: logged, not corrected
+    CorrectionDecision corr;
+    {
+        PerfScope ps(perfCorrection);
+        corr = correction.decide(now);
+    }
+    if (!correctionLadderOn) {
+        corr.outputs = CORR_OUT_ALL;
+        corr.durationMs = MANUAL_PUNISH_MS;
+    }
+    logEvent(JEV_PUNISH, corr.outputs, corr.durationMs);
+    startPunishment(corr.durationMs, corr.outputs);
+    if (sources != BARK_RELAY_SOURCE_BIT && barkCorrectedCallback) {
+        barkCorrectedCallback(sources);  // Keep the audio around this bark as evidence
+    }
+    return true;
+}
+
+// Bark button or console "bark": straight to the manager, no window or correction
+void TrainerLoop::handleManualBark(uint32_t now) {
+    session.onBark(now);
+    if (scheduleGates & GATE_TRAIN) {
+        PerfScope ps(perfQuietBark);
+        quietMgr.onBark(now);
+    }
+    logEvent(JEV_BARK, 0, 0);  // No sensor source
+}
+
+// Fused sensor barks (BLE/mic) → manager
+bool TrainerLoop::updateBarks(uint32_t now) {
+    if (tones.isActive()) micMuteUntilMs = now + MIC_TONE_TAIL_MS;
+
+    if (!fusion.update(now) || !handleBarkEvent(now, fusion.lastSources())) return false;
+    Serial.printf("🐕 Bark accepted (fusion: %s, +%lu ms)\n", BarkFusion::policyName(fusion.policy()),
+                  (unsigned long)fusion.lastLatencyMs());
+    return true;
+}
+
+void TrainerLoop::update(uint32_t now) {
+    updateButtons(now);
+    updateRewards(now);
+    updateProgram(now);
+
+    if (quietMgr.currentLevel() != lastLoggedLevel) {
+        logEvent(JEV_LEVEL, quietMgr.currentLevel(), lastLoggedLevel);
+        if (quietMgr.currentLevel() > lastLoggedLevel && !program.isLoaded()) marker.fire(CUE_LEVEL_UP);
+        lastLoggedLevel = quietMgr.currentLevel();
+    }
+
+    updatePunishment();
+}
+
+void TrainerLoop::updateButtons(uint32_t now) {
+    // Bark button → affects manager
+    if (isButtonPressed(pins.barkButton, lastBarkButtonTime)) {
+        Serial.println("🐕 Bark button pressed → manager bark");
+        handleManualBark(now);
+        Serial.println("\n✅ Loop!");
+    }
+
+    // Water button → manual punishment ONLY (no manager)
+    if (isButtonPressed(pins.waterButton, lastWaterButtonTime)) {
+        Serial.println("🔧 Manual water button → MANUAL punishment");
+        logEvent(JEV_MANUAL_PUNISH, 0, MANUAL_REWARD_MS);
+        quietMgr.invalidatePlan();  // Blocks loop(): keep the marker timer from firing meanwhile
+        runWaterFor(MANUAL_REWARD_MS);
+    }
+
+    // Feeder button → manual reward ONLY (no manager)
+    if (isButtonPressed(pins.feederButton, lastFeederButtonTime)) {
+        Serial.println("🔧 Manual feeder button → MANUAL reward");
+        logEvent(JEV_MANUAL_REWARD, 0, MANUAL_REWARD_MS);
+        dispenseTreat(MANUAL_REWARD_MS);
+    }
+}
+
+// Manager decisions: rewards, marker timing, feeder pre-arm
+void TrainerLoop::updateRewards(uint32_t now) {
+    // A bark or level change since the feeder/marker was pre-armed: cancel it
+    if (feeder.isArmed() && feeder.armTag() != quietMgr.planEpoch()) feeder.disarm();
+    if (marker.isScheduled() && marker.scheduledTag() != quietMgr.planEpoch()) marker.cancel();
+
+    // Rewards (quiet success)
+    uint32_t planBefore = quietMgr.planEpoch();
+    bool training = scheduleGates & GATE_TRAIN;
+    bool rewardDue = false;
+    if (training) {
+        PerfScope ps(perfQuietTick);
+        rewardDue = quietMgr.tick(now);
+    }
+    if (rewardDue) {
+        uint32_t treatMs = quietMgr.consumePendingDispenseMs();
+        if (treatMs > 0 && !punishActive) {
+            Serial.printf("🏆 Manager reward: %lu ms\n", (unsigned long)treatMs);
+            logEvent(JEV_REWARD, quietMgr.currentLevel(), (uint16_t)min<uint32_t>(treatMs, 0xFFFF));
+            // Marker first: it is what the dog times the reward by
+            if (!marker.commit(planBefore) && rewardCue() >= 0) marker.fire((CuePattern)rewardCue());
+            if (feeder.isArmed() && feeder.armTag() == planBefore) feeder.commitArm();
+            else dispenseTreat(treatMs);
+        }
+    }
+    // Success without a reward, or reward skipped during punishment
+    if (feeder.isArmed() && feeder.armTag() != quietMgr.planEpoch()) feeder.disarm();
+    if (marker.isScheduled() && marker.scheduledTag() != quietMgr.planEpoch()) marker.cancel();
+
+    // Look ahead: time the marker to the rewarded deadline on a one-shot timer
+    if (training && !punishActive && !marker.isScheduled() && rewardCue() >= 0 && quietMgr.nextSlotRewards()) {
+        uint32_t deadline = quietMgr.nextDeadlineMs();
+        if ((int32_t)(deadline - now) <= MARKER_LOOKAHEAD_MS) {
+            marker.schedule(deadline, quietMgr.planEpoch(), (CuePattern)rewardCue());
+        }
+    }
+
+#if FEEDER_PREARM
+    // Look ahead: if the coming deadline rewards, start the feeder early
+    if (training && !punishActive && !feeder.isBusy() && !feeder.isArmed() && !feeder.isJammed() &&
+        quietMgr.nextSlotRewards()) {
+        uint32_t deadline = quietMgr.nextDeadlineMs();
+        if ((int32_t)(deadline - now) <= (int32_t)feeder.expectedLatencyMs()) {
+            feeder.arm(deadline, quietMgr.nextDispenseMs(), quietMgr.planEpoch());
+        }
+    }
+#endif
+
+    // Journal quiet successes and level changes (tick, qlevel, reset)
+    if (quietMgr.quietSuccessCount() != lastQuietSuccessCount) {
+        lastQuietSuccessCount = quietMgr.quietSuccessCount();
+        logEvent(JEV_QUIET_SUCCESS, quietMgr.currentLevel(), 0);
+        program.onSuccess(rewardDue);
+    }
+}
+
+// Training program: count barks, then the current phase's transitions
+void TrainerLoop::updateProgram(uint32_t now) {
+    if (!program.isLoaded()) return;
+    while (lastProgramBarkCount != quietMgr.barkCount()) {
+        lastProgramBarkCount++;
+        program.onBark();
+    }
+    if (quietMgr.currentLevel() != program.phaseIndex()) {
+        program.enter(quietMgr.currentLevel(), now);  // Moved by qlevel/reset/GATT
+        if (programPhaseCallback) programPhaseCallback(program.phaseIndex());
+    } else if (program.tick(now)) {
+        Serial.printf("📜 Program phase → %u\n", program.phaseIndex());
+        enterProgramPhase(now);
+    }
+}
+
+// Blink LED when system is idle (a playing cue may own it)
+void TrainerLoop::updateIdleLed(uint32_t now) {
+    if (!punishActive && !tones.drivesLed() && (now - lastLedBlinkTime >= LED_BLINK_MS)) {
+        ledState = !ledState;
+        trace.write(pins.led, ledState);
+        lastLedBlinkTime = now;
+    }
+}
+
+// Marker for the current phase: programs can rebind it or drop it (-1)
+int TrainerLoop::rewardCue() {
+    if (!program.isLoaded()) return CUE_MARKER;
+    uint8_t c = program.current().rewardCue;
+    return c < CUE_PATTERN_COUNT ? c : -1;
+}
+
+void TrainerLoop::startProgram(uint8_t phase, uint32_t now) {
+    lastProgramBarkCount = quietMgr.barkCount();
+    program.enter(phase, now);
+    enterProgramPhase(now);
+}
+
+// Manager follows the program's current phase
+void TrainerLoop::enterProgramPhase(uint32_t now) {
+    const TpPhase& p = program.current();
+    quietMgr.setLevel(program.phaseIndex(), now);
+    quietMgr.setCooldownMs(p.cooldownMs);
+    if (programPhaseCallback) programPhaseCallback(program.phaseIndex());
+    if (p.enterCue < CUE_PATTERN_COUNT) tones.play((CuePattern)p.enterCue);
+}
+
+void TrainerLoop::setGates(uint8_t gates) {
+    scheduleGates = gates;
+}
+
+uint8_t TrainerLoop::gates() {
+    return scheduleGates;
+}
+
+void TrainerLoop::setCorrectionLadder(bool on) {
+    correctionLadderOn = on;
+}
+
+bool TrainerLoop::correctionLadderEnabled() {
+    return correctionLadderOn;
+}
+
+bool TrainerLoop::isPunishing() {
+    return punishActive;
+}
+
+unsigned long TrainerLoop::micSelfNoiseCount() {
+    return micSelfNoise;
+}
@@ -0,0 +1,150 @@
+#ifndef TRAINER_LOOP_H
+#define TRAINER_LOOP_H
+
+#include <Arduino.h>
+#include <functional>
+#include "ActuatorTrace.h"
+#include "FeederController.h"
+#include "ToneEngine.h"
+#include "MarkerCue.h"
+#include "ClickDetector.h"
+#include "QuietReinforcementManager.h"
+#include "BLEBarkWindow.h"
+#include "CorrectionPolicy.h"
+#include "BarkFusion.h"
+#include "BarkRelay.h"
+#include "EventJournal.h"
+#include "TrainingSession.h"
+#include "TrainingProgram.h"
+#include "ScheduleTable.h"
+#include "PerfCounters.h"
+
+// Callback function types
+typedef std::function<void(uint8_t sources)> BarkCorrectedCallback;
+typedef std::function<void(uint8_t phase)> ProgramPhaseCallback;
+
+#define DEBOUNCE_MS             50
+#define LED_BLINK_MS            500
+#define MANUAL_PUNISH_MS        2000  // Manual actions do NOT affect the manager
+#define MANUAL_REWARD_MS        1200
+#define FEEDER_PREARM           1     // Start the feeder early and hold the treat until the quiet deadline
+#define MARKER_LOOKAHEAD_MS     1000  // Schedule the marker timer this close to a rewarded deadline
+#define MIC_TONE_TAIL_MS        200   // Mic reports this soon after our own buzzer are its echo
+
+// Pins the loop drives (water, vibration, LED) and reads (active-low buttons)
+struct TrainerPins {
+    int water;
+    int vibration;
+    int led;
+    int barkButton;
+    int waterButton;
+    int feederButton;
+};
+
+// The sketch's loop() between the inputs and the actuators: fused barks
+// through the bark window to the quiet manager and the correction ladder,
+// remote clicks and buttons to the manual actions, and the manager's
+// rewards to the marker and the (pre-armed) feeder, plus the punishment
+// runner and the idle LED. Radios, console, schedule and sessions stay in
+// the sketch; the gates and the ladder switch are set from there.
+//
+// Nothing here touches hardware except through the drivers it is given and
+// digitalRead() for the buttons, so tools/trace_replay runs this same code
+// on the host shims and traces the water, vibration and LED pins with the
+// feeder and buzzer.
+class TrainerLoop {
+public:
+    TrainerLoop(const TrainerPins& pins, ActuatorTrace& trace, FeederController& feeder, ToneEngine& tones,
+                MarkerCue& marker, ClickDetector& remote, QuietReinforcementManager& quietMgr,
+                BLEBarkWindow& barkWindow, CorrectionPolicy& correction, BarkFusion& fusion,
+                EventJournal& journal, TrainingSession& session, TrainingProgram& program);
+
+    // Setup functions (begin() once the manager and program are loaded)
+    void begin();
+    void setBarkCorrectedCallback(BarkCorrectedCallback onCorrected);  // Sensor bark corrected (not relayed)
+    void setProgramPhaseCallback(ProgramPhaseCallback onPhase);        // Program phase changed
+
+    // Inputs
+    void onMicBark();                                // Mic detector callback
+    bool handleBarkEvent(uint32_t now, uint8_t sources);
+    void handleManualBark(uint32_t now);
+
+    // Main loop functions, in loop() order
+    bool updateBarks(uint32_t now);   // True if a fused bark was accepted
+    void update(uint32_t now);        // Buttons, rewards, program, level, punishment
+    void updateIdleLed(uint32_t now);
+
+    // Actions
+    void dispenseTreat(uint32_t maxMs);
+    void startPunishment(uint32_t ms, uint8_t outputs);
+    void logEvent(JournalEventType type, uint8_t a, uint16_t b);
+    void startProgram(uint8_t phase, uint32_t now);  // After the manager took the program's levels
+    void enterProgramPhase(uint32_t now);
+    int rewardCue();                                 // Marker for the current phase (-1 = none)
+
+    // Control functions
+    void setGates(uint8_t gates);
+    uint8_t gates();
+    void setCorrectionLadder(bool on);
+    bool correctionLadderEnabled();
+    bool isPunishing();
+    unsigned long micSelfNoiseCount();
+
+private:
+    TrainerPins pins;
+    ActuatorTrace& trace;
+    FeederController& feeder;
+    ToneEngine& tones;
+    MarkerCue& marker;
+    ClickDetector& remote;
+    QuietReinforcementManager& quietMgr;
+    BLEBarkWindow& barkWindow;
+    CorrectionPolicy& correction;
+    BarkFusion& fusion;
+    EventJournal& journal;
+    TrainingSession& session;
+    TrainingProgram& program;
+
+    // Settings (from the sketch)
+    uint8_t scheduleGates;
+    bool correctionLadderOn;    // false = always the old fixed correction
+
+    // Non-blocking punishment runner
+    bool punishActive;
+    unsigned long punishEndMs;
+
+    // Button debounce and idle LED
+    unsigned long lastWaterButtonTime;
+    unsigned long lastFeederButtonTime;
+    unsigned long lastBarkButtonTime;
+    unsigned long lastLedBlinkTime;
+    bool ledState;
+
+    // Mic self-noise (buzzer still ringing in the mic's blocks)
+    uint32_t micMuteUntilMs;
+    unsigned long micSelfNoise;
+
+    // Journal/program bookkeeping
+    uint32_t lastQuietSuccessCount;
+    uint8_t lastLoggedLevel;
+    uint32_t lastProgramBarkCount;
+
+    BarkCorrectedCallback barkCorrectedCallback;
+    ProgramPhaseCallback programPhaseCallback;
+
+    // Hot-path cycle probes ("perf" command)
+    PerfProbe perfBarkWindow;
+    PerfProbe perfQuietTick;
+    PerfProbe perfQuietBark;
+    PerfProbe perfCorrection;
+
+    // Internal functions
+    bool isButtonPressed(int pin, unsigned long& lastPressTime);
+    void runWaterFor(uint32_t durationMs);
+    void updateButtons(uint32_t now);
+    void updateRewards(uint32_t now);
+    void updateProgram(uint32_t now);
+    void updatePunishment();
+};
+
+#endif
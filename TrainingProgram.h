@@ -0,0 +1,330 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Compiled training program: a multi-phase plan built on the host by
+// tools/plan_compiler from a readable plan file, uploaded as a small binary
+// image and run here without reflashing. No Arduino dependencies, so the
+// compiler shares this header for the format and validation.
+//
+// Image: TpHeader, then phaseCount fixed-size TpPhase records (CRC-32 over
+// the records). Each phase carries what LEVELS[] used to (quiet target,
+// dispense time, reward pattern), plus a cooldown, cue bindings and up to
+// TP_MAX_TRANSITIONS metric transitions. The interpreter only ever looks at
+// the current phase's transitions, so tick() costs the same for any program.
+
+#define TP_MAGIC0           'T'
+#define TP_MAGIC1           'P'
+#define TP_VERSION          1
+#define TP_MAX_PHASES       16
+#define TP_MAX_TRANSITIONS  3
+#define TP_MAX_PATTERN      16
+#define TP_NAME_LEN         16
+#define TP_NO_CUE           0xFF
+#define TP_UNUSED           0xFF   // Empty transition slot
+#define TP_FLAG_SHUFFLE     0x01
+
+#define TP_MIN_QUIET_MS     500
+#define TP_MAX_QUIET_MS     3600000UL
+#define TP_MAX_CUE          8      // Cue indices are checked against this; the sketch maps them
+
+enum TpMetric : uint8_t {
+  TP_M_SUCCESSES = 0,   // Quiet successes in this phase
+  TP_M_REWARDS,         // Rewarded successes in this phase
+  TP_M_BARKS,           // Barks the manager saw in this phase
+  TP_M_STREAK,          // Successes since the last bark
+  TP_M_MINUTES,         // Minutes in this phase
+  TP_M_COUNT
+};
+
+// Only ">= N" with N > 0: every metric restarts at 0 when a phase is
+// entered, so "< N" or ">= 0" would hold at once and re-enter the phase on
+// every tick
+enum TpCmp : uint8_t { TP_CMP_GE = 0, TP_CMP_COUNT };
+
+enum TpError : uint8_t {
+  TP_OK = 0,
+  TP_ERR_UPLOAD,        // Chunk out of order / outside the announced size
+  TP_ERR_SIZE,
+  TP_ERR_MAGIC,
+  TP_ERR_VERSION,
+  TP_ERR_PHASE_COUNT,
+  TP_ERR_CRC,
+  TP_ERR_START_PHASE,
+  TP_ERR_QUIET,
+  TP_ERR_PATTERN,
+  TP_ERR_CUE,
+  TP_ERR_TRANSITION,
+  TP_ERR_COUNT
+};
+
+struct __attribute__((packed)) TpHeader {
+  char     magic[2];      // "TP"
+  uint8_t  version;
+  uint8_t  phaseCount;
+  uint8_t  startPhase;
+  uint8_t  reserved;
+  uint16_t bodyLen;       // phaseCount * sizeof(TpPhase)
+  uint32_t crc32;         // Over the phase records
+  char     name[TP_NAME_LEN];  // Not necessarily terminated
+};
+
+struct __attribute__((packed)) TpTransition {
+  uint8_t  metric;        // TpMetric, TP_UNUSED = empty
+  uint8_t  cmp;           // TpCmp
+  uint8_t  target;        // Phase index
+  uint8_t  reserved;
+  uint32_t threshold;
+};
+
+struct __attribute__((packed)) TpPhase {
+  uint32_t quietMs;
+  uint16_t dispenseMs;
+  uint16_t cooldownMs;
+  uint16_t patternBits;   // Bit i = slot i rewards
+  uint8_t  patternLen;    // 1..TP_MAX_PATTERN
+  uint8_t  flags;         // TP_FLAG_*
+  uint8_t  rewardCue;     // Cue on a rewarded success, TP_NO_CUE = none
+  uint8_t  enterCue;      // Cue on entering the phase
+  uint16_t reserved;
+  TpTransition transitions[TP_MAX_TRANSITIONS];
+};
+
+#define TP_MAX_IMAGE (sizeof(TpHeader) + TP_MAX_PHASES * sizeof(TpPhase))
+
+// Binary upload chunks (GATT program characteristic): op byte, then
+//   TP_OP_BEGIN  u16 total length
+//   TP_OP_DATA   u16 offset, bytes
+//   TP_OP_COMMIT (validate and load)
+//   TP_OP_CLEAR  (drop the program, back to the built-in levels)
+enum TpUploadOp : uint8_t { TP_OP_BEGIN = 1, TP_OP_DATA, TP_OP_COMMIT, TP_OP_CLEAR };
+
+class TrainingProgram {
+public:
+  static uint32_t crc32(const uint8_t* data, size_t len) {
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) {
+      c ^= data[i];
+      for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0xEDB88320u & (0u - (c & 1)));
+    }
+    return ~c;
+  }
+
+  // Full check of an image; phaseOut gets the offending phase on a phase error
+  static TpError validate(const uint8_t* data, size_t len, uint8_t* phaseOut = nullptr) {
+    if (len < sizeof(TpHeader) || len > TP_MAX_IMAGE) return TP_ERR_SIZE;
+    TpHeader h;
+    memcpy(&h, data, sizeof(h));
+    if (h.magic[0] != TP_MAGIC0 || h.magic[1] != TP_MAGIC1) return TP_ERR_MAGIC;
+    if (h.version != TP_VERSION) return TP_ERR_VERSION;
+    if (h.phaseCount == 0 || h.phaseCount > TP_MAX_PHASES) return TP_ERR_PHASE_COUNT;
+    if (h.bodyLen != h.phaseCount * sizeof(TpPhase) || len != sizeof(TpHeader) + h.bodyLen) {
+      return TP_ERR_SIZE;
+    }
+    if (crc32(data + sizeof(TpHeader), h.bodyLen) != h.crc32) return TP_ERR_CRC;
+    if (h.startPhase >= h.phaseCount) return TP_ERR_START_PHASE;
+
+    for (uint8_t i = 0; i < h.phaseCount; i++) {
+      TpPhase p;
+      memcpy(&p, data + sizeof(TpHeader) + i * sizeof(TpPhase), sizeof(p));
+      if (phaseOut) *phaseOut = i;
+      if (p.quietMs < TP_MIN_QUIET_MS || p.quietMs > TP_MAX_QUIET_MS) return TP_ERR_QUIET;
+      if (p.patternLen == 0 || p.patternLen > TP_MAX_PATTERN) return TP_ERR_PATTERN;
+      if ((p.rewardCue != TP_NO_CUE && p.rewardCue >= TP_MAX_CUE) ||
+          (p.enterCue != TP_NO_CUE && p.enterCue >= TP_MAX_CUE)) {
+        return TP_ERR_CUE;
+      }
+      for (uint8_t t = 0; t < TP_MAX_TRANSITIONS; t++) {
+        const TpTransition& tr = p.transitions[t];
+        if (tr.metric == TP_UNUSED) continue;
+        if (tr.metric >= TP_M_COUNT || tr.cmp >= TP_CMP_COUNT || tr.threshold == 0 ||
+            tr.target >= h.phaseCount) {
+          return TP_ERR_TRANSITION;
+        }
+      }
+    }
+    return TP_OK;
+  }
+
+  // Copies a validated image; the previous program stays on failure
+  TpError load(const uint8_t* data, size_t len, uint8_t* phaseOut = nullptr) {
+    TpError e = validate(data, len, phaseOut);
+    if (e != TP_OK) return e;
+    memcpy(_image, data, len);
+    _len = len;
+    memcpy(&_header, data, sizeof(_header));
+    _phases = (const TpPhase*)(_image + sizeof(TpHeader));
+    _current = _header.startPhase;
+    return TP_OK;
+  }
+
+  void unload() {
+    _len = 0;
+    _phases = nullptr;
+  }
+
+  // Enter a phase (boot resume, transition or console); counters restart
+  void enter(uint8_t phase, uint32_t nowMs) {
+    if (!isLoaded()) return;
+    _current = phase < _header.phaseCount ? phase : _header.startPhase;
+    _enteredMs = nowMs;
+    _successes = _rewards = _barks = _streak = 0;
+    _transitions++;
+  }
+
+  void onBark() {
+    _barks++;
+    _streak = 0;
+  }
+
+  void onSuccess(bool rewarded) {
+    _successes++;
+    _streak++;
+    if (rewarded) _rewards++;
+  }
+
+  // At most TP_MAX_TRANSITIONS compares; first match wins. Returns true
+  // when the phase changed (counters already restarted).
+  bool tick(uint32_t nowMs) {
+    if (!isLoaded()) return false;
+    const TpPhase& p = _phases[_current];
+    for (uint8_t t = 0; t < TP_MAX_TRANSITIONS; t++) {
+      const TpTransition& tr = p.transitions[t];
+      if (tr.metric == TP_UNUSED) continue;
+      uint32_t v = metric((TpMetric)tr.metric, nowMs);
+      if (v >= tr.threshold) {
+        enter(tr.target, nowMs);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  uint32_t metric(TpMetric m, uint32_t nowMs) const {
+    switch (m) {
+      case TP_M_SUCCESSES: return _successes;
+      case TP_M_REWARDS:   return _rewards;
+      case TP_M_BARKS:     return _barks;
+      case TP_M_STREAK:    return _streak;
+      case TP_M_MINUTES:   return (nowMs - _enteredMs) / 60000UL;
+      default:             return 0;
+    }
+  }
+
+  bool isLoaded() const { return _phases != nullptr; }
+  uint8_t phaseIndex() const { return _current; }
+  uint8_t phaseCount() const { return isLoaded() ? _header.phaseCount : 0; }
+  const TpPhase& phase(uint8_t i) const { return _phases[i < _header.phaseCount ? i : 0]; }
+  const TpPhase& current() const { return _phases[_current]; }
+  const uint8_t* image() const { return _image; }
+  size_t imageLen() const { return _len; }
+  uint32_t transitions() const { return _transitions; }
+
+  // Program name, always terminated
+  void name(char out[TP_NAME_LEN + 1]) const {
+    memcpy(out, _header.name, TP_NAME_LEN);
+    out[TP_NAME_LEN] = 0;
+  }
+
+  static bool patternSlot(const TpPhase& p, uint8_t i) { return (p.patternBits >> i) & 1; }
+
+  static const char* metricName(TpMetric m) {
+    static const char* names[TP_M_COUNT] = { "successes", "rewards", "barks", "streak", "minutes" };
+    return m < TP_M_COUNT ? names[m] : "?";
+  }
+
+  static const char* errorName(TpError e) {
+    switch (e) {
+      case TP_OK:              return "ok";
+      case TP_ERR_UPLOAD:      return "bad upload chunk";
+      case TP_ERR_SIZE:        return "bad size";
+      case TP_ERR_MAGIC:       return "bad magic";
+      case TP_ERR_VERSION:     return "unsupported version";
+      case TP_ERR_PHASE_COUNT: return "bad phase count";
+      case TP_ERR_CRC:         return "CRC mismatch";
+      case TP_ERR_START_PHASE: return "bad start phase";
+      case TP_ERR_QUIET:       return "quiet time out of range";
+      case TP_ERR_PATTERN:     return "bad pattern";
+      case TP_ERR_CUE:         return "unknown cue";
+      case TP_ERR_TRANSITION:  return "bad transition";
+      default:                 return "?";
+    }
+  }
+
+private:
+  uint8_t  _image[TP_MAX_IMAGE]{};
+  size_t   _len{0};
+  TpHeader _header{};
+  const TpPhase* _phases{nullptr};
+
+  uint8_t  _current{0};
+  uint32_t _enteredMs{0};
+  uint32_t _successes{0};
+  uint32_t _rewards{0};
+  uint32_t _barks{0};
+  uint32_t _streak{0};
+  uint32_t _transitions{0};
+};
+
+// Stages an image arriving in chunks (serial hex lines or GATT writes).
+// Chunks may repeat or arrive out of order; commit() checks that every byte
+// was written before handing the image to TrainingProgram::load().
+class TrainingProgramLoader {
+public:
+  void begin(size_t totalLen) {
+    _expected = totalLen <= TP_MAX_IMAGE ? totalLen : 0;
+    _written = 0;
+    memset(_have, 0, sizeof(_have));
+    _error = _expected ? TP_OK : TP_ERR_SIZE;
+  }
+
+  bool data(size_t offset, const uint8_t* bytes, size_t len) {
+    if (_expected == 0 || offset + len > _expected) {
+      _error = TP_ERR_UPLOAD;
+      return false;
+    }
+    memcpy(_stage + offset, bytes, len);
+    for (size_t i = offset; i < offset + len; i++) {
+      uint8_t bit = 1 << (i & 7);
+      if (!(_have[i >> 3] & bit)) {
+        _have[i >> 3] |= bit;
+        _written++;
+      }
+    }
+    return true;
+  }
+
+  TpError commit(TrainingProgram& program, uint8_t* phaseOut = nullptr) {
+    if (_expected == 0 || _written != _expected) return _error = TP_ERR_UPLOAD;
+    _error = program.load(_stage, _expected, phaseOut);
+    if (_error == TP_OK) _expected = 0;
+    return _error;
+  }
+
+  // One binary chunk; returns the op for the caller to act on COMMIT/CLEAR
+  TpUploadOp chunk(const uint8_t* d, size_t len) {
+    if (len == 0) return (TpUploadOp)0;
+    uint8_t op = d[0];
+    if (op == TP_OP_BEGIN && len == 3) {
+      begin(d[1] | (d[2] << 8));
+    } else if (op == TP_OP_DATA && len > 3) {
+      data(d[1] | (d[2] << 8), d + 3, len - 3);
+    } else if (op != TP_OP_COMMIT && op != TP_OP_CLEAR) {
+      _error = TP_ERR_UPLOAD;
+      return (TpUploadOp)0;
+    }
+    return (TpUploadOp)op;
+  }
+
+  size_t expected() const { return _expected; }
+  size_t written() const { return _written; }
+  TpError lastError() const { return _error; }
+
+private:
+  uint8_t _stage[TP_MAX_IMAGE]{};
+  uint8_t _have[(TP_MAX_IMAGE + 7) / 8]{};
+  size_t  _expected{0};
+  size_t  _written{0};
+  TpError _error{TP_OK};
+};
@@ -0,0 +1,174 @@
+#pragma once
+#include <Arduino.h>
+#include "EventJournal.h"
+
+#define SESSION_MAX_LEVELS  16    // Time-at-level slots; higher levels share the last one
+
+// What started or ended a session
+enum SessionCause : uint8_t {
+  SESS_CONSOLE = 1,
+  SESS_REMOTE,         // Quad click
+  SESS_SCHEDULE,
+  SESS_MAX_DURATION,   // End only
+};
+
+// Stat ids in the JEV_SESSION_STAT records that follow a JEV_SESSION_END
+enum SessionStat : uint8_t {
+  SSTAT_DURATION_S = 0,
+  SSTAT_BARKS,
+  SSTAT_REWARDS,
+  SSTAT_PUNISHMENTS,
+  SSTAT_SUCCESSES,
+  SSTAT_LONGEST_QUIET_S,
+  SSTAT_END_LEVEL,
+  SSTAT_LEVEL_S = 16,  // + level: seconds spent at that level (non-zero only)
+};
+
+// Packed end-of-session summary (what "session" prints and the journal carries)
+struct __attribute__((packed)) SessionSummary {
+  uint16_t id;
+  uint8_t  startCause;
+  uint8_t  endCause;            // 0 while the session runs
+  uint32_t durationMs;
+  uint16_t barks;               // Every bark, window-suppressed ones included
+  uint16_t rewards;             // Manager and manual
+  uint16_t punishments;         // Corrections and manual
+  uint16_t successes;           // Quiet periods completed
+  uint32_t longestQuietMs;
+  uint8_t  startLevel;
+  uint8_t  endLevel;
+  uint16_t secondsAtLevel[SESSION_MAX_LEVELS];
+};
+
+// One training session: start/stop from any trigger, aggregates kept as the
+// events arrive so the summary costs nothing to produce at the end. Feed it
+// the same events the journal gets, plus every bark; outside a session they
+// are ignored.
+class TrainingSession {
+public:
+  // maxMs = 0: no limit
+  bool start(uint16_t id, SessionCause cause, uint8_t level, uint32_t nowMs, uint32_t maxMs) {
+    if (_active) return false;
+    memset(&_s, 0, sizeof(_s));
+    memset(_msAtLevel, 0, sizeof(_msAtLevel));
+    _s.id = id;
+    _s.startCause = cause;
+    _s.startLevel = _s.endLevel = level;
+    _startMs = _quietSinceMs = _levelSinceMs = nowMs;
+    _maxMs = maxMs;
+    _active = true;
+    return true;
+  }
+
+  // Closes the running totals into last()
+  bool stop(SessionCause cause, uint32_t nowMs) {
+    if (!_active) return false;
+    _s.endCause = cause;
+    _close(nowMs, _s);
+    _last = _s;
+    _hasLast = true;
+    _active = false;
+    return true;
+  }
+
+  bool expired(uint32_t nowMs) const {
+    return _active && _maxMs > 0 && nowMs - _startMs >= _maxMs;
+  }
+
+  // Every detected bark. Barks the bark window suppresses get no JEV_BARK
+  // record, so barks are counted here rather than from the journal events.
+  void onBark(uint32_t nowMs) {
+    if (!_active) return;
+    _s.barks = _plus1(_s.barks);
+    if (nowMs - _quietSinceMs > _s.longestQuietMs) _s.longestQuietMs = nowMs - _quietSinceMs;
+    _quietSinceMs = nowMs;
+  }
+
+  // Journal event types; O(1) each
+  void onEvent(uint8_t type, uint8_t a, uint32_t nowMs) {
+    if (!_active) return;
+    switch (type) {
+      case JEV_PUNISH:
+      case JEV_MANUAL_PUNISH:
+        _s.punishments = _plus1(_s.punishments);
+        break;
+      case JEV_REWARD:
+      case JEV_MANUAL_REWARD:
+        _s.rewards = _plus1(_s.rewards);
+        break;
+      case JEV_QUIET_SUCCESS:
+        _s.successes = _plus1(_s.successes);
+        break;
+      case JEV_LEVEL:
+        _msAtLevel[_slot(_s.endLevel)] += nowMs - _levelSinceMs;
+        _levelSinceMs = nowMs;
+        _s.endLevel = a;
+        break;
+    }
+  }
+
+  // Running totals of the active session (time at the current level and the
+  // current quiet stretch included)
+  SessionSummary snapshot(uint32_t nowMs) const {
+    SessionSummary s = _s;
+    if (_active) _close(nowMs, s);
+    return s;
+  }
+
+  // Calls emit(statId, value) for each journal stat record of a summary
+  template <typename F>
+  static void forEachStat(const SessionSummary& s, F emit) {
+    emit(SSTAT_DURATION_S, _cap(s.durationMs / 1000));
+    emit(SSTAT_BARKS, s.barks);
+    emit(SSTAT_REWARDS, s.rewards);
+    emit(SSTAT_PUNISHMENTS, s.punishments);
+    emit(SSTAT_SUCCESSES, s.successes);
+    emit(SSTAT_LONGEST_QUIET_S, _cap(s.longestQuietMs / 1000));
+    emit(SSTAT_END_LEVEL, s.endLevel);
+    for (uint8_t i = 0; i < SESSION_MAX_LEVELS; i++) {
+      if (s.secondsAtLevel[i]) emit(SSTAT_LEVEL_S + i, s.secondsAtLevel[i]);
+    }
+  }
+
+  bool isActive() const { return _active; }
+  bool hasLast() const { return _hasLast; }
+  const SessionSummary& last() const { return _last; }
+  uint16_t id() const { return _s.id; }
+  uint32_t elapsedMs(uint32_t nowMs) const { return _active ? nowMs - _startMs : 0; }
+  uint32_t maxMs() const { return _maxMs; }
+
+  static const char* causeName(uint8_t c) {
+    switch (c) {
+      case SESS_CONSOLE:      return "console";
+      case SESS_REMOTE:       return "remote";
+      case SESS_SCHEDULE:     return "schedule";
+      case SESS_MAX_DURATION: return "max-duration";
+      default:                return "-";
+    }
+  }
+
+private:
+  void _close(uint32_t nowMs, SessionSummary& s) const {
+    s.durationMs = nowMs - _startMs;
+    if (nowMs - _quietSinceMs > s.longestQuietMs) s.longestQuietMs = nowMs - _quietSinceMs;
+    for (uint8_t i = 0; i < SESSION_MAX_LEVELS; i++) {
+      uint32_t ms = _msAtLevel[i];
+      if (i == _slot(s.endLevel)) ms += nowMs - _levelSinceMs;
+      s.secondsAtLevel[i] = _cap(ms / 1000);
+    }
+  }
+
+  static uint8_t _slot(uint8_t level) { return level < SESSION_MAX_LEVELS ? level : SESSION_MAX_LEVELS - 1; }
+  static uint16_t _cap(uint32_t v) { return v > 0xFFFF ? 0xFFFF : (uint16_t)v; }
+  static uint16_t _plus1(uint16_t c) { return c < 0xFFFF ? c + 1 : c; }  // Packed fields: no references
+
+  SessionSummary _s{};
+  SessionSummary _last{};
+  bool     _active{false};
+  bool     _hasLast{false};
+  uint32_t _startMs{0};
+  uint32_t _maxMs{0};
+  uint32_t _quietSinceMs{0};
+  uint32_t _levelSinceMs{0};
+  uint32_t _msAtLevel[SESSION_MAX_LEVELS]{};
+};
@@ -0,0 +1,84 @@
+#pragma once
+#include <Arduino.h>
+#include <sys/time.h>
+#include <time.h>
+
+#define WALLCLOCK_MIN_VALID  1700000000UL   // Anything earlier is the RTC's power-on default
+
+enum ClockSource : uint8_t {
+  CLOCK_NONE = 0,
+  CLOCK_SERIAL,      // "time set" from the host
+  CLOCK_SNTP,
+  CLOCK_RTC,         // Kept by the RTC across deep sleep / reset since an earlier sync
+};
+
+// Local wall time on top of the ESP32 system clock. The RTC keeps counting
+// through deep sleep and software resets (not power loss), so one sync from
+// the serial host or SNTP lasts until the next power cycle; RTC drift is a
+// few seconds a day. Only a fixed UTC offset is kept (no DST rules).
+class WallClock {
+public:
+  // Restore after a reset: the RTC still has the time if it was ever set
+  void begin(int16_t tzOffsetMin, ClockSource lastSource, uint32_t lastSyncUnix) {
+    _tzOffsetMin = tzOffsetMin;
+    _lastSyncUnix = lastSyncUnix;
+    _source = isValid() ? (lastSource ? lastSource : CLOCK_RTC) : CLOCK_NONE;
+  }
+
+  void set(uint32_t unixSec, ClockSource source) {
+    struct timeval tv = { (time_t)unixSec, 0 };
+    settimeofday(&tv, nullptr);
+    noteSync(source);
+  }
+
+  // The clock was set elsewhere (SNTP callback)
+  void noteSync(ClockSource source) {
+    _source = source;
+    _lastSyncUnix = now();
+  }
+
+  void setTzOffsetMin(int16_t minutes) { _tzOffsetMin = minutes; }
+  int16_t tzOffsetMin() const { return _tzOffsetMin; }
+
+  uint32_t now() const { return (uint32_t)time(nullptr); }
+  bool isValid() const { return now() >= WALLCLOCK_MIN_VALID; }
+  ClockSource source() const { return _source; }
+  uint32_t lastSyncUnix() const { return _lastSyncUnix; }
+  uint32_t syncAgeSec() const { return _lastSyncUnix ? now() - _lastSyncUnix : 0; }
+
+  // Local day of week (0 = Sunday) and minute of the day; false until set
+  bool local(uint8_t& weekday, uint16_t& minuteOfDay) const {
+    if (!isValid()) return false;
+    int64_t t = (int64_t)now() + _tzOffsetMin * 60;
+    uint32_t days = (uint32_t)(t / 86400);
+    weekday = (uint8_t)((days + 4) % 7);  // 1970-01-01 was a Thursday
+    minuteOfDay = (uint16_t)((t % 86400) / 60);
+    return true;
+  }
+
+  // "YYYY-MM-DD HH:MM:SS" local, or "unset"
+  void format(char out[20]) const {
+    if (!isValid()) {
+      strcpy(out, "unset");
+      return;
+    }
+    time_t t = (time_t)now() + _tzOffsetMin * 60;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    strftime(out, 20, "%Y-%m-%d %H:%M:%S", &tm);
+  }
+
+  static const char* sourceName(uint8_t s) {
+    switch (s) {
+      case CLOCK_SERIAL: return "serial";
+      case CLOCK_SNTP:   return "sntp";
+      case CLOCK_RTC:    return "rtc";
+      default:           return "none";
+    }
+  }
+
+private:
+  int16_t     _tzOffsetMin{0};
+  ClockSource _source{CLOCK_NONE};
+  uint32_t    _lastSyncUnix{0};
+};
@@ -0,0 +1,84 @@
+// Replay test for BarkAuth across restarts: a signed advert accepted before
+// a reboot, deep sleep or power cut must not be accepted again after it.
+//
+// Build:  g++ -std=c++17 -O2 -Ihost -I.. auth_replay.cpp -o auth_replay
+// Usage:  ./auth_replay
+//
+// A restart is a new BarkAuth on the same host Preferences store. Deep sleep
+// and resets keep the sketch's RTC block; a power cut clears it, leaving the
+// NVS copy that persistSeqs() writes at most every BARK_AUTH_SEQ_SAVE_MS.
+// Each check prints ok/FAIL; the exit status is 1 on any failure.
+#include <memory>
+
+#include "BarkAuth.h"
+
+static const uint8_t KEY[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                                0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+static const uint16_t SENSOR = 7;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("%-4s %s\n", ok ? "ok" : "FAIL", what);
+  if (!ok) failures++;
+}
+
+static BarkAuthResult send(BarkAuth& auth, uint32_t seq) {
+  BarkAdvPayload p;
+  BarkAuth::sign(KEY, SENSOR, seq, 1760000000 + seq, p);
+  uint16_t id;
+  uint32_t s;
+  return auth.verify((const uint8_t*)&p, sizeof(p), id, s);
+}
+
+static std::unique_ptr<BarkAuth> boot(BarkAuthRtc& rtc) {
+  std::unique_ptr<BarkAuth> auth(new BarkAuth("replayTest"));
+  auth->begin(&rtc);
+  return auth;
+}
+
+int main() {
+  Serial.quiet = true;
+  BarkAuthRtc rtc = {};  // Power-on contents
+  uint32_t now = 1000;
+
+  auto auth = boot(rtc);
+  auth->pair(SENSOR, KEY);
+  check(send(*auth, 10) == BARK_AUTH_OK, "fresh advert accepted");
+  check(send(*auth, 10) == BARK_AUTH_REPLAY, "same advert again is a repeat");
+  auth->persistSeqs(now);  // Within BARK_AUTH_SEQ_SAVE_MS of boot: not written yet
+
+  // Deep sleep / reset: RTC kept, NVS has no sequence yet
+  auth = boot(rtc);
+  check(send(*auth, 10) == BARK_AUTH_REPLAY, "deep sleep: recorded advert rejected (RTC)");
+  check(send(*auth, 11) == BARK_AUTH_OK, "deep sleep: next advert accepted");
+
+  now += BARK_AUTH_SEQ_SAVE_MS;
+  auth->persistSeqs(now);
+
+  // Power cut: RTC lost, NVS copy from the last save
+  memset(&rtc, 0, sizeof(rtc));
+  auth = boot(rtc);
+  check(send(*auth, 11) == BARK_AUTH_REPLAY, "power cut: recorded advert rejected (NVS)");
+  check(send(*auth, 5) == BARK_AUTH_REPLAY, "power cut: older advert rejected");
+  check(send(*auth, 12) == BARK_AUTH_OK, "power cut: next advert accepted");
+
+  // The save before deep sleep is forced
+  auth->persistSeqs(now + 1, true);
+  memset(&rtc, 0, sizeof(rtc));
+  auth = boot(rtc);
+  check(send(*auth, 12) == BARK_AUTH_REPLAY, "forced save: recorded advert rejected");
+
+  // RTC ahead of NVS wins
+  check(send(*auth, 20) == BARK_AUTH_OK, "advert 20 accepted");
+  auth = boot(rtc);
+  check(send(*auth, 20) == BARK_AUTH_REPLAY, "RTC newer than NVS: advert 20 rejected");
+
+  // Re-pairing starts the sensor over (new key, new sequence)
+  auth->pair(SENSOR, KEY);
+  auth = boot(rtc);
+  check(send(*auth, 1) == BARK_AUTH_OK, "re-paired sensor starts over");
+
+  printf(failures ? "%d FAILED\n" : "all passed\n", failures);
+  return failures ? 1 : 0;
+}
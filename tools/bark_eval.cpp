@@ -0,0 +1,140 @@
+// Host evaluation of the bark front end + classifier over a labelled WAV set.
+//
+// Build:  g++ -std=c++17 -O2 -I.. bark_eval.cpp -o bark_eval
+// Usage:  ./bark_eval labels.txt [--classifier|--no-classifier]
+//
+// The classifier defaults to the device default (off while
+// BARK_CLS_MODEL_TRAINED is 0); --classifier evaluates the model in
+// BarkClassifier.h regardless.
+//
+// labels.txt has one "<label> <path.wav>" per line, label 1 = contains a bark,
+// 0 = no bark (door slam, TV, ...). WAVs must be 16 kHz mono 16-bit PCM.
+// A file counts as detected if the detector fires at least once.
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "BarkDsp.h"
+
+static const int BLOCK = 256;  // Same as MIC_BLOCK_SAMPLES on the device
+
+static bool readWav(const std::string& path, std::vector<int16_t>& pcm) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f) return false;
+
+  char riff[12];
+  if (!f.read(riff, 12) || memcmp(riff, "RIFF", 4) || memcmp(riff + 8, "WAVE", 4)) return false;
+
+  bool fmtOk = false;
+  char hdr[8];
+  while (f.read(hdr, 8)) {
+    uint32_t size;
+    memcpy(&size, hdr + 4, 4);
+    if (!memcmp(hdr, "fmt ", 4)) {
+      std::vector<char> fmt(size);
+      if (!f.read(fmt.data(), size) || size < 16) return false;
+      uint16_t format, channels, bits;
+      uint32_t rate;
+      memcpy(&format, &fmt[0], 2);
+      memcpy(&channels, &fmt[2], 2);
+      memcpy(&rate, &fmt[4], 4);
+      memcpy(&bits, &fmt[14], 2);
+      fmtOk = format == 1 && channels == 1 && rate == 16000 && bits == 16;
+      if (!fmtOk) return false;
+    } else if (!memcmp(hdr, "data", 4)) {
+      if (!fmtOk) return false;
+      pcm.resize(size / 2);
+      f.read((char*)pcm.data(), pcm.size() * 2);
+      pcm.resize(f.gcount() / 2);
+      return true;
+    } else {
+      f.seekg(size + (size & 1), std::ios::cur);
+    }
+  }
+  return false;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s labels.txt [--classifier|--no-classifier]\n", argv[0]);
+    return 2;
+  }
+  bool useClassifier = BarkDspConfig().useClassifier;
+  if (argc > 2 && !strcmp(argv[2], "--classifier")) useClassifier = true;
+  if (argc > 2 && !strcmp(argv[2], "--no-classifier")) useClassifier = false;
+
+  std::ifstream list(argv[1]);
+  if (!list) {
+    fprintf(stderr, "cannot open %s\n", argv[1]);
+    return 2;
+  }
+
+  int tp = 0, fp = 0, tn = 0, fn = 0, skipped = 0;
+  double blockNs = 0, decisionNs = 0, maxDecisionNs = 0;
+  long blocks = 0, decisions = 0;
+
+  std::string line;
+  while (std::getline(list, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream ls(line);
+    int label;
+    std::string path;
+    if (!(ls >> label >> path)) continue;
+
+    std::vector<int16_t> pcm;
+    if (!readWav(path, pcm)) {
+      fprintf(stderr, "skip %s (not 16 kHz mono 16-bit WAV)\n", path.c_str());
+      skipped++;
+      continue;
+    }
+
+    BarkDspConfig cfg;
+    cfg.useClassifier = useClassifier;
+    BarkDsp dsp(cfg);
+
+    int fired = 0;
+    for (size_t off = 0; off + BLOCK <= pcm.size(); off += BLOCK) {
+      uint32_t runsBefore = dsp.classifierRuns();
+      auto t0 = std::chrono::steady_clock::now();
+      if (dsp.processBlock(&pcm[off], BLOCK)) fired++;
+      double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+
+      blockNs += ns;
+      blocks++;
+      if (dsp.classifierRuns() != runsBefore) {
+        decisionNs += ns;
+        decisions++;
+        if (ns > maxDecisionNs) maxDecisionNs = ns;
+      }
+    }
+
+    bool detected = fired > 0;
+    if (label && detected) tp++;
+    else if (label) fn++;
+    else if (detected) fp++;
+    else tn++;
+    printf("%d %s fired=%d score=%d\n", label, path.c_str(), fired, (int)dsp.classifier().lastScore());
+  }
+
+  int total = tp + fp + tn + fn;
+  printf("\nfiles=%d skipped=%d classifier=%s\n", total, skipped, useClassifier ? "on" : "off");
+  printf("            detected  missed\n");
+  printf("bark        %8d %7d\n", tp, fn);
+  printf("not bark    %8d %7d\n", fp, tn);
+  if (total) {
+    printf("accuracy %.1f%%  precision %.1f%%  recall %.1f%%\n",
+           100.0 * (tp + tn) / total,
+           tp + fp ? 100.0 * tp / (tp + fp) : 0.0,
+           tp + fn ? 100.0 * tp / (tp + fn) : 0.0);
+  }
+  if (blocks) printf("block avg %.0f ns (host)\n", blockNs / blocks);
+  if (decisions) {
+    printf("classifier decisions %ld, avg %.0f ns, max %.0f ns (host, incl. block DSP)\n",
+           decisions, decisionNs / decisions, maxDecisionNs);
+  }
+  return 0;
+}
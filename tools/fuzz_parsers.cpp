@@ -0,0 +1,252 @@
+// Fuzz target for the code that parses untrusted input: serial console
+// lines (InputParsers.h), BLE advertisement payloads (BarkAuth.h and the
+// legacy match) and RF remote frames (ClickDetector).
+//
+// libFuzzer (clang):
+//   clang++ -std=c++17 -g -O1 -fsanitize=fuzzer,address,undefined -DFUZZ_WITH_LIBFUZZER
+//           -Ihost -I.. fuzz_parsers.cpp ../ClickDetector.cpp -o fuzz_parsers
+//   ./fuzz_parsers -max_len=1024 fuzz_corpus
+// Without clang the same target builds with its own runner and mutator:
+//   g++ -std=c++17 -g -O1 -fsanitize=address,undefined -fno-sanitize-recover=all
+//       -Ihost -I.. fuzz_parsers.cpp ../ClickDetector.cpp -o fuzz_parsers
+//   ./fuzz_parsers [-runs=N] [-seed=S] fuzz_corpus   (replays the corpus, then mutates)
+//   ./fuzz_parsers --seeds fuzz_corpus               (rewrites the seed corpus)
+//
+// The first input byte picks the parser (mod 3); the rest is its input:
+//   0 serial  raw console bytes; each line goes through every argument parser
+//   1 advert  [name length] name, then manufacturer data
+//   2 RF      frames of [ms since last / 4] [item count] count × 4-byte rmt_item32_t
+// Besides crashes and sanitizer reports, results are checked against each
+// parser's contract (ranges, lengths) and violations abort.
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "InputParsers.h"
+#include "BarkAuth.h"
+#include "ClickDetector.h"
+
+#define ADV_NAME "PING-ESP32"  // Same as Draft.ino
+#define ADV_TAG  "PING1234"
+
+static const uint8_t PAIRED_KEY[16] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+                                       0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+static const uint16_t PAIRED_SENSOR = 7;
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    if (!(cond)) {                                                    \
+      fprintf(stderr, "contract violated: %s (%s:%d)\n", #cond, __FILE__, __LINE__); \
+      abort();                                                        \
+    }                                                                 \
+  } while (0)
+
+static void fuzzLine(const char* line) {
+  size_t len = strlen(line);
+  for (size_t pos = 0; pos <= len; pos++) {
+    int64_t v;
+    if (parseDecimal(line + pos, -CONSOLE_INT_LIMIT, CONSOLE_INT_LIMIT, v))
+      CHECK(v >= -CONSOLE_INT_LIMIT && v <= CONSOLE_INT_LIMIT);
+    if (parseDecimal(line + pos, 0, UINT32_MAX, v)) CHECK(v >= 0 && v <= UINT32_MAX);
+  }
+  uint8_t bytes[64];
+  int n = parseHexBytes(line, bytes, sizeof(bytes));
+  CHECK(n >= -1 && n <= (int)sizeof(bytes));
+  uint16_t minute;
+  if (parseClockTime(line, minute)) CHECK(minute < 24 * 60);
+}
+
+static void fuzzSerial(const uint8_t* data, size_t size) {
+  LineReader<64> reader;  // SERIAL_LINE_MAX
+  for (size_t i = 0; i < size; i++) {
+    if (reader.push((char)data[i]) == LINE_READY) {
+      CHECK(strlen(reader.line()) <= 64);
+      fuzzLine(reader.line());
+    }
+  }
+}
+
+static void fuzzAdvert(const uint8_t* data, size_t size) {
+  if (size < 1) return;
+  size_t nameLen = std::min<size_t>(data[0], size - 1);
+  std::string name((const char*)data + 1, nameLen);
+  std::string mfg((const char*)data + 1 + nameLen, size - 1 - nameLen);
+
+  BarkAuth auth("fuzzKeys");  // Fresh replay state for every input
+  auth.pair(PAIRED_SENSOR, PAIRED_KEY);
+  uint16_t sensorId = 0;
+  uint32_t seq = 0;
+  BarkAuthResult r = auth.verify((const uint8_t*)mfg.data(), mfg.size(), sensorId, seq);
+  CHECK(r < BARK_AUTH_RESULT_COUNT);
+  if (r == BARK_AUTH_OK) CHECK(sensorId == PAIRED_SENSOR);
+  isBarkAdvertisement(name, mfg, ADV_NAME, ADV_TAG);
+}
+
+static void fuzzRf(const uint8_t* data, size_t size) {
+  hostSetMillis(0);
+  hostRmtFrames().clear();
+  int clicks = 0;
+  ClickDetector det;
+  det.setCallbacks([&] { clicks++; }, [&] { clicks++; }, [&] { clicks++; });
+  det.setQuadClickCallback([&] { clicks++; });
+  det.setMinQuality(data[0] % 2 ? 40 : 0);
+  det.begin();
+
+  size_t i = 1;
+  while (i + 2 <= size) {
+    hostAdvanceMs(data[i] * 4);
+    size_t n = std::min<size_t>(data[i + 1], (size - i - 2) / sizeof(rmt_item32_t));
+    std::vector<rmt_item32_t> frame(n);
+    if (n) memcpy(frame.data(), data + i + 2, n * sizeof(rmt_item32_t));
+    i += 2 + n * sizeof(rmt_item32_t);
+    hostRmtFrames().push_back(std::move(frame));
+    det.update();
+    int q = det.getLastFrameQuality();
+    CHECK(q >= 0 && q <= 100);
+    CHECK(det.getSignalQuality() >= -1 && det.getSignalQuality() <= 100);
+  }
+  hostAdvanceMs(2000);
+  det.update();  // Flush a pending click
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  Serial.quiet = true;
+  if (size < 1) return 0;
+  switch (data[0] % 3) {
+    case 0: fuzzSerial(data + 1, size - 1); break;
+    case 1: fuzzAdvert(data + 1, size - 1); break;
+    case 2: fuzzRf(data + 1, size - 1); break;
+  }
+  return 0;
+}
+
+#ifndef FUZZ_WITH_LIBFUZZER
+
+// ----- Seed corpus -----
+
+static std::string rfFrame(uint8_t dtQuarterMs, uint32_t code, int jitterUs) {
+  // EV1527-style: 24 bits of short/long pairs then a sync gap, sent 4 times
+  std::vector<rmt_item32_t> items;
+  for (int rep = 0; rep < 4; rep++) {
+    for (int b = 23; b >= 0; b--) {
+      bool one = code >> b & 1;
+      int j = (b % 3 - 1) * jitterUs;
+      items.push_back({(uint32_t)((one ? 1050 : 350) + j), 1, (uint32_t)((one ? 350 : 1050) - j), 0});
+    }
+    items.push_back({350, 1, 10850, 0});
+  }
+  std::string s;
+  s += (char)dtQuarterMs;
+  s += (char)items.size();
+  s.append((const char*)items.data(), items.size() * sizeof(rmt_item32_t));
+  return s;
+}
+
+static void writeSeed(const std::string& dir, const std::string& name, const std::string& data) {
+  std::ofstream(dir + "/" + name, std::ios::binary) << data;
+}
+
+static void writeSeeds(const std::string& dir) {
+  const char* lines[] = {
+    "status\n", "qlevel 3\n", "qlevel -99999999999\n", "pair 12 00112233445566778899aabbccddeeff\n",
+    "sched add 07:30 22:00 tcs 12345\n", "prog data 0 a1b2c3\n", "time set 1760000000\n",
+    "tz -300\r\nbark\r\n",
+  };
+  for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++)
+    writeSeed(dir, "serial_" + std::to_string(i), std::string(1, '\0') + lines[i]);
+  writeSeed(dir, "serial_long", std::string(1, '\0') + std::string(100, 'x') + "\nstatus\n");
+
+  BarkAdvPayload p;
+  BarkAuth::sign(PAIRED_KEY, PAIRED_SENSOR, 42, 1760000000, p);
+  std::string signedMfg((const char*)&p, sizeof(p));
+  writeSeed(dir, "adv_signed", std::string("\1") + '\0' + signedMfg);
+  std::string legacyName = ADV_NAME;
+  writeSeed(dir, "adv_legacy", std::string("\1") + (char)legacyName.size() + legacyName + "\xff\xff" ADV_TAG);
+  writeSeed(dir, "adv_foreign", std::string("\1") + '\4' + "Tile" + std::string("\x4c\x00\x02\x15", 4) + std::string(21, '\x5a'));
+
+  std::string learn = std::string("\2") + '\0';
+  for (int k = 0; k < 3; k++) learn += rfFrame(250, 0xA5C3F1, 20);
+  writeSeed(dir, "rf_learn", learn);
+  writeSeed(dir, "rf_double", learn + rfFrame(250, 0xA5C3F1, 40) + rfFrame(75, 0xA5C3F1, 0));
+  writeSeed(dir, "rf_noisy", std::string("\2") + '\1' + rfFrame(10, 0x123456, 300));
+}
+
+// ----- Runner without libFuzzer -----
+
+static std::vector<std::string> loadCorpus(const std::string& path) {
+  std::vector<std::string> out;
+  DIR* d = opendir(path.c_str());
+  if (!d) {
+    std::ifstream f(path, std::ios::binary);
+    if (f) out.push_back(std::string(std::istreambuf_iterator<char>(f), {}));
+    return out;
+  }
+  while (dirent* e = readdir(d)) {
+    if (e->d_name[0] == '.') continue;
+    std::ifstream f(path + "/" + e->d_name, std::ios::binary);
+    out.push_back(std::string(std::istreambuf_iterator<char>(f), {}));
+  }
+  closedir(d);
+  return out;
+}
+
+static uint32_t rng = 1;
+static uint32_t next() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static std::string mutate(std::string s) {
+  int edits = 1 + next() % 4;
+  for (int e = 0; e < edits; e++) {
+    size_t at = s.empty() ? 0 : 1 + next() % std::max<size_t>(s.size(), 1);  // Keep the selector
+    at = std::min(at, s.size());
+    switch (next() % 6) {
+      case 0: if (at < s.size()) s[at] ^= 1 << (next() % 8); break;
+      case 1: if (at < s.size()) s[at] = (char)next(); break;
+      case 2: s.insert(at, 1, (char)next()); break;
+      case 3: if (at < s.size()) s.erase(at, 1 + next() % 8); break;
+      case 4: if (at < s.size()) s.insert(at, s.substr(at, 1 + next() % 16)); break;
+      case 5: s.resize(std::min(s.size(), at)); break;
+    }
+  }
+  return s.size() > 4096 ? s.substr(0, 4096) : s;
+}
+
+int main(int argc, char** argv) {
+  long runs = 100000;
+  std::vector<std::string> corpus;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--seeds" && i + 1 < argc) {
+      writeSeeds(argv[++i]);
+      return 0;
+    } else if (a.rfind("-runs=", 0) == 0) {
+      runs = atol(a.c_str() + 6);
+    } else if (a.rfind("-seed=", 0) == 0) {
+      rng = (uint32_t)atol(a.c_str() + 6) | 1;
+    } else {
+      for (auto& c : loadCorpus(a)) corpus.push_back(c);
+    }
+  }
+  if (corpus.empty()) {
+    fprintf(stderr, "usage: %s [-runs=N] [-seed=S] CORPUS... | --seeds DIR\n", argv[0]);
+    return 2;
+  }
+
+  for (auto& c : corpus) LLVMFuzzerTestOneInput((const uint8_t*)c.data(), c.size());
+  printf("replayed %zu inputs\n", corpus.size());
+  for (long r = 0; r < runs; r++) {
+    std::string in = mutate(corpus[next() % corpus.size()]);
+    if (next() % 8 == 0) corpus.push_back(in);  // Let mutations stack
+    LLVMFuzzerTestOneInput((const uint8_t*)in.data(), in.size());
+  }
+  printf("%ld mutated runs, no failures\n", runs);
+  return 0;
+}
+
+#endif
@@ -0,0 +1,233 @@
+#pragma once
+// Host stand-ins for the Arduino core, enough to build the header-only
+// device classes into the tools in tools/. micros()/millis() are a virtual
+// clock the tool sets and advances (esp_timer.h runs timers along it);
+// Serial prints to stdout; LEDC and interrupts are recorded for the tool.
+// FreeRTOS tasks are real threads and queues are locked FIFOs (non-blocking
+// only), for the drivers that capture in a task of their own.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define PROGMEM
+#define constrain(a, l, h) ((a) < (l) ? (l) : ((a) > (h) ? (h) : (a)))
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define FALLING 2
+#define portTICK_PERIOD_MS 1
+
+typedef struct { int owner; int count; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+#define portENTER_CRITICAL(m) ((void)(m))
+#define portEXIT_CRITICAL(m) ((void)(m))
+
+// ----- FreeRTOS -----
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+struct HostQueue {
+  std::mutex m;
+  std::deque<std::vector<uint8_t>> items;
+  size_t itemSize;
+  size_t length;
+};
+typedef HostQueue* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(size_t length, size_t itemSize) {
+  QueueHandle_t q = new HostQueue();
+  q->itemSize = itemSize;
+  q->length = length;
+  return q;
+}
+inline BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t) {
+  std::lock_guard<std::mutex> l(q->m);
+  if (q->items.size() >= q->length) return pdFALSE;
+  q->items.emplace_back((const uint8_t*)item, (const uint8_t*)item + q->itemSize);
+  return pdTRUE;
+}
+inline BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t) {
+  std::lock_guard<std::mutex> l(q->m);
+  if (q->items.empty()) return pdFALSE;
+  memcpy(item, q->items.front().data(), q->itemSize);
+  q->items.pop_front();
+  return pdTRUE;
+}
+inline BaseType_t xQueueReset(QueueHandle_t q) {
+  std::lock_guard<std::mutex> l(q->m);
+  q->items.clear();
+  return pdPASS;
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(void (*fn)(void*), const char*, uint32_t, void* arg, int,
+                                          TaskHandle_t*, int) {
+  std::thread(fn, arg).detach();  // Runs until the tool exits
+  return pdPASS;
+}
+inline void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+
+inline uint64_t& hostMicros() {
+  static uint64_t t = 0;
+  return t;
+}
+inline void hostSetMillis(uint32_t ms) { hostMicros() = (uint64_t)ms * 1000; }
+inline void hostAdvanceMs(uint32_t ms) { hostMicros() += (uint64_t)ms * 1000; }
+inline unsigned long millis() { return (uint32_t)(hostMicros() / 1000); }
+inline unsigned long micros() { return (uint32_t)hostMicros(); }
+// esp_timer.h hooks in its timer runner so timers fire during delay(), as
+// their own task would on the device
+inline void (*&hostDelayRunner())(uint64_t) {
+  static void (*run)(uint64_t) = nullptr;
+  return run;
+}
+inline void delay(unsigned long ms) {
+  uint64_t until = hostMicros() + (uint64_t)ms * 1000;
+  if (hostDelayRunner()) hostDelayRunner()(until);
+  else hostMicros() = until;
+}
+
+// Input levels by pin, for the tool to set (idle high: pull-ups)
+inline int& hostPinLevel(int pin) {
+  static int level[64] = {};
+  static bool init = false;
+  if (!init) {
+    std::fill(level, level + 64, HIGH);
+    init = true;
+  }
+  return level[pin & 63];
+}
+
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline int digitalRead(int pin) { return hostPinLevel(pin); }
+
+// Interrupt handlers by pin, for the tool to fire
+inline void (*&hostIsr(int pin))() {
+  static void (*isr[64])() = {};
+  return isr[pin & 63];
+}
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline void attachInterrupt(int pin, void (*isr)(), int) { hostIsr(pin) = isr; }
+
+inline void ledcSetup(int, double, int) {}
+inline void ledcAttachPin(int, int) {}
+inline void ledcWrite(int, uint32_t) {}
+inline double ledcWriteTone(int, double hz) { return hz; }
+
+inline uint32_t getCpuFrequencyMhz() { return 240; }
+
+inline long random(long lo, long hi) { return hi > lo ? lo + std::rand() % (hi - lo) : lo; }
+inline long random(long hi) { return random(0, hi); }
+inline void randomSeed(unsigned long s) { std::srand(s); }
+inline uint32_t esp_random() { return ((uint32_t)std::rand() << 16) ^ (uint32_t)std::rand(); }
+
+class String {
+public:
+  String() {}
+  String(const char* c) : _s(c ? c : "") {}
+  String(const std::string& s) : _s(s) {}
+  String(char c) : _s(1, c) {}
+  String(int v) : _s(std::to_string(v)) {}
+  String(unsigned v) : _s(std::to_string(v)) {}
+  String(long v) : _s(std::to_string(v)) {}
+  String(unsigned long v) : _s(std::to_string(v)) {}
+  String(float v, int decimals = 2) : String((double)v, decimals) {}
+  String(double v, int decimals = 2) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+    _s = buf;
+  }
+
+  const char* c_str() const { return _s.c_str(); }
+  unsigned length() const { return _s.size(); }
+  char operator[](unsigned i) const { return i < _s.size() ? _s[i] : 0; }
+  bool operator==(const String& o) const { return _s == o._s; }
+  bool operator!=(const String& o) const { return _s != o._s; }
+  String& operator+=(const String& o) { _s += o._s; return *this; }
+  String& operator+=(char c) { _s += c; return *this; }
+  friend String operator+(const String& a, const String& b) { return String(a._s + b._s); }
+  friend String operator+(const String& a, const char* b) { return String(a._s + b); }
+  friend String operator+(const char* a, const String& b) { return String(a + b._s); }
+
+  bool startsWith(const String& p) const { return _s.rfind(p._s, 0) == 0; }
+  bool endsWith(const String& p) const {
+    return _s.size() >= p._s.size() && _s.compare(_s.size() - p._s.size(), p._s.size(), p._s) == 0;
+  }
+  int indexOf(char c, unsigned from = 0) const {
+    size_t p = _s.find(c, from);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  String substring(unsigned from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+  String substring(unsigned from, unsigned to) const {
+    return from < to && from < _s.size() ? String(_s.substr(from, to - from)) : String();
+  }
+  void trim() {
+    size_t a = _s.find_first_not_of(" \t\r\n"), b = _s.find_last_not_of(" \t\r\n");
+    _s = a == std::string::npos ? "" : _s.substr(a, b - a + 1);
+  }
+  void toLowerCase() { for (char& c : _s) c = (char)tolower((unsigned char)c); }
+  long toInt() const { return atol(_s.c_str()); }
+  float toFloat() const { return (float)atof(_s.c_str()); }
+  void reserve(unsigned n) { _s.reserve(n); }
+  void remove(unsigned from) {
+    if (from < _s.size()) _s.erase(from);
+  }
+
+private:
+  std::string _s;
+};
+
+struct HostSerial {
+  bool quiet = false;  // Drop all output (fuzzing, benchmarks)
+
+  void begin(long) {}
+  int printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    if (quiet) return 0;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vprintf(fmt, ap);
+    va_end(ap);
+    return n;
+  }
+  void print(const String& s) {
+    if (!quiet) fputs(s.c_str(), stdout);
+  }
+  void println(const String& s = String()) {
+    if (!quiet) puts(s.c_str());
+  }
+  int available() { return 0; }
+  explicit operator bool() const { return true; }
+};
+inline HostSerial Serial;
+
+struct HostEsp {
+  uint64_t efuseMac = 0x0000A1B2C3D4E5F6ULL;
+  uint64_t getEfuseMac() const { return efuseMac; }
+  uint32_t getCycleCount() const { return (uint32_t)(hostMicros() * 240); }
+  uint32_t getFreeHeap() const { return 200000; }
+};
+inline HostEsp ESP;
@@ -0,0 +1,157 @@
+#pragma once
+// Host stand-in for AsyncMqttClient: a minimal MQTT 3.1.1 client over a
+// blocking TCP socket (CONNECT, PUBLISH QoS 0/1, PUBACK). A reader thread
+// delivers PUBACKs to onPublish, as AsyncTCP's task does on the device.
+// The hostmqtt framing helpers are shared with the tools' broker side.
+#include <Arduino.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace hostmqtt {
+
+enum : uint8_t { CONNECT = 1, CONNACK = 2, PUBLISH = 3, PUBACK = 4, SUBSCRIBE = 8, SUBACK = 9,
+                 PINGREQ = 12, PINGRESP = 13, DISCONNECT = 14 };
+
+inline bool readAll(int fd, void* buf, size_t n) {
+  uint8_t* p = (uint8_t*)buf;
+  while (n) {
+    ssize_t r = ::recv(fd, p, n, 0);
+    if (r <= 0) return false;
+    p += r;
+    n -= (size_t)r;
+  }
+  return true;
+}
+
+// One packet: type in the high nibble of `header`, body after the length
+inline bool readPacket(int fd, uint8_t& header, std::string& body) {
+  if (!readAll(fd, &header, 1)) return false;
+  uint32_t len = 0;
+  for (int shift = 0; shift < 28; shift += 7) {
+    uint8_t b;
+    if (!readAll(fd, &b, 1)) return false;
+    len |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80)) {
+      body.resize(len);
+      return len == 0 || readAll(fd, &body[0], len);
+    }
+  }
+  return false;
+}
+
+inline bool sendPacket(int fd, uint8_t header, const std::string& body) {
+  std::string p(1, (char)header);
+  uint32_t len = body.size();
+  do {
+    uint8_t b = len & 0x7F;
+    len >>= 7;
+    p += (char)(b | (len ? 0x80 : 0));
+  } while (len);
+  p += body;
+  return ::send(fd, p.data(), p.size(), MSG_NOSIGNAL) == (ssize_t)p.size();
+}
+
+inline std::string u16(uint16_t v) { return std::string{(char)(v >> 8), (char)(v & 0xFF)}; }
+inline uint16_t u16At(const std::string& s, size_t at) { return (uint8_t)s[at] << 8 | (uint8_t)s[at + 1]; }
+inline std::string str(const std::string& s) { return u16(s.size()) + s; }
+
+inline int dial(const char* host, uint16_t port) {
+  addrinfo hints{}, *res = nullptr;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host, std::to_string(port).c_str(), &hints, &res) != 0) return -1;
+  int fd = ::socket(res->ai_family, res->ai_socktype, 0);
+  if (fd >= 0 && ::connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+    ::close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  return fd;
+}
+
+// CONNECT with a clean session; true once the broker accepted it
+inline bool handshake(int fd, const std::string& clientId) {
+  std::string body = str("MQTT") + (char)4 + (char)0x02 + u16(60) + str(clientId);
+  uint8_t h;
+  std::string ack;
+  return sendPacket(fd, CONNECT << 4, body) && readPacket(fd, h, ack) &&
+         h >> 4 == CONNACK && ack.size() == 2 && ack[1] == 0;
+}
+
+}  // namespace hostmqtt
+
+class AsyncMqttClient {
+public:
+  ~AsyncMqttClient() { disconnect(); }
+
+  AsyncMqttClient& setServer(const char* host, uint16_t port) {
+    _host = host;
+    _port = port;
+    return *this;
+  }
+  AsyncMqttClient& onPublish(std::function<void(uint16_t)> cb) {
+    _onPublish = cb;
+    return *this;
+  }
+  bool connected() const { return _connected; }
+
+  // Blocking here; the device client connects in the background
+  void connect() {
+    disconnect();
+    _fd = hostmqtt::dial(_host.c_str(), _port);
+    static std::atomic<int> clients{0};
+    if (_fd < 0 || !hostmqtt::handshake(_fd, "dogapp-host-" + std::to_string(getpid()) + "-" +
+                                                 std::to_string(clients++))) {
+      disconnect();
+      return;
+    }
+    _connected = true;
+    _reader = std::thread([this] { _read(); });
+  }
+
+  void disconnect(bool = false) {
+    if (_fd >= 0) ::shutdown(_fd, SHUT_RDWR);
+    if (_reader.joinable()) _reader.join();
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+    _connected = false;
+  }
+
+  // Packet id (1 for QoS 0), 0 if not sent
+  uint16_t publish(const char* topic, uint8_t qos, bool retain, const char* payload, size_t length) {
+    if (!_connected) return 0;
+    uint16_t id = 1;
+    std::string body = hostmqtt::str(topic);
+    if (qos) {
+      if (++_nextId == 0) _nextId = 1;
+      id = _nextId;
+      body += hostmqtt::u16(id);
+    }
+    body.append(payload, length);
+    uint8_t header = hostmqtt::PUBLISH << 4 | (qos ? 0x02 : 0) | (retain ? 1 : 0);
+    if (!hostmqtt::sendPacket(_fd, header, body)) return 0;
+    return id;
+  }
+
+private:
+  void _read() {
+    uint8_t h;
+    std::string body;
+    while (hostmqtt::readPacket(_fd, h, body)) {
+      if (h >> 4 == hostmqtt::PUBACK && body.size() == 2 && _onPublish) _onPublish(hostmqtt::u16At(body, 0));
+    }
+    _connected = false;
+  }
+
+  std::string _host;
+  uint16_t _port{1883};
+  int _fd{-1};
+  std::atomic<bool> _connected{false};
+  uint16_t _nextId{0};
+  std::thread _reader;
+  std::function<void(uint16_t)> _onPublish;
+};
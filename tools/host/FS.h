@@ -0,0 +1,56 @@
+#pragma once
+// Host stand-in for the Arduino FS File: plain stdio files under the
+// directory set with hostFsRoot().
+#include <Arduino.h>
+
+#define FILE_READ   "r"
+#define FILE_WRITE  "w"
+#define FILE_APPEND "a"
+
+inline std::string& hostFsRoot() {
+  static std::string root = ".";
+  return root;
+}
+inline std::string hostFsPath(const char* path) { return hostFsRoot() + path; }
+
+class File {
+public:
+  File() {}
+  explicit File(FILE* f) : _f(f) {}
+  explicit operator bool() const { return _f != nullptr; }
+
+  size_t size() {
+    long at = ftell(_f);
+    fseek(_f, 0, SEEK_END);
+    long n = ftell(_f);
+    fseek(_f, at, SEEK_SET);
+    return (size_t)n;
+  }
+  bool seek(uint32_t pos) { return fseek(_f, pos, SEEK_SET) == 0; }
+  int read(uint8_t* buf, size_t n) { return (int)fread(buf, 1, n, _f); }
+  size_t write(const uint8_t* buf, size_t n) { return fwrite(buf, 1, n, _f); }
+  void close() {
+    if (_f) fclose(_f);
+    _f = nullptr;
+  }
+
+private:
+  FILE* _f{nullptr};
+};
+
+namespace fs {
+class FS {
+public:
+  bool begin(bool = false) { return true; }
+  File open(const char* path, const char* mode) {
+    std::string m = std::string(mode) == FILE_READ ? "rb" : std::string(mode) + "b";
+    return File(fopen(hostFsPath(path).c_str(), m.c_str()));
+  }
+  bool exists(const char* path) {
+    FILE* f = fopen(hostFsPath(path).c_str(), "rb");
+    if (f) fclose(f);
+    return f != nullptr;
+  }
+  bool remove(const char* path) { return ::remove(hostFsPath(path).c_str()) == 0; }
+};
+}  // namespace fs
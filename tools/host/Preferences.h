@@ -0,0 +1,67 @@
+#pragma once
+// Host stand-in for Preferences: an in-memory store that outlives the
+// Preferences objects, so a tool can "reboot" by recreating them.
+#include <Arduino.h>
+#include <map>
+
+inline std::map<std::string, std::string>& hostPreferences() {
+  static std::map<std::string, std::string> store;
+  return store;
+}
+
+class Preferences {
+public:
+  bool begin(const char* ns, bool = false) {
+    _ns = std::string(ns) + "/";
+    return true;
+  }
+  void end() {}
+  bool clear() {
+    auto& s = hostPreferences();
+    for (auto it = s.begin(); it != s.end();) it = it->first.rfind(_ns, 0) == 0 ? s.erase(it) : std::next(it);
+    return true;
+  }
+  bool remove(const char* key) { return hostPreferences().erase(_ns + key) > 0; }
+  bool isKey(const char* key) { return hostPreferences().count(_ns + key) > 0; }
+
+  size_t putBytes(const char* key, const void* v, size_t n) {
+    hostPreferences()[_ns + key] = std::string((const char*)v, n);
+    return n;
+  }
+  size_t getBytes(const char* key, void* v, size_t n) {
+    auto it = hostPreferences().find(_ns + key);
+    if (it == hostPreferences().end()) return 0;
+    n = std::min(n, it->second.size());
+    memcpy(v, it->second.data(), n);
+    return n;
+  }
+  size_t getBytesLength(const char* key) {
+    auto it = hostPreferences().find(_ns + key);
+    return it == hostPreferences().end() ? 0 : it->second.size();
+  }
+
+  size_t putUChar(const char* k, uint8_t v) { return _put(k, v); }
+  size_t putUShort(const char* k, uint16_t v) { return _put(k, v); }
+  size_t putShort(const char* k, int16_t v) { return _put(k, v); }
+  size_t putUInt(const char* k, uint32_t v) { return _put(k, v); }
+  size_t putInt(const char* k, int32_t v) { return _put(k, v); }
+  size_t putULong(const char* k, uint32_t v) { return _put(k, v); }
+  size_t putBool(const char* k, bool v) { return _put(k, v); }
+  size_t putFloat(const char* k, float v) { return _put(k, v); }
+  uint8_t getUChar(const char* k, uint8_t d = 0) { return _get(k, d); }
+  uint16_t getUShort(const char* k, uint16_t d = 0) { return _get(k, d); }
+  int16_t getShort(const char* k, int16_t d = 0) { return _get(k, d); }
+  uint32_t getUInt(const char* k, uint32_t d = 0) { return _get(k, d); }
+  int32_t getInt(const char* k, int32_t d = 0) { return _get(k, d); }
+  uint32_t getULong(const char* k, uint32_t d = 0) { return _get(k, d); }
+  bool getBool(const char* k, bool d = false) { return _get(k, d); }
+  float getFloat(const char* k, float d = 0) { return _get(k, d); }
+
+private:
+  template <class T> size_t _put(const char* k, T v) { return putBytes(k, &v, sizeof(v)); }
+  template <class T> T _get(const char* k, T d) {
+    T v;
+    return getBytes(k, &v, sizeof(v)) == sizeof(v) ? v : d;
+  }
+  std::string _ns;
+};
@@ -0,0 +1,14 @@
+#pragma once
+// Host stand-in for WiFi: the tool decides when the link is up.
+#include <Arduino.h>
+
+#define WIFI_STA 1
+
+struct HostWiFi {
+  bool up = false;
+  void mode(int) {}
+  void setSleep(bool) {}
+  void begin(const char*, const char*) {}
+  bool isConnected() const { return up; }
+};
+inline HostWiFi WiFi;
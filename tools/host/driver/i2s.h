@@ -0,0 +1,91 @@
+#pragma once
+// Host stand-in for the I2S receiver: PCM the tool feeds with hostI2sPush()
+// comes out of i2s_read() as 32-bit left-justified mic samples, which the
+// reader blocks for as on the device. hostI2sWaitIdle() returns once the
+// reader has taken everything and is waiting again, i.e. the blocks before
+// it have been handled.
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include "esp_timer.h"
+
+typedef int i2s_port_t;
+enum { I2S_NUM_0 = 0 };
+typedef int i2s_mode_t;
+enum { I2S_MODE_MASTER = 1, I2S_MODE_RX = 4 };
+enum { I2S_BITS_PER_SAMPLE_32BIT = 32 };
+enum { I2S_CHANNEL_FMT_ONLY_LEFT = 4 };
+enum { I2S_COMM_FORMAT_STAND_I2S = 1 };
+#define I2S_PIN_NO_CHANGE (-1)
+
+typedef struct {
+  i2s_mode_t mode;
+  int sample_rate;
+  int bits_per_sample;
+  int channel_format;
+  int communication_format;
+  int intr_alloc_flags;
+  int dma_buf_count;
+  int dma_buf_len;
+  bool use_apll;
+} i2s_config_t;
+
+typedef struct {
+  int mck_io_num;
+  int bck_io_num;
+  int ws_io_num;
+  int data_out_num;
+  int data_in_num;
+} i2s_pin_config_t;
+
+typedef enum { I2S_EVENT_DMA_ERROR, I2S_EVENT_TX_DONE, I2S_EVENT_RX_DONE, I2S_EVENT_TX_Q_OVF, I2S_EVENT_RX_Q_OVF } i2s_event_type_t;
+typedef struct {
+  i2s_event_type_t type;
+  size_t size;
+} i2s_event_t;
+
+struct HostI2s {
+  std::mutex m;
+  std::condition_variable cv;
+  std::deque<int32_t> samples;
+  bool reading = false;  // Reader blocked for more samples
+};
+inline HostI2s& hostI2s() {
+  static HostI2s* i2s = new HostI2s();  // Never destroyed: the capture thread outlives main()
+  return *i2s;
+}
+
+// The device keeps raw >> 14 as its 16-bit sample, so pcm comes back as is
+inline void hostI2sPush(const int16_t* pcm, size_t n) {
+  HostI2s& h = hostI2s();
+  std::lock_guard<std::mutex> l(h.m);
+  for (size_t i = 0; i < n; i++) h.samples.push_back((int32_t)pcm[i] * (1 << 14));
+  h.cv.notify_all();
+}
+
+inline void hostI2sWaitIdle() {
+  HostI2s& h = hostI2s();
+  std::unique_lock<std::mutex> l(h.m);
+  h.cv.wait(l, [&] { return h.reading && h.samples.empty(); });
+}
+
+inline esp_err_t i2s_driver_install(i2s_port_t, const i2s_config_t*, int queueSize, QueueHandle_t* events) {
+  if (events) *events = xQueueCreate(queueSize, sizeof(i2s_event_t));
+  return ESP_OK;
+}
+inline esp_err_t i2s_set_pin(i2s_port_t, const i2s_pin_config_t*) { return ESP_OK; }
+inline esp_err_t i2s_zero_dma_buffer(i2s_port_t) { return ESP_OK; }
+
+inline esp_err_t i2s_read(i2s_port_t, void* dst, size_t size, size_t* bytesRead, TickType_t) {
+  HostI2s& h = hostI2s();
+  std::unique_lock<std::mutex> l(h.m);
+  size_t n = size / sizeof(int32_t);
+  h.reading = true;
+  h.cv.notify_all();
+  h.cv.wait(l, [&] { return h.samples.size() >= n; });
+  h.reading = false;
+  std::copy(h.samples.begin(), h.samples.begin() + n, (int32_t*)dst);
+  h.samples.erase(h.samples.begin(), h.samples.begin() + n);
+  *bytesRead = n * sizeof(int32_t);
+  return ESP_OK;
+}
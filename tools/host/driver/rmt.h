@@ -0,0 +1,61 @@
+#pragma once
+// Host stand-in for the RMT receiver: frames the tool queues with
+// hostRmtFrames() come out of the ring buffer one per receive.
+#include <deque>
+#include <vector>
+#include "driver/gpio.h"
+
+typedef int rmt_channel_t;
+enum { RMT_CHANNEL_0 = 0 };
+enum { RMT_MODE_RX = 1 };
+typedef unsigned int UBaseType_t;
+typedef void* RingbufHandle_t;
+
+typedef struct {
+  uint32_t duration0 : 15;
+  uint32_t level0 : 1;
+  uint32_t duration1 : 15;
+  uint32_t level1 : 1;
+} rmt_item32_t;
+
+typedef struct {
+  int rmt_mode;
+  rmt_channel_t channel;
+  gpio_num_t gpio_num;
+  int clk_div;
+  int mem_block_num;
+  struct {
+    bool filter_en;
+    int filter_ticks_thresh;
+    int idle_threshold;
+  } rx_config;
+} rmt_config_t;
+
+inline std::deque<std::vector<rmt_item32_t>>& hostRmtFrames() {
+  static std::deque<std::vector<rmt_item32_t>> q;
+  return q;
+}
+
+inline int rmt_config(const rmt_config_t*) { return 0; }
+inline int rmt_driver_install(rmt_channel_t, size_t, int) { return 0; }
+inline int rmt_rx_start(rmt_channel_t, bool) { return 0; }
+inline int rmt_get_ringbuf_handle(rmt_channel_t, RingbufHandle_t* rb) {
+  *rb = &hostRmtFrames();
+  return 0;
+}
+
+// The item stays valid until it is returned, as on the device
+inline void* xRingbufferReceive(RingbufHandle_t, size_t* length, int) {
+  static std::vector<rmt_item32_t> out;
+  if (hostRmtFrames().empty()) return nullptr;
+  out = std::move(hostRmtFrames().front());
+  hostRmtFrames().pop_front();
+  *length = out.size() * sizeof(rmt_item32_t);
+  // A zero-length item is still an item; hand out a distinct non-null pointer
+  return out.empty() ? (void*)&out : (void*)out.data();
+}
+inline void vRingbufferReturnItem(RingbufHandle_t, void*) {}
+inline void vRingbufferGetInfo(RingbufHandle_t, UBaseType_t*, UBaseType_t*, UBaseType_t*, UBaseType_t*,
+                               UBaseType_t* waiting) {
+  *waiting = hostRmtFrames().size();
+}
@@ -0,0 +1,65 @@
+#pragma once
+// Host stand-in for esp_timer on the virtual clock. Timers fire only inside
+// hostRunUntilUs() (and delay(), which runs it), each at its exact due time,
+// in due order.
+#include <Arduino.h>
+#include <vector>
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+typedef void (*esp_timer_cb_t)(void*);
+typedef enum { ESP_TIMER_TASK } esp_timer_dispatch_t;
+typedef struct {
+  esp_timer_cb_t callback;
+  void* arg;
+  esp_timer_dispatch_t dispatch_method;
+  const char* name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+struct esp_timer {
+  esp_timer_cb_t callback;
+  void* arg;
+  bool armed;
+  uint64_t dueUs;
+};
+typedef esp_timer* esp_timer_handle_t;
+
+inline std::vector<esp_timer*>& hostTimers() {
+  static std::vector<esp_timer*> timers;
+  return timers;
+}
+
+inline int64_t esp_timer_get_time() { return (int64_t)hostMicros(); }
+
+// Advance the clock to tUs, firing every timer that falls due on the way
+inline void hostRunUntilUs(uint64_t tUs) {
+  for (;;) {
+    esp_timer* next = nullptr;
+    for (esp_timer* t : hostTimers())
+      if (t->armed && t->dueUs <= tUs && (!next || t->dueUs < next->dueUs)) next = t;
+    if (!next) break;
+    if (next->dueUs > hostMicros()) hostMicros() = next->dueUs;
+    next->armed = false;
+    next->callback(next->arg);
+  }
+  if (tUs > hostMicros()) hostMicros() = tUs;
+}
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+  *out = new esp_timer{args->callback, args->arg, false, 0};
+  hostTimers().push_back(*out);
+  hostDelayRunner() = hostRunUntilUs;
+  return ESP_OK;
+}
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t us) {
+  t->armed = true;
+  t->dueUs = hostMicros() + us;
+  return ESP_OK;
+}
+inline esp_err_t esp_timer_stop(esp_timer_handle_t t) {
+  t->armed = false;
+  return ESP_OK;
+}
@@ -0,0 +1,19 @@
+// Host build of the hot-path micro-benchmarks in PerfBench.h.
+//
+// Build:  g++ -std=c++17 -O2 -Ihost -I.. perf_bench.cpp ../ClickDetector.cpp -o perf_bench
+// Usage:  ./perf_bench [name-filter]
+//
+// Reports ns per op on this machine: useful for before/after comparisons of
+// a change, not as device numbers. For cycle counts, build the sketch with
+// ENABLE_PERF_BENCH 1 and run "perf bench [name]" on the console.
+#include "PerfBench.h"
+
+int main(int argc, char** argv) {
+  hostPreferences().clear();
+  int ran = PerfBench::runAll(argc > 1 ? argv[1] : nullptr);
+  if (!ran) {
+    fprintf(stderr, "no case matches '%s'\n", argv[1]);
+    return 1;
+  }
+  return 0;
+}
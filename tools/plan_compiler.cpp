@@ -0,0 +1,329 @@
+// Host compiler for training plans → TrainingProgram images.
+//
+// Build:  g++ -std=c++17 -O2 -I.. plan_compiler.cpp -o plan_compiler
+// Usage:  ./plan_compiler plan.txt out.bin      Compile to a binary image
+//         ./plan_compiler plan.txt --serial     Print "prog ..." console lines to paste
+//         ./plan_compiler --dump image.bin      Validate and list an image
+//
+// Plan file (one statement per line, '#' comments, indentation ignored):
+//   program puppy-basics          Name (up to 16 chars)
+//   start settle                  First phase (default: the first one)
+//   phase warmup                  Begin a phase; the settings below apply to it
+//     quiet 2s                    Quiet target (ms, s, m, h; bare number = ms)
+//     dispense 1200ms             Feeder time budget
+//     cooldown 7s                 Minimum time between rewards
+//     pattern 11110               Reward slots, 1 = reward (up to 16)
+//     shuffle                     Random start slot after each pass
+//     reward-cue marker           Cue on a rewarded success (or none)
+//     enter-cue level-up          Cue on entering the phase (or none)
+//     when successes >= 4 -> settle   Up to 3; first match wins
+//
+// Metrics: successes, rewards, barks, streak (successes since the last bark),
+// minutes (in this phase), all restarting at 0 when the phase is entered.
+// Only ">= N" with N >= 1: anything else would already hold on entry and
+// re-enter the phase on every tick. Every image written is
+// re-read through TrainingProgram::validate(), the same check the device runs.
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "TrainingProgram.h"
+
+// Same order as CuePattern in ToneEngine.h
+static const char* CUE_NAMES[] = { "marker", "level-up", "reset", "correction" };
+static const int CUE_NAME_COUNT = sizeof(CUE_NAMES) / sizeof(CUE_NAMES[0]);
+
+static const int SERIAL_CHUNK = 24;  // Bytes per "prog data" line (SERIAL_LINE_MAX = 64)
+
+struct PendingTransition {
+  uint8_t metric, cmp;
+  uint32_t threshold;
+  std::string target;
+  int line;
+};
+
+struct PhaseDef {
+  std::string name;
+  TpPhase p;
+  std::vector<PendingTransition> when;
+  int line;
+};
+
+static int errors = 0;
+
+static void fail(int line, const std::string& msg) {
+  fprintf(stderr, "line %d: %s\n", line, msg.c_str());
+  errors++;
+}
+
+static bool parseDuration(const std::string& s, uint32_t& ms) {
+  char* end;
+  double v = strtod(s.c_str(), &end);
+  if (end == s.c_str() || v < 0) return false;
+  std::string unit(end);
+  double mult;
+  if (unit.empty() || unit == "ms") mult = 1;
+  else if (unit == "s") mult = 1000;
+  else if (unit == "m") mult = 60000;
+  else if (unit == "h") mult = 3600000;
+  else return false;
+  double r = v * mult;
+  if (r > 4294967295.0) return false;
+  ms = (uint32_t)(r + 0.5);
+  return true;
+}
+
+static int cueIndex(const std::string& s) {
+  if (s == "none") return TP_NO_CUE;
+  for (int i = 0; i < CUE_NAME_COUNT; i++) if (s == CUE_NAMES[i]) return i;
+  return -1;
+}
+
+static int metricIndex(const std::string& s) {
+  for (int m = 0; m < TP_M_COUNT; m++) if (s == TrainingProgram::metricName((TpMetric)m)) return m;
+  return -1;
+}
+
+static bool compile(const char* path, std::vector<uint8_t>& image) {
+  std::ifstream in(path);
+  if (!in) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+
+  std::string programName = "plan", startName;
+  std::vector<PhaseDef> phases;
+  std::string raw;
+  int line = 0;
+
+  while (std::getline(in, raw)) {
+    line++;
+    size_t hash = raw.find('#');
+    if (hash != std::string::npos) raw.resize(hash);
+    std::istringstream ls(raw);
+    std::vector<std::string> w;
+    for (std::string t; ls >> t;) w.push_back(t);
+    if (w.empty()) continue;
+
+    const std::string& kw = w[0];
+    if (kw == "program" && w.size() == 2) {
+      programName = w[1];
+      if (programName.size() > TP_NAME_LEN) fail(line, "program name longer than 16 chars");
+      continue;
+    }
+    if (kw == "start" && w.size() == 2) {
+      startName = w[1];
+      continue;
+    }
+    if (kw == "phase" && w.size() == 2) {
+      PhaseDef d;
+      d.name = w[1];
+      d.line = line;
+      memset(&d.p, 0, sizeof(d.p));
+      d.p.quietMs = 2000;
+      d.p.dispenseMs = 1200;
+      d.p.cooldownMs = 7000;
+      d.p.patternBits = 1;
+      d.p.patternLen = 1;
+      d.p.rewardCue = 0;
+      d.p.enterCue = TP_NO_CUE;
+      for (auto& t : d.p.transitions) t.metric = TP_UNUSED;
+      for (const PhaseDef& o : phases) if (o.name == d.name) fail(line, "duplicate phase " + d.name);
+      phases.push_back(d);
+      continue;
+    }
+    if (phases.empty()) {
+      fail(line, "'" + kw + "' outside a phase");
+      continue;
+    }
+
+    PhaseDef& d = phases.back();
+    uint32_t ms;
+    if ((kw == "quiet" || kw == "dispense" || kw == "cooldown") && w.size() == 2) {
+      if (!parseDuration(w[1], ms)) {
+        fail(line, "bad duration " + w[1]);
+      } else if (kw == "quiet") {
+        if (ms < TP_MIN_QUIET_MS || ms > TP_MAX_QUIET_MS) fail(line, "quiet must be 500ms..1h");
+        d.p.quietMs = ms;
+      } else if (ms > 0xFFFF) {
+        fail(line, kw + " must be under 65.5s");
+      } else if (kw == "dispense") {
+        d.p.dispenseMs = (uint16_t)ms;
+      } else {
+        d.p.cooldownMs = (uint16_t)ms;
+      }
+    } else if (kw == "pattern" && w.size() == 2) {
+      const std::string& bits = w[1];
+      if (bits.empty() || bits.size() > TP_MAX_PATTERN || bits.find_first_not_of("01") != std::string::npos) {
+        fail(line, "pattern must be 1-16 digits of 0/1");
+        continue;
+      }
+      d.p.patternBits = 0;
+      for (size_t i = 0; i < bits.size(); i++) if (bits[i] == '1') d.p.patternBits |= 1u << i;
+      d.p.patternLen = (uint8_t)bits.size();
+    } else if (kw == "shuffle" && w.size() == 1) {
+      d.p.flags |= TP_FLAG_SHUFFLE;
+    } else if ((kw == "reward-cue" || kw == "enter-cue") && w.size() == 2) {
+      int c = cueIndex(w[1]);
+      if (c < 0) fail(line, "unknown cue " + w[1]);
+      else if (kw == "reward-cue") d.p.rewardCue = (uint8_t)c;
+      else d.p.enterCue = (uint8_t)c;
+    } else if (kw == "when" && w.size() == 6 && w[4] == "->") {
+      PendingTransition t;
+      int m = metricIndex(w[1]);
+      if (m < 0) {
+        fail(line, "unknown metric " + w[1]);
+        continue;
+      }
+      t.metric = (uint8_t)m;
+      if (w[2] != ">=") {
+        fail(line, "comparison must be >= (metrics restart at 0 in each phase, so < holds at once)");
+        continue;
+      }
+      t.cmp = TP_CMP_GE;
+      // Digits only: strtoul would take a sign and wrap "-1" to a huge value
+      const std::string& th = w[3];
+      if (th.empty() || th.size() > 10 || th.find_first_not_of("0123456789") != std::string::npos ||
+          std::stoull(th) > 0xFFFFFFFFULL) {
+        fail(line, "threshold must be 1-4294967295, got " + th);
+        continue;
+      }
+      t.threshold = (uint32_t)std::stoull(th);
+      if (t.threshold == 0) {
+        fail(line, ">= 0 always holds; the phase would re-enter on every tick");
+        continue;
+      }
+      t.target = w[5];
+      t.line = line;
+      if (d.when.size() >= TP_MAX_TRANSITIONS) fail(line, "more than 3 transitions in a phase");
+      else d.when.push_back(t);
+    } else {
+      fail(line, "cannot parse: " + raw);
+    }
+  }
+
+  if (phases.empty()) fail(line, "no phases");
+  if (phases.size() > TP_MAX_PHASES) fail(line, "more than 16 phases");
+  if (errors) return false;
+
+  std::map<std::string, uint8_t> index;
+  for (size_t i = 0; i < phases.size(); i++) index[phases[i].name] = (uint8_t)i;
+
+  for (PhaseDef& d : phases) {
+    for (size_t i = 0; i < d.when.size(); i++) {
+      const PendingTransition& t = d.when[i];
+      auto it = index.find(t.target);
+      if (it == index.end()) {
+        fail(t.line, "unknown phase " + t.target);
+        continue;
+      }
+      d.p.transitions[i] = { t.metric, t.cmp, it->second, 0, t.threshold };
+    }
+  }
+
+  TpHeader h;
+  memset(&h, 0, sizeof(h));
+  h.magic[0] = TP_MAGIC0;
+  h.magic[1] = TP_MAGIC1;
+  h.version = TP_VERSION;
+  h.phaseCount = (uint8_t)phases.size();
+  h.startPhase = 0;
+  if (!startName.empty()) {
+    auto it = index.find(startName);
+    if (it == index.end()) fail(0, "unknown start phase " + startName);
+    else h.startPhase = it->second;
+  }
+  if (errors) return false;
+  memcpy(h.name, programName.data(), std::min(programName.size(), (size_t)TP_NAME_LEN));
+
+  std::vector<uint8_t> body(phases.size() * sizeof(TpPhase));
+  for (size_t i = 0; i < phases.size(); i++) memcpy(&body[i * sizeof(TpPhase)], &phases[i].p, sizeof(TpPhase));
+  h.bodyLen = (uint16_t)body.size();
+  h.crc32 = TrainingProgram::crc32(body.data(), body.size());
+
+  image.resize(sizeof(h));
+  memcpy(image.data(), &h, sizeof(h));
+  image.insert(image.end(), body.begin(), body.end());
+
+  uint8_t bad = 0;
+  TpError e = TrainingProgram::validate(image.data(), image.size(), &bad);
+  if (e != TP_OK) {
+    fprintf(stderr, "internal: image fails validation (%s, phase %u)\n", TrainingProgram::errorName(e), bad);
+    return false;
+  }
+  return true;
+}
+
+static void dump(const std::vector<uint8_t>& image) {
+  TrainingProgram prog;
+  uint8_t bad = 0;
+  TpError e = prog.load(image.data(), image.size(), &bad);
+  if (e != TP_OK) {
+    printf("invalid image: %s (phase %u)\n", TrainingProgram::errorName(e), bad);
+    return;
+  }
+  char name[TP_NAME_LEN + 1];
+  prog.name(name);
+  printf("program %s: %u phases, %zu bytes, start %u\n", name, prog.phaseCount(), image.size(),
+         prog.phaseIndex());
+  for (uint8_t i = 0; i < prog.phaseCount(); i++) {
+    const TpPhase& p = prog.phase(i);
+    printf("  phase %u: quiet %lu ms, dispense %u ms, cooldown %u ms, pattern ", i,
+           (unsigned long)p.quietMs, p.dispenseMs, p.cooldownMs);
+    for (uint8_t s = 0; s < p.patternLen; s++) putchar(TrainingProgram::patternSlot(p, s) ? '1' : '0');
+    printf("%s, reward cue %s, enter cue %s\n", (p.flags & TP_FLAG_SHUFFLE) ? " (shuffle)" : "",
+           p.rewardCue < CUE_NAME_COUNT ? CUE_NAMES[p.rewardCue] : "none",
+           p.enterCue < CUE_NAME_COUNT ? CUE_NAMES[p.enterCue] : "none");
+    for (const TpTransition& t : p.transitions) {
+      if (t.metric == TP_UNUSED) continue;
+      printf("    when %s >= %lu -> %u\n", TrainingProgram::metricName((TpMetric)t.metric),
+             (unsigned long)t.threshold, t.target);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc == 3 && strcmp(argv[1], "--dump") == 0) {
+    std::ifstream f(argv[2], std::ios::binary);
+    std::vector<uint8_t> image((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    dump(image);
+    return 0;
+  }
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s plan.txt out.bin|--serial\n       %s --dump image.bin\n", argv[0], argv[0]);
+    return 2;
+  }
+
+  std::vector<uint8_t> image;
+  if (!compile(argv[1], image)) {
+    fprintf(stderr, "%d error(s)\n", errors);
+    return 1;
+  }
+
+  if (strcmp(argv[2], "--serial") == 0) {
+    printf("prog begin %zu\n", image.size());
+    for (size_t off = 0; off < image.size(); off += SERIAL_CHUNK) {
+      printf("prog data %zu ", off);
+      for (size_t i = off; i < image.size() && i < off + SERIAL_CHUNK; i++) printf("%02x", image[i]);
+      printf("\n");
+    }
+    printf("prog commit\n");
+    return 0;
+  }
+
+  FILE* out = fopen(argv[2], "wb");
+  if (!out || fwrite(image.data(), 1, image.size(), out) != image.size()) {
+    fprintf(stderr, "cannot write %s\n", argv[2]);
+    return 1;
+  }
+  fclose(out);
+  dump(image);
+  return 0;
+}
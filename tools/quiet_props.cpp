@@ -0,0 +1,313 @@
+// Property test for QuietReinforcementManager: random interleavings of its
+// calls under virtual time, with invariants checked after every step.
+//
+// Build:  g++ -std=c++17 -O2 -Ihost -I.. quiet_props.cpp -o quiet_props
+// Usage:  ./quiet_props [cases=2000] [steps=300] [seed=1]
+//
+// Steps are onBark, tick, consumePendingDispenseMs, setLevel (also out of
+// range), resetState, restartQuiet, useLevels (tables of other sizes,
+// internal or external control), setAdaptiveShaping, setCooldownMs, time
+// jumps, and reboots, which run begin() on a new manager, sometimes after
+// corrupting the saved state. Half the cases start just before millis()
+// wraps. After every step:
+//
+//   - the level, successes and pattern index are valid for the current
+//     table (what _sanitizeState() enforces on boot)
+//   - at most one dispense is pending: tick() decides none until the last
+//     one was consumed, dropped by a bark or cleared by a reset
+//   - dispenses are at least the cooldown apart (a reset or reboot clears it)
+//   - the look-ahead is honest: when nextSlotRewards() says the coming
+//     success dispenses, it does; when a tick lands exactly on
+//     nextDeadlineMs(), it dispenses only if that was predicted
+//   - the first bark after a reset, restartQuiet or reboot adds no bark
+//     interval (the gap since the last bark is not one)
+//
+// A failing case is shrunk (drop runs of steps, then shorten time jumps)
+// and printed step by step; the exit status is 1.
+#include <cinttypes>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "QuietReinforcementManager.h"
+
+static const uint8_t P_FIXED[] = {1, 1, 1, 1};
+static const uint8_t P_HALF[] = {1, 0};
+static const uint8_t P_VR[] = {1, 0, 1, 1, 0, 0, 1};
+static const uint8_t P_SPARSE[] = {0, 0, 1};
+
+static const LevelConfig TABLE_A[] = {
+  {3000, 1000, P_FIXED, 4, false},
+  {5000, 800, P_HALF, 2, false},
+  {8000, 700, P_VR, 7, true},
+  {12000, 600, nullptr, 0, false},
+  {20000, 500, P_SPARSE, 3, true},
+};
+static const LevelConfig TABLE_B[] = {
+  {4000, 900, P_VR, 7, false},
+  {9000, 600, P_HALF, 2, true},
+};
+static const LevelConfig TABLE_C[] = {
+  {2500, 1200, P_SPARSE, 3, false},
+};
+
+struct Table {
+  const LevelConfig* levels;
+  uint8_t count;
+};
+static const Table TABLES[] = {{TABLE_A, 5}, {TABLE_B, 2}, {TABLE_C, 1}};
+
+static const uint8_t NEED_SUCCESSES = 3;
+
+enum OpKind : uint8_t {
+  OP_WAIT, OP_TICK, OP_BARK, OP_CONSUME, OP_SET_LEVEL, OP_RESET, OP_RESTART_QUIET,
+  OP_USE_LEVELS, OP_ADAPTIVE, OP_COOLDOWN, OP_REBOOT, OP_KIND_COUNT
+};
+static const char* OP_NAMES[] = {"wait", "tick", "onBark", "consume", "setLevel", "resetState",
+                                 "restartQuiet", "useLevels", "adaptive", "cooldown", "reboot"};
+
+struct Op {
+  OpKind kind;
+  uint32_t arg;   // Wait: ms; setLevel: level; useLevels: table | external<<4;
+  uint32_t arg2;  // adaptive: on; cooldown: ms; reboot: corrupt saved state
+};
+
+static uint32_t rng;
+static uint32_t next() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static std::vector<Op> generate(int steps) {
+  std::vector<Op> ops;
+  for (int i = 0; i < steps; i++) {
+    uint32_t r = next() % 100;
+    Op op{OP_TICK, 0, 0};
+    if (r < 30) op = {OP_WAIT, next() % 4 == 0 ? next() % 30000 : next() % 2000, 0};
+    else if (r < 55) op = {OP_TICK, 0, 0};
+    else if (r < 65) op = {OP_BARK, 0, 0};
+    else if (r < 75) op = {OP_CONSUME, 0, 0};
+    else if (r < 80) op = {OP_SET_LEVEL, next() % 7, 0};
+    else if (r < 83) op = {OP_RESET, 0, 0};
+    else if (r < 86) op = {OP_RESTART_QUIET, 0, 0};
+    else if (r < 90) op = {OP_USE_LEVELS, next() % 3 | (next() % 2) << 4, 0};
+    else if (r < 93) op = {OP_ADAPTIVE, 0, next() % 2};
+    else if (r < 96) op = {OP_COOLDOWN, 0, next() % 15000};
+    else op = {OP_REBOOT, 0, next() % 3 == 0};
+    ops.push_back(op);
+  }
+  return ops;
+}
+
+// One run of a case; returns an empty string or what went wrong and where
+struct Runner {
+  std::unique_ptr<QuietReinforcementManager> mgr;
+  const Table* table = &TABLES[0];
+  bool external = false;
+  bool pending = false;
+  bool haveDispense = false;
+  bool barkSinceReset = false;
+  uint32_t lastDispenseMs = 0;
+  uint32_t cooldownMs = 7000;
+  uint32_t now = 0;
+
+  void boot(bool corrupt) {
+    if (corrupt) {
+      Preferences p;
+      p.begin("qprops");
+      p.putUChar("lvl", next() % 256);
+      p.putUChar("succ", next() % 256);
+      p.putUChar("pidx", next() % 256);
+    }
+    hostSetMillis(now);
+    mgr.reset(new QuietReinforcementManager("qprops", TABLES[0].levels, TABLES[0].count,
+                                            NEED_SUCCESSES, cooldownMs, 1));
+    table = &TABLES[0];
+    external = false;
+    pending = false;
+    haveDispense = false;
+    barkSinceReset = false;
+    mgr->begin();
+  }
+
+  std::string check() {
+    const QuietReinforcementManager& m = *mgr;
+    if (m.levelCount() != table->count) return "level count does not match the table in use";
+    if (m.currentLevel() >= table->count) return "level out of range";
+    if (m.successesAtLevel() >= NEED_SUCCESSES) return "successesAtLevel not below successesToAdvance";
+    const LevelConfig& L = table->levels[m.currentLevel()];
+    if (L.patternLen > 0 && m.patternIndex() >= L.patternLen) return "pattern index out of range";
+    return "";
+  }
+
+  std::string step(const Op& op) {
+    switch (op.kind) {
+      case OP_WAIT:
+        now += op.arg;
+        break;
+      case OP_TICK: {
+        bool predicted = mgr->nextSlotRewards();
+        bool onDeadline = now == mgr->nextDeadlineMs();
+        bool due = now - mgr->nextDeadlineMs() < 0x80000000UL;
+        uint32_t successes = mgr->quietSuccessCount();
+        bool fired = mgr->tick(now);
+        bool succeeded = mgr->quietSuccessCount() != successes;
+        if (pending) {
+          if (fired || succeeded) return "tick() decided again with a dispense still pending";
+          break;
+        }
+        if (due && !succeeded) return "quiet deadline passed without a success";
+        if (!due && succeeded) return "success before the quiet deadline";
+        if (succeeded && predicted && !fired) return "nextSlotRewards() promised a dispense that did not come";
+        if (succeeded && onDeadline && fired && !predicted) return "dispense that nextSlotRewards() did not predict";
+        if (fired) {
+          if (haveDispense && now - lastDispenseMs < cooldownMs) return "dispense inside the cooldown";
+          if (mgr->nextDispenseMs() == 0) return "dispense of 0 ms";
+          pending = true;
+          haveDispense = true;
+          lastDispenseMs = now;
+        }
+        break;
+      }
+      case OP_BARK: {
+        uint32_t intervals = mgr->barkIntervals().count();
+        mgr->onBark(now);
+        if (!barkSinceReset && mgr->barkIntervals().count() != intervals)
+          return "bark interval measured across a reset, pause or reboot";
+        barkSinceReset = true;
+        pending = false;
+        break;
+      }
+      case OP_CONSUME: {
+        uint32_t ms = mgr->consumePendingDispenseMs();
+        if ((ms > 0) != pending) return "consumePendingDispenseMs() disagrees with tick()";
+        pending = false;
+        break;
+      }
+      case OP_SET_LEVEL:
+        mgr->setLevel((uint8_t)op.arg, now);
+        break;
+      case OP_RESET:
+        hostSetMillis(now);
+        mgr->resetState();
+        pending = false;
+        haveDispense = false;
+        barkSinceReset = false;
+        break;
+      case OP_RESTART_QUIET:
+        mgr->restartQuiet(now);
+        barkSinceReset = false;
+        break;
+      case OP_USE_LEVELS:
+        table = &TABLES[op.arg & 0x0F];
+        external = op.arg >> 4;
+        mgr->useLevels(table->levels, table->count, external);
+        break;
+      case OP_ADAPTIVE:
+        mgr->setAdaptiveShaping(op.arg2, 0.7f, 2000, 15000);
+        break;
+      case OP_COOLDOWN:
+        cooldownMs = op.arg2;
+        mgr->setCooldownMs(cooldownMs);
+        break;
+      case OP_REBOOT:
+        cooldownMs = 7000;
+        boot(op.arg2);
+        break;
+      default:
+        break;
+    }
+    return check();
+  }
+
+  // Index of the failing step, or -1
+  int run(const std::vector<Op>& ops, uint32_t start, uint32_t seed, std::string& why) {
+    hostPreferences().clear();
+    rng = seed;
+    srand(seed);
+    now = start;
+    cooldownMs = 7000;
+    boot(false);
+    why = check();
+    if (!why.empty()) return 0;
+    for (size_t i = 0; i < ops.size(); i++) {
+      why = step(ops[i]);
+      if (!why.empty()) return (int)i;
+    }
+    return -1;
+  }
+};
+
+static bool fails(const std::vector<Op>& ops, uint32_t start, uint32_t seed) {
+  Runner r;
+  std::string why;
+  return r.run(ops, start, seed, why) >= 0;
+}
+
+// Delta debugging over steps, then smaller waits
+static std::vector<Op> shrink(std::vector<Op> ops, uint32_t start, uint32_t seed) {
+  Runner r;
+  std::string why;
+  ops.resize(r.run(ops, start, seed, why) + 1);
+  for (size_t chunk = ops.size() / 2; chunk >= 1; chunk /= 2) {
+    for (size_t at = 0; at + chunk <= ops.size();) {
+      std::vector<Op> t = ops;
+      t.erase(t.begin() + at, t.begin() + at + chunk);
+      if (fails(t, start, seed)) ops = t;
+      else at += chunk;
+    }
+  }
+  for (auto& op : ops) {
+    while (op.kind == OP_WAIT && op.arg > 0) {
+      Op saved = op;
+      op.arg /= 2;
+      if (!fails(ops, start, seed)) {
+        op = saved;
+        break;
+      }
+    }
+  }
+  return ops;
+}
+
+static void print(const std::vector<Op>& ops, uint32_t start, uint32_t seed) {
+  Runner r;
+  std::string why;
+  int at = r.run(ops, start, seed, why);
+  printf("  start t=%" PRIu32 ", seed %" PRIu32 "\n", start, seed);
+  for (size_t i = 0; i < ops.size(); i++) {
+    const Op& op = ops[i];
+    printf("  %3zu %-12s", i, OP_NAMES[op.kind]);
+    if (op.kind == OP_WAIT) printf(" %" PRIu32 " ms", op.arg);
+    if (op.kind == OP_SET_LEVEL) printf(" %" PRIu32, op.arg);
+    if (op.kind == OP_USE_LEVELS) printf(" table %u%s", op.arg & 0x0F, op.arg >> 4 ? " external" : "");
+    if (op.kind == OP_ADAPTIVE) printf(" %s", op.arg2 ? "on" : "off");
+    if (op.kind == OP_COOLDOWN) printf(" %" PRIu32 " ms", op.arg2);
+    if (op.kind == OP_REBOOT && op.arg2) printf(" (saved state corrupted)");
+    printf("\n");
+  }
+  printf("  → step %d: %s\n", at, why.c_str());
+}
+
+int main(int argc, char** argv) {
+  int cases = argc > 1 ? atoi(argv[1]) : 2000;
+  int steps = argc > 2 ? atoi(argv[2]) : 300;
+  uint32_t seed = argc > 3 ? (uint32_t)atol(argv[3]) : 1;
+
+  for (int c = 0; c < cases; c++) {
+    uint32_t caseSeed = seed * 2654435761u + c * 40503u + 1;
+    rng = caseSeed;
+    uint32_t start = c % 2 ? 0xFFFFFFFFu - next() % 100000 : next() % 100000;
+    std::vector<Op> ops = generate(steps);
+    if (!fails(ops, start, caseSeed)) continue;
+
+    std::vector<Op> small = shrink(ops, start, caseSeed);
+    printf("FAIL: case %d, shrunk from %zu to %zu steps:\n", c, ops.size(), small.size());
+    print(small, start, caseSeed);
+    return 1;
+  }
+  printf("%d cases × %d steps: all invariants held\n", cases, steps);
+  return 0;
+}
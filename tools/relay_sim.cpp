@@ -0,0 +1,89 @@
+// Host simulation of the bark relay over the loopback transport.
+//
+// Build:  g++ -std=c++17 -O2 -I.. relay_sim.cpp -o relay_sim
+// Usage:  ./relay_sim [units=3] [barks=1000] [drop%=10] [repeats=2]
+//
+// Every unit hears its own random share of barks, relays them and applies
+// the same 5 s bark window as Draft.ino. Reports, per unit, how many barks
+// arrived by relay, duplicates dropped, gaps counted as lost and how many
+// corrections the window suppressed, so relay and dedup changes can be
+// checked without radios. Unit 1 reboots halfway through (new epoch,
+// numbering from 1 again); none of its later barks may count as duplicates.
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "BarkRelay.h"
+
+static const uint32_t BARK_WINDOW_MS = 5000;  // Same as BARK_WINDOW on the device
+
+struct Unit {
+  std::unique_ptr<LoopbackTransport> transport;
+  std::unique_ptr<BarkRelay> relay;
+  uint32_t lastPunishMs = 0;
+  bool punished = false;
+  uint32_t corrections = 0, suppressed = 0, heardLocally = 0;
+
+  bool window(uint32_t now) {
+    if (punished && now - lastPunishMs < BARK_WINDOW_MS) {
+      suppressed++;
+      return false;
+    }
+    punished = true;
+    lastPunishMs = now;
+    corrections++;
+    return true;
+  }
+};
+
+int main(int argc, char** argv) {
+  int units = argc > 1 ? atoi(argv[1]) : 3;
+  int barks = argc > 2 ? atoi(argv[2]) : 1000;
+  int drop = argc > 3 ? atoi(argv[3]) : 10;
+  int repeats = argc > 4 ? atoi(argv[4]) : 2;
+  if (units < 2 || units > LoopbackBus::MAX_NODES) {
+    fprintf(stderr, "units must be 2-%d\n", LoopbackBus::MAX_NODES);
+    return 2;
+  }
+
+  LoopbackBus bus;
+  bus.setDropPercent(drop);
+  std::vector<Unit> u(units);
+  for (int i = 0; i < units; i++) {
+    u[i].transport.reset(new LoopbackTransport(bus, (uint8_t)(i + 1)));
+    u[i].relay.reset(new BarkRelay(*u[i].transport, (uint8_t)repeats));
+    u[i].relay->begin((uint32_t)rand());
+  }
+
+  srand(1);
+  uint32_t now = 1000;
+  for (int b = 0; b < barks; b++) {
+    now += 500 + rand() % 15000;
+    if (b == barks / 2) {
+      u[0].relay.reset(new BarkRelay(*u[0].transport, (uint8_t)repeats));
+      u[0].relay->begin((uint32_t)rand());
+    }
+    // Each bark is heard by one unit, sometimes by two (dog between rooms)
+    int first = rand() % units;
+    int second = (rand() % 4 == 0) ? (first + 1) % units : -1;
+    for (int h : {first, second}) {
+      if (h < 0) continue;
+      u[h].heardLocally++;
+      if (u[h].window(now)) u[h].relay->relay(1, now, now);
+    }
+    for (Unit& x : u) {
+      BarkRelayEvent ev;
+      while (x.relay->poll(ev, now)) x.window(now);
+    }
+  }
+
+  printf("units=%d barks=%d drop=%d%% repeats=%d\n", units, barks, drop, repeats);
+  printf("unit  local  relayed  dup  lost  restarts  corrections  suppressed\n");
+  for (int i = 0; i < units; i++) {
+    const BarkRelay::Stats& s = u[i].relay->stats();
+    printf("%4d %6u %8u %4u %5u %9u %12u %11u\n", i + 1, u[i].heardLocally, s.received,
+           s.duplicates, s.lost, s.restarts, u[i].corrections, u[i].suppressed);
+  }
+  return 0;
+}
@@ -0,0 +1,384 @@
+// Host integration test and drain benchmark for TelemetryPublisher against
+// a real MQTT broker connection.
+//
+// Build:  g++ -std=c++17 -O2 -pthread -Ihost -I.. telemetry_bench.cpp -o telemetry_bench
+// Usage:  ./telemetry_bench [records=3000] [ackDrop%=0] [--broker HOST:PORT]
+//
+// Runs the device publisher on the host shims in tools/host (virtual
+// millis(), LittleFS in a temp dir) against a built-in broker on 127.0.0.1,
+// or against HOST:PORT with a subscriber collecting what arrives
+// (ackDrop% needs the built-in broker). The scenario:
+//
+//   1. Wi-Fi down: `records` events are logged and spilled to the backlog.
+//   2. Wi-Fi up: half of the backlog is drained.
+//   3. Reboot: journal and publisher are recreated, millis() restarts at 0;
+//      the drain must resume at the persisted offset.
+//   4. 200 live events are logged while the rest drains.
+//
+// Fails (exit 1) unless every spilled and every post-reboot event arrives,
+// every backlog batch carries its journal sequence and a send anchor no
+// earlier than its records, and (with no dropped acks) at most one batch
+// is sent twice. Prints the drain time in device time and the throughput.
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include <LittleFS.h>
+#include <WiFi.h>
+#include "TelemetryPublisher.h"
+
+static const uint32_t STEP_MS = 10;          // Device loop period
+static const uint32_t LIVE_RECORDS = 200;
+static const uint32_t LIVE_EVERY_MS = 100;
+static const uint32_t GIVE_UP_MS = 60UL * 60 * 1000;
+
+struct Batch {
+  TelemetryHeader h;
+  std::vector<JournalRecord> recs;
+};
+
+// Everything that reached the broker, in arrival order
+struct Inbox {
+  std::mutex lock;
+  std::vector<Batch> batches;
+
+  void add(const std::string& payload) {
+    if (payload.size() < sizeof(TelemetryHeader)) return;
+    Batch b;
+    memcpy(&b.h, payload.data(), sizeof(b.h));
+    if (b.h.kind != TELEMETRY_EVENTS) return;
+    b.recs.resize((payload.size() - sizeof(b.h)) / sizeof(JournalRecord));
+    memcpy(b.recs.data(), payload.data() + sizeof(b.h), b.recs.size() * sizeof(JournalRecord));
+    std::lock_guard<std::mutex> g(lock);
+    batches.push_back(b);
+  }
+};
+
+static uint32_t idOf(const JournalRecord& r) { return (uint32_t)r.a << 16 | r.b; }
+
+// Payload of a PUBLISH body, and its packet id if QoS 1
+static std::string publishPayload(uint8_t header, const std::string& body, uint16_t& id) {
+  size_t at = 2 + hostmqtt::u16At(body, 0);
+  id = 0;
+  if (header & 0x06) {
+    id = hostmqtt::u16At(body, at);
+    at += 2;
+  }
+  return body.substr(at);
+}
+
+// Just enough broker for one QoS 1 publisher; drops a share of PUBACKs
+class LocalBroker {
+public:
+  LocalBroker(Inbox& inbox, int dropPercent) : _inbox(inbox), _drop(dropPercent) {
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(a);
+    if (bind(_fd, (sockaddr*)&a, len) != 0 || listen(_fd, 4) != 0 ||
+        getsockname(_fd, (sockaddr*)&a, &len) != 0) {
+      perror("broker");
+      exit(2);
+    }
+    _port = ntohs(a.sin_port);
+    _accept = std::thread([this] { _serve(); });
+  }
+
+  ~LocalBroker() {
+    shutdown(_fd, SHUT_RDWR);
+    close(_fd);
+    _accept.join();
+    for (auto& t : _sessions) t.join();
+  }
+
+  uint16_t port() const { return _port; }
+  uint32_t droppedAcks() const { return _dropped; }
+
+private:
+  void _serve() {
+    for (;;) {
+      int c = accept(_fd, nullptr, nullptr);
+      if (c < 0) return;
+      _sessions.emplace_back([this, c] { _session(c); });
+    }
+  }
+
+  void _session(int c) {
+    uint8_t h;
+    std::string body;
+    while (hostmqtt::readPacket(c, h, body)) {
+      switch (h >> 4) {
+        case hostmqtt::CONNECT:
+          hostmqtt::sendPacket(c, hostmqtt::CONNACK << 4, std::string(2, '\0'));
+          break;
+        case hostmqtt::PUBLISH: {
+          uint16_t id;
+          _inbox.add(publishPayload(h, body, id));
+          if (!id) break;
+          if (rand() % 100 < _drop) _dropped++;
+          else hostmqtt::sendPacket(c, hostmqtt::PUBACK << 4, hostmqtt::u16(id));
+          break;
+        }
+        case hostmqtt::PINGREQ:
+          hostmqtt::sendPacket(c, hostmqtt::PINGRESP << 4, "");
+          break;
+      }
+    }
+    close(c);
+  }
+
+  Inbox& _inbox;
+  int _drop;
+  int _fd;
+  uint16_t _port{0};
+  std::atomic<uint32_t> _dropped{0};
+  std::thread _accept;
+  std::vector<std::thread> _sessions;
+};
+
+// Subscriber on an external broker, feeding the inbox
+class Subscriber {
+public:
+  Subscriber(Inbox& inbox, const char* host, uint16_t port, const std::string& filter) : _inbox(inbox) {
+    _fd = hostmqtt::dial(host, port);
+    std::string sub = hostmqtt::u16(1) + hostmqtt::str(filter) + (char)0;
+    uint8_t h;
+    std::string ack;
+    if (_fd < 0 || !hostmqtt::handshake(_fd, "dogapp-bench-sub-" + std::to_string(getpid())) ||
+        !hostmqtt::sendPacket(_fd, hostmqtt::SUBSCRIBE << 4 | 0x02, sub) ||
+        !hostmqtt::readPacket(_fd, h, ack) || h >> 4 != hostmqtt::SUBACK) {
+      fprintf(stderr, "cannot subscribe on %s:%u\n", host, port);
+      exit(2);
+    }
+    _reader = std::thread([this] {
+      uint8_t h;
+      std::string body;
+      uint16_t id;
+      while (hostmqtt::readPacket(_fd, h, body)) {
+        if (h >> 4 == hostmqtt::PUBLISH) _inbox.add(publishPayload(h, body, id));
+      }
+    });
+  }
+
+  ~Subscriber() {
+    shutdown(_fd, SHUT_RDWR);
+    _reader.join();
+    close(_fd);
+  }
+
+private:
+  Inbox& _inbox;
+  int _fd;
+  std::thread _reader;
+};
+
+// Backlog file as the device left it: event ids per chunk
+static bool readBacklog(std::vector<std::vector<uint32_t>>& chunks) {
+  FILE* f = fopen(hostFsPath(TELEMETRY_BACKLOG_PATH).c_str(), "rb");
+  if (!f) return false;
+  TelemetryBacklogChunk c;
+  while (fread(&c, sizeof(c), 1, f) == 1) {
+    if (memcmp(c.magic, "BL", 2) != 0) break;
+    std::vector<JournalRecord> recs(c.count);
+    if (fread(recs.data(), sizeof(JournalRecord), c.count, f) != c.count) break;
+    chunks.emplace_back();
+    for (auto& r : recs) chunks.back().push_back(idOf(r));
+  }
+  fclose(f);
+  return true;
+}
+
+struct Device {
+  std::unique_ptr<EventJournal> journal;
+  std::unique_ptr<TelemetryPublisher> pub;
+
+  void boot(const char* host, uint16_t port, const char* prefix) {
+    pub.reset();  // Closes the old MQTT session first
+    hostSetMillis(0);
+    journal.reset(new EventJournal());
+    pub.reset(new TelemetryPublisher(*journal, "bench", "bench", host, port, prefix));
+    pub->begin();
+  }
+
+  void step() {
+    hostAdvanceMs(STEP_MS);
+    pub->update(millis());
+    std::this_thread::sleep_for(std::chrono::microseconds(50));  // Let PUBACKs land
+  }
+};
+
+static bool fsExists(const char* path) {
+  FILE* f = fopen(hostFsPath(path).c_str(), "rb");
+  if (f) fclose(f);
+  return f != nullptr;
+}
+
+int main(int argc, char** argv) {
+  uint32_t records = 3000;
+  int dropPercent = 0;
+  std::string brokerHost;
+  uint16_t brokerPort = 0;
+  int pos = 0;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--broker") && i + 1 < argc) {
+      std::string hp = argv[++i];
+      size_t colon = hp.find(':');
+      brokerHost = hp.substr(0, colon);
+      brokerPort = colon == std::string::npos ? 1883 : (uint16_t)atoi(hp.c_str() + colon + 1);
+    } else if (pos == 0) {
+      records = (uint32_t)atol(argv[i]), pos++;
+    } else {
+      dropPercent = atoi(argv[i]), pos++;
+    }
+  }
+  if (!brokerHost.empty() && dropPercent) {
+    fprintf(stderr, "ackDrop%% needs the built-in broker\n");
+    return 2;
+  }
+  srand(1);
+
+  char dir[] = "/tmp/telemetry_bench.XXXXXX";
+  if (!mkdtemp(dir)) return 2;
+  hostFsRoot() = dir;
+
+  Inbox inbox;
+  std::unique_ptr<LocalBroker> broker;
+  std::unique_ptr<Subscriber> sub;
+  std::string prefix = "dogapp-bench/" + std::to_string(getpid());
+  if (brokerHost.empty()) {
+    broker.reset(new LocalBroker(inbox, dropPercent));
+    brokerHost = "127.0.0.1";
+    brokerPort = broker->port();
+  } else {
+    sub.reset(new Subscriber(inbox, brokerHost.c_str(), brokerPort, prefix + "/#"));
+  }
+
+  Device dev;
+  dev.boot(brokerHost.c_str(), brokerPort, prefix.c_str());
+
+  // 1. Offline
+  WiFi.up = false;
+  uint32_t nextId = 1;
+  for (uint32_t i = 0; i < records; i++, nextId++) {
+    dev.journal->log(JEV_BARK, (uint8_t)(nextId >> 16), (uint16_t)nextId);
+    for (int s = 0; s < 5; s++) dev.step();
+  }
+  std::vector<std::vector<uint32_t>> chunks;
+  if (!readBacklog(chunks) || chunks.empty()) {
+    printf("FAIL: nothing spilled to the backlog\n");
+    return 1;
+  }
+  std::set<uint32_t> spilled;
+  size_t spilledRecords = 0;
+  for (auto& c : chunks) {
+    spilled.insert(c.begin(), c.end());
+    spilledRecords += c.size();
+  }
+  uint32_t backlogBytes = dev.pub->backlogBytes();
+
+  // 2. Drain half
+  WiFi.up = true;
+  auto wallStart = std::chrono::steady_clock::now();
+  uint32_t drainMs = 0;
+  uint32_t half = backlogBytes / 2, readPos = 0;
+  while (readPos < half && drainMs < GIVE_UP_MS) {
+    dev.step();
+    drainMs += STEP_MS;
+    FILE* f = fopen(hostFsPath(TELEMETRY_BACKLOG_POS_PATH).c_str(), "rb");
+    if (f) {
+      if (fread(&readPos, sizeof(readPos), 1, f) != 1) readPos = 0;
+      fclose(f);
+    }
+  }
+  size_t beforeReboot;
+  {
+    std::lock_guard<std::mutex> g(inbox.lock);
+    beforeReboot = inbox.batches.size();
+  }
+
+  // 3. Reboot, 4. live events while the rest drains
+  dev.boot(brokerHost.c_str(), brokerPort, prefix.c_str());
+  std::set<uint32_t> live;
+  uint32_t sinceLive = 0, rebootMs = 0;
+  bool drained = false;
+  for (uint32_t t = 0; t < GIVE_UP_MS; t += STEP_MS) {
+    if (live.size() < LIVE_RECORDS && (sinceLive += STEP_MS) >= LIVE_EVERY_MS) {
+      sinceLive = 0;
+      live.insert(nextId);
+      dev.journal->log(JEV_BARK, (uint8_t)(nextId >> 16), (uint16_t)nextId);
+      nextId++;
+    }
+    dev.step();
+    if (!drained && dev.pub->backlogBytes() == 0) {
+      drained = true;
+      rebootMs = t + STEP_MS;
+    }
+    if (drained && live.size() == LIVE_RECORDS && dev.journal->nextSeq() > 0) {
+      // Wait for the last partial batch (batch interval) and its ack
+      size_t have = 0;
+      {
+        std::lock_guard<std::mutex> g(inbox.lock);
+        for (auto& b : inbox.batches)
+          for (auto& r : b.recs) have += live.count(idOf(r));
+      }
+      if (have >= LIVE_RECORDS) break;
+    }
+  }
+  double wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  dev.pub.reset();
+  sub.reset();
+  broker.reset();
+
+  // Checks
+  std::lock_guard<std::mutex> g(inbox.lock);
+  std::map<uint32_t, uint32_t> seen;
+  uint32_t unknownSeq = 0, badAnchor = 0, resentAfterReboot = 0;
+  for (size_t i = 0; i < inbox.batches.size(); i++) {
+    const Batch& b = inbox.batches[i];
+    if (b.h.firstSeq == 0xFFFFFFFF) unknownSeq++;
+    bool dup = false;
+    for (auto& r : b.recs) {
+      if (r.tMs > b.h.sentMs) badAnchor++;
+      dup |= seen[idOf(r)]++ > 0;
+    }
+    if (dup && i >= beforeReboot) resentAfterReboot++;
+  }
+  uint32_t missingSpilled = 0, missingLive = 0, dupRecords = 0;
+  for (uint32_t id : spilled) missingSpilled += !seen.count(id);
+  for (uint32_t id : live) missingLive += !seen.count(id);
+  for (auto& s : seen) dupRecords += s.second - 1;
+  uint32_t lostInRam = 0;
+  for (uint32_t id = 1; id <= records; id++) lostInRam += !spilled.count(id) && !seen.count(id);
+
+  drainMs += rebootMs;
+  printf("backlog:   %zu chunks, %zu records, %u bytes\n", chunks.size(), spilledRecords, backlogBytes);
+  printf("batches:   %zu received, %zu before reboot, %u resent after reboot\n",
+         inbox.batches.size(), beforeReboot, resentAfterReboot);
+  printf("records:   %u missing spilled, %u missing live, %u duplicates, %u unsent in RAM at reboot\n",
+         missingSpilled, missingLive, dupRecords, lostInRam);
+  if (broker) printf("acks:      %u dropped\n", broker->droppedAcks());
+  printf("drain:     %.1f s device time, %.0f records/s, %.0f B/s (%.2f s wall)\n", drainMs / 1000.0,
+         spilledRecords * 1000.0 / drainMs, backlogBytes * 1000.0 / drainMs, wallSec);
+
+  bool ok = true;
+  auto fail = [&](bool bad, const char* what) {
+    if (bad) printf("FAIL: %s\n", what);
+    ok &= !bad;
+  };
+  fail(!drained, "backlog never drained");
+  fail(missingSpilled || missingLive, "events lost");
+  fail(unknownSeq, "batch without a journal sequence");
+  fail(badAnchor, "record later than its batch's send anchor");
+  fail(!dropPercent && resentAfterReboot > 1, "drain restarted after reboot");
+  fail(fsExists(TELEMETRY_BACKLOG_PATH) || fsExists(TELEMETRY_BACKLOG_POS_PATH), "backlog files left behind");
+
+  remove(hostFsPath(TELEMETRY_BACKLOG_PATH).c_str());
+  remove(hostFsPath(TELEMETRY_BACKLOG_POS_PATH).c_str());
+  rmdir(dir);
+  printf(ok ? "PASS\n" : "FAIL\n");
+  return ok ? 0 : 1;
+}
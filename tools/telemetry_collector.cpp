@@ -0,0 +1,727 @@
+// Host-side collector for device telemetry: ingest + aggregate queries.
+//
+// Build:  g++ -std=c++17 -O3 telemetry_collector.cpp -o telemetry_collector
+// Usage:  ./telemetry_collector ingest <store> [--device MAC] [--at UNIXSEC] [file|-]...
+//         ./telemetry_collector query <store> barks-per-hour|reward-ratio|time-to-level N|sessions
+//                                     [--device MAC] [--from YYYY-MM-DD] [--to YYYY-MM-DD]
+//
+// Ingest reads either the binary "DJ" payloads published by TelemetryPublisher
+// (back to back, e.g. `mosquitto_sub -t 'dogtrainer/+/+' -N | ... ingest store -`)
+// or a "journal" console dump captured from serial (needs --device).
+//
+// Storage is append-only and columnar, partitioned by device and UTC day:
+//   <store>/<mac>/<YYYY-MM-DD>/t.i64 seq.u32 type.u8 a.u8 b.u16   (events)
+//   <store>/<mac>/<YYYY-MM-DD>/mt.i64 mlevel.u8 mheap.u32          (metrics)
+// Queries read whole columns and scan them with branch-free loops
+// that the compiler vectorizes, so thousands of device-days take milliseconds.
+//
+// Record times are device millis(). Each payload (version 2 on) carries the
+// millis() it was sent at and the device wall clock at that moment, and a
+// journal dump prints the same pair in its header; record times are placed
+// from that pair, however late the batch arrives. Without a device clock
+// (not synced yet, version 1 payloads, old dumps) the send time is taken as
+// the receive time: now for stdin, which is treated as a live feed, and
+// --at UNIXSEC (the wall time the capture was taken) for files. Files
+// without either are not guessed at; those payloads/dumps are skipped.
+//
+// Resent batches are dropped using the per-device last sequence kept in
+// <store>/<mac>/state; re-ingesting the same capture file is not detected.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// ===== Wire format (must match EventJournal.h / TelemetryPublisher.h) =====
+enum : uint8_t {
+  JEV_BOOT = 1, JEV_BARK, JEV_PUNISH, JEV_QUIET_SUCCESS, JEV_REWARD, JEV_LEVEL,
+  JEV_MANUAL_REWARD, JEV_MANUAL_PUNISH, JEV_RESET, JEV_TREAT_DROPPED, JEV_TREAT_FAILED,
+  JEV_FEEDER_JAM, JEV_SESSION_START, JEV_SESSION_END, JEV_SESSION_STAT, JEV_SCHEDULE,
+  JEV_SLEEP, JEV_WAKE, JEV_TYPE_COUNT
+};
+static const char* TYPE_NAMES[JEV_TYPE_COUNT] = {
+  "?", "boot", "bark", "punish", "quiet-success", "reward", "level",
+  "manual-reward", "manual-punish", "reset", "treat-dropped", "treat-failed", "feeder-jam",
+  "session-start", "session-end", "session-stat", "schedule", "sleep", "wake"
+};
+// JEV_SESSION_STAT ids (must match TrainingSession.h)
+enum : uint8_t {
+  SSTAT_DURATION_S = 0, SSTAT_BARKS, SSTAT_REWARDS, SSTAT_PUNISHMENTS, SSTAT_SUCCESSES,
+  SSTAT_LONGEST_QUIET_S, SSTAT_END_LEVEL, SSTAT_LEVEL_S = 16
+};
+
+#pragma pack(push, 1)
+struct JournalRecord {
+  uint32_t tMs;
+  uint8_t  type;
+  uint8_t  a;
+  uint16_t b;
+};
+struct TelemetryHeader {
+  char     magic[2];
+  uint8_t  version;       // 1, 2 with sentMs/sentUnix, 3 with RF quality metrics
+  uint8_t  kind;
+  uint8_t  deviceId[6];
+  uint16_t count;
+  uint32_t firstSeq;
+  uint32_t sentMs;
+  uint32_t sentUnix;
+};
+struct TelemetryMetrics {
+  uint32_t uptimeMs;
+  uint8_t  level;
+  uint8_t  successesAtLevel;
+  uint16_t barkMissPermille;
+  uint32_t quietTargetMs;
+  uint32_t journalSeq;
+  uint32_t barksFused;
+  uint32_t freeHeap;
+  uint32_t backlogBytes;
+  uint32_t droppedRecords;
+  uint32_t treatsDispensed;
+  uint32_t treatsFailed;
+  int8_t   rfSignalQuality;   // Version 3 on
+  uint32_t rfLowQualityRejects;
+};
+#pragma pack(pop)
+static_assert(sizeof(JournalRecord) == 8, "record layout");
+static_assert(sizeof(TelemetryHeader) == 24, "header layout");
+static_assert(sizeof(TelemetryMetrics) == 45, "metrics layout");
+static const size_t HEADER_V1_BYTES = 16;  // Version 1 stops after firstSeq
+static const size_t METRICS_V2_BYTES = 40;  // Versions 1-2 stop after treatsFailed
+
+static const uint8_t KIND_EVENTS = 1, KIND_METRICS = 2;
+static const uint32_t SEQ_UNKNOWN = 0xFFFFFFFF;  // Backlog replays from firmware before chunked backlogs
+static const int64_t MS_PER_HOUR = 3600000;
+static const uint32_t DEVICE_CLOCK_MIN_VALID = 1700000000;  // WALLCLOCK_MIN_VALID on the device
+
+// A device millis() value and the wall time it corresponds to
+struct TimeAnchor {
+  int64_t  wallMs;
+  uint32_t deviceMs;
+
+  int64_t wallFor(uint32_t tMs) const { return wallMs - (int64_t)(uint32_t)(deviceMs - tMs); }
+};
+
+// Column files of one partition
+enum Column { COL_T, COL_SEQ, COL_TYPE, COL_A, COL_B, COL_MT, COL_MLEVEL, COL_MHEAP, COL_COUNT };
+static const char* COLUMN_FILES[COL_COUNT] = {
+  "t.i64", "seq.u32", "type.u8", "a.u8", "b.u16", "mt.i64", "mlevel.u8", "mheap.u32"
+};
+
+static int64_t wallNowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static std::string dayName(int64_t wallMs) {
+  time_t s = (time_t)(wallMs / 1000);
+  struct tm tm;
+  gmtime_r(&s, &tm);
+  char buf[16];
+  strftime(buf, sizeof(buf), "%Y-%m-%d", &tm);
+  return buf;
+}
+
+static std::string macName(const uint8_t* id) {
+  char buf[13];
+  snprintf(buf, sizeof(buf), "%02x%02x%02x%02x%02x%02x", id[0], id[1], id[2], id[3], id[4], id[5]);
+  return buf;
+}
+
+// ===== Append-only column store =====
+class ColumnStore {
+public:
+  explicit ColumnStore(const std::string& root) : _root(root) {}
+  ~ColumnStore() { flush(); for (auto& p : _parts) p.second.close(); }
+
+  // Append one event batch. Resent batches (lost PUBACK) are recognised by
+  // the device sequence and trimmed; a sequence that goes backwards with a
+  // different timestamp is a reboot and starts a new run.
+  void addEvents(const std::string& mac, uint32_t firstSeq, const JournalRecord* r, size_t n,
+                 const TimeAnchor& anchor) {
+    if (n == 0) return;
+    DeviceState& st = _state(mac);
+    size_t skip = 0;
+    if (firstSeq != SEQ_UNKNOWN && st.valid && firstSeq <= st.lastSeq &&
+        st.lastSeq - firstSeq < n && r[st.lastSeq - firstSeq].tMs == st.lastTMs) {
+      skip = st.lastSeq - firstSeq + 1;
+    }
+
+    for (size_t i = skip; i < n; i++) {
+      int64_t t = anchor.wallFor(r[i].tMs);
+      Partition& p = _partition(mac, dayName(t));
+      uint32_t seq = firstSeq == SEQ_UNKNOWN ? SEQ_UNKNOWN : firstSeq + (uint32_t)i;
+      fwrite(&t, sizeof(t), 1, p.col[COL_T]);
+      fwrite(&seq, sizeof(seq), 1, p.col[COL_SEQ]);
+      fwrite(&r[i].type, 1, 1, p.col[COL_TYPE]);
+      fwrite(&r[i].a, 1, 1, p.col[COL_A]);
+      fwrite(&r[i].b, sizeof(r[i].b), 1, p.col[COL_B]);
+      _events++;
+    }
+    _duplicates += skip;
+    if (firstSeq != SEQ_UNKNOWN) {
+      st.valid = true;
+      st.lastSeq = firstSeq + (uint32_t)(n - 1);
+      st.lastTMs = r[n - 1].tMs;
+      _saveState(mac, st);
+    }
+  }
+
+  void addMetrics(const std::string& mac, const TelemetryMetrics& m, int64_t wallMs) {
+    Partition& p = _partition(mac, dayName(wallMs));
+    fwrite(&wallMs, sizeof(wallMs), 1, p.col[COL_MT]);
+    fwrite(&m.level, 1, 1, p.col[COL_MLEVEL]);
+    fwrite(&m.freeHeap, sizeof(m.freeHeap), 1, p.col[COL_MHEAP]);
+    _metrics++;
+  }
+
+  void flush() {
+    for (auto& p : _parts) p.second.flush();
+  }
+
+  size_t events() const { return _events; }
+  size_t metrics() const { return _metrics; }
+  size_t duplicates() const { return _duplicates; }
+
+private:
+  struct Partition {
+    FILE* col[COL_COUNT] = {};
+    void flush() { for (FILE* f : col) if (f) fflush(f); }
+    void close() { for (FILE* f : col) if (f) fclose(f); }
+  };
+  struct DeviceState {
+    bool     valid = false;
+    bool     loaded = false;
+    uint32_t lastSeq = 0;
+    uint32_t lastTMs = 0;
+  };
+
+  Partition& _partition(const std::string& mac, const std::string& day) {
+    std::string key = mac + "/" + day;
+    auto it = _parts.find(key);
+    if (it != _parts.end()) return it->second;
+
+    fs::path dir = fs::path(_root) / mac / day;
+    fs::create_directories(dir);
+    Partition p;
+    for (int c = 0; c < COL_COUNT; c++) {
+      p.col[c] = fopen((dir / COLUMN_FILES[c]).string().c_str(), "ab");
+      if (!p.col[c]) {
+        fprintf(stderr, "cannot open %s/%s\n", dir.string().c_str(), COLUMN_FILES[c]);
+        exit(1);
+      }
+    }
+    return _parts[key] = p;
+  }
+
+  DeviceState& _state(const std::string& mac) {
+    DeviceState& st = _states[mac];
+    if (!st.loaded) {
+      st.loaded = true;
+      FILE* f = fopen((fs::path(_root) / mac / "state").string().c_str(), "r");
+      if (f) {
+        unsigned long seq, tMs;
+        if (fscanf(f, "%lu %lu", &seq, &tMs) == 2) {
+          st.valid = true;
+          st.lastSeq = (uint32_t)seq;
+          st.lastTMs = (uint32_t)tMs;
+        }
+        fclose(f);
+      }
+    }
+    return st;
+  }
+
+  void _saveState(const std::string& mac, const DeviceState& st) {
+    fs::create_directories(fs::path(_root) / mac);
+    FILE* f = fopen((fs::path(_root) / mac / "state").string().c_str(), "w");
+    if (!f) return;
+    fprintf(f, "%lu %lu\n", (unsigned long)st.lastSeq, (unsigned long)st.lastTMs);
+    fclose(f);
+  }
+
+  std::string _root;
+  std::map<std::string, Partition> _parts;
+  std::map<std::string, DeviceState> _states;
+  size_t _events = 0, _metrics = 0, _duplicates = 0;
+};
+
+// ===== Ingest =====
+
+// Stream of back-to-back DJ payloads; resyncs on the magic after garbage.
+// Reads straight from the stream, so a live pipe is stored payload by payload.
+// atMs < 0: no --at given.
+static void ingestBinary(FILE* in, ColumnStore& store, bool magicConsumed, bool live, int64_t atMs) {
+  std::vector<uint8_t> body;
+  size_t skipped = 0, unanchored = 0;
+  for (;;) {
+    if (!magicConsumed) {
+      int c = fgetc(in);
+      if (c == EOF) break;
+      if (c != 'D') { skipped++; continue; }
+      c = fgetc(in);
+      if (c == EOF) break;
+      if (c != 'J') { skipped += 2; continue; }
+    }
+    magicConsumed = false;
+
+    TelemetryHeader h = {};
+    if (fread((uint8_t*)&h + 2, HEADER_V1_BYTES - 2, 1, in) != 1) break;
+    if ((h.version < 1 || h.version > 3) || (h.kind != KIND_EVENTS && h.kind != KIND_METRICS) ||
+        h.count > 1024) {
+      skipped += HEADER_V1_BYTES;
+      continue;
+    }
+    if (h.version >= 2 &&
+        fread((uint8_t*)&h + HEADER_V1_BYTES, sizeof(h) - HEADER_V1_BYTES, 1, in) != 1) {
+      break;
+    }
+
+    size_t len = h.kind == KIND_EVENTS ? h.count * sizeof(JournalRecord)
+                 : h.version >= 3 ? sizeof(TelemetryMetrics) : METRICS_V2_BYTES;
+    body.resize(len);
+    if (len && fread(body.data(), len, 1, in) != 1) break;
+
+    const JournalRecord* recs = (const JournalRecord*)body.data();
+    TelemetryMetrics m = {};
+    if (h.kind == KIND_METRICS) memcpy(&m, body.data(), len);
+
+    TimeAnchor anchor;
+    if (h.version >= 2 && h.sentUnix >= DEVICE_CLOCK_MIN_VALID) {
+      anchor = {(int64_t)h.sentUnix * 1000, h.sentMs};
+    } else {
+      int64_t received = atMs >= 0 ? atMs : live ? wallNowMs() : -1;
+      if (received < 0) {
+        unanchored++;
+        continue;
+      }
+      // Version 1 has no send time: its newest record stands in for it
+      uint32_t sent = h.version >= 2 ? h.sentMs
+                      : h.kind == KIND_EVENTS ? (h.count ? recs[h.count - 1].tMs : 0) : m.uptimeMs;
+      anchor = {received, sent};
+    }
+
+    std::string mac = macName(h.deviceId);
+    if (h.kind == KIND_EVENTS) store.addEvents(mac, h.firstSeq, recs, h.count, anchor);
+    else store.addMetrics(mac, m, anchor.wallFor(m.uptimeMs));
+    store.flush();  // Make each payload visible to queries right away
+  }
+  if (skipped) fprintf(stderr, "skipped %zu bytes of non-payload data\n", skipped);
+  if (unanchored) {
+    fprintf(stderr, "skipped %zu payloads sent before the device clock was set; "
+                    "pass --at UNIXSEC (capture time) to place them\n", unanchored);
+  }
+}
+
+// Records of one dump; each contiguous sequence run is one batch
+static bool storeDump(ColumnStore& store, const std::string& mac, const std::vector<JournalRecord>& recs,
+                      const std::vector<uint32_t>& seqs, bool haveNow, uint32_t nowMs, uint32_t nowUnix,
+                      int64_t atMs) {
+  if (recs.empty()) return true;
+  TimeAnchor anchor;
+  if (haveNow && nowUnix >= DEVICE_CLOCK_MIN_VALID) anchor = {(int64_t)nowUnix * 1000, nowMs};
+  else if (atMs >= 0) anchor = {atMs, haveNow ? nowMs : recs.back().tMs};  // Old dumps: last record at --at
+  else return false;
+
+  size_t start = 0;
+  for (size_t i = 1; i <= recs.size(); i++) {
+    if (i == recs.size() || seqs[i] != seqs[i - 1] + 1) {
+      store.addEvents(mac, seqs[start], &recs[start], i - start, anchor);
+      start = i;
+    }
+  }
+  return true;
+}
+
+// "journal" console dumps: a header "📒 JOURNAL (N records total, now t=MS unix=S):"
+// then "   #12 t=34567 bark          a=1 b=0" lines. Returns the dumps that
+// could not be placed in time.
+static size_t ingestDump(const std::string& text, ColumnStore& store, const std::string& mac,
+                         int64_t atMs) {
+  std::vector<JournalRecord> recs;
+  std::vector<uint32_t> seqs;
+  bool haveNow = false;
+  uint32_t nowMs = 0, nowUnix = 0;
+  size_t unplaced = 0;
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t eol = text.find('\n', pos);
+    if (eol == std::string::npos) eol = text.size();
+    std::string line = text.substr(pos, eol - pos);
+    pos = eol + 1;
+
+    unsigned long seq, tMs;
+    const char* hdr = strstr(line.c_str(), "now t=");
+    if (hdr) {
+      unplaced += !storeDump(store, mac, recs, seqs, haveNow, nowMs, nowUnix, atMs);
+      recs.clear();
+      seqs.clear();
+      unsigned long u = 0;
+      haveNow = sscanf(hdr, "now t=%lu unix=%lu", &tMs, &u) == 2;
+      nowMs = (uint32_t)tMs;
+      nowUnix = (uint32_t)u;
+      continue;
+    }
+    unsigned a, b;
+    char name[32];
+    if (sscanf(line.c_str(), " #%lu t=%lu %31s a=%u b=%u", &seq, &tMs, name, &a, &b) != 5) continue;
+    uint8_t type = 0;
+    for (uint8_t k = 1; k < JEV_TYPE_COUNT; k++) {
+      if (!strcmp(name, TYPE_NAMES[k])) type = k;
+    }
+    if (!type) continue;
+    recs.push_back({(uint32_t)tMs, type, (uint8_t)a, (uint16_t)b});
+    seqs.push_back((uint32_t)seq);
+  }
+  unplaced += !storeDump(store, mac, recs, seqs, haveNow, nowMs, nowUnix, atMs);
+  return unplaced;
+}
+
+static int cmdIngest(int argc, char** argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s ingest <store> [--device MAC] [--at UNIXSEC] [file|-]...\n", argv[0]);
+    return 2;
+  }
+  ColumnStore store(argv[2]);
+  std::string device;
+  int64_t atMs = -1;
+  std::vector<std::string> inputs;
+  for (int i = 3; i < argc; i++) {
+    if (!strcmp(argv[i], "--device") && i + 1 < argc) device = argv[++i];
+    else if (!strcmp(argv[i], "--at") && i + 1 < argc) atMs = atoll(argv[++i]) * 1000;
+    else inputs.push_back(argv[i]);
+  }
+  if (inputs.empty()) inputs.push_back("-");
+
+  for (const std::string& path : inputs) {
+    FILE* in = path == "-" ? stdin : fopen(path.c_str(), "rb");
+    if (!in) {
+      fprintf(stderr, "cannot open %s\n", path.c_str());
+      return 2;
+    }
+    int c0 = fgetc(in);
+    int c1 = c0 == EOF ? EOF : fgetc(in);
+    if (c0 == 'D' && c1 == 'J') {
+      ingestBinary(in, store, true, path == "-", atMs);
+    } else {
+      if (device.size() != 12) {
+        fprintf(stderr, "%s: serial dumps need --device <12 hex digits>\n", path.c_str());
+        return 2;
+      }
+      std::string text;
+      if (c0 != EOF) text += (char)c0;
+      if (c1 != EOF) text += (char)c1;
+      char buf[4096];
+      size_t n;
+      while ((n = fread(buf, 1, sizeof(buf), in)) > 0) text.append(buf, n);
+      if (ingestDump(text, store, device, atMs)) {
+        fprintf(stderr, "%s: dump without a device clock skipped; pass --at UNIXSEC (time of the dump)\n",
+                path.c_str());
+      }
+    }
+    if (in != stdin) fclose(in);
+  }
+
+  store.flush();
+  printf("ingested events=%zu metrics=%zu duplicates=%zu\n",
+         store.events(), store.metrics(), store.duplicates());
+  return 0;
+}
+
+// ===== Queries =====
+
+struct QueryFilter {
+  std::string device;
+  std::string from;  // Inclusive YYYY-MM-DD, empty = open
+  std::string to;
+};
+
+struct PartitionRef {
+  std::string mac;
+  std::string day;
+  fs::path    dir;
+};
+
+// Partitions matching the filter, sorted by device then day
+static std::vector<PartitionRef> listPartitions(const std::string& root, const QueryFilter& f) {
+  std::vector<PartitionRef> out;
+  if (!fs::is_directory(root)) return out;
+  for (const auto& dev : fs::directory_iterator(root)) {
+    if (!dev.is_directory()) continue;
+    std::string mac = dev.path().filename().string();
+    if (!f.device.empty() && mac != f.device) continue;
+    for (const auto& day : fs::directory_iterator(dev.path())) {
+      if (!day.is_directory()) continue;
+      std::string d = day.path().filename().string();
+      if ((!f.from.empty() && d < f.from) || (!f.to.empty() && d > f.to)) continue;
+      out.push_back({mac, d, day.path()});
+    }
+  }
+  std::sort(out.begin(), out.end(), [](const PartitionRef& x, const PartitionRef& y) {
+    return x.mac != y.mac ? x.mac < y.mac : x.day < y.day;
+  });
+  return out;
+}
+
+template <typename T>
+static size_t loadColumn(const fs::path& dir, Column c, std::vector<T>& out) {
+  out.clear();
+  FILE* f = fopen((dir / COLUMN_FILES[c]).string().c_str(), "rb");
+  if (!f) return 0;
+  fseek(f, 0, SEEK_END);
+  long bytes = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  out.resize(bytes > 0 ? bytes / sizeof(T) : 0);
+  size_t n = out.empty() ? 0 : fread(out.data(), sizeof(T), out.size(), f);
+  out.resize(n);
+  fclose(f);
+  return n;
+}
+
+// Branch-free column kernels (auto-vectorized at -O2/-O3)
+static uint64_t countEq(const uint8_t* col, size_t n, uint8_t v) {
+  uint64_t c = 0;
+  for (size_t i = 0; i < n; i++) c += col[i] == v;
+  return c;
+}
+
+static uint32_t activeHourMask(const int64_t* t, size_t n, int64_t dayStart) {
+  uint32_t mask = 0;
+  for (size_t i = 0; i < n; i++) {
+    uint64_t h = (uint64_t)(t[i] - dayStart) / MS_PER_HOUR;
+    mask |= (h < 24 ? 1u : 0u) << (h & 31);
+  }
+  return mask;
+}
+
+static int64_t dayStartMs(const std::string& day) {
+  struct tm tm = {};
+  if (sscanf(day.c_str(), "%d-%d-%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday) != 3) return 0;
+  tm.tm_year -= 1900;
+  tm.tm_mon -= 1;
+  return (int64_t)timegm(&tm) * 1000;
+}
+
+struct ScanStats {
+  size_t partitions = 0;
+  size_t rows = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  void print() const {
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    printf("\nscanned %zu rows in %zu device-days, %.2f ms\n", rows, partitions, ms);
+  }
+};
+
+// Barks per active hour (an hour with any event or metrics report), overall
+// and by hour of day (UTC)
+static void queryBarksPerHour(const std::vector<PartitionRef>& parts) {
+  ScanStats stats;
+  uint64_t barksByHour[24] = {}, activeByHour[24] = {};
+  uint64_t barks = 0, activeHours = 0;
+  std::vector<int64_t> t, mt;
+  std::vector<uint8_t> type;
+
+  for (const PartitionRef& p : parts) {
+    size_t n = loadColumn(p.dir, COL_T, t);
+    loadColumn(p.dir, COL_TYPE, type);
+    size_t m = loadColumn(p.dir, COL_MT, mt);
+    n = std::min(n, type.size());
+    int64_t dayStart = dayStartMs(p.day);
+
+    uint32_t active = activeHourMask(t.data(), n, dayStart) | activeHourMask(mt.data(), m, dayStart);
+    for (size_t i = 0; i < n; i++) {
+      uint64_t h = (uint64_t)(t[i] - dayStart) / MS_PER_HOUR;
+      barksByHour[h < 24 ? h : 23] += type[i] == JEV_BARK;
+    }
+    barks += countEq(type.data(), n, JEV_BARK);
+    for (int h = 0; h < 24; h++) activeByHour[h] += (active >> h) & 1;
+    activeHours += __builtin_popcount(active);
+
+    stats.partitions++;
+    stats.rows += n + m;
+  }
+
+  printf("barks %llu over %llu active hours: %.2f barks/hour\n", (unsigned long long)barks,
+         (unsigned long long)activeHours, activeHours ? (double)barks / activeHours : 0.0);
+  printf("hour(UTC)  barks/hour  device-hours\n");
+  for (int h = 0; h < 24; h++) {
+    if (!activeByHour[h]) continue;
+    printf("   %02d      %8.2f  %12llu\n", h, (double)barksByHour[h] / activeByHour[h],
+           (unsigned long long)activeByHour[h]);
+  }
+  stats.print();
+}
+
+// Manager rewards per quiet success, plus manual vs automatic split
+static void queryRewardRatio(const std::vector<PartitionRef>& parts) {
+  ScanStats stats;
+  static const uint8_t TYPES[] = {
+    JEV_BARK, JEV_PUNISH, JEV_QUIET_SUCCESS, JEV_REWARD, JEV_MANUAL_REWARD, JEV_MANUAL_PUNISH,
+    JEV_TREAT_DROPPED, JEV_TREAT_FAILED
+  };
+  uint64_t counts[JEV_TYPE_COUNT] = {};
+  std::vector<uint8_t> type;
+
+  for (const PartitionRef& p : parts) {
+    size_t n = loadColumn(p.dir, COL_TYPE, type);
+    for (uint8_t k : TYPES) counts[k] += countEq(type.data(), n, k);
+    stats.partitions++;
+    stats.rows += n;
+  }
+
+  for (uint8_t k : TYPES) printf("%-14s %10llu\n", TYPE_NAMES[k], (unsigned long long)counts[k]);
+  uint64_t quiet = counts[JEV_QUIET_SUCCESS], rewards = counts[JEV_REWARD];
+  uint64_t allRewards = rewards + counts[JEV_MANUAL_REWARD];
+  uint64_t allPunish = counts[JEV_PUNISH] + counts[JEV_MANUAL_PUNISH];
+  printf("reward ratio (rewards / quiet successes): %.3f\n", quiet ? (double)rewards / quiet : 0.0);
+  printf("manual share of rewards: %.1f%%, of corrections: %.1f%%\n",
+         allRewards ? 100.0 * counts[JEV_MANUAL_REWARD] / allRewards : 0.0,
+         allPunish ? 100.0 * counts[JEV_MANUAL_PUNISH] / allPunish : 0.0);
+  printf("rewards per correction: %.2f\n", allPunish ? (double)allRewards / allPunish : 0.0);
+  uint64_t treats = counts[JEV_TREAT_DROPPED] + counts[JEV_TREAT_FAILED];
+  if (treats) printf("treat delivery: %.1f%% dropped\n", 100.0 * counts[JEV_TREAT_DROPPED] / treats);
+  stats.print();
+}
+
+// Hours from a device's first record to its first LEVEL event reaching `level`
+static void queryTimeToLevel(const std::vector<PartitionRef>& parts, int level) {
+  ScanStats stats;
+  std::vector<double> hours;
+  std::vector<int64_t> t;
+  std::vector<uint8_t> type, a;
+
+  size_t i = 0;
+  while (i < parts.size()) {
+    const std::string& mac = parts[i].mac;
+    int64_t first = INT64_MAX, reached = -1;
+    for (; i < parts.size() && parts[i].mac == mac; i++) {
+      if (reached >= 0) continue;  // Done with this device, skip its later days
+      size_t n = loadColumn(parts[i].dir, COL_T, t);
+      loadColumn(parts[i].dir, COL_TYPE, type);
+      loadColumn(parts[i].dir, COL_A, a);
+      n = std::min(n, std::min(type.size(), a.size()));
+      stats.partitions++;
+      stats.rows += n;
+      if (n == 0) continue;
+
+      first = std::min(first, *std::min_element(t.begin(), t.begin() + n));
+      for (size_t j = 0; j < n; j++) {
+        if (type[j] == JEV_LEVEL && a[j] >= level && (reached < 0 || t[j] < reached)) reached = t[j];
+      }
+    }
+    if (reached >= 0) {
+      double h = (double)(reached - first) / MS_PER_HOUR;
+      hours.push_back(h);
+      printf("%s  %8.1f h\n", mac.c_str(), h);
+    } else {
+      printf("%s  not reached\n", mac.c_str());
+    }
+  }
+
+  if (!hours.empty()) {
+    std::sort(hours.begin(), hours.end());
+    double sum = 0;
+    for (double h : hours) sum += h;
+    printf("level %d reached by %zu devices: median %.1f h, mean %.1f h\n", level, hours.size(),
+           hours[hours.size() / 2], sum / hours.size());
+  }
+  stats.print();
+}
+
+// One line per session from the summary the device journals at session end
+// (JEV_SESSION_END + its JEV_SESSION_STAT records); raw events are not read
+static void querySessions(const std::vector<PartitionRef>& parts) {
+  ScanStats stats;
+  std::vector<int64_t> t;
+  std::vector<uint8_t> type, a;
+  std::vector<uint16_t> b;
+  uint64_t sessions = 0, barks = 0, rewards = 0, seconds = 0;
+
+  printf("device        end (UTC)         id   min  barks rewards corr  longest-quiet  end-level\n");
+  for (const PartitionRef& p : parts) {
+    size_t n = loadColumn(p.dir, COL_TYPE, type);
+    loadColumn(p.dir, COL_T, t);
+    loadColumn(p.dir, COL_A, a);
+    loadColumn(p.dir, COL_B, b);
+    n = std::min(std::min(n, t.size()), std::min(a.size(), b.size()));
+    stats.partitions++;
+    stats.rows += n;
+
+    for (size_t i = 0; i < n; i++) {
+      if (type[i] != JEV_SESSION_END) continue;
+      uint32_t v[SSTAT_LEVEL_S] = {};
+      for (size_t j = i + 1; j < n && type[j] == JEV_SESSION_STAT; j++) {
+        if (a[j] < SSTAT_LEVEL_S) v[a[j]] = b[j];
+      }
+      time_t end = (time_t)(t[i] / 1000);
+      struct tm tm;
+      gmtime_r(&end, &tm);
+      char when[20];
+      strftime(when, sizeof(when), "%Y-%m-%d %H:%M", &tm);
+      printf("%s  %s  %5u %5.1f %6u %7u %4u %12us %10u\n", p.mac.c_str(), when, b[i],
+             v[SSTAT_DURATION_S] / 60.0, v[SSTAT_BARKS], v[SSTAT_REWARDS], v[SSTAT_PUNISHMENTS],
+             v[SSTAT_LONGEST_QUIET_S], v[SSTAT_END_LEVEL]);
+      sessions++;
+      barks += v[SSTAT_BARKS];
+      rewards += v[SSTAT_REWARDS];
+      seconds += v[SSTAT_DURATION_S];
+    }
+  }
+  printf("%llu sessions, %.1f h: %.2f barks/session, %.2f rewards/session\n",
+         (unsigned long long)sessions, seconds / 3600.0, sessions ? (double)barks / sessions : 0.0,
+         sessions ? (double)rewards / sessions : 0.0);
+  stats.print();
+}
+
+static int cmdQuery(int argc, char** argv) {
+  if (argc < 4) {
+    fprintf(stderr, "usage: %s query <store> barks-per-hour|reward-ratio|time-to-level N|sessions "
+                    "[--device MAC] [--from YYYY-MM-DD] [--to YYYY-MM-DD]\n", argv[0]);
+    return 2;
+  }
+  std::string what = argv[3];
+  int i = 4, level = 0;
+  if (what == "time-to-level") {
+    if (argc < 5) {
+      fprintf(stderr, "time-to-level needs a level\n");
+      return 2;
+    }
+    level = atoi(argv[4]);
+    i = 5;
+  }
+
+  QueryFilter f;
+  for (; i < argc; i++) {
+    if (!strcmp(argv[i], "--device") && i + 1 < argc) f.device = argv[++i];
+    else if (!strcmp(argv[i], "--from") && i + 1 < argc) f.from = argv[++i];
+    else if (!strcmp(argv[i], "--to") && i + 1 < argc) f.to = argv[++i];
+  }
+
+  std::vector<PartitionRef> parts = listPartitions(argv[2], f);
+  if (what == "barks-per-hour") queryBarksPerHour(parts);
+  else if (what == "reward-ratio") queryRewardRatio(parts);
+  else if (what == "time-to-level") queryTimeToLevel(parts, level);
+  else if (what == "sessions") querySessions(parts);
+  else {
+    fprintf(stderr, "unknown query %s\n", what.c_str());
+    return 2;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 2 && !strcmp(argv[1], "ingest")) return cmdIngest(argc, argv);
+  if (argc >= 2 && !strcmp(argv[1], "query")) return cmdQuery(argc, argv);
+  fprintf(stderr, "usage: %s ingest|query <store> ...\n", argv[0]);
+  return 2;
+}
@@ -0,0 +1,349 @@
+// Golden-trace regression check for the actuator drivers.
+//
+// Build:  g++ -std=c++17 -O2 -Ihost -I.. trace_replay.cpp ../FeederController.cpp ../ToneEngine.cpp ../MarkerCue.cpp ../ClickDetector.cpp ../TrainerLoop.cpp -o trace_replay
+// Usage:  ./trace_replay SCENARIO                          print the replayed trace
+//         ./trace_replay SCENARIO --check GOLDEN [--tol-us N]
+//         ./trace_replay --diff GOLDEN CAPTURE [--tol-us N] [--align]
+//
+// Replays a scenario through FeederController and ToneEngine on the host
+// shims (virtual clock, esp_timer callbacks at their exact due times, the
+// drop sensor ISR fired on cue) with loop() every millisecond, and prints
+// the ActuatorTrace in the device's "trace dump" format. --check diffs it
+// against a stored golden trace; --diff compares any two dumps, e.g. a
+// device capture against a golden (--align lines both up on their first
+// edge). Per pin, the edges must match in number and level and each time
+// must be within the tolerance (default 1000 us). Exit status 1 on any
+// difference. Goldens and their scenarios are in tools/golden; after an
+// intended behaviour change, regenerate with
+//   ./trace_replay golden/X.scn > golden/X.trace
+//
+// Scenario lines are "<t_ms> <action> [args]", '#' starts a comment:
+//   cue marker|level_up|reset|correction   stop   hold MASK (CUE_OUT_* bits)
+//   dispense MAX_MS   arm RELEASE_MS MAX_MS   commit   disarm   drop   end
+// The replay runs until `end`, or 2 s after the last action.
+//
+// `sketch` switches to the firmware's own loop: from then on every pass runs
+// the remote, the feeder and TrainerLoop (fused barks, buttons, the quiet
+// manager's rewards, marker and pre-arm, corrections, idle LED) with the
+// sketch's levels and correction ladder, and these inputs go through it:
+//   bark ble|mic     a sensor reports a bark (mic: self-tone check first)
+//   rf [CODE]        one remote frame (the first one teaches the button)
+//   button bark|water|feeder [MS]   held low for MS (default BUTTON_TAP_MS;
+//                    held longer, a press repeats every DEBOUNCE_MS as on the device)
+//   clock MS         the clock runs MS on without a loop pass (timers fire)
+// Actions due while a pass blocks (the water button) run right after it.
+#include <cmath>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "esp_timer.h"
+#include "ActuatorTrace.h"
+#include "FeederController.h"
+#include "ToneEngine.h"
+#include "TrainerLoop.h"
+
+// Same pins as Draft.ino
+static const int waterPin = 13;
+static const int stepPin = 33;
+static const int dirPin = 25;
+static const int enPin = 26;
+static const int vibrationPin = 32;
+static const int ledPin = 2;
+static const int barkButtonPin = 12;
+static const int waterButtonPin = 14;
+static const int feederButtonPin = 27;
+static const int rfRemotePin = 35;
+static const int dropSensorPin = 4;
+static const int buzzerPin = 23;
+
+// Same levels, ladder and windows as Draft.ino
+static const uint8_t P_100[] = {1, 1, 1, 1};
+static const uint8_t P_80[] = {1, 1, 1, 1, 0};
+static LevelConfig LEVELS[] = {
+  {2000, 1200, P_100, sizeof(P_100), false},
+  {4000, 1400, P_100, sizeof(P_100), false},
+  {6000, 1600, P_80, sizeof(P_100), false},
+  {9000, 1800, P_80, sizeof(P_100), false},
+  {12000, 2600, P_80, sizeof(P_100), false},
+};
+static const CorrectionRung CORRECTION_LADDER[] = {
+  {1, CORR_OUT_TONE, 700},
+  {2, CORR_OUT_TONE | CORR_OUT_VIB, 1000},
+  {4, CORR_OUT_ALL, 1500},
+  {6, CORR_OUT_ALL, MANUAL_PUNISH_MS},
+};
+static const uint32_t BARK_WINDOW_MS = 5000;
+static const uint32_t CORRECTION_WINDOW_MS = 120000;
+static const uint32_t REWARD_COOLDOWN_MS = 7000;
+static const uint32_t FUSION_ALIGN_MS = 60;
+
+static const uint32_t BUTTON_TAP_MS = 40;  // Under DEBOUNCE_MS: one press
+static const uint32_t RF_CODE = 0xA5C3E1;  // Any 24-bit code; the remote learns the first one it sees
+
+struct Action {
+  uint32_t tMs;
+  std::string name;
+  std::vector<std::string> args;
+};
+
+static bool loadScenario(const char* path, std::vector<Action>& out) {
+  std::ifstream f(path);
+  if (!f) return false;
+  std::string line;
+  int lineNo = 0;
+  while (std::getline(f, line)) {
+    lineNo++;
+    line = line.substr(0, line.find('#'));
+    std::istringstream in(line);
+    Action a;
+    if (!(in >> a.tMs)) continue;
+    if (!(in >> a.name)) {
+      fprintf(stderr, "%s:%d: action missing\n", path, lineNo);
+      return false;
+    }
+    for (std::string w; in >> w;) a.args.push_back(w);
+    if (!out.empty() && a.tMs < out.back().tMs) {
+      fprintf(stderr, "%s:%d: actions out of order\n", path, lineNo);
+      return false;
+    }
+    out.push_back(a);
+  }
+  return true;
+}
+
+static bool cueByName(const std::string& name, CuePattern& p) {
+  static const std::map<std::string, CuePattern> names = {
+    {"marker", CUE_MARKER}, {"level_up", CUE_LEVEL_UP}, {"reset", CUE_RESET}, {"correction", CUE_CORRECTION}};
+  auto it = names.find(name);
+  if (it == names.end()) return false;
+  p = it->second;
+  return true;
+}
+
+static int buttonPin(const std::string& name) {
+  if (name == "bark") return barkButtonPin;
+  if (name == "water") return waterButtonPin;
+  if (name == "feeder") return feederButtonPin;
+  return -1;
+}
+
+// EV1527-style frame: 24 bits of short/long pairs then a sync gap, sent 4 times
+static std::vector<rmt_item32_t> rfFrame(uint32_t code) {
+  std::vector<rmt_item32_t> items;
+  for (int rep = 0; rep < 4; rep++) {
+    for (int b = 23; b >= 0; b--) {
+      bool one = code >> b & 1;
+      items.push_back({(uint32_t)(one ? 1050 : 350), 1, (uint32_t)(one ? 350 : 1050), 0});
+    }
+    items.push_back({350, 1, 10850, 0});
+  }
+  return items;
+}
+
+// Replay and capture the dump text
+static bool replay(const std::vector<Action>& actions, std::string& dump) {
+  hostSetMillis(0);
+  hostRmtFrames().clear();
+  ActuatorTrace trace;
+  FeederController feeder(trace, stepPin, dirPin, enPin, dropSensorPin);
+  ToneEngine tone(trace, buzzerPin, ledPin, vibrationPin);
+  MarkerCue marker(tone);
+  ClickDetector remote(rfRemotePin);
+  QuietReinforcementManager quietMgr("replay", LEVELS, sizeof(LEVELS) / sizeof(LEVELS[0]), 4,
+                                     REWARD_COOLDOWN_MS, 3, true);
+  BLEBarkWindow barkWindow(BARK_WINDOW_MS);
+  CorrectionPolicy correction(CORRECTION_LADDER, sizeof(CORRECTION_LADDER) / sizeof(CORRECTION_LADDER[0]),
+                              CORRECTION_WINDOW_MS);
+  BarkFusion fusion(FUSION_ANY, FUSION_ALIGN_MS);
+  EventJournal journal;
+  TrainingSession session;
+  TrainingProgram program;
+  TrainerLoop trainer({waterPin, vibrationPin, ledPin, barkButtonPin, waterButtonPin, feederButtonPin}, trace,
+                      feeder, tone, marker, remote, quietMgr, barkWindow, correction, fusion, journal, session,
+                      program);
+  Serial.quiet = true;
+  feeder.begin();
+  tone.begin();
+  marker.begin();
+  marker.setPlanEpochSource([&]() { return quietMgr.planEpoch(); });
+  remote.begin();
+  quietMgr.begin();
+  trainer.begin();
+  trace.start();
+
+  bool sketch = false;
+  std::vector<std::pair<uint32_t, int>> releases;  // Button release time, pin
+  uint32_t endMs = actions.empty() ? 0 : actions.back().tMs + 2000;
+  size_t next = 0;
+  for (uint32_t t = 0; t <= endMs; t = std::max<uint32_t>(t + 1, millis())) {
+    hostRunUntilUs((uint64_t)t * 1000);
+    for (auto it = releases.begin(); it != releases.end();) {
+      if (it->first <= t) {
+        hostPinLevel(it->second) = HIGH;
+        it = releases.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    for (; next < actions.size() && actions[next].tMs <= t; next++) {
+      const Action& a = actions[next];
+      auto arg = [&](size_t i) { return i < a.args.size() ? (uint32_t)atol(a.args[i].c_str()) : 0; };
+      std::string arg0 = a.args.empty() ? "" : a.args[0];
+      CuePattern p;
+      if (a.name == "cue" && cueByName(arg0, p)) tone.play(p);
+      else if (a.name == "stop") tone.stop();
+      else if (a.name == "hold") tone.holdOutputs((uint8_t)arg(0));
+      else if (a.name == "dispense") feeder.dispense(arg(0));
+      else if (a.name == "arm") feeder.arm(arg(0), arg(1), 1);
+      else if (a.name == "commit") feeder.commitArm();
+      else if (a.name == "disarm") feeder.disarm();
+      else if (a.name == "drop" && hostIsr(dropSensorPin)) hostIsr(dropSensorPin)();
+      else if (a.name == "sketch") sketch = true;
+      else if (a.name == "bark" && arg0 == "ble") fusion.report(BARK_SRC_BLE, millis());
+      else if (a.name == "bark" && arg0 == "mic") trainer.onMicBark();
+      else if (a.name == "rf") hostRmtFrames().push_back(rfFrame(a.args.empty() ? RF_CODE : strtoul(arg0.c_str(), 0, 0)));
+      else if (a.name == "button" && buttonPin(arg0) >= 0) {
+        hostPinLevel(buttonPin(arg0)) = LOW;
+        releases.push_back({t + (a.args.size() > 1 ? arg(1) : BUTTON_TAP_MS), buttonPin(arg0)});
+      }
+      else if (a.name == "clock") hostRunUntilUs(hostMicros() + (uint64_t)arg(0) * 1000);
+      else if (a.name == "end") endMs = t;
+      else {
+        fprintf(stderr, "t=%u: unknown action '%s'\n", t, a.name.c_str());
+        return false;
+      }
+    }
+    if (!sketch) {
+      feeder.update();
+      continue;
+    }
+    // loop() order in Draft.ino
+    uint32_t now = millis();
+    remote.update();
+    feeder.update();
+    trainer.updateBarks(now);
+    trainer.update(now);
+    trainer.updateIdleLed(now);
+  }
+
+  // Capture the device's dump output
+  fflush(stdout);
+  char* buf = nullptr;
+  size_t len = 0;
+  FILE* mem = open_memstream(&buf, &len);
+  FILE* saved = stdout;
+  stdout = mem;
+  Serial.quiet = false;
+  trace.dump();
+  fclose(mem);
+  stdout = saved;
+  dump.assign(buf, len);
+  free(buf);
+  return true;
+}
+
+struct Edge {
+  uint32_t tUs;
+  uint16_t level;
+};
+typedef std::map<int, std::vector<Edge>> PinEdges;
+
+static PinEdges parseDump(std::istream& in, uint32_t& firstUs) {
+  PinEdges pins;
+  firstUs = UINT32_MAX;
+  std::string line;
+  while (std::getline(in, line)) {
+    unsigned long t;
+    unsigned pin, level;
+    if (line.empty() || line[0] == '#' || sscanf(line.c_str(), "%lu,%u,%u", &t, &pin, &level) != 3) continue;
+    pins[pin].push_back({(uint32_t)t, (uint16_t)level});
+    if (t < firstUs) firstUs = t;
+  }
+  return pins;
+}
+
+static int diff(std::istream& golden, std::istream& actual, uint32_t tolUs, bool align) {
+  uint32_t g0, a0;
+  PinEdges g = parseDump(golden, g0), a = parseDump(actual, a0);
+  if (!align) g0 = a0 = 0;
+  int problems = 0;
+  std::map<int, bool> pins;
+  for (auto& p : g) pins[p.first] = true;
+  for (auto& p : a) pins[p.first] = true;
+  for (auto& p : pins) {
+    const std::vector<Edge>& ge = g[p.first];
+    const std::vector<Edge>& ae = a[p.first];
+    uint32_t worst = 0;
+    int before = problems;
+    for (size_t i = 0; i < std::max(ge.size(), ae.size()); i++) {
+      if (i >= ge.size() || i >= ae.size()) {
+        printf("pin %d: %zu edges, golden has %zu\n", p.first, ae.size(), ge.size());
+        problems++;
+        break;
+      }
+      if (ge[i].level != ae[i].level) {
+        printf("pin %d edge %zu: level %u at %u us, golden %u at %u us\n", p.first, i, ae[i].level,
+               ae[i].tUs - a0, ge[i].level, ge[i].tUs - g0);
+        problems++;
+        break;
+      }
+      uint32_t dt = (uint32_t)std::abs((int64_t)(ae[i].tUs - a0) - (int64_t)(ge[i].tUs - g0));
+      worst = std::max(worst, dt);
+      if (dt > tolUs) {
+        printf("pin %d edge %zu (level %u): at %u us, golden %u us (off by %u)\n", p.first, i, ae[i].level,
+               ae[i].tUs - a0, ge[i].tUs - g0, dt);
+        problems++;
+      }
+    }
+    if (problems == before) printf("pin %-3d %3zu edges, worst timing difference %u us\n", p.first, ae.size(), worst);
+  }
+  printf(problems ? "MISMATCH (%d)\n" : "match\n", problems);
+  return problems ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  const char* scenario = nullptr;
+  const char* golden = nullptr;
+  const char* capture = nullptr;
+  uint32_t tolUs = 1000;
+  bool align = false;
+  for (int i = 1; i < argc; i++) {
+    std::string a = argv[i];
+    if (a == "--check" && i + 1 < argc) golden = argv[++i];
+    else if (a == "--diff" && i + 2 < argc) golden = argv[++i], capture = argv[++i];
+    else if (a == "--tol-us" && i + 1 < argc) tolUs = (uint32_t)atol(argv[++i]);
+    else if (a == "--align") align = true;
+    else scenario = argv[i];
+  }
+
+  if (capture) {
+    std::ifstream g(golden), c(capture);
+    if (!g || !c) {
+      fprintf(stderr, "cannot read %s or %s\n", golden, capture);
+      return 2;
+    }
+    return diff(g, c, tolUs, align);
+  }
+  if (!scenario) {
+    fprintf(stderr, "usage: %s SCENARIO [--check GOLDEN] [--tol-us N] | --diff GOLDEN CAPTURE\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<Action> actions;
+  std::string dump;
+  if (!loadScenario(scenario, actions) || !replay(actions, dump)) return 2;
+  if (!golden) {
+    fputs(dump.c_str(), stdout);
+    return 0;
+  }
+  std::ifstream g(golden);
+  if (!g) {
+    fprintf(stderr, "cannot read %s\n", golden);
+    return 2;
+  }
+  std::istringstream a(dump);
+  return diff(g, a, tolUs, align);
+}